@@ -0,0 +1,125 @@
+#include "Jahley.h"
+#include <benchmark/benchmark.h>
+#include "BodySpawner.h"
+
+const std::string APP_NAME = "BodySpawner";
+
+// Spawning dynamic bodies that all share one convex hull. Sizes are in thousands of
+// bodies, items per second is bodies per second.
+//
+// oneAtATime is what NewtonBodyHandler did for every geometry instance: copy the shape,
+// work out its mass matrix and add the body. batched goes through BodySpawner.
+// Creating and tearing down the world isn't timed.
+
+using Poses = std::vector<Pose, Eigen::aligned_allocator<Pose>>;
+
+static ndShapeInstance makeHull()
+{
+    std::mt19937 rng (3);
+    std::uniform_real_distribution<float> position (-0.5f, 0.5f);
+
+    const uint32_t pointCount = 64;
+    std::vector<float> points (pointCount * 3);
+    for (float& p : points)
+        p = position (rng);
+
+    return ndShapeInstance (new ndShapeConvexHull (pointCount, 3 * sizeof (float), 0.0f, points.data(), 32));
+}
+
+// a cube of bodies one unit apart, a little turned so the poses aren't all alike
+static Poses makeStack (uint32_t count)
+{
+    uint32_t side = static_cast<uint32_t> (std::ceil (std::cbrt (static_cast<double> (count))));
+
+    Poses poses (count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        Pose pose = Pose::Identity();
+        pose.translate (Eigen::Vector3f (float (i % side), float (i / (side * side)), float ((i / side) % side)));
+        pose.rotate (Eigen::AngleAxisf (0.01f * float (i), Eigen::Vector3f::UnitY()));
+        poses[i] = pose;
+    }
+    return poses;
+}
+
+static void oneAtATime (benchmark::State& s)
+{
+    uint32_t count = static_cast<uint32_t> (s.range (0)) * 1000;
+    ndShapeInstance hull = makeHull();
+    Poses poses = makeStack (count);
+
+    for (auto _ : s)
+    {
+        s.PauseTiming();
+        auto world = std::make_unique<ndWorld>();
+        s.ResumeTiming();
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            ndShapeInstance shape (hull);
+            ndBodyDynamic* const body = new ndBodyDynamic();
+            body->SetCollisionShape (shape);
+            body->SetMassMatrix (1.0f, shape);
+
+            ndMatrix pose;
+            eigenToNewton (poses[i], pose);
+            body->SetMatrix (pose);
+
+            ndSharedPtr<ndBody> bodyPtr (body);
+            world->AddBody (bodyPtr);
+        }
+
+        s.PauseTiming();
+        world.reset();
+        s.ResumeTiming();
+    }
+    s.SetItemsProcessed (s.iterations() * count);
+}
+
+static void batched (benchmark::State& s)
+{
+    uint32_t count = static_cast<uint32_t> (s.range (0)) * 1000;
+    ndShapeInstance hull = makeHull();
+    Poses poses = makeStack (count);
+
+    for (auto _ : s)
+    {
+        s.PauseTiming();
+        auto world = std::make_unique<ndWorld>();
+        s.ResumeTiming();
+
+        std::vector<ndBodyDynamic*> bodies = BodySpawner::create (hull, 1.0f, poses.data(), count);
+        BodySpawner::commit (*world, bodies);
+
+        s.PauseTiming();
+        world.reset();
+        s.ResumeTiming();
+    }
+    s.SetItemsProcessed (s.iterations() * count);
+}
+
+BENCHMARK (oneAtATime)->Arg (1)->Arg (10)->Arg (100)->Unit (benchmark::kMillisecond)->UseRealTime();
+BENCHMARK (batched)->Arg (1)->Arg (10)->Arg (100)->Unit (benchmark::kMillisecond)->UseRealTime();
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        int argc = 1;
+        std::vector<char*> argv;
+        char name[] = "BodySpawner";
+        argv.push_back (name);
+
+        benchmark::Initialize (&argc, argv.data());
+        benchmark::RunSpecifiedBenchmarks();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
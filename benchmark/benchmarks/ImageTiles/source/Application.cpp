@@ -0,0 +1,240 @@
+#include "Jahley.h"
+#include <benchmark/benchmark.h>
+
+const std::string APP_NAME = "ImageTiles";
+
+using mace::ImageRegions;
+using mace::ImageTile;
+using mace::ImageTileRange;
+
+// Viewing a large image: reading all of it against reading only the tiles a
+// viewport or overview needs through an OIIO ImageCache. Every iteration starts
+// from a cold cache. The outputMB counter is what the caller ends up holding and
+// cacheMB is what the cache had resident once the read was done.
+//
+// Test images are written to the temp folder on the first run and reused after:
+// a 16K x 8K scanline RGB TIFF like a stitched panorama, and an 8K x 8K half float
+// RGBA EXR that is tiled and MIP mapped like a baked texture.
+
+static const int PANO_WIDTH = 16384;
+static const int PANO_HEIGHT = 8192;
+static const int TEXTURE_SIZE = 8192;
+static const int VIEW_WIDTH = 1920;
+static const int VIEW_HEIGHT = 1080;
+
+static std::string testImagePath (int64_t which)
+{
+    std::filesystem::path folder = std::filesystem::temp_directory_path() / "ImageTilesBenchmark";
+    std::filesystem::create_directories (folder);
+    return (folder / (which == 0 ? "panorama.tif" : "texture.exr")).generic_string();
+}
+
+static std::string ensureTestImage (int64_t which)
+{
+    std::string path = testImagePath (which);
+    if (std::filesystem::exists (path)) return path;
+
+    if (which == 0)
+    {
+        OIIO::ImageBuf image (OIIO::ImageSpec (PANO_WIDTH, PANO_HEIGHT, 3, OIIO::TypeDesc::UINT8));
+        OIIO::ImageBufAlgo::noise (image, "uniform", 0.0f, 1.0f, false, 7);
+        image.write (path);
+    }
+    else
+    {
+        OIIO::ImageBuf image (OIIO::ImageSpec (TEXTURE_SIZE, TEXTURE_SIZE, 4, OIIO::TypeDesc::HALF));
+        OIIO::ImageBufAlgo::noise (image, "uniform", 0.0f, 1.0f, false, 7);
+
+        OIIO::ImageSpec config;
+        config.tile_width = 64;
+        config.tile_height = 64;
+        config.attribute ("maketx:filtername", "box");
+        OIIO::ImageBufAlgo::make_texture (OIIO::ImageBufAlgo::MakeTxTexture, image, path, config);
+    }
+    return path;
+}
+
+static OIIO::ImageCache* makeCache()
+{
+    OIIO::ImageCache* cache = OIIO::ImageCache::create (false);
+    cache->attribute ("max_memory_MB", 500.0f);
+    cache->attribute ("autotile", 64);
+    cache->attribute ("automip", 1);
+    return cache;
+}
+
+static double cacheMB (OIIO::ImageCache* cache)
+{
+    long long bytes = 0;
+    cache->getattribute ("stat:cache_memory_used", OIIO::TypeDesc::INT64, &bytes);
+    return bytes / (1024.0 * 1024.0);
+}
+
+// what ImageCacheHandler used to do, the whole image through the cache into one buffer
+static void wholeImageGetPixels (benchmark::State& s)
+{
+    std::string path = ensureTestImage (s.range (0));
+    OIIO::ImageCache* cache = makeCache();
+
+    double outputMB = 0.0;
+    double residentMB = 0.0;
+    for (auto _ : s)
+    {
+        OIIO::ImageSpec spec;
+        ImageRegions::getLevelSpec (cache, path, 0, spec);
+        std::vector<std::byte> pixels (spec.image_bytes());
+        ImageRegions::read (cache, path, 0, OIIO::get_roi (spec), spec.format, pixels.data());
+        benchmark::DoNotOptimize (pixels.data());
+
+        outputMB = pixels.size() / (1024.0 * 1024.0);
+        residentMB = cacheMB (cache);
+
+        s.PauseTiming();
+        cache->invalidate_all (true);
+        s.ResumeTiming();
+    }
+    s.counters["outputMB"] = outputMB;
+    s.counters["cacheMB"] = residentMB;
+    OIIO::ImageCache::destroy (cache);
+}
+
+// plain OIIO read of the whole file into local memory, no cache
+static void wholeImageRead (benchmark::State& s)
+{
+    std::string path = ensureTestImage (s.range (0));
+
+    double outputMB = 0.0;
+    for (auto _ : s)
+    {
+        OIIO::ImageBuf image (path);
+        image.read (0, 0, true);
+        benchmark::DoNotOptimize (image.localpixels());
+        outputMB = image.spec().image_bytes() / (1024.0 * 1024.0);
+    }
+    s.counters["outputMB"] = outputMB;
+}
+
+// a screen sized viewport into level 0, panned across the image from one iteration to the next
+static void viewportRegion (benchmark::State& s)
+{
+    std::string path = ensureTestImage (s.range (0));
+    OIIO::ImageCache* cache = makeCache();
+
+    OIIO::ImageSpec spec;
+    ImageRegions::getLevelSpec (cache, path, 0, spec);
+    std::vector<std::byte> pixels (size_t (VIEW_WIDTH) * VIEW_HEIGHT * spec.pixel_bytes());
+
+    int step = 0;
+    double residentMB = 0.0;
+    for (auto _ : s)
+    {
+        int x = (step * 997) % (spec.width - VIEW_WIDTH);
+        int y = (step * 613) % (spec.height - VIEW_HEIGHT);
+        ++step;
+
+        OIIO::ROI roi (x, x + VIEW_WIDTH, y, y + VIEW_HEIGHT, 0, 1, 0, spec.nchannels);
+        ImageRegions::read (cache, path, 0, roi, spec.format, pixels.data());
+        benchmark::DoNotOptimize (pixels.data());
+        residentMB = cacheMB (cache);
+
+        s.PauseTiming();
+        cache->invalidate_all (true);
+        s.ResumeTiming();
+    }
+    s.counters["outputMB"] = pixels.size() / (1024.0 * 1024.0);
+    s.counters["cacheMB"] = residentMB;
+    OIIO::ImageCache::destroy (cache);
+}
+
+// the whole image at screen size, read from the closest MIP level
+static void overviewFromMipLevel (benchmark::State& s)
+{
+    std::string path = ensureTestImage (s.range (0));
+    OIIO::ImageCache* cache = makeCache();
+
+    OIIO::ImageSpec base;
+    ImageRegions::getLevelSpec (cache, path, 0, base);
+    float fit = std::min (float (VIEW_WIDTH) / base.width, float (VIEW_HEIGHT) / base.height);
+
+    double outputMB = 0.0;
+    double residentMB = 0.0;
+    for (auto _ : s)
+    {
+        int miplevel = ImageRegions::chooseMipLevel (cache, path, fit);
+
+        OIIO::ImageSpec spec;
+        ImageRegions::getLevelSpec (cache, path, miplevel, spec);
+        std::vector<std::byte> pixels (spec.image_bytes());
+        ImageRegions::read (cache, path, miplevel, OIIO::get_roi (spec), spec.format, pixels.data());
+        benchmark::DoNotOptimize (pixels.data());
+
+        outputMB = pixels.size() / (1024.0 * 1024.0);
+        residentMB = cacheMB (cache);
+        s.counters["miplevel"] = miplevel;
+
+        s.PauseTiming();
+        cache->invalidate_all (true);
+        s.ResumeTiming();
+    }
+    s.counters["outputMB"] = outputMB;
+    s.counters["cacheMB"] = residentMB;
+    OIIO::ImageCache::destroy (cache);
+}
+
+// visits every pixel of level 0 one tile at a time, nothing is materialized
+static void streamTiles (benchmark::State& s)
+{
+    std::string path = ensureTestImage (s.range (0));
+    OIIO::ImageCache* cache = makeCache();
+
+    double residentMB = 0.0;
+    for (auto _ : s)
+    {
+        uint64_t sum = 0;
+        for (const ImageTile& tile : ImageTileRange (cache, path, 0))
+        {
+            if (!tile.pixels) continue;
+            for (int y = tile.roi.ybegin; y < tile.roi.yend; ++y)
+                sum += static_cast<uint8_t> (*tile.pixel (tile.roi.xbegin, y));
+        }
+        benchmark::DoNotOptimize (sum);
+        residentMB = cacheMB (cache);
+
+        s.PauseTiming();
+        cache->invalidate_all (true);
+        s.ResumeTiming();
+    }
+    s.counters["outputMB"] = 0.0;
+    s.counters["cacheMB"] = residentMB;
+    OIIO::ImageCache::destroy (cache);
+}
+
+// Arg 0 is the scanline TIFF panorama, 1 the tiled and MIP mapped EXR
+BENCHMARK (wholeImageRead)->Arg (0)->Arg (1)->Unit (benchmark::kMillisecond)->UseRealTime()->Iterations (3);
+BENCHMARK (wholeImageGetPixels)->Arg (0)->Arg (1)->Unit (benchmark::kMillisecond)->UseRealTime()->Iterations (3);
+BENCHMARK (viewportRegion)->Arg (0)->Arg (1)->Unit (benchmark::kMillisecond)->UseRealTime()->Iterations (10);
+BENCHMARK (overviewFromMipLevel)->Arg (0)->Arg (1)->Unit (benchmark::kMillisecond)->UseRealTime()->Iterations (3);
+BENCHMARK (streamTiles)->Arg (0)->Arg (1)->Unit (benchmark::kMillisecond)->UseRealTime()->Iterations (3);
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        int argc = 1;
+        std::vector<char*> argv;
+        char name[] = "ImageTiles";
+        argv.push_back (name);
+
+        benchmark::Initialize (&argc, argv.data());
+        benchmark::RunSpecifiedBenchmarks();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
@@ -0,0 +1,92 @@
+#include "Jahley.h"
+#include <benchmark/benchmark.h>
+
+const std::string APP_NAME = "MipChain";
+
+using mace::MipChain;
+using mace::MipChainOptions;
+using mace::MipFilter;
+
+// Full mip chain of a square RGBA image, mace::MipChain against calling
+// OIIO::ImageBufAlgo::resize once per level. OIIO filters in whatever space the
+// pixels are stored in, so for 8 bit images it does less work than the sRGB
+// correct chain, the float runs compare like with like.
+
+static OIIO::ImageBuf makeNoise (int size, OIIO::TypeDesc format)
+{
+    OIIO::ImageBuf image (OIIO::ImageSpec (size, size, 4, format));
+    OIIO::ImageBufAlgo::noise (image, "uniform", 0.0f, 1.0f, false, 7);
+    return image;
+}
+
+static void mipChainBench (benchmark::State& s, OIIO::TypeDesc format, MipFilter filter)
+{
+    OIIO::ImageBuf image = makeNoise (static_cast<int> (s.range (0)), format);
+
+    MipChainOptions options;
+    options.filter = filter;
+
+    for (auto _ : s)
+    {
+        mace::MipChainRef chain = MipChain::build (image, options);
+        benchmark::DoNotOptimize (chain->getLevelData (chain->getLevelCount() - 1));
+    }
+    s.SetItemsProcessed (s.iterations() * s.range (0) * s.range (0));
+}
+
+static void oiioResizeBench (benchmark::State& s, OIIO::TypeDesc format, const std::string& filter)
+{
+    OIIO::ImageBuf image = makeNoise (static_cast<int> (s.range (0)), format);
+
+    for (auto _ : s)
+    {
+        std::vector<OIIO::ImageBuf> levels;
+        const OIIO::ImageBuf* previous = &image;
+        for (int size = static_cast<int> (s.range (0)) / 2; size >= 1; size /= 2)
+        {
+            OIIO::ImageBuf level (OIIO::ImageSpec (size, size, 4, format));
+            OIIO::ImageBufAlgo::resize (level, *previous, filter);
+            levels.push_back (std::move (level));
+            previous = &levels.back();
+        }
+        benchmark::DoNotOptimize (levels.back().localpixels());
+    }
+    s.SetItemsProcessed (s.iterations() * s.range (0) * s.range (0));
+}
+
+static void mipChainBox8 (benchmark::State& s) { mipChainBench (s, OIIO::TypeDesc::UINT8, MipFilter::Box); }
+static void mipChainKaiser8 (benchmark::State& s) { mipChainBench (s, OIIO::TypeDesc::UINT8, MipFilter::Kaiser); }
+static void mipChainBoxFloat (benchmark::State& s) { mipChainBench (s, OIIO::TypeDesc::FLOAT, MipFilter::Box); }
+static void oiioResizeBox8 (benchmark::State& s) { oiioResizeBench (s, OIIO::TypeDesc::UINT8, "box"); }
+static void oiioResizeBoxFloat (benchmark::State& s) { oiioResizeBench (s, OIIO::TypeDesc::FLOAT, "box"); }
+static void oiioResizeDefault8 (benchmark::State& s) { oiioResizeBench (s, OIIO::TypeDesc::UINT8, ""); }
+
+BENCHMARK (mipChainBox8)->RangeMultiplier (2)->Range (512, 4096)->Unit (benchmark::kMillisecond)->UseRealTime();
+BENCHMARK (mipChainKaiser8)->RangeMultiplier (2)->Range (512, 4096)->Unit (benchmark::kMillisecond)->UseRealTime();
+BENCHMARK (mipChainBoxFloat)->RangeMultiplier (2)->Range (512, 4096)->Unit (benchmark::kMillisecond)->UseRealTime();
+BENCHMARK (oiioResizeBox8)->RangeMultiplier (2)->Range (512, 4096)->Unit (benchmark::kMillisecond)->UseRealTime();
+BENCHMARK (oiioResizeBoxFloat)->RangeMultiplier (2)->Range (512, 4096)->Unit (benchmark::kMillisecond)->UseRealTime();
+BENCHMARK (oiioResizeDefault8)->RangeMultiplier (2)->Range (512, 4096)->Unit (benchmark::kMillisecond)->UseRealTime();
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        int argc = 1;
+        std::vector<char*> argv;
+        char name[] = "MipChain";
+        argv.push_back (name);
+
+        benchmark::Initialize (&argc, argv.data());
+        benchmark::RunSpecifiedBenchmarks();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
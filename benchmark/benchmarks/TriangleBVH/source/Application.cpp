@@ -0,0 +1,196 @@
+#include "Jahley.h"
+#include <benchmark/benchmark.h>
+
+const std::string APP_NAME = "TriangleBVH";
+
+using wabi::HitStreamf;
+using wabi::Ray3f;
+using wabi::RayStreamf;
+using wabi::TriangleBVH;
+using wabi::TriangleBVHSettings;
+
+// Building and querying wabi::TriangleBVH. Build sizes are in millions of triangles,
+// items per second is triangles per second for builds and rays per second for queries.
+//
+// The terrain is a displaced grid, close to what scanned and sculpted meshes look like.
+// The soup is small triangles thrown into a box, lots of overlap and a worst case for SAH.
+
+struct Mesh
+{
+    MatrixXf V;
+    MatrixXu F;
+};
+
+static Mesh makeTerrain (uint32_t triangleCount)
+{
+    uint32_t grid = static_cast<uint32_t> (std::sqrt (triangleCount / 2.0));
+
+    Mesh mesh;
+    mesh.V.resize (3, (grid + 1) * (grid + 1));
+    mesh.F.resize (3, 2 * grid * grid);
+    for (uint32_t y = 0; y <= grid; ++y)
+    {
+        for (uint32_t x = 0; x <= grid; ++x)
+        {
+            float u = x * 20.0f / grid - 10.0f;
+            float v = y * 20.0f / grid - 10.0f;
+            mesh.V.col (y * (grid + 1) + x) = Eigen::Vector3f (u, std::sin (u * 2.0f) * std::cos (v * 3.0f), v);
+        }
+    }
+
+    uint32_t f = 0;
+    for (uint32_t y = 0; y < grid; ++y)
+    {
+        for (uint32_t x = 0; x < grid; ++x)
+        {
+            uint32_t corner = y * (grid + 1) + x;
+            mesh.F.col (f++) = Vector3u (corner, corner + 1, corner + grid + 1);
+            mesh.F.col (f++) = Vector3u (corner + 1, corner + grid + 2, corner + grid + 1);
+        }
+    }
+    return mesh;
+}
+
+static Mesh makeSoup (uint32_t triangleCount)
+{
+    std::mt19937 rng (7);
+    std::uniform_real_distribution<float> position (-10.0f, 10.0f);
+    std::uniform_real_distribution<float> offset (-0.2f, 0.2f);
+
+    Mesh mesh;
+    mesh.V.resize (3, triangleCount * 3);
+    mesh.F.resize (3, triangleCount);
+    for (uint32_t i = 0; i < triangleCount; ++i)
+    {
+        Eigen::Vector3f center (position (rng), position (rng), position (rng));
+        for (uint32_t corner = 0; corner < 3; ++corner)
+        {
+            mesh.V.col (i * 3 + corner) = center + Eigen::Vector3f (offset (rng), offset (rng), offset (rng));
+            mesh.F (corner, i) = i * 3 + corner;
+        }
+    }
+    return mesh;
+}
+
+// rays from above aimed down into the middle of the box
+static std::vector<Ray3f> makeRays (uint32_t count)
+{
+    std::mt19937 rng (11);
+    std::uniform_real_distribution<float> position (-10.0f, 10.0f);
+
+    std::vector<Ray3f> rays;
+    rays.reserve (count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        Eigen::Vector3f origin (position (rng), 15.0f, position (rng));
+        Eigen::Vector3f target (position (rng) * 0.5f, 0.0f, position (rng) * 0.5f);
+        rays.emplace_back (origin, target - origin);
+    }
+    return rays;
+}
+
+static void build (benchmark::State& s, const Mesh& mesh, bool parallel)
+{
+    TriangleBVHSettings settings;
+    settings.parallel = parallel;
+
+    TriangleBVH bvh;
+    for (auto _ : s)
+    {
+        bvh.build (mesh.V, mesh.F, settings);
+        benchmark::DoNotOptimize (bvh.getNodes().data());
+    }
+    s.SetItemsProcessed (s.iterations() * mesh.F.cols());
+    s.counters["nodes"] = bvh.getStats().nodeCount;
+    s.counters["depth"] = bvh.getStats().maxDepth;
+    s.counters["sah"] = bvh.getStats().sahCost;
+}
+
+static void buildTerrain (benchmark::State& s) { build (s, makeTerrain (static_cast<uint32_t> (s.range (0)) * 1000000), true); }
+static void buildTerrainSerial (benchmark::State& s) { build (s, makeTerrain (static_cast<uint32_t> (s.range (0)) * 1000000), false); }
+static void buildSoup (benchmark::State& s) { build (s, makeSoup (static_cast<uint32_t> (s.range (0)) * 1000000), true); }
+
+static const uint32_t QUERY_RAYS = 1 << 18;
+
+static void closestHitRays (benchmark::State& s)
+{
+    Mesh mesh = makeTerrain (static_cast<uint32_t> (s.range (0)) * 1000000);
+    TriangleBVH bvh;
+    bvh.build (mesh.V, mesh.F);
+    std::vector<Ray3f> rays = makeRays (QUERY_RAYS);
+
+    for (auto _ : s)
+    {
+        uint32_t hits = 0;
+        for (Ray3f ray : rays)
+            hits += bvh.intersect (ray);
+        benchmark::DoNotOptimize (hits);
+    }
+    s.SetItemsProcessed (s.iterations() * rays.size());
+}
+
+static void closestHitStream (benchmark::State& s)
+{
+    Mesh mesh = makeTerrain (static_cast<uint32_t> (s.range (0)) * 1000000);
+    TriangleBVH bvh;
+    bvh.build (mesh.V, mesh.F);
+
+    RayStreamf rays (QUERY_RAYS);
+    HitStreamf hits (QUERY_RAYS);
+    wabi::toStreams (makeRays (QUERY_RAYS), rays);
+
+    for (auto _ : s)
+    {
+        bvh.intersect (rays, hits);
+        benchmark::DoNotOptimize (hits.t);
+    }
+    s.SetItemsProcessed (s.iterations() * rays.size());
+}
+
+static void anyHitStream (benchmark::State& s)
+{
+    Mesh mesh = makeTerrain (static_cast<uint32_t> (s.range (0)) * 1000000);
+    TriangleBVH bvh;
+    bvh.build (mesh.V, mesh.F);
+
+    RayStreamf rays (QUERY_RAYS);
+    HitStreamf hits (QUERY_RAYS);
+    wabi::toStreams (makeRays (QUERY_RAYS), rays);
+
+    for (auto _ : s)
+    {
+        bvh.intersectAny (rays, hits);
+        benchmark::DoNotOptimize (hits.t);
+    }
+    s.SetItemsProcessed (s.iterations() * rays.size());
+}
+
+BENCHMARK (buildTerrain)->Arg (1)->Arg (4)->Unit (benchmark::kMillisecond)->UseRealTime();
+BENCHMARK (buildTerrainSerial)->Arg (1)->Arg (4)->Unit (benchmark::kMillisecond)->UseRealTime();
+BENCHMARK (buildSoup)->Arg (1)->Unit (benchmark::kMillisecond)->UseRealTime();
+BENCHMARK (closestHitRays)->Arg (1)->Unit (benchmark::kMillisecond)->UseRealTime();
+BENCHMARK (closestHitStream)->Arg (1)->Unit (benchmark::kMillisecond)->UseRealTime();
+BENCHMARK (anyHitStream)->Arg (1)->Unit (benchmark::kMillisecond)->UseRealTime();
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        int argc = 1;
+        std::vector<char*> argv;
+        char name[] = "TriangleBVH";
+        argv.push_back (name);
+
+        benchmark::Initialize (&argc, argv.data());
+        benchmark::RunSpecifiedBenchmarks();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
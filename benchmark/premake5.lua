@@ -25,5 +25,9 @@ end
 	outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 	
 	include "benchmarks/HelloBenchmark"
+	include "benchmarks/MipChain"
+	include "benchmarks/ImageTiles"
+	include "benchmarks/TriangleBVH"
+	include "benchmarks/BodySpawner"
 	
     
\ No newline at end of file
@@ -138,6 +138,10 @@ class InputEvent
     float getScreenMovementX() const { return dx_; }
     float getScreenMovementY() const { return dy_; }
 
+    // size of the widget the mouse coordinates are in, 0 when unknown
+    float getWindowWidth() const { return windowWidth_; }
+    float getWindowHeight() const { return windowHeight_; }
+
     void setX (float x) { mouseX_ = x; }
     void setY (float y) { mouseY_ = y; }
     void setButton (MouseButton button) { button_ = button; }
@@ -147,6 +151,11 @@ class InputEvent
         dx_ = deltaX;
         dy_ = deltaY;
     }
+    void setWindowSize (float width, float height)
+    {
+        windowWidth_ = width;
+        windowHeight_ = height;
+    }
     void setKeyboardModifiers (unsigned int state) { keyState_ = state; }
     void setKey (uint32_t key) { key_ = key; }
     uint32_t getKey() const { return key_; }
@@ -221,6 +230,8 @@ class InputEvent
     uint32_t keyState_ = 0;
     float dx_ = 0.0f;
     float dy_ = 0.0f;
+    float windowWidth_ = 0.0f;
+    float windowHeight_ = 0.0f;
 
     uint32_t key_ = ~0;
     uint32_t scanCode = ~0;
@@ -0,0 +1,127 @@
+MappedFileRef MappedFile::open (const std::filesystem::path& path)
+{
+    MappedFileRef file = std::make_shared<MappedFile>();
+
+#if defined(_WIN32)
+    HANDLE fileHandle = CreateFileW (path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                     OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) return nullptr;
+    file->fileHandle = fileHandle;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx (fileHandle, &fileSize) || fileSize.QuadPart == 0) return nullptr;
+
+    HANDLE mappingHandle = CreateFileMappingW (fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr) return nullptr;
+    file->mappingHandle = mappingHandle;
+
+    void* view = MapViewOfFile (mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) return nullptr;
+
+    file->bytes = static_cast<const uint8_t*> (view);
+    file->byteCount = static_cast<size_t> (fileSize.QuadPart);
+#else
+    int fd = ::open (path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    file->fileDescriptor = fd;
+
+    struct stat info;
+    if (fstat (fd, &info) != 0 || info.st_size == 0) return nullptr;
+
+    void* view = mmap (nullptr, static_cast<size_t> (info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) return nullptr;
+
+    file->bytes = static_cast<const uint8_t*> (view);
+    file->byteCount = static_cast<size_t> (info.st_size);
+#endif
+
+    return file;
+}
+
+MappedFile::~MappedFile()
+{
+#if defined(_WIN32)
+    if (bytes) UnmapViewOfFile (bytes);
+    if (mappingHandle) CloseHandle (mappingHandle);
+    if (fileHandle) CloseHandle (fileHandle);
+#else
+    if (bytes) munmap (const_cast<uint8_t*> (bytes), byteCount);
+    if (fileDescriptor >= 0) close (fileDescriptor);
+#endif
+}
+
+std::filesystem::path uniqueTempPath (const std::filesystem::path& path)
+{
+    // random per process so two instances of the app can't collide either
+    static const uint64_t processTag = (uint64_t (std::random_device{}()) << 32) | std::random_device{}();
+    static std::atomic<uint64_t> counter = 0;
+
+    std::ostringstream suffix;
+    suffix << "." << std::hex << processTag << "." << counter++ << ".tmp";
+
+    std::filesystem::path tempPath (path);
+    tempPath += suffix.str();
+    return tempPath;
+}
+
+uint64_t hashBytes (const void* data, size_t count, uint64_t hash)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*> (data);
+    for (size_t i = 0; i < count; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+uint64_t hashSourceFile (const std::filesystem::path& source)
+{
+    std::error_code error;
+    std::string canonical = std::filesystem::weakly_canonical (source, error).generic_string();
+    if (error) canonical = source.generic_string();
+
+    uint64_t size = std::filesystem::file_size (source, error);
+    if (error) size = 0;
+    int64_t time = std::filesystem::last_write_time (source, error).time_since_epoch().count();
+    if (error) time = 0;
+
+    uint64_t hash = hashBytes (canonical.data(), canonical.size());
+    hash = hashBytes (&size, sizeof (size), hash);
+    return hashBytes (&time, sizeof (time), hash);
+}
+
+bool writeFileAtomically (const std::filesystem::path& path, const std::function<void (std::ofstream& out)>& write)
+{
+    std::filesystem::path tempPath = uniqueTempPath (path);
+    bool complete = false;
+
+    {
+        std::ofstream out (tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        try
+        {
+            write (out);
+        }
+        catch (...)
+        {
+            out.close();
+            std::error_code ec;
+            std::filesystem::remove (tempPath, ec);
+            throw;
+        }
+        complete = static_cast<bool> (out);
+    }
+
+    // a reader may have the old file mapped, losing the race just means no cache this time
+    std::error_code ec;
+    if (complete)
+        std::filesystem::rename (tempPath, path, ec);
+    if (!complete || ec)
+    {
+        std::filesystem::remove (tempPath, ec);
+        return false;
+    }
+    return true;
+}
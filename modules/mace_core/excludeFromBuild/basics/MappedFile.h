@@ -0,0 +1,79 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+// Read only memory mapped file
+// The mapping stays valid for as long as the MappedFile is alive so
+// views into it can be handed out without copying
+using MappedFileRef = std::shared_ptr<class MappedFile>;
+
+class MappedFile : Noncopyable
+{
+ public:
+    // returns nullptr if the file can't be opened or is empty
+    static MappedFileRef open (const std::filesystem::path& path);
+
+ public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return byteCount; }
+
+ private:
+    const uint8_t* bytes = nullptr;
+    size_t byteCount = 0;
+
+#if defined(_WIN32)
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+};
+
+// A sibling of path no other writer will pick, for writing a file and then renaming
+// it over path. Workers caching the same key at once each get their own
+std::filesystem::path uniqueTempPath (const std::filesystem::path& path);
+
+// Helpers shared by the binary caches (.nbmesh, .nbmip, .nbenv)
+
+// FNV-1a, pass the previous result back in to hash several pieces as one
+constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+uint64_t hashBytes (const void* data, size_t count, uint64_t hash = FNV_OFFSET_BASIS);
+
+// sections of a cache file start on this so they can be read in place once it's mapped
+constexpr uint64_t CACHE_FILE_ALIGNMENT = 16;
+inline uint64_t alignCacheOffset (uint64_t offset)
+{
+    return (offset + CACHE_FILE_ALIGNMENT - 1) & ~(CACHE_FILE_ALIGNMENT - 1);
+}
+
+// the canonical path, size and modification time of source hashed, a file that can't
+// be read hashes its path alone. Caches hash their own options on top
+uint64_t hashSourceFile (const std::filesystem::path& source);
+
+// write fills a sibling temp file which is then renamed over path, so a reader only ever
+// maps a complete file. False if anything failed, the temp file is removed then
+bool writeFileAtomically (const std::filesystem::path& path, const std::function<void (std::ofstream& out)>& write);
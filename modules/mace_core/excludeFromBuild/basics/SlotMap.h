@@ -0,0 +1,171 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// Dense array of T addressed through stable handles
+//
+// The values are packed back to back in insertion order and erase() moves the
+// last one into the hole, so iterating is a walk over a plain array and erasing
+// is O(1). Only the element that moved changes its dense index, erase() says
+// which one that was so anything kept in the same order can be fixed up in
+// step. A handle stays valid until its element is erased, the slot's generation
+// then moves on so an old handle is never mistaken for a new element.
+
+struct SlotHandle
+{
+    uint32_t index = std::numeric_limits<uint32_t>::max();
+    uint32_t generation = 0;
+
+    bool operator== (const SlotHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!= (const SlotHandle& other) const { return !(*this == other); }
+};
+
+template <typename T>
+class SlotMap
+{
+ public:
+    static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+ public:
+    SlotMap() = default;
+
+    // appended at the end of the dense array
+    SlotHandle insert (T value)
+    {
+        uint32_t index;
+        if (freeSlots.empty())
+        {
+            index = static_cast<uint32_t> (slots.size());
+            slots.emplace_back();
+        }
+        else
+        {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        }
+
+        slots[index].dense = static_cast<uint32_t> (values.size());
+        values.push_back (std::move (value));
+        denseToSlot.push_back (index);
+
+        return SlotHandle{index, slots[index].generation};
+    }
+
+    // Returns the dense index the last element was moved into,
+    // which is where the erased one was, or npos if nothing moved
+    uint32_t erase (SlotHandle handle)
+    {
+        uint32_t dense = indexOf (handle);
+        uint32_t last = static_cast<uint32_t> (values.size()) - 1;
+
+        uint32_t moved = npos;
+        if (dense != last)
+        {
+            values[dense] = std::move (values[last]);
+            denseToSlot[dense] = denseToSlot[last];
+            slots[denseToSlot[dense]].dense = dense;
+            moved = dense;
+        }
+        values.pop_back();
+        denseToSlot.pop_back();
+
+        Slot& slot = slots[handle.index];
+        slot.dense = npos;
+        ++slot.generation;
+        freeSlots.push_back (handle.index);
+
+        return moved;
+    }
+
+    void clear()
+    {
+        // every outstanding handle goes stale
+        for (uint32_t index : denseToSlot)
+        {
+            slots[index].dense = npos;
+            ++slots[index].generation;
+            freeSlots.push_back (index);
+        }
+        values.clear();
+        denseToSlot.clear();
+    }
+
+    void reserve (size_t count)
+    {
+        values.reserve (count);
+        denseToSlot.reserve (count);
+    }
+
+    bool contains (SlotHandle handle) const
+    {
+        return handle.index < slots.size() && slots[handle.index].generation == handle.generation && slots[handle.index].dense != npos;
+    }
+
+    // dense index of a live handle
+    uint32_t indexOf (SlotHandle handle) const
+    {
+        if (!contains (handle))
+            throw std::runtime_error ("SlotMap handle " + std::to_string (handle.index) + " is stale or invalid");
+        return slots[handle.index].dense;
+    }
+
+    // the handle of the element at a dense index
+    SlotHandle handleAt (uint32_t dense) const
+    {
+        uint32_t index = denseToSlot[dense];
+        return SlotHandle{index, slots[index].generation};
+    }
+
+    T& operator[] (SlotHandle handle) { return values[indexOf (handle)]; }
+    const T& operator[] (SlotHandle handle) const { return values[indexOf (handle)]; }
+
+    // by dense index
+    T& at (uint32_t dense) { return values[dense]; }
+    const T& at (uint32_t dense) const { return values[dense]; }
+
+    uint32_t size() const { return static_cast<uint32_t> (values.size()); }
+    bool empty() const { return values.empty(); }
+
+    T* data() { return values.data(); }
+    const T* data() const { return values.data(); }
+
+    typename std::vector<T>::iterator begin() { return values.begin(); }
+    typename std::vector<T>::iterator end() { return values.end(); }
+    typename std::vector<T>::const_iterator begin() const { return values.begin(); }
+    typename std::vector<T>::const_iterator end() const { return values.end(); }
+
+ private:
+    struct Slot
+    {
+        uint32_t dense = npos;
+        uint32_t generation = 0;
+    };
+
+    std::vector<T> values;
+    std::vector<uint32_t> denseToSlot;
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+
+}; // end class SlotMap
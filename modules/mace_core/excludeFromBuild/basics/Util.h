@@ -350,20 +350,6 @@ struct FileServices
         }
         return "";
     }
-
-    static std::optional<std::filesystem::path> findFileInFolder (
-        const std::filesystem::path& folder,
-        const std::string& filename)
-    {
-        for (const auto& entry : std::filesystem::recursive_directory_iterator (folder))
-        {
-            if (entry.path().filename() == filename)
-            {
-                return entry.path();
-            }
-        }
-        return std::nullopt;
-    }
 };
 
 inline bool hasObjExtension (const std::filesystem::path& filePath)
@@ -0,0 +1,221 @@
+TaskSchedulerSettings TaskScheduler::settings;
+std::atomic<bool> TaskScheduler::created = false;
+thread_local int32_t TaskScheduler::workerIndex = -1;
+
+void TaskScheduler::configure (const TaskSchedulerSettings& newSettings)
+{
+    // the workers are already running with whatever was there before
+    if (created.load (std::memory_order_acquire))
+    {
+        LOG (WARNING) << "TaskScheduler::configure() called after the scheduler started, the settings are ignored";
+        return;
+    }
+    settings = newSettings;
+}
+
+TaskScheduler& TaskScheduler::get()
+{
+    // created on first use and torn down at exit
+    static TaskScheduler scheduler (takeSettings());
+    return scheduler;
+}
+
+const TaskSchedulerSettings& TaskScheduler::takeSettings()
+{
+    created.store (true, std::memory_order_release);
+    return settings;
+}
+
+TaskScheduler::TaskScheduler (const TaskSchedulerSettings& settings)
+{
+    uint32_t hardwareThreads = std::max (1u, std::thread::hardware_concurrency());
+    uint32_t threadCount = settings.threadCount ? settings.threadCount : std::max (1u, hardwareThreads - 1);
+
+    queues.reserve (threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i)
+        queues.push_back (std::make_unique<WorkQueue>());
+
+    workers.reserve (threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        workers.emplace_back (&TaskScheduler::workerLoop, this, i);
+
+        if (settings.pinToCores)
+            pinToCore (workers.back(), (settings.firstCore + i) % hardwareThreads);
+    }
+
+    LOG (DBUG) << "TaskScheduler started with " << threadCount << " worker threads";
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock (sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void TaskScheduler::submit (Task&& task)
+{
+    // workers push onto their own queue so the work stays on a warm cache
+    uint32_t home = workerIndex >= 0 ? static_cast<uint32_t> (workerIndex)
+                                     : nextQueue.fetch_add (1, std::memory_order_relaxed) % queues.size();
+    {
+        std::lock_guard<std::mutex> lock (queues[home]->mutex);
+        queues[home]->tasks.push_back (std::move (task));
+    }
+    queuedTasks.fetch_add (1, std::memory_order_release);
+
+    // take the sleep lock so a worker can't miss the wakeup between its check and its wait
+    {
+        std::lock_guard<std::mutex> lock (sleepMutex);
+    }
+    wake.notify_one();
+
+    // a waitUntil() with nothing to do can help with this
+    if (waitingThreads.load (std::memory_order_acquire) > 0)
+        taskFinished.notify_all();
+}
+
+void TaskScheduler::parallel_for (uint32_t begin, uint32_t end, uint32_t grainSize, const RangeTask& body)
+{
+    if (end <= begin) return;
+
+    uint32_t count = end - begin;
+    if (grainSize == 0)
+        grainSize = std::max (1u, count / (getThreadCount() * 4 + 1));
+
+    uint32_t chunkCount = (count + grainSize - 1) / grainSize;
+    if (chunkCount == 1)
+    {
+        body (begin, end);
+        return;
+    }
+
+    std::atomic<uint32_t> remaining = chunkCount;
+    std::exception_ptr error = nullptr;
+    std::mutex errorMutex;
+
+    auto runChunk = [&] (uint32_t chunk)
+    {
+        uint32_t start = begin + chunk * grainSize;
+        uint32_t stop = std::min (end, start + grainSize);
+        try
+        {
+            body (start, stop);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock (errorMutex);
+            if (!error) error = std::current_exception();
+        }
+
+        // must be the last thing touched, the caller's frame goes away once this hits 0
+        remaining.fetch_sub (1, std::memory_order_acq_rel);
+    };
+
+    for (uint32_t chunk = 1; chunk < chunkCount; ++chunk)
+        submit ([&runChunk, chunk]()
+                { runChunk (chunk); });
+
+    // the calling thread takes the first chunk then helps with the rest
+    runChunk (0);
+    waitUntil ([&remaining]()
+               { return remaining.load (std::memory_order_acquire) == 0; });
+
+    if (error) std::rethrow_exception (error);
+}
+
+void TaskScheduler::waitUntil (const std::function<bool()>& done)
+{
+    uint32_t home = workerIndex >= 0 ? static_cast<uint32_t> (workerIndex) : 0;
+    while (!done())
+    {
+        if (tryRunTask (home)) continue;
+
+        // the rest is running elsewhere, sleep until a task finishes or more is queued
+        std::unique_lock<std::mutex> lock (sleepMutex);
+        waitingThreads.fetch_add (1, std::memory_order_seq_cst);
+        std::atomic_thread_fence (std::memory_order_seq_cst);
+        taskFinished.wait (lock, [&]()
+                           { return done() || queuedTasks.load (std::memory_order_acquire) > 0; });
+        waitingThreads.fetch_sub (1, std::memory_order_relaxed);
+    }
+}
+
+bool TaskScheduler::tryRunTask (uint32_t home)
+{
+    if (queuedTasks.load (std::memory_order_acquire) == 0) return false;
+
+    Task task;
+    uint32_t queueCount = static_cast<uint32_t> (queues.size());
+    for (uint32_t i = 0; i < queueCount && !task; ++i)
+    {
+        uint32_t victim = (home + i) % queueCount;
+        WorkQueue& queue = *queues[victim];
+
+        std::lock_guard<std::mutex> lock (queue.mutex);
+        if (queue.tasks.empty()) continue;
+
+        // LIFO from our own queue, FIFO when stealing
+        if (victim == home)
+        {
+            task = std::move (queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move (queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+
+    if (!task) return false;
+
+    queuedTasks.fetch_sub (1, std::memory_order_acq_rel);
+    task();
+
+    // whatever a sleeping waitUntil() is waiting for may have just happened. The fence
+    // pairs with the one there so either it sees the task's effects or we see it waiting
+    std::atomic_thread_fence (std::memory_order_seq_cst);
+    if (waitingThreads.load (std::memory_order_relaxed) > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock (sleepMutex);
+        }
+        taskFinished.notify_all();
+    }
+    return true;
+}
+
+void TaskScheduler::workerLoop (uint32_t index)
+{
+    workerIndex = static_cast<int32_t> (index);
+
+    while (true)
+    {
+        if (tryRunTask (index)) continue;
+
+        std::unique_lock<std::mutex> lock (sleepMutex);
+        wake.wait (lock, [this]()
+                   { return stopping || queuedTasks.load (std::memory_order_acquire) > 0; });
+
+        if (stopping) return;
+    }
+}
+
+void TaskScheduler::pinToCore (std::thread& thread, uint32_t core)
+{
+#if defined(_WIN32)
+    SetThreadAffinityMask (static_cast<HANDLE> (thread.native_handle()), DWORD_PTR (1) << core);
+#elif defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO (&cpuSet);
+    CPU_SET (core, &cpuSet);
+    pthread_setaffinity_np (thread.native_handle(), sizeof (cpu_set_t), &cpuSet);
+#endif
+}
@@ -0,0 +1,115 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+// Process wide work stealing task scheduler
+// Geometry processing, image caching and the loaders all share this one set of
+// threads instead of creating and destroying a pool per call. Each worker owns a
+// deque, pops its own work LIFO and steals FIFO from the others when it runs dry.
+
+struct TaskSchedulerSettings
+{
+    // 0 means one worker per hardware thread minus the calling thread
+    uint32_t threadCount = 0;
+
+    // pin worker i to logical core firstCore + i
+    bool pinToCores = false;
+    uint32_t firstCore = 0;
+};
+
+class TaskScheduler : Noncopyable
+{
+ public:
+    using Task = std::function<void()>;
+    using RangeTask = std::function<void (uint32_t start, uint32_t end)>;
+
+    // must be called before the first call to get(), later calls are logged and ignored
+    static void configure (const TaskSchedulerSettings& settings);
+    static TaskScheduler& get();
+
+ public:
+    explicit TaskScheduler (const TaskSchedulerSettings& settings);
+    ~TaskScheduler();
+
+    uint32_t getThreadCount() const { return static_cast<uint32_t> (workers.size()); }
+
+    // fire and forget
+    void submit (Task&& task);
+
+    // submit a task and get its result through a future
+    template <typename F>
+    auto async (F&& f) -> std::future<std::invoke_result_t<F>>
+    {
+        using Result = std::invoke_result_t<F>;
+        auto job = std::make_shared<std::packaged_task<Result()>> (std::forward<F> (f));
+        std::future<Result> result = job->get_future();
+        submit ([job]()
+                { (*job)(); });
+        return result;
+    }
+
+    // Splits [begin, end) into chunks of grainSize and calls body (start, end) for each.
+    // A grainSize of 0 picks one that gives every worker a few chunks.
+    // The calling thread runs chunks too so nested calls from inside a task can't deadlock.
+    // The first exception thrown by body is rethrown on the calling thread.
+    void parallel_for (uint32_t begin, uint32_t end, uint32_t grainSize, const RangeTask& body);
+
+    // runs queued tasks on the calling thread until done() returns true, sleeping
+    // whenever there's nothing to help with. done() is checked each time a task
+    // finishes, sometimes under an internal lock, so keep it cheap
+    void waitUntil (const std::function<bool()>& done);
+
+ private:
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<uint32_t> nextQueue = 0;
+    std::atomic<uint32_t> queuedTasks = 0;
+    std::atomic<bool> stopping = false;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+
+    // waitUntil() callers sleeping until a task finishes
+    std::condition_variable taskFinished;
+    std::atomic<uint32_t> waitingThreads = 0;
+
+    static TaskSchedulerSettings settings;
+    static std::atomic<bool> created;
+
+    // index of the worker running on this thread, -1 on threads the scheduler doesn't own
+    static thread_local int32_t workerIndex;
+
+    static const TaskSchedulerSettings& takeSettings();
+    bool tryRunTask (uint32_t home);
+    void workerLoop (uint32_t index);
+    static void pinToCore (std::thread& thread, uint32_t core);
+
+}; // end class TaskScheduler
@@ -0,0 +1,78 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+// Lock free single producer, single consumer triple buffer
+// The writer fills back() and publishes it, the reader picks up the latest
+// published buffer with acquire() and reads front(). Neither side ever waits
+// for the other, the writer just overwrites whatever the reader skipped.
+// The three buffers are swapped by index so T is never copied.
+
+template <typename T>
+class TripleBuffer : Noncopyable
+{
+ public:
+    TripleBuffer() = default;
+
+    // writer side
+    T& back() { return buffers[backIndex]; }
+    void publish()
+    {
+        uint8_t previous = middle.exchange (static_cast<uint8_t> (backIndex | FRESH), std::memory_order_acq_rel);
+        backIndex = previous & INDEX_MASK;
+        ++published;
+    }
+
+    // reader side, true if acquire() will pick up something new
+    bool hasUpdate() const { return middle.load (std::memory_order_acquire) & FRESH; }
+
+    // reader side, false if nothing new was published since the last call
+    bool acquire()
+    {
+        if (!(middle.load (std::memory_order_acquire) & FRESH)) return false;
+
+        uint8_t previous = middle.exchange (frontIndex, std::memory_order_acq_rel);
+        frontIndex = previous & INDEX_MASK;
+        return true;
+    }
+    const T& front() const { return buffers[frontIndex]; }
+    T& front() { return buffers[frontIndex]; }
+
+    // writer side count of publish() calls
+    uint64_t getPublishCount() const { return published; }
+
+    // all three, only while neither side is running
+    T& operator[] (uint32_t i) { return buffers[i]; }
+
+ private:
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t FRESH = 0x4;
+
+    T buffers[3];
+    uint8_t frontIndex = 0;
+    std::atomic<uint8_t> middle = 1;
+    uint8_t backIndex = 2;
+    uint64_t published = 0;
+
+}; // end class TripleBuffer
@@ -0,0 +1,317 @@
+DirectoryIndex::DirectoryIndex (const std::filesystem::path& root, bool caseInsensitive) :
+    root (root),
+    caseInsensitive (caseInsensitive)
+{
+}
+
+std::optional<std::filesystem::path> DirectoryIndex::find (const std::string& filename)
+{
+    std::string key = makeKey (filename);
+
+    std::lock_guard<std::mutex> lock (mutex);
+    if (!built) build();
+
+    auto lookup = [&]() -> std::optional<std::filesystem::path>
+    {
+        auto it = files.find (key);
+        if (it == files.end()) return std::nullopt;
+
+        for (const auto& path : it->second)
+        {
+            std::error_code error;
+            if (std::filesystem::is_regular_file (path, error)) return path;
+        }
+        return std::nullopt;
+    };
+
+    if (auto path = lookup()) return path;
+
+    // maybe the file showed up or moved since the last walk
+    if (std::chrono::steady_clock::now() - lastRefresh < refreshInterval) return std::nullopt;
+    if (!update()) return std::nullopt;
+
+    return lookup();
+}
+
+std::vector<std::filesystem::path> DirectoryIndex::findAll (const std::string& filename)
+{
+    std::string key = makeKey (filename);
+
+    std::lock_guard<std::mutex> lock (mutex);
+    if (!built) build();
+
+    auto it = files.find (key);
+    return it != files.end() ? it->second : std::vector<std::filesystem::path>();
+}
+
+bool DirectoryIndex::refresh()
+{
+    std::lock_guard<std::mutex> lock (mutex);
+    if (!built)
+    {
+        build();
+        return true;
+    }
+    return update();
+}
+
+void DirectoryIndex::setRefreshInterval (std::chrono::milliseconds interval)
+{
+    std::lock_guard<std::mutex> lock (mutex);
+    refreshInterval = interval;
+}
+
+size_t DirectoryIndex::getFileCount()
+{
+    std::lock_guard<std::mutex> lock (mutex);
+    if (!built) build();
+
+    size_t count = 0;
+    for (const auto& it : folders)
+        count += it.second.files.size();
+    return count;
+}
+
+size_t DirectoryIndex::getFolderCount()
+{
+    std::lock_guard<std::mutex> lock (mutex);
+    if (!built) build();
+    return folders.size();
+}
+
+std::string DirectoryIndex::makeKey (const std::string& filename) const
+{
+    std::string key = std::filesystem::path (filename).filename().string();
+    if (caseInsensitive)
+        std::transform (key.begin(), key.end(), key.begin(), [] (unsigned char c)
+                        { return static_cast<char> (std::tolower (c)); });
+    return key;
+}
+
+void DirectoryIndex::build()
+{
+    folders.clear();
+
+    std::error_code error;
+    if (std::filesystem::is_directory (root, error))
+        scan ({root});
+    else
+        LOG (DBUG) << "Not a folder: " << root.generic_string();
+
+    rebuildFileMap();
+    built = true;
+    lastRefresh = std::chrono::steady_clock::now();
+}
+
+bool DirectoryIndex::update()
+{
+    lastRefresh = std::chrono::steady_clock::now();
+
+    std::vector<std::filesystem::path> known;
+    known.reserve (folders.size());
+    for (const auto& it : folders)
+        known.push_back (it.first);
+
+    // one stat per folder, adding, removing or renaming an entry bumps its parent's time
+    // and only those folders get listed again
+    std::vector<std::filesystem::file_time_type> modified (known.size());
+    std::vector<uint8_t> missing (known.size(), 0);
+    forEach (static_cast<uint32_t> (known.size()), [&] (uint32_t i)
+             {
+                 std::error_code error;
+                 modified[i] = std::filesystem::last_write_time (known[i], error);
+                 missing[i] = error ? 1 : 0; });
+
+    bool changed = false;
+    std::vector<std::filesystem::path> stale;
+    for (size_t i = 0; i < known.size(); ++i)
+    {
+        auto it = folders.find (known[i].generic_string());
+        if (it == folders.end()) continue; // went with an ancestor
+
+        if (missing[i])
+        {
+            forget (known[i]);
+            changed = true;
+        }
+        else if (modified[i] != it->second.modified)
+        {
+            stale.push_back (known[i]);
+        }
+    }
+
+    if (stale.size())
+    {
+        std::vector<Folder> listed (stale.size());
+        forEach (static_cast<uint32_t> (stale.size()), [&] (uint32_t i)
+                 { listed[i] = list (stale[i]); });
+
+        std::vector<std::filesystem::path> added;
+        for (size_t i = 0; i < stale.size(); ++i)
+        {
+            auto it = folders.find (stale[i].generic_string());
+            if (it == folders.end()) continue; // an ancestor went away in the meantime
+
+            const auto& before = it->second.subfolders;
+            const auto& after = listed[i].subfolders;
+            for (const auto& folder : before)
+                if (std::find (after.begin(), after.end(), folder) == after.end())
+                    forget (folder);
+            for (const auto& folder : after)
+                if (std::find (before.begin(), before.end(), folder) == before.end())
+                    added.push_back (folder);
+
+            if (before != after || it->second.files != listed[i].files)
+                changed = true;
+
+            it->second = std::move (listed[i]);
+        }
+
+        scan (std::move (added));
+    }
+
+    if (changed) rebuildFileMap();
+    return changed;
+}
+
+void DirectoryIndex::scan (std::vector<std::filesystem::path> level)
+{
+    // breadth first, every folder on a level is listed in parallel
+    while (level.size())
+    {
+        std::vector<Folder> listed (level.size());
+        forEach (static_cast<uint32_t> (level.size()), [&] (uint32_t i)
+                 { listed[i] = list (level[i]); });
+
+        std::vector<std::filesystem::path> next;
+        for (size_t i = 0; i < level.size(); ++i)
+        {
+            next.insert (next.end(), listed[i].subfolders.begin(), listed[i].subfolders.end());
+            folders[level[i].generic_string()] = std::move (listed[i]);
+        }
+        level = std::move (next);
+    }
+}
+
+void DirectoryIndex::forget (const std::filesystem::path& folder)
+{
+    auto it = folders.find (folder.generic_string());
+    if (it == folders.end()) return;
+
+    std::vector<std::filesystem::path> subfolders = std::move (it->second.subfolders);
+    folders.erase (it);
+
+    for (const auto& subfolder : subfolders)
+        forget (subfolder);
+}
+
+void DirectoryIndex::rebuildFileMap()
+{
+    files.clear();
+    for (const auto& it : folders)
+        for (const auto& path : it.second.files)
+            files[makeKey (path.filename().string())].push_back (path);
+
+    // path order so lookups don't depend on the order folders were listed in
+    for (auto& it : files)
+        std::sort (it.second.begin(), it.second.end());
+}
+
+DirectoryIndex::Folder DirectoryIndex::list (const std::filesystem::path& folder)
+{
+    Folder listed;
+
+    std::error_code error;
+    listed.modified = std::filesystem::last_write_time (folder, error);
+
+    // timestamps are coarse on some file systems so a change landing in the same
+    // tick as this listing wouldn't move the time, anything that recent is
+    // treated as unknown and gets listed again on the next refresh
+    auto now = std::filesystem::file_time_type::clock::now();
+    if (!error && now - listed.modified < std::chrono::seconds (2))
+        listed.modified = std::filesystem::file_time_type::min();
+
+    // like recursive_directory_iterator this doesn't follow links to folders
+    std::filesystem::directory_iterator it (folder, std::filesystem::directory_options::skip_permission_denied, error), end;
+    for (; !error && it != end; it.increment (error))
+    {
+        std::error_code typeError;
+        if (it->is_directory (typeError) && !it->is_symlink (typeError))
+            listed.subfolders.push_back (it->path());
+        else if (it->is_regular_file (typeError))
+            listed.files.push_back (it->path());
+    }
+
+    if (error)
+        LOG (DBUG) << "Failed to list " << folder.generic_string() << ": " << error.message();
+
+    return listed;
+}
+
+void DirectoryIndex::forEach (uint32_t count, const std::function<void (uint32_t)>& body)
+{
+    if (count == 0) return;
+
+    struct Work
+    {
+        std::atomic<uint32_t> next = 0;
+        std::atomic<uint32_t> done = 0;
+        uint32_t count = 0;
+        const std::function<void (uint32_t)>* body = nullptr;
+    };
+
+    // shared so workers that only get to run after everything is claimed have something to look at
+    auto work = std::make_shared<Work>();
+    work->count = count;
+    work->body = &body;
+
+    auto drain = [] (Work& work)
+    {
+        for (uint32_t i = work.next.fetch_add (1); i < work.count; i = work.next.fetch_add (1))
+        {
+            (*work.body) (i);
+            work.done.fetch_add (1, std::memory_order_release);
+        }
+    };
+
+    TaskScheduler& scheduler = TaskScheduler::get();
+    uint32_t helpers = std::min (scheduler.getThreadCount(), count - 1);
+    for (uint32_t i = 0; i < helpers; ++i)
+        scheduler.submit ([work, drain]()
+                          { drain (*work); });
+
+    drain (*work);
+
+    // only waits on items a worker has already claimed and is running
+    while (work->done.load (std::memory_order_acquire) < count)
+        std::this_thread::yield();
+}
+
+DirectoryIndexService& DirectoryIndexService::get()
+{
+    static DirectoryIndexService service;
+    return service;
+}
+
+DirectoryIndexRef DirectoryIndexService::getIndex (const std::filesystem::path& root, bool caseInsensitive)
+{
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical (root, error);
+    if (error) canonical = root;
+
+    std::string key = canonical.generic_string() + (caseInsensitive ? "|i" : "");
+
+    // the walk happens on the first lookup, not in here, so one slow root
+    // doesn't hold up everyone asking for a different one
+    std::lock_guard<std::mutex> lock (mutex);
+    DirectoryIndexRef& index = indices[key];
+    if (!index)
+        index = DirectoryIndex::create (canonical, caseInsensitive);
+    return index;
+}
+
+void DirectoryIndexService::clear()
+{
+    std::lock_guard<std::mutex> lock (mutex);
+    indices.clear();
+}
@@ -0,0 +1,127 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+// Filename lookup over a folder tree without rescanning it for every file
+//
+// The tree is walked once, a level at a time with each level's folders listed
+// in parallel, and every file is filed under its filename. Each folder's
+// modification time is recorded so refresh() only relists the folders that had
+// entries added, removed or renamed since the last walk.
+
+using DirectoryIndexRef = std::shared_ptr<class DirectoryIndex>;
+
+class DirectoryIndex : Noncopyable
+{
+ public:
+    static DirectoryIndexRef create (const std::filesystem::path& root, bool caseInsensitive = false)
+    {
+        return std::make_shared<DirectoryIndex> (root, caseInsensitive);
+    }
+
+ public:
+    DirectoryIndex (const std::filesystem::path& root, bool caseInsensitive = false);
+    ~DirectoryIndex() = default;
+
+    // first match in path order, a miss or a match that has since been
+    // deleted triggers a refresh before giving up
+    std::optional<std::filesystem::path> find (const std::string& filename);
+
+    // every indexed file with this name, in path order
+    std::vector<std::filesystem::path> findAll (const std::string& filename);
+
+    // relists folders whose modification time changed, returns true if anything did
+    bool refresh();
+
+    // how long a miss waits after the last refresh before triggering another one,
+    // keeps a run of missing textures from restatting the whole tree each time
+    void setRefreshInterval (std::chrono::milliseconds interval);
+
+    const std::filesystem::path& getRoot() const { return root; }
+    bool isCaseInsensitive() const { return caseInsensitive; }
+    size_t getFileCount();
+    size_t getFolderCount();
+
+ private:
+    struct Folder
+    {
+        std::filesystem::file_time_type modified;
+        std::vector<std::filesystem::path> files;
+        std::vector<std::filesystem::path> subfolders;
+    };
+
+    std::filesystem::path root;
+    bool caseInsensitive = false;
+
+    std::mutex mutex;
+    bool built = false;
+    std::chrono::milliseconds refreshInterval{1000};
+    std::chrono::steady_clock::time_point lastRefresh;
+
+    std::unordered_map<std::string, Folder> folders; // keyed on generic path
+    std::unordered_map<std::string, std::vector<std::filesystem::path>> files;
+
+    std::string makeKey (const std::string& filename) const;
+
+    // caller holds the lock
+    void build();
+    bool update();
+    void scan (std::vector<std::filesystem::path> level);
+    void forget (const std::filesystem::path& folder);
+    void rebuildFileMap();
+
+    static Folder list (const std::filesystem::path& folder);
+
+    // runs body (i) for every i in [0, count) on the calling thread with idle
+    // workers joining in, unlike parallel_for the caller never picks up unrelated
+    // tasks while it waits so it's safe to call with the index locked
+    static void forEach (uint32_t count, const std::function<void (uint32_t)>& body);
+};
+
+// Shares one index per root folder between everything that resolves files,
+// so materials living in the same folder tree trigger a single walk
+class DirectoryIndexService : Noncopyable
+{
+ public:
+    static DirectoryIndexService& get();
+
+ public:
+    DirectoryIndexService() = default;
+    ~DirectoryIndexService() = default;
+
+    DirectoryIndexRef getIndex (const std::filesystem::path& root, bool caseInsensitive = false);
+
+    std::optional<std::filesystem::path> find (const std::filesystem::path& root, const std::string& filename,
+                                               bool caseInsensitive = false)
+    {
+        return getIndex (root, caseInsensitive)->find (filename);
+    }
+
+    // drops every index, the next lookup walks its root again
+    void clear();
+
+ private:
+    std::mutex mutex;
+    std::unordered_map<std::string, DirectoryIndexRef> indices;
+};
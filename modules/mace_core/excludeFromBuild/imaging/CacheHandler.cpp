@@ -1,3 +1,329 @@
 
 #include "berserkpch.h"
 OIIO::ImageCache* ImageCacheHandler::imageCache = nullptr;
+
+ImageCacheHandler::ImageCacheHandler()
+{
+    // Create an image imageCache and set some options
+    imageCache = ImageCache::create();
+    imageCache->attribute ("max_memory_MB", 500.0f);
+    imageCache->attribute ("autotile", 64);
+
+    // files without MIP levels get them built tile by tile when a coarse level is asked for
+    imageCache->attribute ("automip", 1);
+
+    scheduler = &TaskScheduler::get();
+    prefetch = std::make_shared<PrefetchState>();
+    pixelPool = PixelBlockPool::create (settings.frameBudgetBytes);
+}
+
+ImageCacheHandler::~ImageCacheHandler()
+{
+    // queued prefetches skip the decode once closed, wait for the ones already decoding
+    prefetch->closed = true;
+    scheduler->waitUntil ([this]()
+                          { return prefetch->inFlight == 0; });
+
+    info();
+    imagePathSet.clear();
+    ImageCache::destroy (imageCache);
+}
+
+void ImageCacheHandler::info()
+{
+    LOG (DBUG) << imageCache->getstats();
+
+    PixelBlockPool::Stats stats = pixelPool->getStats();
+    LOG (DBUG) << "Frame pool: " << stats.bytesInUse / (1024 * 1024) << " MB in " << stats.blocksInUse
+               << " frames, " << stats.bytesFree / (1024 * 1024) << " MB free, " << stats.reuses << " reuses, "
+               << stats.allocations << " allocations, " << stats.overBudget << " over budget";
+}
+
+void ImageCacheHandler::setPrefetchSettings (const ImagePrefetchSettings& prefetchSettings)
+{
+    settings = prefetchSettings;
+    pixelPool->setByteBudget (settings.frameBudgetBytes);
+}
+
+const std::string& ImageCacheHandler::getImagePath (size_t index)
+{
+    syncImageList();
+    return imagePaths.at (index);
+}
+
+ImageBufRef ImageCacheHandler::getNextImage()
+{
+    syncImageList();
+    if (imagePaths.empty()) return nullptr;
+
+    return getImage (hasCurrent ? (currentIndex + 1) % imagePaths.size() : 0);
+}
+
+ImageBufRef ImageCacheHandler::getPreviousImage()
+{
+    syncImageList();
+    if (imagePaths.empty()) return nullptr;
+
+    size_t count = imagePaths.size();
+    return getImage (hasCurrent ? (currentIndex + count - 1) % count : count - 1);
+}
+
+ImageBufRef ImageCacheHandler::getImage (size_t index)
+{
+    syncImageList();
+    if (index >= imagePaths.size()) return nullptr;
+
+    currentIndex = index;
+    currentPath = imagePaths[index];
+    hasCurrent = true;
+
+    // schedules the image itself too if nobody has started on it yet
+    prefetchAround (index);
+
+    // help out with the queued work instead of blocking if it isn't ready
+    const std::string& path = currentPath;
+    scheduler->waitUntil ([&]()
+                          {
+                              collectFinished();
+                              return frames.contains (path) || !pending.contains (path); });
+
+    auto it = frames.find (path);
+    if (it != frames.end()) return it->second;
+
+    // a prefetch scheduled against an older list or refused by the pool skips it, decode it here
+    ImageBufRef frame = prepareImage (path, true, settings.displayWidth, settings.displayHeight, 0, *pixelPool, false);
+    if (frame) frames[path] = frame;
+    return frame;
+}
+
+ImageBufRef ImageCacheHandler::getCachedImage (const std::string& imagePath, bool fitToScreen)
+{
+    return prepareImage (imagePath, fitToScreen, settings.displayWidth, settings.displayHeight, 0, *pixelPool, false);
+}
+
+ImageBufRef ImageCacheHandler::getRegion (const std::string& imagePath, OIIO::ROI roi, int miplevel, TypeDesc format)
+{
+    ImageSpec spec;
+    if (!ImageRegions::getLevelSpec (imageCache, imagePath, miplevel, spec)) return nullptr;
+
+    roi = ImageRegions::clip (spec, roi);
+    if (roi.width() <= 0 || roi.height() <= 0) return nullptr;
+
+    ImageSpec regionSpec (roi.width(), roi.height(), roi.nchannels(), format == TypeDesc::UNKNOWN ? spec.format : format);
+    regionSpec.x = roi.xbegin;
+    regionSpec.y = roi.ybegin;
+    regionSpec.full_x = spec.full_x;
+    regionSpec.full_y = spec.full_y;
+    regionSpec.full_width = spec.full_width;
+    regionSpec.full_height = spec.full_height;
+
+    auto region = std::make_shared<PooledImage> (pixelPool->acquire (regionSpec.image_bytes()), regionSpec);
+    if (!ImageRegions::read (imageCache, imagePath, miplevel, roi, regionSpec.format, region->block->data()))
+        return nullptr;
+
+    return ImageBufRef (region, &region->image);
+}
+
+void ImageCacheHandler::addImage (const std::string& imagePath)
+{
+    insertPath (imagePath);
+}
+
+void ImageCacheHandler::addImageFolderToCache (const std::string& imageFolder)
+{
+    std::filesystem::path folder (imageFolder);
+
+    if (!std::filesystem::is_directory (folder))
+        throw std::runtime_error ("Invalid folder: " + imageFolder);
+
+    std::vector<std::string> files = FileServices::getFiles (imageFolder, supportedImageFormats(), true);
+
+    for (const auto& path : files)
+    {
+        std::filesystem::path f (path);
+        if (std::filesystem::is_directory (f)) continue;
+
+        insertPath (path);
+    }
+}
+
+void ImageCacheHandler::addImagePathsToCache (const std::vector<std::string>& paths)
+{
+    for (const auto& path : paths)
+    {
+        // Pass on directories
+        std::filesystem::path f (path);
+        if (std::filesystem::is_directory (f)) continue;
+
+        insertPath (path);
+    }
+}
+
+bool ImageCacheHandler::PrefetchState::isWanted (uint32_t index) const
+{
+    uint32_t n = count;
+    if (n == 0 || index >= n) return false;
+
+    uint32_t c = center;
+    uint32_t ahead = (index + n - c) % n;
+    uint32_t behind = (c + n - index) % n;
+    return ahead <= lookAhead || behind <= lookBehind;
+}
+
+void ImageCacheHandler::insertPath (const std::string& imagePath)
+{
+    // decoding waits until the image comes into the prefetch window
+    if (imagePathSet.insert (imagePath).second)
+        imageListDirty = true;
+}
+
+void ImageCacheHandler::syncImageList()
+{
+    if (!imageListDirty) return;
+
+    imagePaths.assign (imagePathSet.begin(), imagePathSet.end());
+    imageListDirty = false;
+
+    // new paths shift the indices, stay on the image we were showing
+    if (hasCurrent)
+    {
+        auto it = std::lower_bound (imagePaths.begin(), imagePaths.end(), currentPath);
+        currentIndex = static_cast<size_t> (std::distance (imagePaths.begin(), it));
+        if (currentIndex >= imagePaths.size()) currentIndex = 0;
+    }
+}
+
+void ImageCacheHandler::collectFinished()
+{
+    PreparedImage prepared;
+    while (prefetch->finished.try_dequeue (prepared))
+    {
+        pending.erase (prepared.path);
+
+        // the window may have moved on while it was decoding
+        if (prepared.image && windowPaths.contains (prepared.path))
+            frames[prepared.path] = std::move (prepared.image);
+    }
+}
+
+void ImageCacheHandler::prefetchAround (size_t index)
+{
+    const uint32_t count = static_cast<uint32_t> (imagePaths.size());
+    const uint32_t ahead = std::min (settings.lookAhead, count - 1);
+    const uint32_t behind = std::min (settings.lookBehind, count - 1 - ahead);
+
+    prefetch->lookAhead = ahead;
+    prefetch->lookBehind = behind;
+    prefetch->count = count;
+    prefetch->center = static_cast<uint32_t> (index);
+
+    // nearest first, the current image, then alternating forward and back
+    std::vector<uint32_t> window;
+    window.reserve (ahead + behind + 1);
+    window.push_back (static_cast<uint32_t> (index));
+    for (uint32_t step = 1; step <= std::max (ahead, behind); ++step)
+    {
+        if (step <= ahead) window.push_back (static_cast<uint32_t> ((index + step) % count));
+        if (step <= behind) window.push_back (static_cast<uint32_t> ((index + count - step) % count));
+    }
+
+    windowPaths.clear();
+    for (uint32_t i : window)
+        windowPaths.insert (imagePaths[i]);
+
+    // drop the frames that fell out of the window
+    std::erase_if (frames, [this] (const auto& frame)
+                   { return !windowPaths.contains (frame.first); });
+
+    // the scheduler runs a worker's own queue LIFO so submit the farthest first
+    for (auto it = window.rbegin(); it != window.rend(); ++it)
+    {
+        const std::string& path = imagePaths[*it];
+        if (frames.contains (path) || pending.contains (path)) continue;
+
+        pending.insert (path);
+        ++prefetch->inFlight;
+
+        scheduler->submit ([state = prefetch, pool = pixelPool, path, i = *it, w = settings.displayWidth, h = settings.displayHeight]()
+                           {
+                               PreparedImage prepared{path, nullptr};
+                               if (!state->closed && state->isWanted (i))
+                                   prepared.image = prepareImage (path, true, w, h, 1, *pool, true);
+
+                               // an explicit producer, the implicit ones outlive the queue in the
+                               // workers' thread locals and get touched again when the threads exit
+                               moodycamel::ProducerToken token (state->finished);
+                               state->finished.enqueue (token, std::move (prepared));
+                               --state->inFlight; });
+    }
+}
+
+ImageBufRef ImageCacheHandler::prepareImage (const std::string& imagePath, bool fitToScreen,
+                                             int displayWidth, int displayHeight, int nthreads,
+                                             PixelBlockPool& pool, bool speculative)
+{
+    try
+    {
+        // shrinking a huge image starts from the MIP level closest to the display,
+        // read through the shared ImageCache so only the tiles resize touches are decoded
+        int miplevel = 0;
+        if (fitToScreen)
+        {
+            ImageSpec base;
+            if (ImageRegions::getLevelSpec (imageCache, imagePath, 0, base) && base.width > 0 && base.height > 0)
+            {
+                float fit = std::min (static_cast<float> (displayWidth) / base.width,
+                                      static_cast<float> (displayHeight) / base.height);
+                miplevel = ImageRegions::chooseMipLevel (imageCache, imagePath, fit);
+            }
+        }
+
+        ImageBuf source (imagePath, 0, miplevel, imageCache);
+        const ImageSpec& spec = source.spec();
+        if (source.has_error() || spec.width <= 0 || spec.height <= 0)
+        {
+            LOG (CRITICAL) << "File read failed!"
+                           << "::" << imagePath << " " << source.geterror();
+            return nullptr;
+        }
+
+        // the display only takes 8 bit or float pixels
+        TypeDesc format = spec.format == TypeDesc::UINT8 ? TypeDesc::UINT8 : TypeDesc::FLOAT;
+
+        float scale = 1.0f;
+        if (fitToScreen)
+        {
+            scale = std::min ({1.0f,
+                               static_cast<float> (displayWidth) / spec.width,
+                               static_cast<float> (displayHeight) / spec.height});
+        }
+
+        int width = std::max (1, static_cast<int> (spec.width * scale + 0.5f));
+        int height = std::max (1, static_cast<int> (spec.height * scale + 0.5f));
+
+        ImageSpec frameSpec (width, height, spec.nchannels, format);
+        size_t bytes = frameSpec.image_bytes();
+        PixelBlockRef block = speculative ? pool.tryAcquire (bytes) : pool.acquire (bytes);
+        if (!block) return nullptr;
+
+        auto frame = std::make_shared<PooledImage> (std::move (block), frameSpec);
+
+        bool ok = width == spec.width && height == spec.height
+                      ? source.get_pixels (ROI::All(), format, frame->block->data())
+                      : ImageBufAlgo::resize (frame->image, source, "", 0.0f, ROI::All(), nthreads);
+        if (!ok)
+        {
+            LOG (CRITICAL) << source.geterror() << frame->image.geterror() << "::" << imagePath;
+            return nullptr;
+        }
+
+        // shares ownership of the block, the pixels stay put for as long as the frame is held
+        return ImageBufRef (frame, &frame->image);
+    }
+    catch (std::exception& e)
+    {
+        LOG (CRITICAL) << e.what();
+    }
+
+    return nullptr;
+}
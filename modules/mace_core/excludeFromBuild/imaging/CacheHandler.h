@@ -26,7 +26,28 @@ SOFTWARE.
 using namespace OIIO;
 
 using ImageCacheHandlerRef = std::shared_ptr<class ImageCacheHandler>;
+using ImageBufRef = std::shared_ptr<const ImageBuf>;
 
+struct ImagePrefetchSettings
+{
+    // neighbours decoded ahead of and behind the current image
+    uint32_t lookAhead = 8;
+    uint32_t lookBehind = 2;
+
+    // images are shrunk to fit inside this, never enlarged
+    int displayWidth = static_cast<int> (DEFAULT_DESKTOP_WINDOW_WIDTH);
+    int displayHeight = static_cast<int> (DEFAULT_DESKTOP_WINDOW_HEIGHT);
+
+    // pixel memory for every frame handed out or prefetched, prefetching stops at the budget
+    size_t frameBudgetBytes = PixelBlockPool::DEFAULT_BYTE_BUDGET;
+};
+
+// Sorted, index addressable list of images for browsing.
+// Every step decodes and resizes the images in a window around the current one on
+// the TaskScheduler, finished frames come back through a lock free queue that the
+// browsing thread drains, so flipping to a neighbour normally doesn't wait at all.
+// Frames live in blocks from a budgeted PixelBlockPool and pin them for as long as
+// they're held. Not thread safe, use it from one thread.
 class ImageCacheHandler
 {
  public:
@@ -34,170 +55,111 @@ class ImageCacheHandler
     using CachedImageSet = std::set<std::string>;
 
  public:
-    ImageCacheHandler()
-    {
-        // Create an image imageCache and set some options
-        imageCache = ImageCache::create();
-        imageCache->attribute ("max_memory_MB", 500.0f);
-        imageCache->attribute ("autotile", 64);
+    ImageCacheHandler();
+    ~ImageCacheHandler();
 
-        threadPool = OIIO::default_thread_pool();
-    }
-    ~ImageCacheHandler()
-    {
-        info();
-        imagePathSet.clear();
-        ImageCache::destroy (imageCache);
-    }
+    void info();
 
-    void info()
-    {
-        LOG (DBUG) << imageCache->getstats();
-    }
+    // a new window takes effect on the next step
+    void setPrefetchSettings (const ImagePrefetchSettings& prefetchSettings);
+    const ImagePrefetchSettings& getPrefetchSettings() const { return settings; }
 
     size_t getCachedImageCount() { return imagePathSet.size(); }
 
-    ImageBuf getNextImage()
-    {
-        size_t imageCount = imagePathSet.size();
+    // position in the sorted list of the image returned last
+    size_t getCurrentIndex() const { return currentIndex; }
+    const std::string& getImagePath (size_t index);
 
-        // our path set must match the number of files in the cache
-        int total_cached;
-        imageCache->getattribute ("total_files", total_cached);
-        if (imageCount == 0 || total_cached != imageCount) return ImageBuf();
+    // step through the list wrapping at either end, nullptr if it's empty or the image can't be read
+    ImageBufRef getNextImage();
+    ImageBufRef getPreviousImage();
+    ImageBufRef getImage (size_t index);
 
-        // maybe reset the image index so we don't go out of bounds
-        if (imageIndex >= imageCount) imageIndex = 0;
+    // decodes on the calling thread, bypassing the prefetch window
+    ImageBufRef getCachedImage (const std::string& imagePath, bool fitToScreen = true);
 
-        // https://thispointer.com/how-to-access-element-by-index-in-a-set-c/
-        std::set<std::string>::iterator it = std::next (imagePathSet.begin(), imageIndex++);
+    // Just the pixels inside roi of one MIP level, for zooming and panning around images
+    // far bigger than the screen. The result keeps the roi's origin in its spec.
+    // An undefined roi reads the whole level, format UNKNOWN keeps the file's own.
+    ImageBufRef getRegion (const std::string& imagePath, OIIO::ROI roi, int miplevel = 0,
+                           TypeDesc format = TypeDesc::UNKNOWN);
 
-        return getCachedImage (*it);
-    }
-
-    ImageBuf getCachedImage (const std::string& imagePath, bool fitToScreen = true)
+    // streams the tiles of a region without reading the rest of the image
+    ImageTileRange getTiles (const std::string& imagePath, int miplevel = 0, OIIO::ROI roi = OIIO::ROI::All())
     {
-        pixels.clear();
-        floatPixels.clear();
-
-        ustring filename (imagePath);
-        ImageSpec spec;
-        imageCache->get_imagespec (filename, spec);
-
-        if (spec.format == OIIO::TypeDesc::UINT8)
-        {
-            pixels.resize (spec.width * spec.height * spec.nchannels * sizeof (uint8_t));
-            imageCache->get_pixels (filename, 0, 0, 0, spec.width, 0, spec.height,
-                                    0, 1, spec.format, pixels.data());
-
-            if (fitToScreen)
-            {
-                ImageBuf image (spec, pixels.data());
-                // const OIIO::ImageSpec& spec = image.spec();
-                int w = spec.width;
-                int h = spec.height;
-                int nChan = spec.nchannels;
-
-                float aspectRatio = (float)spec.width / (float)spec.height;
-                float resizedWidth = DEFAULT_DESKTOP_WINDOW_WIDTH;
-                float resizedHeight = resizedWidth / aspectRatio;
-
-                OIIO::ROI roi (0, (int)resizedWidth, 0, (int)resizedHeight, 0, 1, /*chans:*/ 0, spec.nchannels);
-                OIIO::ImageBuf img = OIIO::ImageBufAlgo::resize (image, "", 0, roi);
-
-                return OIIO::ImageBufAlgo::resize (image, "", 0, roi);
-            }
-            else
-                return ImageBuf (spec, pixels.data());
-        }
-        else if (spec.format == OIIO::TypeDesc::FLOAT)
-        {
-            floatPixels.resize (spec.width * spec.height * spec.nchannels * sizeof (float));
-            imageCache->get_pixels (filename, 0, 0, 0, spec.width, 0, spec.height,
-                                    0, 1, spec.format, floatPixels.data());
-
-            return ImageBuf (spec, floatPixels.data());
-        }
-
-        return ImageBuf();
+        return ImageTileRange (imageCache, imagePath, miplevel, roi);
     }
 
-    void addImage (const std::string& imagePath)
-    {
-        imagePathSet.insert (imagePath);
-
-        threadPool->push (&ImageCacheHandler::addImageToCache, imagePath);
-    }
+    int getMipLevelCount (const std::string& imagePath) { return ImageRegions::getMipLevelCount (imageCache, imagePath); }
 
-    void addImageFolderToCache (const std::string& imageFolder)
-    {
-        std::filesystem::path folder (imageFolder);
+    // coarsest level that still has scale times the pixels of level 0
+    int chooseMipLevel (const std::string& imagePath, float scale) { return ImageRegions::chooseMipLevel (imageCache, imagePath, scale); }
 
-        if (!std::filesystem::is_directory (folder))
-            throw std::runtime_error ("Invalid folder: " + imageFolder);
+    void addImage (const std::string& imagePath);
+    void addImageFolderToCache (const std::string& imageFolder);
+    void addImagePathsToCache (const std::vector<std::string>& paths);
 
-        std::vector<std::string> files = FileServices::getFiles (imageFolder, supportedImageFormats(), true);
+ private:
+    // the ImageBuf wraps the block, handed out through an aliasing ImageBufRef
+    struct PooledImage
+    {
+        PixelBlockRef block;
+        ImageBuf image;
 
-        for (const auto& path : files)
-        {
-            std::filesystem::path f (path);
-            if (std::filesystem::is_directory (f)) continue;
+        PooledImage (PixelBlockRef pixels, const ImageSpec& spec) :
+            block (std::move (pixels)),
+            image (spec, block->data()) {}
+    };
 
-            imagePathSet.insert (path);
-            threadPool->push (&ImageCacheHandler::addImageToCache, path);
-        }
-    }
+    struct PreparedImage
+    {
+        std::string path;
+        ImageBufRef image;
+    };
 
-    void addImagePathsToCache (const std::vector<std::string>& paths)
+    // shared with the prefetch tasks so it outlives the handler until they finish
+    struct PrefetchState
     {
-        for (const auto& path : paths)
-        {
-            // Pass on directories
-            std::filesystem::path f (path);
-            if (std::filesystem::is_directory (f)) continue;
-
-            imagePathSet.insert (path);
-            threadPool->push (&ImageCacheHandler::addImageToCache, path);
-        }
-    }
+        moodycamel::ConcurrentQueue<PreparedImage> finished;
+        std::atomic<uint32_t> inFlight = 0;
+        std::atomic<bool> closed = false;
 
+        // window around the current image, tasks that fall out of it skip the decode
+        std::atomic<uint32_t> center = 0;
+        std::atomic<uint32_t> count = 0;
+        std::atomic<uint32_t> lookAhead = 0;
+        std::atomic<uint32_t> lookBehind = 0;
 
-    static void addImageToCache (int thread_id, const std::string& imagePath)
-    {
-        LOG (DBUG) << imagePath;
-        try
-        {
-            ImageBuf iBuf (imagePath, 0, 0, imageCache);
-            if (iBuf.read())
-            {
-                if (iBuf.cachedpixels())
-                {
-                }
-                else
-                {
-                    LOG (CRITICAL) << "Pixels not cached " << imagePath;
-                }
-            }
-            else
-            {
-                LOG (CRITICAL) << "File read failed!"
-                               << "::" << imagePath;
-            }
-        }
-        catch (std::exception& e)
-        {
-            LOG (CRITICAL) << e.what();
-        }
-    }
+        bool isWanted (uint32_t index) const;
+    };
 
- private:
     static ImageCache* imageCache;
     CachedImageSet imagePathSet;
-    uint32_t imageIndex = 0;
-    OIIO::thread_pool* threadPool = nullptr;
-
-    // pixels must persist until reaching opengl renderer
-    // FIXME
-    std::vector<uint8_t> pixels;
-    std::vector<float> floatPixels;
-};
\ No newline at end of file
+    TaskScheduler* scheduler = nullptr;
+    ImagePrefetchSettings settings;
+    PixelBlockPoolRef pixelPool;
+
+    // imagePathSet in order, rebuilt after paths are added
+    std::vector<std::string> imagePaths;
+    bool imageListDirty = false;
+
+    size_t currentIndex = 0;
+    bool hasCurrent = false;
+    std::string currentPath;
+
+    // frames inside the window and the paths still being decoded
+    std::unordered_map<std::string, ImageBufRef> frames;
+    std::unordered_set<std::string> pending;
+    std::unordered_set<std::string> windowPaths;
+    std::shared_ptr<PrefetchState> prefetch;
+
+    void insertPath (const std::string& imagePath);
+    void syncImageList();
+    void collectFinished();
+    void prefetchAround (size_t index);
+
+    // speculative decodes give up instead of pushing the pool over budget
+    static ImageBufRef prepareImage (const std::string& imagePath, bool fitToScreen,
+                                     int displayWidth, int displayHeight, int nthreads,
+                                     PixelBlockPool& pool, bool speculative);
+};
@@ -0,0 +1,205 @@
+#include "DecodedImageCache.h"
+
+std::string DecodedImageCache::makeKey (const std::filesystem::path& path, const ImageDecodeOptions& options)
+{
+    // weakly_canonical so "a/../b.png" and "b.png" land on the same entry
+    std::error_code ec;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical (path, ec);
+    if (ec) canonical = path.lexically_normal();
+
+    return canonical.generic_string() + "|" + options.toString();
+}
+
+OIIO::ImageBuf DecodedImageCache::decode (const std::filesystem::path& path, const ImageDecodeOptions& options)
+{
+    OIIO::ImageBuf image (path.generic_string());
+    if (!image.read (0, 0, true))
+    {
+        LOG (CRITICAL) << "File read failed!" << "::" << path.generic_string();
+        return OIIO::ImageBuf();
+    }
+
+    return options.forceRGBA8 ? toRGBA8 (image) : image;
+}
+
+// float and half images hold linear values but 8 bit textures are sampled as sRGB,
+// so the colour channels are encoded on the way down, alpha stays linear
+static OIIO::ImageBuf encodeSrgb8 (const OIIO::ImageBuf& image)
+{
+    const OIIO::ImageSpec& spec = image.spec();
+    const int channels = spec.nchannels;
+
+    std::vector<float> pixels (size_t (spec.width) * spec.height * channels);
+    if (!image.get_pixels (image.roi(), OIIO::TypeDesc::FLOAT, pixels.data())) return OIIO::ImageBuf();
+
+    OIIO::ImageBuf encoded (OIIO::ImageSpec (spec.width, spec.height, channels, OIIO::TypeDesc::UINT8));
+    uint8_t* out = static_cast<uint8_t*> (encoded.localpixels());
+    for (size_t i = 0; i < pixels.size(); ++i)
+    {
+        int c = static_cast<int> (i % channels);
+        bool alpha = c == spec.alpha_channel || (channels == 4 && c == 3) || (channels == 2 && c == 1);
+
+        float v = std::clamp (pixels[i], 0.0f, 1.0f);
+        if (!alpha)
+            v = v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow (v, 1.0f / 2.4f) - 0.055f;
+        out[i] = static_cast<uint8_t> (v * 255.0f + 0.5f);
+    }
+
+    return encoded;
+}
+
+OIIO::ImageBuf DecodedImageCache::toRGBA8 (const OIIO::ImageBuf& image)
+{
+    const OIIO::ImageSpec& spec = image.spec();
+
+    OIIO::ImageBuf rgba8 = image;
+    if (spec.format.is_floating_point())
+    {
+        rgba8 = encodeSrgb8 (image);
+        if (!rgba8.initialized()) return OIIO::ImageBuf();
+    }
+    else if (spec.format != OIIO::TypeDesc::UINT8)
+    {
+        rgba8 = OIIO::ImageBuf();
+        if (!rgba8.copy (image, OIIO::TypeDesc::UINT8)) return OIIO::ImageBuf();
+    }
+
+    if (spec.nchannels == 4) return rgba8;
+
+    // need to add an alpha channel, grey images are spread over rgb
+    int channelorder[] = {0, spec.nchannels > 1 ? 1 : 0, spec.nchannels > 2 ? 2 : 0, -1};
+    float channelvalues[] = {0 /*ignore*/, 0 /*ignore*/, 0 /*ignore*/, 1.0f};
+    std::string channelnames[] = {"R", "G", "B", "A"};
+    return OIIO::ImageBufAlgo::channels (rgba8, 4, channelorder, channelvalues, channelnames);
+}
+
+DecodedImageCache::DecodedImageCache (size_t byteBudget, Decoder decoder) :
+    decoder (decoder ? std::move (decoder) : Decoder (&DecodedImageCache::decode)),
+    byteBudget (byteBudget)
+{
+}
+
+DecodedImageRef DecodedImageCache::acquire (const std::filesystem::path& path, const ImageDecodeOptions& options)
+{
+    std::string key = makeKey (path, options);
+
+    std::shared_ptr<PendingDecode> pending = std::make_shared<PendingDecode>();
+    {
+        std::unique_lock<std::mutex> lock (mutex);
+
+        while (true)
+        {
+            auto it = entries.find (key);
+            if (it == entries.end()) break;
+
+            if (it->second.image)
+            {
+                lru.splice (lru.begin(), lru, it->second.lru);
+                ++hits;
+                return it->second.image;
+            }
+
+            // someone else is decoding it, wait for them instead of decoding it twice
+            std::shared_ptr<PendingDecode> other = it->second.pending;
+            decoded.wait (lock, [&]()
+                          { return other->done; });
+
+            // the other decode failed, nothing to wait for
+            if (other->failed) return nullptr;
+
+            // it was decoded but may have been evicted before we woke, look again
+        }
+
+        Entry& entry = entries[key];
+        entry.pending = pending;
+        lru.push_front (key);
+        entry.lru = lru.begin();
+    }
+
+    // decode outside the lock so different images decode in parallel
+    std::shared_ptr<DecodedImage> image = std::make_shared<DecodedImage>();
+    image->key = key;
+    image->path = path;
+
+    try
+    {
+        image->image = decoder (path, options);
+    }
+    catch (std::exception& e)
+    {
+        LOG (CRITICAL) << e.what();
+        image->image = OIIO::ImageBuf();
+    }
+    ++decodes;
+
+    bool valid = image->image.initialized();
+    if (valid)
+        image->bytes = image->image.spec().image_bytes();
+
+    std::lock_guard<std::mutex> lock (mutex);
+
+    pending->done = true;
+    pending->failed = !valid;
+
+    auto it = entries.find (key);
+    if (!valid)
+    {
+        lru.erase (it->second.lru);
+        entries.erase (it);
+        decoded.notify_all();
+        return nullptr;
+    }
+
+    it->second.image = image;
+    it->second.pending = nullptr;
+    residentBytes += image->bytes;
+
+    evict (byteBudget);
+    decoded.notify_all();
+
+    return image;
+}
+
+void DecodedImageCache::setByteBudget (size_t budget)
+{
+    std::lock_guard<std::mutex> lock (mutex);
+    byteBudget = budget;
+    evict (byteBudget);
+}
+
+size_t DecodedImageCache::getResidentBytes() const
+{
+    std::lock_guard<std::mutex> lock (mutex);
+    return residentBytes;
+}
+
+size_t DecodedImageCache::getEntryCount() const
+{
+    std::lock_guard<std::mutex> lock (mutex);
+    return entries.size();
+}
+
+void DecodedImageCache::trim()
+{
+    std::lock_guard<std::mutex> lock (mutex);
+    evict (0);
+}
+
+void DecodedImageCache::evict (size_t budget)
+{
+    // walk from the least recently used end, skipping images a caller
+    // still holds and ones that are mid decode
+    auto it = lru.end();
+    while (residentBytes > budget && it != lru.begin())
+    {
+        --it;
+
+        auto entry = entries.find (*it);
+        const DecodedImageRef& image = entry->second.image;
+        if (entry->second.pending || !image || image.use_count() > 1) continue;
+
+        residentBytes -= image->bytes;
+        entries.erase (entry);
+        it = lru.erase (it);
+    }
+}
@@ -0,0 +1,123 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+// CPU side cache of decoded images shared by everything that needs pixels
+//
+// Images are keyed on their canonical path plus the decode options so the same
+// file referenced by many materials is decoded once. Entries are handed out as
+// shared pointers, anything still held by a caller is pinned and the rest are
+// evicted least recently used first once the byte budget is exceeded.
+// Nothing here touches the GPU.
+
+struct ImageDecodeOptions
+{
+    bool forceRGBA8 = true; // convert to 8 bit RGBA, adding an opaque alpha if needed
+
+    std::string toString() const { return forceRGBA8 ? "rgba8" : "native"; }
+};
+
+struct DecodedImage
+{
+    std::string key; // canonical path + decode options
+    std::filesystem::path path;
+    OIIO::ImageBuf image;
+    size_t bytes = 0;
+};
+
+using DecodedImageRef = std::shared_ptr<const DecodedImage>;
+using DecodedImageCacheRef = std::shared_ptr<class DecodedImageCache>;
+
+class DecodedImageCache : Noncopyable
+{
+ public:
+    static constexpr size_t DEFAULT_BYTE_BUDGET = 512ull * 1024ull * 1024ull;
+
+    // turns a file into pixels, must be safe to call from several threads at once
+    using Decoder = std::function<OIIO::ImageBuf (const std::filesystem::path& path, const ImageDecodeOptions& options)>;
+
+    static DecodedImageCacheRef create (size_t byteBudget = DEFAULT_BYTE_BUDGET, Decoder decoder = nullptr)
+    {
+        return std::make_shared<DecodedImageCache> (byteBudget, std::move (decoder));
+    }
+
+    static std::string makeKey (const std::filesystem::path& path, const ImageDecodeOptions& options);
+
+    // reads with OIIO, straight into local memory
+    static OIIO::ImageBuf decode (const std::filesystem::path& path, const ImageDecodeOptions& options);
+
+    // float and half images are taken to be linear and sRGB encoded, 8 bit
+    // textures are sampled as sRGB
+    static OIIO::ImageBuf toRGBA8 (const OIIO::ImageBuf& image);
+
+ public:
+    DecodedImageCache (size_t byteBudget = DEFAULT_BYTE_BUDGET, Decoder decoder = nullptr);
+    ~DecodedImageCache() = default;
+
+    // decodes on a miss, concurrent requests for the same key wait for a single decode
+    // returns nullptr if the image can't be decoded
+    DecodedImageRef acquire (const std::filesystem::path& path, const ImageDecodeOptions& options = ImageDecodeOptions());
+
+    void setByteBudget (size_t budget);
+    size_t getByteBudget() const { return byteBudget; }
+
+    size_t getResidentBytes() const;
+    size_t getEntryCount() const;
+    uint64_t getHitCount() const { return hits; }
+    uint64_t getDecodeCount() const { return decodes; }
+
+    // drops every entry no caller holds
+    void trim();
+
+ private:
+    // one decode in progress, waiters keep it so they can tell a failure
+    // from an image that was evicted again before they woke
+    struct PendingDecode
+    {
+        bool done = false;
+        bool failed = false;
+    };
+
+    struct Entry
+    {
+        DecodedImageRef image = nullptr;
+        std::shared_ptr<PendingDecode> pending = nullptr; // set while it's being decoded
+        std::list<std::string>::iterator lru;
+    };
+
+    Decoder decoder;
+    size_t byteBudget = DEFAULT_BYTE_BUDGET;
+
+    mutable std::mutex mutex;
+    std::condition_variable decoded;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> lru; // most recently used at the front
+    size_t residentBytes = 0;
+
+    std::atomic<uint64_t> hits = 0;
+    std::atomic<uint64_t> decodes = 0;
+
+    // caller holds the lock
+    void evict (size_t budget);
+};
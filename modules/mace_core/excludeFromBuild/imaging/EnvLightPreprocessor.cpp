@@ -0,0 +1,361 @@
+struct EnvLightCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    float integral;
+    uint64_t sourceKey;
+    uint64_t fileSize;
+};
+
+static constexpr char NBENV_MAGIC[8] = {'N', 'B', 'E', 'N', 'V', '\0', '\0', '\0'};
+
+// keeps a whole row of the brightest pixels summable in float
+static constexpr float ENV_MAX_RADIANCE = 1.0e30f;
+
+// same weights as sRGB_calcLuminance
+static constexpr float ENV_LUMINANCE_R = 0.2126729f;
+static constexpr float ENV_LUMINANCE_G = 0.7151522f;
+static constexpr float ENV_LUMINANCE_B = 0.0721750f;
+
+// clamps count RGBA pixels to finite non negative values with alpha 1,
+// and writes their luminance if luminance isn't nullptr
+static void clampEnvRow (float* rgba, uint32_t count, float* luminance)
+{
+    uint32_t x = 0;
+#if defined(MACE_SSE2)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 maxRadiance = _mm_set1_ps (ENV_MAX_RADIANCE);
+    const __m128 rgbMask = _mm_castsi128_ps (_mm_set_epi32 (0, -1, -1, -1));
+    const __m128 alphaOne = _mm_set_ps (1.0f, 0.0f, 0.0f, 0.0f);
+    const __m128 wr = _mm_set1_ps (ENV_LUMINANCE_R);
+    const __m128 wg = _mm_set1_ps (ENV_LUMINANCE_G);
+    const __m128 wb = _mm_set1_ps (ENV_LUMINANCE_B);
+
+    // max returns its second operand when either is NaN so NaNs become 0
+    auto clampPixel = [&] (float* pixel)
+    {
+        __m128 p = _mm_min_ps (_mm_max_ps (_mm_loadu_ps (pixel), zero), maxRadiance);
+        p = _mm_or_ps (_mm_and_ps (p, rgbMask), alphaOne);
+        _mm_storeu_ps (pixel, p);
+        return p;
+    };
+
+    for (; x + 4 <= count; x += 4)
+    {
+        float* pixels = rgba + size_t (x) * 4;
+        __m128 p0 = clampPixel (pixels);
+        __m128 p1 = clampPixel (pixels + 4);
+        __m128 p2 = clampPixel (pixels + 8);
+        __m128 p3 = clampPixel (pixels + 12);
+
+        if (luminance)
+        {
+            // to one register each of r, g, b and a
+            _MM_TRANSPOSE4_PS (p0, p1, p2, p3);
+            __m128 y = _mm_add_ps (_mm_add_ps (_mm_mul_ps (p0, wr), _mm_mul_ps (p1, wg)), _mm_mul_ps (p2, wb));
+            _mm_storeu_ps (luminance + x, y);
+        }
+    }
+#endif
+    for (; x < count; ++x)
+    {
+        float* pixel = rgba + size_t (x) * 4;
+        for (int c = 0; c < 3; ++c)
+        {
+            float v = pixel[c];
+            pixel[c] = v > 0.0f ? std::min (v, ENV_MAX_RADIANCE) : 0.0f;
+        }
+        pixel[3] = 1.0f;
+
+        if (luminance)
+            luminance[x] = ENV_LUMINANCE_R * pixel[0] + ENV_LUMINANCE_G * pixel[1] + ENV_LUMINANCE_B * pixel[2];
+    }
+}
+
+// normalized pdf and cdf of count piecewise constant values over [0, 1),
+// returns the unnormalized integral. All zeros gives a uniform distribution.
+static float buildEnvCDF (const float* values, uint32_t count, float* pdf, float* cdf)
+{
+    double sum = 0.0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        cdf[i] = static_cast<float> (sum);
+        sum += double (values[i]) / count;
+    }
+
+    if (sum > 0.0)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            pdf[i] = static_cast<float> (values[i] / sum);
+            cdf[i] = static_cast<float> (cdf[i] / sum);
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            pdf[i] = 1.0f;
+            cdf[i] = float (i) / count;
+        }
+    }
+    cdf[count] = 1.0f;
+
+    return static_cast<float> (sum);
+}
+
+EnvLightDistributionRef EnvLightDistribution::build (const float* importance, uint32_t width, uint32_t height)
+{
+    if (width == 0 || height == 0) return nullptr;
+
+    EnvLightDistributionRef dist = std::make_shared<EnvLightDistribution>();
+    dist->width = width;
+    dist->height = height;
+    dist->rowPDFs.resize (size_t (width) * height);
+    dist->rowCDFs.resize (size_t (width + 1) * height);
+    dist->rowIntegrals.resize (height);
+    dist->marginalPDF.resize (height);
+    dist->marginalCDF.resize (height + 1);
+
+    // every row is independent
+    TaskScheduler::get().parallel_for (0, height, 0, [&] (uint32_t start, uint32_t end)
+                                       {
+        for (uint32_t y = start; y < end; ++y)
+        {
+            dist->rowIntegrals[y] = buildEnvCDF (importance + size_t (y) * width, width,
+                                                 dist->rowPDFs.data() + size_t (y) * width,
+                                                 dist->rowCDFs.data() + size_t (y) * (width + 1));
+        } });
+
+    dist->integral = buildEnvCDF (dist->rowIntegrals.data(), height, dist->marginalPDF.data(), dist->marginalCDF.data());
+    return dist;
+}
+
+EnvLightDistributionRef EnvLightDistribution::load (const std::filesystem::path& path, uint64_t sourceKey)
+{
+    std::error_code ec;
+    if (!std::filesystem::exists (path, ec))
+        return nullptr;
+
+    MappedFileRef file = MappedFile::open (path);
+    if (!file || file->size() < sizeof (EnvLightCacheHeader))
+        return nullptr;
+
+    EnvLightCacheHeader header;
+    std::memcpy (&header, file->data(), sizeof (EnvLightCacheHeader));
+
+    if (std::memcmp (header.magic, NBENV_MAGIC, sizeof (NBENV_MAGIC)) != 0 ||
+        header.version != VERSION || header.sourceKey != sourceKey ||
+        header.fileSize != file->size() || header.width == 0 || header.height == 0)
+        return nullptr;
+
+    EnvLightDistributionRef dist = std::make_shared<EnvLightDistribution>();
+    dist->width = header.width;
+    dist->height = header.height;
+    dist->integral = header.integral;
+
+    uint64_t offset = alignCacheOffset (sizeof (EnvLightCacheHeader));
+    auto read = [&] (std::vector<float>& values, size_t count)
+    {
+        uint64_t bytes = count * sizeof (float);
+        if (offset + bytes > file->size()) return false;
+        values.resize (count);
+        std::memcpy (values.data(), file->data() + offset, bytes);
+        offset = alignCacheOffset (offset + bytes);
+        return true;
+    };
+
+    size_t width = header.width;
+    size_t height = header.height;
+    if (!read (dist->rowPDFs, width * height) || !read (dist->rowCDFs, (width + 1) * height) ||
+        !read (dist->rowIntegrals, height) || !read (dist->marginalPDF, height) || !read (dist->marginalCDF, height + 1))
+        return nullptr;
+
+    return dist;
+}
+
+bool EnvLightDistribution::save (const std::filesystem::path& path, uint64_t sourceKey) const
+{
+    try
+    {
+        if (path.has_parent_path())
+            std::filesystem::create_directories (path.parent_path());
+
+        const std::vector<float>* sections[] = {&rowPDFs, &rowCDFs, &rowIntegrals, &marginalPDF, &marginalCDF};
+
+        uint64_t fileSize = alignCacheOffset (sizeof (EnvLightCacheHeader));
+        for (const std::vector<float>* section : sections)
+            fileSize = alignCacheOffset (fileSize + section->size() * sizeof (float));
+
+        EnvLightCacheHeader header = {};
+        std::memcpy (header.magic, NBENV_MAGIC, sizeof (NBENV_MAGIC));
+        header.version = VERSION;
+        header.width = width;
+        header.height = height;
+        header.integral = integral;
+        header.sourceKey = sourceKey;
+        header.fileSize = fileSize;
+
+        return writeFileAtomically (path, [&] (std::ofstream& out)
+                                    {
+            static const char zeros[CACHE_FILE_ALIGNMENT] = {};
+            uint64_t written = 0;
+            auto write = [&] (const void* data, uint64_t bytes)
+            {
+                out.write (static_cast<const char*> (data), bytes);
+                written += bytes;
+                uint64_t padded = alignCacheOffset (written);
+                out.write (zeros, padded - written);
+                written = padded;
+            };
+
+            write (&header, sizeof (header));
+            for (const std::vector<float>* section : sections)
+                write (section->data(), section->size() * sizeof (float)); });
+    }
+    catch (std::exception& e)
+    {
+        LOG (CRITICAL) << "Environment light cache write failed: " << e.what();
+        return false;
+    }
+}
+
+void EnvLightPreprocessor::computeImportance (float* rgba, uint32_t width, uint32_t height, const EnvLightOptions& options,
+                                              std::vector<float>& importance, uint32_t& importanceWidth, uint32_t& importanceHeight)
+{
+    uint32_t factor = 1;
+    if (options.importanceWidth && options.importanceWidth < width)
+        factor = (width + options.importanceWidth - 1) / options.importanceWidth;
+
+    importanceWidth = (width + factor - 1) / factor;
+    importanceHeight = (height + factor - 1) / factor;
+    importance.assign (size_t (importanceWidth) * importanceHeight, 0.0f);
+
+    // one chunk of map rows per task, each covering factor image rows
+    TaskScheduler::get().parallel_for (0, importanceHeight, 0, [&] (uint32_t start, uint32_t end)
+                                       {
+        std::vector<float> luminance (width);
+
+        for (uint32_t my = start; my < end; ++my)
+        {
+            float* cells = importance.data() + size_t (my) * importanceWidth;
+            uint32_t y0 = my * factor;
+            uint32_t y1 = std::min (height, y0 + factor);
+
+            for (uint32_t y = y0; y < y1; ++y)
+            {
+                float sinTheta = std::sin (std::numbers::pi_v<float> * (y + 0.5f) / height);
+                clampEnvRow (rgba + size_t (y) * width * 4, width, luminance.data());
+
+                if (factor == 1)
+                {
+                    for (uint32_t x = 0; x < width; ++x)
+                        cells[x] = luminance[x] * sinTheta;
+                }
+                else
+                {
+                    for (uint32_t x = 0; x < width; ++x)
+                        cells[x / factor] += luminance[x] * sinTheta;
+                }
+            }
+
+            // average over the pixels each cell covers, edge cells cover fewer
+            if (factor > 1)
+            {
+                float rows = float (y1 - y0);
+                for (uint32_t mx = 0; mx < importanceWidth; ++mx)
+                {
+                    uint32_t x0 = mx * factor;
+                    uint32_t columns = std::min (width, x0 + factor) - x0;
+                    cells[mx] /= rows * columns;
+                }
+            }
+        } });
+}
+
+uint64_t EnvLightPreprocessor::makeSourceKey (const std::filesystem::path& source, const EnvLightOptions& options)
+{
+    uint64_t hash = hashSourceFile (source);
+    return hashBytes (&options.importanceWidth, sizeof (options.importanceWidth), hash);
+}
+
+EnvLightDataRef EnvLightPreprocessor::process (const OIIO::ImageBuf& image, const EnvLightOptions& options,
+                                               const std::filesystem::path& cacheFolder)
+{
+    const OIIO::ImageSpec& spec = image.spec();
+    if (spec.width <= 0 || spec.height <= 0 || spec.nchannels <= 0)
+    {
+        LOG (CRITICAL) << "Can't read environment image " << image.name();
+        return nullptr;
+    }
+
+    EnvLightDataRef data = std::make_shared<EnvLightData>();
+    data->width = static_cast<uint32_t> (spec.width);
+    data->height = static_cast<uint32_t> (spec.height);
+    data->rgba.resize (size_t (data->width) * data->height * 4);
+
+    // strided straight into RGBA, alpha gets filled in by the clamp
+    uint32_t channels = static_cast<uint32_t> (std::min (spec.nchannels, 3));
+    OIIO::ROI roi = image.roi();
+    roi.chbegin = 0;
+    roi.chend = static_cast<int> (channels);
+    if (!image.get_pixels (roi, OIIO::TypeDesc::FLOAT, data->rgba.data(), 4 * sizeof (float)))
+    {
+        LOG (CRITICAL) << "Can't read environment image " << image.name() << ": " << image.geterror();
+        return nullptr;
+    }
+
+    // grey images are spread over rgb
+    if (channels < 3)
+    {
+        TaskScheduler::get().parallel_for (0, data->height, 0, [&] (uint32_t start, uint32_t end)
+                                           {
+            for (size_t i = size_t (start) * data->width; i < size_t (end) * data->width; ++i)
+            {
+                float* pixel = data->rgba.data() + i * 4;
+                for (uint32_t c = channels; c < 3; ++c)
+                    pixel[c] = pixel[0];
+            } });
+    }
+
+    std::filesystem::path cachePath;
+    uint64_t sourceKey = 0;
+    std::string source = image.name();
+    if (!cacheFolder.empty() && !source.empty())
+    {
+        std::filesystem::path sourcePath (source);
+        sourceKey = makeSourceKey (sourcePath, options);
+
+        std::ostringstream name;
+        name << sourcePath.stem().string() << "_" << std::hex << sourceKey << EnvLightDistribution::EXTENSION;
+        cachePath = cacheFolder / name.str();
+
+        data->distribution = EnvLightDistribution::load (cachePath, sourceKey);
+    }
+
+    if (data->distribution)
+    {
+        // the importance map is already baked into the distribution, only clamp
+        data->fromCache = true;
+        data->importanceWidth = data->distribution->width;
+        data->importanceHeight = data->distribution->height;
+
+        TaskScheduler::get().parallel_for (0, data->height, 0, [&] (uint32_t start, uint32_t end)
+                                           {
+            for (uint32_t y = start; y < end; ++y)
+                clampEnvRow (data->rgba.data() + size_t (y) * data->width * 4, data->width, nullptr); });
+
+        return data;
+    }
+
+    computeImportance (data->rgba.data(), data->width, data->height, options,
+                       data->importance, data->importanceWidth, data->importanceHeight);
+    data->distribution = EnvLightDistribution::build (data->importance.data(), data->importanceWidth, data->importanceHeight);
+
+    if (!cachePath.empty() && !data->distribution->save (cachePath, sourceKey))
+        LOG (DBUG) << "Failed to cache environment light distribution for " << source;
+
+    return data;
+}
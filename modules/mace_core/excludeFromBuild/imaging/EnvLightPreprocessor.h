@@ -0,0 +1,97 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+// CPU preprocessing for environment lights (.nbenv)
+//
+// One fused pass over the image clamps it to finite non negative RGBA and
+// builds the importance map, luminance weighted by sin theta for the lat-long
+// mapping, optionally box filtered down to a smaller map. The per row and
+// marginal CDFs are then built in parallel. Rows are spread over the
+// TaskScheduler and the per pixel work is SSE2 on 4 pixels at a time.
+//
+// Only the distribution is cached on disk, the texture itself has to be read
+// from the source image anyway and clamping it is cheap next to that.
+
+using EnvLightDistributionRef = std::shared_ptr<struct EnvLightDistribution>;
+using EnvLightDataRef = std::shared_ptr<struct EnvLightData>;
+
+// Piecewise constant 2D distribution laid out the way
+// RegularConstantContinuousDistribution2D stores it, rows are the conditional
+// distributions along u and the marginal runs over the rows
+struct EnvLightDistribution
+{
+    static constexpr uint32_t VERSION = 1;
+    static constexpr const char* EXTENSION = ".nbenv";
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<float> rowPDFs;      // width per row, each row integrates to 1
+    std::vector<float> rowCDFs;      // width + 1 per row
+    std::vector<float> rowIntegrals; // height
+    std::vector<float> marginalPDF;  // height
+    std::vector<float> marginalCDF;  // height + 1
+    float integral = 0.0f;
+
+    // importance is width * height values, rows of all zeros sample uniformly
+    static EnvLightDistributionRef build (const float* importance, uint32_t width, uint32_t height);
+
+    // returns nullptr if the file is missing, damaged or was written for another source key
+    static EnvLightDistributionRef load (const std::filesystem::path& path, uint64_t sourceKey);
+    bool save (const std::filesystem::path& path, uint64_t sourceKey) const;
+};
+
+struct EnvLightOptions
+{
+    // width of the importance map, 0 keeps the image resolution
+    // the image is box filtered by the smallest whole factor that gets there
+    uint32_t importanceWidth = 0;
+};
+
+struct EnvLightData
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<float> rgba; // clamped, always 4 channels with alpha 1
+    std::vector<float> importance;
+    uint32_t importanceWidth = 0;
+    uint32_t importanceHeight = 0;
+    EnvLightDistributionRef distribution = nullptr;
+    bool fromCache = false;
+};
+
+class EnvLightPreprocessor
+{
+ public:
+    // an empty cacheFolder or an image not read from a file skips the disk cache
+    // returns nullptr if the image can't be read
+    static EnvLightDataRef process (const OIIO::ImageBuf& image, const EnvLightOptions& options = EnvLightOptions(),
+                                    const std::filesystem::path& cacheFolder = std::filesystem::path());
+
+    // the clamp and importance pass on its own, rgba is width * height * 4 and clamped in place
+    static void computeImportance (float* rgba, uint32_t width, uint32_t height, const EnvLightOptions& options,
+                                   std::vector<float>& importance, uint32_t& importanceWidth, uint32_t& importanceHeight);
+
+    static uint64_t makeSourceKey (const std::filesystem::path& source, const EnvLightOptions& options);
+};
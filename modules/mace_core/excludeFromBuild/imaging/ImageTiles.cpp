@@ -0,0 +1,137 @@
+#include "ImageTiles.h"
+
+ImageTileRange::ImageTileRange (OIIO::ImageCache* cache, const std::string& path, int miplevel, OIIO::ROI roi) :
+    cache (cache),
+    filename (path),
+    miplevel (miplevel)
+{
+    if (!ImageRegions::getLevelSpec (cache, path, miplevel, spec)) return;
+
+    region = ImageRegions::clip (spec, roi);
+    if (region.width() <= 0 || region.height() <= 0) return;
+
+    // a file the cache doesn't tile comes back as a single tile
+    tileWidth = spec.tile_width > 0 ? spec.tile_width : spec.width;
+    tileHeight = spec.tile_height > 0 ? spec.tile_height : spec.height;
+
+    // tiles are aligned to the data window origin
+    firstTileX = (region.xbegin - spec.x) / tileWidth;
+    firstTileY = (region.ybegin - spec.y) / tileHeight;
+    int lastTileX = (region.xend - 1 - spec.x) / tileWidth;
+    int lastTileY = (region.yend - 1 - spec.y) / tileHeight;
+    tilesX = static_cast<uint32_t> (lastTileX - firstTileX + 1);
+    tilesY = static_cast<uint32_t> (lastTileY - firstTileY + 1);
+
+    valid = true;
+}
+
+ImageTileRange::~ImageTileRange()
+{
+    release();
+}
+
+const ImageTile& ImageTileRange::fetch (uint32_t index)
+{
+    // a failed tile is kept too, so dereferencing it again doesn't retry and log again
+    if (fetched && index == currentIndex) return tile;
+    release();
+
+    tile = ImageTile();
+    tile.x = spec.x + (firstTileX + static_cast<int> (index % tilesX)) * tileWidth;
+    tile.y = spec.y + (firstTileY + static_cast<int> (index / tilesX)) * tileHeight;
+    tile.roi = OIIO::ROI (std::max (tile.x, region.xbegin), std::min (tile.x + tileWidth, region.xend),
+                          std::max (tile.y, region.ybegin), std::min (tile.y + tileHeight, region.yend),
+                          0, 1, region.chbegin, region.chend);
+
+    currentIndex = index;
+    fetched = true;
+
+    current = cache->get_tile (filename, 0, miplevel, tile.x, tile.y, spec.z, region.chbegin, region.chend);
+    if (!current)
+    {
+        LOG (CRITICAL) << "Tile read failed " << filename.string() << " at " << tile.x << ", " << tile.y << " " << cache->geterror();
+        return tile;
+    }
+
+    OIIO::TypeDesc format;
+    tile.pixels = static_cast<const std::byte*> (cache->tile_pixels (current, format));
+    tile.format = format;
+    tile.nchannels = region.chend - region.chbegin;
+    tile.pixelStride = format.size() * tile.nchannels;
+    tile.rowStride = tile.pixelStride * tileWidth;
+
+    return tile;
+}
+
+void ImageTileRange::release()
+{
+    fetched = false;
+    if (!current) return;
+
+    cache->release_tile (current);
+    current = nullptr;
+}
+
+bool ImageRegions::getLevelSpec (OIIO::ImageCache* cache, const std::string& path, int miplevel, OIIO::ImageSpec& spec)
+{
+    if (!cache->get_imagespec (OIIO::ustring (path), spec, 0, miplevel))
+    {
+        LOG (CRITICAL) << "Can't read " << path << " level " << miplevel << " " << cache->geterror();
+        return false;
+    }
+    return true;
+}
+
+int ImageRegions::getMipLevelCount (OIIO::ImageCache* cache, const std::string& path)
+{
+    int levels = 0;
+    if (!cache->get_image_info (OIIO::ustring (path), 0, 0, OIIO::ustring ("miplevels"), OIIO::TypeInt, &levels))
+        return 0;
+    return levels;
+}
+
+int ImageRegions::chooseMipLevel (OIIO::ImageCache* cache, const std::string& path, float scale)
+{
+    OIIO::ImageSpec base;
+    if (scale >= 1.0f || !getLevelSpec (cache, path, 0, base)) return 0;
+
+    float wantedWidth = base.width * scale;
+    float wantedHeight = base.height * scale;
+
+    int chosen = 0;
+    int levels = getMipLevelCount (cache, path);
+    for (int level = 1; level < levels; ++level)
+    {
+        OIIO::ImageSpec spec;
+        if (!cache->get_imagespec (OIIO::ustring (path), spec, 0, level)) break;
+        if (spec.width < wantedWidth || spec.height < wantedHeight) break;
+        chosen = level;
+    }
+    return chosen;
+}
+
+OIIO::ROI ImageRegions::clip (const OIIO::ImageSpec& spec, OIIO::ROI roi)
+{
+    OIIO::ROI window = OIIO::get_roi (spec);
+    if (!roi.defined()) return window;
+
+    if (roi.chend <= roi.chbegin || roi.chend > spec.nchannels)
+    {
+        roi.chbegin = 0;
+        roi.chend = spec.nchannels;
+    }
+    return OIIO::roi_intersection (roi, window);
+}
+
+bool ImageRegions::read (OIIO::ImageCache* cache, const std::string& path, int miplevel,
+                         const OIIO::ROI& roi, OIIO::TypeDesc format, void* dst)
+{
+    if (!cache->get_pixels (OIIO::ustring (path), 0, miplevel,
+                            roi.xbegin, roi.xend, roi.ybegin, roi.yend, roi.zbegin, roi.zend,
+                            roi.chbegin, roi.chend, format, dst))
+    {
+        LOG (CRITICAL) << "Region read failed " << path << " " << cache->geterror();
+        return false;
+    }
+    return true;
+}
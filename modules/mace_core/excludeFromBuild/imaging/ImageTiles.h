@@ -0,0 +1,136 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+// Region and tile access to images through an OIIO ImageCache
+//
+// Nothing here reads more of a file than the tiles overlapping the request, so a
+// viewport into a gigapixel panorama costs what the viewport covers. Untiled files
+// are carved up by the cache's "autotile" and files without MIP levels get them
+// built on demand when the cache has "automip" turned on.
+
+// One cache tile, clipped to the requested region. The pixels belong to the cache
+// and stay valid until the range moves on to the next tile. A tile the cache
+// couldn't read still has its position and roi but no pixels, check isValid first.
+struct ImageTile
+{
+    int x = 0; // tile origin in the MIP level
+    int y = 0;
+    OIIO::ROI roi; // part of the tile inside the requested region
+    OIIO::TypeDesc format;
+    int nchannels = 0;
+    const std::byte* pixels = nullptr; // pixel (x, y)
+    size_t pixelStride = 0;
+    size_t rowStride = 0;
+
+    bool isValid() const { return pixels != nullptr; }
+
+    const std::byte* pixel (int px, int py) const
+    {
+        return pixels + size_t (py - y) * rowStride + size_t (px - x) * pixelStride;
+    }
+};
+
+// Streams the tiles overlapping a region in scanline order, holding one at a time.
+// A failed read is logged once and the range carries on with the next tile.
+// for (const ImageTile& tile : ImageTileRange (cache, path, miplevel, roi))
+//     if (tile.isValid()) ...
+class ImageTileRange : Noncopyable
+{
+ public:
+    class Iterator
+    {
+     public:
+        Iterator (ImageTileRange* range, uint32_t index) :
+            range (range), index (index) {}
+
+        const ImageTile& operator*() const { return range->fetch (index); }
+        const ImageTile* operator->() const { return &range->fetch (index); }
+        Iterator& operator++()
+        {
+            ++index;
+            return *this;
+        }
+        bool operator!= (const Iterator& other) const { return index != other.index; }
+
+     private:
+        ImageTileRange* range = nullptr;
+        uint32_t index = 0;
+    };
+
+ public:
+    // an undefined roi means the whole level, it's clipped to the data window either way
+    ImageTileRange (OIIO::ImageCache* cache, const std::string& path, int miplevel = 0, OIIO::ROI roi = OIIO::ROI::All());
+    ~ImageTileRange();
+
+    // false if the file or MIP level can't be read, the range is empty then
+    bool isValid() const { return valid; }
+    const OIIO::ImageSpec& getSpec() const { return spec; }
+    const OIIO::ROI& getRegion() const { return region; }
+    uint32_t getTileCount() const { return tilesX * tilesY; }
+
+    Iterator begin() { return Iterator (this, 0); }
+    Iterator end() { return Iterator (this, getTileCount()); }
+
+ private:
+    OIIO::ImageCache* cache = nullptr;
+    OIIO::ustring filename;
+    int miplevel = 0;
+    OIIO::ImageSpec spec;
+    OIIO::ROI region;
+    bool valid = false;
+
+    int tileWidth = 0;
+    int tileHeight = 0;
+    int firstTileX = 0;
+    int firstTileY = 0;
+    uint32_t tilesX = 0;
+    uint32_t tilesY = 0;
+
+    OIIO::ImageCache::Tile* current = nullptr;
+    uint32_t currentIndex = 0;
+    bool fetched = false; // tile holds currentIndex, with or without pixels
+    ImageTile tile;
+
+    const ImageTile& fetch (uint32_t index);
+    void release();
+};
+
+// ROI and MIP level reads
+struct ImageRegions
+{
+    // spec of one MIP level as the cache sees it, tile sizes included
+    static bool getLevelSpec (OIIO::ImageCache* cache, const std::string& path, int miplevel, OIIO::ImageSpec& spec);
+    static int getMipLevelCount (OIIO::ImageCache* cache, const std::string& path);
+
+    // the smallest level still at least scale times the size of level 0
+    static int chooseMipLevel (OIIO::ImageCache* cache, const std::string& path, float scale);
+
+    // roi clipped to the level's data window with every channel if roi has none
+    static OIIO::ROI clip (const OIIO::ImageSpec& spec, OIIO::ROI roi);
+
+    // copies the region into dst, tightly packed in format
+    static bool read (OIIO::ImageCache* cache, const std::string& path, int miplevel,
+                      const OIIO::ROI& roi, OIIO::TypeDesc format, void* dst);
+};
@@ -0,0 +1,450 @@
+struct MipChainHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t channels;
+    uint32_t floatData;
+    uint32_t levelCount;
+    uint64_t sourceKey;
+    uint64_t fileSize;
+};
+
+static constexpr char NBMIP_MAGIC[8] = {'N', 'B', 'M', 'I', 'P', '\0', '\0', '\0'};
+
+// sRGB transfer both ways, the encode table is indexed by linear * 65535
+// which keeps it within a twentieth of an 8 bit step even near black
+struct MipSrgbTables
+{
+    float toLinear[256];
+    float unorm[256];
+    uint8_t fromLinear[65536];
+
+    MipSrgbTables()
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            float v = i / 255.0f;
+            unorm[i] = v;
+            toLinear[i] = v <= 0.04045f ? v / 12.92f : std::pow ((v + 0.055f) / 1.055f, 2.4f);
+        }
+
+        for (int i = 0; i < 65536; ++i)
+        {
+            double v = i / 65535.0;
+            double s = v <= 0.0031308 ? v * 12.92 : 1.055 * std::pow (v, 1.0 / 2.4) - 0.055;
+            fromLinear[i] = static_cast<uint8_t> (std::clamp (s * 255.0 + 0.5, 0.0, 255.0));
+        }
+    }
+
+    static const MipSrgbTables& get()
+    {
+        static MipSrgbTables tables;
+        return tables;
+    }
+};
+
+static bool isMipAlphaChannel (uint32_t channel, uint32_t channels)
+{
+    return (channels == 4 && channel == 3) || (channels == 2 && channel == 1);
+}
+
+// source pixels that contribute to each destination pixel along one axis
+struct MipTaps
+{
+    std::vector<uint32_t> start; // per destination pixel, into index and weight
+    std::vector<uint32_t> count;
+    std::vector<uint32_t> index; // source pixel
+    std::vector<float> weight;
+};
+
+static double besselI0 (double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 64 && term > sum * 1e-12; ++k)
+    {
+        double t = x / (2.0 * k);
+        term *= t * t;
+        sum += term;
+    }
+    return sum;
+}
+
+static double kaiserWeight (double x, const MipChainOptions& options)
+{
+    double t = x / options.kaiserWidth;
+    if (std::abs (t) >= 1.0) return 0.0;
+
+    double window = besselI0 (options.kaiserAlpha * std::sqrt (1.0 - t * t)) / besselI0 (options.kaiserAlpha);
+
+    double s = x * options.kaiserStretch * std::numbers::pi;
+    double sinc = std::abs (s) < 1e-8 ? 1.0 : std::sin (s) / s;
+
+    return sinc * window;
+}
+
+static MipTaps computeMipTaps (uint32_t srcSize, uint32_t dstSize, const MipChainOptions& options)
+{
+    MipTaps taps;
+    taps.start.resize (dstSize);
+    taps.count.resize (dstSize);
+
+    double scale = double (srcSize) / double (dstSize);
+    int64_t last = int64_t (srcSize) - 1;
+
+    for (uint32_t d = 0; d < dstSize; ++d)
+    {
+        uint32_t first = static_cast<uint32_t> (taps.index.size());
+
+        if (options.filter == MipFilter::Box)
+        {
+            // weight is how much of each source pixel the destination pixel covers
+            double lo = d * scale;
+            double hi = (d + 1) * scale;
+            for (int64_t j = int64_t (std::floor (lo)); j < int64_t (std::ceil (hi)); ++j)
+            {
+                double w = std::min (hi, double (j + 1)) - std::max (lo, double (j));
+                if (w <= 0.0) continue;
+                taps.index.push_back (static_cast<uint32_t> (std::clamp<int64_t> (j, 0, last)));
+                taps.weight.push_back (float (w));
+            }
+        }
+        else
+        {
+            // the filter is defined in destination pixels and stretched over the source
+            double center = (d + 0.5) * scale;
+            double radius = options.kaiserWidth * scale;
+            for (int64_t j = int64_t (std::floor (center - radius)); j <= int64_t (std::ceil (center + radius)); ++j)
+            {
+                double w = kaiserWeight ((j + 0.5 - center) / scale, options);
+                if (w == 0.0) continue;
+                taps.index.push_back (static_cast<uint32_t> (std::clamp<int64_t> (j, 0, last)));
+                taps.weight.push_back (float (w));
+            }
+        }
+
+        double sum = 0.0;
+        for (size_t i = first; i < taps.weight.size(); ++i)
+            sum += taps.weight[i];
+        if (sum != 0.0)
+            for (size_t i = first; i < taps.weight.size(); ++i)
+                taps.weight[i] = float (taps.weight[i] / sum);
+
+        taps.start[d] = first;
+        taps.count[d] = static_cast<uint32_t> (taps.index.size()) - first;
+    }
+
+    return taps;
+}
+
+// rows of the level being filtered, either linear floats already or
+// 8 bit pixels that get decoded on the fly
+struct MipSource
+{
+    const float* linear = nullptr;
+    const uint8_t* bytes = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t channels = 0;
+    bool srgb = false;
+
+    const float* row (uint32_t y, float* scratch) const
+    {
+        size_t count = size_t (width) * channels;
+        if (linear) return linear + y * count;
+
+        const MipSrgbTables& tables = MipSrgbTables::get();
+        const uint8_t* src = bytes + y * count;
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            const float* table = srgb && !isMipAlphaChannel (c, channels) ? tables.toLinear : tables.unorm;
+            for (size_t i = c; i < count; i += channels)
+                scratch[i] = table[src[i]];
+        }
+        return scratch;
+    }
+};
+
+// dst += w * src
+static void accumulateMipRow (float* dst, const float* src, float w, size_t count)
+{
+    size_t i = 0;
+#if defined(MACE_SSE2)
+    __m128 weight = _mm_set1_ps (w);
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps (dst + i, _mm_add_ps (_mm_loadu_ps (dst + i), _mm_mul_ps (_mm_loadu_ps (src + i), weight)));
+#endif
+    for (; i < count; ++i)
+        dst[i] += w * src[i];
+}
+
+static void filterMipRow (float* out, const float* row, const MipTaps& taps, uint32_t dstWidth, uint32_t channels)
+{
+#if defined(MACE_SSE2)
+    // one RGBA pixel per register
+    if (channels == 4)
+    {
+        for (uint32_t x = 0; x < dstWidth; ++x)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for (uint32_t t = taps.start[x], end = t + taps.count[x]; t < end; ++t)
+                sum = _mm_add_ps (sum, _mm_mul_ps (_mm_loadu_ps (row + size_t (taps.index[t]) * 4), _mm_set1_ps (taps.weight[t])));
+            _mm_storeu_ps (out + size_t (x) * 4, sum);
+        }
+        return;
+    }
+#endif
+    for (uint32_t x = 0; x < dstWidth; ++x)
+    {
+        float* pixel = out + size_t (x) * channels;
+        std::fill (pixel, pixel + channels, 0.0f);
+        for (uint32_t t = taps.start[x], end = t + taps.count[x]; t < end; ++t)
+        {
+            const float* src = row + size_t (taps.index[t]) * channels;
+            for (uint32_t c = 0; c < channels; ++c)
+                pixel[c] += taps.weight[t] * src[c];
+        }
+    }
+}
+
+static void encodeMipRow (uint8_t* out, const float* row, size_t count, uint32_t channels, bool srgb)
+{
+    const MipSrgbTables& tables = MipSrgbTables::get();
+    for (uint32_t c = 0; c < channels; ++c)
+    {
+        bool linear = !srgb || isMipAlphaChannel (c, channels);
+        for (size_t i = c; i < count; i += channels)
+        {
+            float v = std::clamp (row[i], 0.0f, 1.0f);
+            out[i] = linear ? static_cast<uint8_t> (v * 255.0f + 0.5f) : tables.fromLinear[static_cast<uint32_t> (v * 65535.0f + 0.5f)];
+        }
+    }
+}
+
+// separable filter, vertical taps accumulate whole source rows then the
+// horizontal taps run over that one row, every destination row is independent
+static void downsampleMipLevel (const MipSource& src, float* dst, uint8_t* encoded,
+                                uint32_t dstWidth, uint32_t dstHeight, const MipChainOptions& options)
+{
+    MipTaps xTaps = computeMipTaps (src.width, dstWidth, options);
+    MipTaps yTaps = computeMipTaps (src.height, dstHeight, options);
+
+    size_t srcCount = size_t (src.width) * src.channels;
+    size_t dstCount = size_t (dstWidth) * src.channels;
+    bool clampNegative = options.filter == MipFilter::Kaiser;
+
+    TaskScheduler::get().parallel_for (0, dstHeight, 0, [&] (uint32_t start, uint32_t end)
+                                       {
+        std::vector<float> accum (srcCount);
+        std::vector<float> scratch (src.linear ? 0 : srcCount);
+
+        for (uint32_t y = start; y < end; ++y)
+        {
+            std::fill (accum.begin(), accum.end(), 0.0f);
+            for (uint32_t t = yTaps.start[y], last = t + yTaps.count[y]; t < last; ++t)
+                accumulateMipRow (accum.data(), src.row (yTaps.index[t], scratch.data()), yTaps.weight[t], srcCount);
+
+            float* out = dst + y * dstCount;
+            filterMipRow (out, accum.data(), xTaps, dstWidth, src.channels);
+
+            // sinc lobes can undershoot next to hard edges
+            if (clampNegative)
+                for (size_t i = 0; i < dstCount; ++i)
+                    out[i] = std::max (out[i], 0.0f);
+
+            if (encoded)
+                encodeMipRow (encoded + y * dstCount, out, dstCount, src.channels, src.srgb);
+        } });
+}
+
+uint32_t MipChain::fullLevelCount (uint32_t width, uint32_t height)
+{
+    uint32_t levels = 1;
+    for (uint32_t size = std::max (width, height); size > 1; size >>= 1)
+        ++levels;
+    return levels;
+}
+
+MipChainRef MipChain::build (const OIIO::ImageBuf& image, const MipChainOptions& options)
+{
+    const OIIO::ImageSpec& spec = image.spec();
+    if (!image.initialized() || spec.width <= 0 || spec.height <= 0 || spec.nchannels <= 0)
+        return nullptr;
+
+    MipChainRef chain = std::make_shared<MipChain>();
+    chain->channels = static_cast<uint32_t> (spec.nchannels);
+    chain->floatData = spec.format != OIIO::TypeDesc::UINT8;
+
+    uint32_t width = static_cast<uint32_t> (spec.width);
+    uint32_t height = static_cast<uint32_t> (spec.height);
+    uint32_t levelCount = fullLevelCount (width, height);
+    if (options.maxLevels)
+        levelCount = std::min (levelCount, options.maxLevels);
+
+    // every level goes in one allocation
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < levelCount; ++i)
+    {
+        MipLevel level;
+        level.width = std::max (1u, width >> i);
+        level.height = std::max (1u, height >> i);
+        level.offset = offset;
+        level.bytes = uint64_t (level.width) * level.height * chain->channels * chain->getBytesPerChannel();
+        chain->levels.push_back (level);
+        offset = alignCacheOffset (offset + level.bytes);
+    }
+    chain->pixels.resize (offset);
+    chain->data = chain->pixels.data();
+
+    // level 0 is the source as is
+    OIIO::TypeDesc format = chain->floatData ? OIIO::TypeDesc::FLOAT : OIIO::TypeDesc::UINT8;
+    if (!image.get_pixels (image.roi(), format, chain->pixels.data()))
+    {
+        LOG (CRITICAL) << "Mip chain failed to read pixels: " << image.geterror();
+        return nullptr;
+    }
+
+    MipSource source;
+    source.width = width;
+    source.height = height;
+    source.channels = chain->channels;
+    source.srgb = options.srgb && !chain->floatData;
+    if (chain->floatData)
+        source.linear = reinterpret_cast<const float*> (chain->pixels.data());
+    else
+        source.bytes = chain->pixels.data();
+
+    // 8 bit chains filter from a float copy of the level above so error
+    // doesn't build up by requantizing at every level
+    std::vector<float> previous;
+    std::vector<float> current;
+
+    for (uint32_t i = 1; i < levelCount; ++i)
+    {
+        const MipLevel& level = chain->levels[i];
+        uint8_t* levelData = chain->pixels.data() + level.offset;
+
+        float* dst = nullptr;
+        uint8_t* encoded = nullptr;
+        if (chain->floatData)
+        {
+            dst = reinterpret_cast<float*> (levelData);
+        }
+        else
+        {
+            current.resize (size_t (level.width) * level.height * chain->channels);
+            dst = current.data();
+            encoded = levelData;
+        }
+
+        downsampleMipLevel (source, dst, encoded, level.width, level.height, options);
+
+        source.linear = dst;
+        source.bytes = nullptr;
+        source.width = level.width;
+        source.height = level.height;
+
+        // source now points into what was current
+        std::swap (previous, current);
+    }
+
+    return chain;
+}
+
+uint64_t MipChain::makeSourceKey (const std::filesystem::path& source, const MipChainOptions& options)
+{
+    uint32_t filter = static_cast<uint32_t> (options.filter);
+    uint32_t srgb = options.srgb ? 1 : 0;
+
+    uint64_t hash = hashSourceFile (source);
+    hash = hashBytes (&filter, sizeof (filter), hash);
+    hash = hashBytes (&srgb, sizeof (srgb), hash);
+    hash = hashBytes (&options.maxLevels, sizeof (options.maxLevels), hash);
+    if (options.filter == MipFilter::Kaiser)
+    {
+        hash = hashBytes (&options.kaiserWidth, sizeof (float), hash);
+        hash = hashBytes (&options.kaiserAlpha, sizeof (float), hash);
+        hash = hashBytes (&options.kaiserStretch, sizeof (float), hash);
+    }
+    return hash;
+}
+
+MipChainRef MipChain::load (const std::filesystem::path& path, uint64_t sourceKey)
+{
+    std::error_code ec;
+    if (!std::filesystem::exists (path, ec))
+        return nullptr;
+
+    MappedFileRef file = MappedFile::open (path);
+    if (!file || file->size() < sizeof (MipChainHeader))
+        return nullptr;
+
+    MipChainHeader header;
+    std::memcpy (&header, file->data(), sizeof (MipChainHeader));
+
+    if (std::memcmp (header.magic, NBMIP_MAGIC, sizeof (NBMIP_MAGIC)) != 0 ||
+        header.version != VERSION || header.sourceKey != sourceKey ||
+        header.fileSize != file->size() || header.channels == 0 || header.levelCount == 0)
+        return nullptr;
+
+    uint64_t recordStart = alignCacheOffset (sizeof (MipChainHeader));
+    uint64_t dataStart = alignCacheOffset (recordStart + uint64_t (header.levelCount) * sizeof (MipLevel));
+    if (dataStart > file->size())
+        return nullptr;
+
+    MipChainRef chain = std::make_shared<MipChain>();
+    chain->channels = header.channels;
+    chain->floatData = header.floatData != 0;
+    chain->levels.resize (header.levelCount);
+    std::memcpy (chain->levels.data(), file->data() + recordStart, header.levelCount * sizeof (MipLevel));
+
+    uint64_t dataBytes = file->size() - dataStart;
+    for (const MipLevel& level : chain->levels)
+    {
+        uint64_t expected = uint64_t (level.width) * level.height * chain->channels * chain->getBytesPerChannel();
+        if (level.bytes != expected || level.offset > dataBytes || level.bytes > dataBytes - level.offset)
+            return nullptr;
+    }
+
+    chain->file = file;
+    chain->data = file->data() + dataStart;
+    return chain;
+}
+
+bool MipChain::save (const std::filesystem::path& path, uint64_t sourceKey) const
+{
+    if (levels.empty()) return false;
+
+    try
+    {
+        if (path.has_parent_path())
+            std::filesystem::create_directories (path.parent_path());
+
+        uint64_t recordStart = alignCacheOffset (sizeof (MipChainHeader));
+        uint64_t dataStart = alignCacheOffset (recordStart + levels.size() * sizeof (MipLevel));
+        uint64_t dataBytes = levels.back().offset + levels.back().bytes;
+
+        MipChainHeader header = {};
+        std::memcpy (header.magic, NBMIP_MAGIC, sizeof (NBMIP_MAGIC));
+        header.version = VERSION;
+        header.channels = channels;
+        header.floatData = floatData ? 1 : 0;
+        header.levelCount = static_cast<uint32_t> (levels.size());
+        header.sourceKey = sourceKey;
+        header.fileSize = dataStart + dataBytes;
+
+        return writeFileAtomically (path, [&] (std::ofstream& out)
+                                    {
+            static const char zeros[CACHE_FILE_ALIGNMENT] = {};
+            out.write (reinterpret_cast<const char*> (&header), sizeof (header));
+            out.write (zeros, recordStart - sizeof (header));
+            out.write (reinterpret_cast<const char*> (levels.data()), levels.size() * sizeof (MipLevel));
+            out.write (zeros, dataStart - (recordStart + levels.size() * sizeof (MipLevel)));
+            out.write (reinterpret_cast<const char*> (data), dataBytes); });
+    }
+    catch (std::exception& e)
+    {
+        LOG (CRITICAL) << "Mip chain write failed: " << e.what();
+        return false;
+    }
+}
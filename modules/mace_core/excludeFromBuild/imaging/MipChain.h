@@ -0,0 +1,112 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+// CPU built mip chains (.nbmip)
+//
+// Each level is filtered from the one above it in linear space, 8 bit color
+// channels are sRGB decoded first and encoded again on the way out, alpha is
+// always linear. Rows of a level are filtered in parallel on the TaskScheduler.
+// Level sizes follow the CUDA convention, max (1, size >> level), so a chain
+// can be written straight into a mipmapped cudau::Array one level at a time.
+//
+// File layout, every section 16 byte aligned:
+//   MipChainHeader
+//   MipLevel[levelCount]
+//   pixel data, levels in order, rows tightly packed
+
+using MipChainRef = std::shared_ptr<class MipChain>;
+
+enum class MipFilter
+{
+    Box,   // area average, cheap and never rings
+    Kaiser // Kaiser windowed sinc, sharper but can ring at hard edges
+};
+
+struct MipChainOptions
+{
+    MipFilter filter = MipFilter::Box;
+    bool srgb = true;         // 8 bit color channels are sRGB encoded, ignored for float images
+    uint32_t maxLevels = 0;   // 0 builds all the way down to 1x1
+    float kaiserWidth = 3.0f; // filter radius in destination pixels
+    float kaiserAlpha = 4.0f;
+    float kaiserStretch = 1.0f;
+};
+
+struct MipLevel
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint64_t offset = 0; // into the chain's pixel data
+    uint64_t bytes = 0;
+};
+
+class MipChain : Noncopyable
+{
+ public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr const char* EXTENSION = ".nbmip";
+
+    // 8 bit images stay 8 bit, any other format becomes float
+    // the channel count of the source is kept, returns nullptr for an empty image
+    static MipChainRef build (const OIIO::ImageBuf& image, const MipChainOptions& options = MipChainOptions());
+
+    static uint32_t fullLevelCount (uint32_t width, uint32_t height);
+
+    // identifies the source file and the options a cached chain was built with
+    static uint64_t makeSourceKey (const std::filesystem::path& source, const MipChainOptions& options);
+
+    // returns nullptr if the file is missing, damaged or was written for another source key
+    static MipChainRef load (const std::filesystem::path& path, uint64_t sourceKey = 0);
+
+    // writes to a temporary file and renames it so a crash can't leave a half written chain
+    bool save (const std::filesystem::path& path, uint64_t sourceKey = 0) const;
+
+ public:
+    MipChain() = default;
+    ~MipChain() = default;
+
+    uint32_t getWidth() const { return levels.size() ? levels[0].width : 0; }
+    uint32_t getHeight() const { return levels.size() ? levels[0].height : 0; }
+    uint32_t getChannels() const { return channels; }
+    bool isFloat() const { return floatData; }
+    uint32_t getBytesPerChannel() const { return floatData ? sizeof (float) : sizeof (uint8_t); }
+
+    uint32_t getLevelCount() const { return static_cast<uint32_t> (levels.size()); }
+    const MipLevel& getLevel (uint32_t level) const { return levels[level]; }
+    const uint8_t* getLevelData (uint32_t level) const { return data + levels[level].offset; }
+
+    template <typename T>
+    const T* getLevelPixels (uint32_t level) const { return reinterpret_cast<const T*> (getLevelData (level)); }
+
+ private:
+    uint32_t channels = 0;
+    bool floatData = false;
+    std::vector<MipLevel> levels;
+
+    // pixels are either owned or mapped from a cache file
+    std::vector<uint8_t> pixels;
+    MappedFileRef file = nullptr;
+    const uint8_t* data = nullptr;
+};
@@ -0,0 +1,162 @@
+#include "PixelBlockPool.h"
+
+PixelBlock::PixelBlock (size_t bytes) :
+    bytes (bytes)
+{
+    storage = ::operator new (bytes, std::align_val_t (ALIGNMENT));
+}
+
+PixelBlock::~PixelBlock()
+{
+    ::operator delete (storage, std::align_val_t (ALIGNMENT));
+}
+
+PixelBlockPool::PixelBlockPool (size_t byteBudget) :
+    byteBudget (byteBudget)
+{
+}
+
+PixelBlockPool::~PixelBlockPool()
+{
+    // every held block keeps the pool alive so only free blocks are left here
+    trim();
+}
+
+PixelBlockRef PixelBlockPool::acquire (size_t bytes)
+{
+    return acquire (bytes, true);
+}
+
+PixelBlockRef PixelBlockPool::tryAcquire (size_t bytes)
+{
+    return acquire (bytes, false);
+}
+
+void PixelBlockPool::setByteBudget (size_t budget)
+{
+    std::lock_guard<std::mutex> lock (mutex);
+    byteBudget = budget;
+    evict (byteBudget);
+}
+
+size_t PixelBlockPool::getByteBudget() const
+{
+    std::lock_guard<std::mutex> lock (mutex);
+    return byteBudget;
+}
+
+PixelBlockPool::Stats PixelBlockPool::getStats() const
+{
+    std::lock_guard<std::mutex> lock (mutex);
+
+    Stats stats;
+    stats.budget = byteBudget;
+    stats.bytesInUse = bytesInUse;
+    stats.bytesFree = bytesFree;
+    stats.blocksInUse = blocksInUse;
+    stats.blocksFree = freeBlocks.size();
+    stats.reuses = reuses;
+    stats.allocations = allocations;
+    stats.evictions = evictions;
+    stats.overBudget = overBudget;
+    return stats;
+}
+
+void PixelBlockPool::trim()
+{
+    std::lock_guard<std::mutex> lock (mutex);
+    evict (0);
+}
+
+PixelBlockRef PixelBlockPool::acquire (size_t bytes, bool allowOverBudget)
+{
+    bytes = std::max<size_t> (1, (bytes + GRANULARITY - 1) / GRANULARITY) * GRANULARITY;
+
+    std::unique_lock<std::mutex> lock (mutex);
+
+    // smallest free block that fits without wasting more than a quarter
+    auto it = freeBySize.lower_bound (bytes);
+    if (it != freeBySize.end() && it->first <= bytes + bytes / 4)
+    {
+        PixelBlock* block = it->second->release();
+        freeBlocks.erase (it->second);
+        freeBySize.erase (it);
+
+        bytesFree -= block->size();
+        bytesInUse += block->size();
+        ++blocksInUse;
+        ++reuses;
+        return wrap (block);
+    }
+
+    // make room by dropping free blocks, oldest first
+    evict (byteBudget > bytes ? byteBudget - bytes : 0);
+
+    if (bytesInUse + bytesFree + bytes > byteBudget)
+    {
+        if (!allowOverBudget) return nullptr;
+        ++overBudget;
+    }
+
+    // reserve it now and allocate outside the lock
+    bytesInUse += bytes;
+    ++blocksInUse;
+    ++allocations;
+    lock.unlock();
+
+    try
+    {
+        return wrap (new PixelBlock (bytes));
+    }
+    catch (...)
+    {
+        lock.lock();
+        bytesInUse -= bytes;
+        --blocksInUse;
+        throw;
+    }
+}
+
+PixelBlockRef PixelBlockPool::wrap (PixelBlock* block)
+{
+    return PixelBlockRef (block, [pool = shared_from_this()] (PixelBlock* b)
+                          { pool->release (b); });
+}
+
+void PixelBlockPool::release (PixelBlock* block)
+{
+    std::lock_guard<std::mutex> lock (mutex);
+
+    bytesInUse -= block->size();
+    --blocksInUse;
+
+    freeBlocks.emplace_front (block);
+    freeBySize.emplace (block->size(), freeBlocks.begin());
+    bytesFree += block->size();
+
+    evict (byteBudget);
+}
+
+void PixelBlockPool::evict (size_t budget)
+{
+    while (!freeBlocks.empty() && bytesInUse + bytesFree > budget)
+    {
+        auto oldest = std::prev (freeBlocks.end());
+        size_t size = (*oldest)->size();
+
+        // several free blocks can share a size, find this one
+        auto range = freeBySize.equal_range (size);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == oldest)
+            {
+                freeBySize.erase (it);
+                break;
+            }
+        }
+
+        bytesFree -= size;
+        freeBlocks.erase (oldest);
+        ++evictions;
+    }
+}
@@ -0,0 +1,120 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+// Budgeted pool of pixel memory
+//
+// Blocks are handed out as shared pointers, so an image built on one stays valid for
+// as long as anybody holds it and every caller gets its own block. A released block
+// goes onto a free list so the next image of about the same size reuses it instead
+// of going back to the allocator. Free blocks are evicted least recently used first
+// whenever the pool would go over its byte budget, blocks still held are never touched.
+
+class PixelBlock : Noncopyable
+{
+ public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    explicit PixelBlock (size_t bytes);
+    ~PixelBlock();
+
+    void* data() { return storage; }
+    const void* data() const { return storage; }
+    size_t size() const { return bytes; }
+
+ private:
+    void* storage = nullptr;
+    size_t bytes = 0;
+};
+
+using PixelBlockRef = std::shared_ptr<PixelBlock>;
+using PixelBlockPoolRef = std::shared_ptr<class PixelBlockPool>;
+
+class PixelBlockPool : public std::enable_shared_from_this<PixelBlockPool>, Noncopyable
+{
+ public:
+    static constexpr size_t DEFAULT_BYTE_BUDGET = 256ull * 1024ull * 1024ull;
+
+    // blocks are rounded up to this, and a free block up to a quarter bigger than asked for is reused
+    static constexpr size_t GRANULARITY = 4096;
+
+    // blocks keep the pool alive, so it has to be owned by a shared_ptr
+    static PixelBlockPoolRef create (size_t byteBudget = DEFAULT_BYTE_BUDGET)
+    {
+        return std::make_shared<PixelBlockPool> (byteBudget);
+    }
+
+    struct Stats
+    {
+        size_t budget = 0;
+        size_t bytesInUse = 0;
+        size_t bytesFree = 0;
+        size_t blocksInUse = 0;
+        size_t blocksFree = 0;
+        uint64_t reuses = 0;
+        uint64_t allocations = 0;
+        uint64_t evictions = 0;
+        uint64_t overBudget = 0; // acquires that had to go over budget because everything was held
+    };
+
+ public:
+    explicit PixelBlockPool (size_t byteBudget = DEFAULT_BYTE_BUDGET);
+    ~PixelBlockPool();
+
+    // always returns a block, going over budget if everything is held
+    PixelBlockRef acquire (size_t bytes);
+
+    // nullptr rather than going over budget, for speculative work like prefetching
+    PixelBlockRef tryAcquire (size_t bytes);
+
+    void setByteBudget (size_t budget);
+    size_t getByteBudget() const;
+
+    Stats getStats() const;
+
+    // frees every block nobody holds
+    void trim();
+
+ private:
+    size_t byteBudget = DEFAULT_BYTE_BUDGET;
+
+    mutable std::mutex mutex;
+    std::list<std::unique_ptr<PixelBlock>> freeBlocks; // most recently released at the front
+    std::multimap<size_t, std::list<std::unique_ptr<PixelBlock>>::iterator> freeBySize;
+    size_t bytesInUse = 0;
+    size_t bytesFree = 0;
+    size_t blocksInUse = 0;
+
+    uint64_t reuses = 0;
+    uint64_t allocations = 0;
+    uint64_t evictions = 0;
+    uint64_t overBudget = 0;
+
+    PixelBlockRef acquire (size_t bytes, bool allowOverBudget);
+    PixelBlockRef wrap (PixelBlock* block);
+    void release (PixelBlock* block);
+
+    // caller holds the lock, frees blocks until the total fits in budget
+    void evict (size_t budget);
+};
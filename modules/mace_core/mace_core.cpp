@@ -1,10 +1,32 @@
 #include "berserkpch.h"
 #include "mace_core.h"
 
+// thread affinity for TaskScheduler and file mapping for MappedFile
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 ItemID HasId::sId = 0;
 
 namespace mace
 {
+	#include "excludeFromBuild/basics/MappedFile.cpp"
+	#include "excludeFromBuild/concurrency/TaskScheduler.cpp"
+	#include "excludeFromBuild/filesystem/DirectoryIndex.cpp"
+	#include "excludeFromBuild/imaging/PixelBlockPool.cpp"
+	#include "excludeFromBuild/imaging/ImageTiles.cpp"
 	#include "excludeFromBuild/imaging/CacheHandler.cpp"
+	#include "excludeFromBuild/imaging/DecodedImageCache.cpp"
+	#include "excludeFromBuild/imaging/MipChain.cpp"
+	#include "excludeFromBuild/imaging/EnvLightPreprocessor.cpp"
 
 } // namespace mace
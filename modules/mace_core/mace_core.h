@@ -27,6 +27,10 @@ SOFTWARE.
 #include <unordered_set>
 #include <array>
 #include <queue>
+#include <deque>
+#include <list>
+#include <map>
+#include <atomic>
 #include <stack>
 #include <fstream>
 #include <set>
@@ -42,6 +46,7 @@ SOFTWARE.
 #include <assert.h>
 #include <limits>
 #include <algorithm>
+#include <cctype>
 #include <functional>
 #include <stdint.h>
 #include <any>
@@ -64,6 +69,12 @@ SOFTWARE.
 #define COROUTINE_NAMESPACE std
 #endif
 
+// SSE2 is baseline on every x64 target
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MACE_SSE2 1
+#endif
+
 // eigen math
 #include <linalg/eigen34/Eigen/Dense>
 
@@ -104,8 +115,22 @@ namespace mace
 // basics
 #include "excludeFromBuild/basics/StringUtil.h"
 #include "excludeFromBuild/basics/InputEvent.h"
+#include "excludeFromBuild/basics/MappedFile.h"
+#include "excludeFromBuild/basics/SlotMap.h"
+
+// concurrency
+#include "excludeFromBuild/concurrency/TaskScheduler.h"
+#include "excludeFromBuild/concurrency/TripleBuffer.h"
+
+// filesystem
+#include "excludeFromBuild/filesystem/DirectoryIndex.h"
 
 // imaging
+#include "excludeFromBuild/imaging/PixelBlockPool.h"
+#include "excludeFromBuild/imaging/ImageTiles.h"
 #include "excludeFromBuild/imaging/CacheHandler.h"
+#include "excludeFromBuild/imaging/DecodedImageCache.h"
+#include "excludeFromBuild/imaging/MipChain.h"
+#include "excludeFromBuild/imaging/EnvLightPreprocessor.h"
 
 } // namespace mace
@@ -147,6 +147,103 @@ void CameraBody::zoom (float d)
     }
 }
 
+void CameraBody::generateRays (uint32_t x, uint32_t y, uint32_t width, uint32_t height, CameraRays& rays, bool transformed) const
+{
+    rays.resize (x, y, width, height);
+    rays.jitterU.setConstant (0.5f);
+    rays.jitterV.setConstant (0.5f);
+
+    // generateRay() does the pixel centre math in double, u only
+    // depends on the column and v on the row so each is done once
+    Eigen::ArrayXf columnU (width);
+    for (uint32_t i = 0; i < width; ++i)
+        columnU[i] = (2 * ((x + i + 0.5) * sensor.pixelSize().x()) - 1) * verticalFOVradians * sensor.getPixelAspectRatio();
+
+    for (uint32_t row = 0; row < height; ++row)
+    {
+        float v = (1 - 2 * ((y + row + 0.5) * sensor.pixelSize().y())) * verticalFOVradians;
+        rays.dirX.segment (Eigen::Index (row) * width, width) = columnU;
+        rays.dirY.segment (Eigen::Index (row) * width, width).setConstant (v);
+    }
+
+    finishRays (rays, transformed);
+}
+
+void CameraBody::generateJitteredRays (CameraRays& rays, bool transformed) const
+{
+    const float pixelWidth = sensor.pixelSize().x();
+    const float pixelHeight = sensor.pixelSize().y();
+    const float aspect = sensor.getPixelAspectRatio();
+
+    // same float math as the jittered generateRay(), a row at a time
+    const Eigen::ArrayXf columns = Eigen::ArrayXf::LinSpaced (rays.width, 0.0f, float (rays.width - 1)) + float (rays.x);
+    for (uint32_t row = 0; row < rays.height; ++row)
+    {
+        Eigen::Index start = Eigen::Index (row) * rays.width;
+        auto jitterU = rays.jitterU.segment (start, rays.width);
+        auto jitterV = rays.jitterV.segment (start, rays.width);
+        float py = float (rays.y + row);
+
+        rays.dirX.segment (start, rays.width) = ((2.0f * ((columns + jitterU) * pixelWidth) - 1.0f) * verticalFOVradians) * aspect;
+        rays.dirY.segment (start, rays.width) = (1.0f - 2.0f * ((py + jitterV) * pixelHeight)) * verticalFOVradians;
+    }
+
+    finishRays (rays, transformed);
+}
+
+// dirX and dirY come in holding u and v, normalizes (u, v, 1) and takes it into world space
+void CameraBody::finishRays (CameraRays& rays, bool transformed) const
+{
+    // a block of rays stays in registers and L1 without any heap scratch
+    constexpr Eigen::Index BLOCK = 64;
+    using Block = Eigen::Array<float, Eigen::Dynamic, 1, Eigen::ColMajor, BLOCK, 1>;
+
+    const Eigen::Matrix3f m = pose.linear();
+    const Eigen::Index count = rays.size();
+    for (Eigen::Index start = 0; start < count; start += BLOCK)
+    {
+        Eigen::Index n = std::min (BLOCK, count - start);
+        auto dirX = rays.dirX.segment (start, n);
+        auto dirY = rays.dirY.segment (start, n);
+        auto dirZ = rays.dirZ.segment (start, n);
+
+        // Eigen's squaredNorm() of a Vector3f sums as x * x + (y * y + z * z)
+        Block length = dirX.square() + (dirY.square() + 1.0f);
+
+        // Eigen's packet sqrt is only an approximation under EIGEN_FAST_MATH, sqrtps rounds like std::sqrt
+        float* l = length.data();
+        Eigen::Index i = 0;
+#if SABI_SSE2
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps (l + i, _mm_sqrt_ps (_mm_loadu_ps (l + i)));
+#endif
+        for (; i < n; ++i)
+            l[i] = std::sqrt (l[i]);
+
+        Block u = dirX / length;
+        Block v = dirY / length;
+        Block w = length.inverse();
+
+        if (transformed)
+        {
+            // and a 3x3 times Vector3f as m(i, 0) * x + (m(i, 1) * y + m(i, 2) * z)
+            dirX = m (0, 0) * u + (m (0, 1) * v + m (0, 2) * w);
+            dirY = m (1, 0) * u + (m (1, 1) * v + m (1, 2) * w);
+            dirZ = m (2, 0) * u + (m (2, 1) * v + m (2, 2) * w);
+        }
+        else
+        {
+            dirX = u;
+            dirY = v;
+            dirZ = w;
+        }
+    }
+
+    rays.originX.setConstant (pose.translation().x());
+    rays.originY.setConstant (pose.translation().y());
+    rays.originZ.setConstant (pose.translation().z());
+}
+
 void CameraBody::track (const Eigen::Vector2f& point2D)
 {
     Vector3f newPoint3D;
@@ -87,6 +87,35 @@ class CameraBody
         return wabi::Ray3<float> (pose.translation(), transformed ? pose.linear() * dir : dir);
     }
 
+    // Batched versions of generateRay() for a tile of pixels, or the whole sensor when the
+    // tile is the full pixel resolution. They give bit for bit the same rays as the scalar
+    // calls, as long as the compiler isn't allowed to contract multiply-adds into FMAs.
+
+    // rays through the pixel centres
+    void generateRays (uint32_t x, uint32_t y, uint32_t width, uint32_t height, CameraRays& rays, bool transformed = true) const;
+
+    // sampler (px, py) returns the sub-pixel jitter for pixel (px, py) as an Eigen::Vector2f
+    template <typename Sampler>
+    void generateRays (uint32_t x, uint32_t y, uint32_t width, uint32_t height, Sampler&& sampler, CameraRays& rays, bool transformed = true) const
+    {
+        rays.resize (x, y, width, height);
+
+        Eigen::Index i = 0;
+        for (uint32_t py = y; py < y + height; ++py)
+        {
+            for (uint32_t px = x; px < x + width; ++px, ++i)
+            {
+                Eigen::Vector2f jitter = sampler (px, py);
+                rays.jitterU[i] = jitter.x();
+                rays.jitterV[i] = jitter.y();
+            }
+        }
+        generateJitteredRays (rays, transformed);
+    }
+
+    // uses the tile and jitter already in rays, for callers that fill the jitter themselves
+    void generateJitteredRays (CameraRays& rays, bool transformed = true) const;
+
     void rotateAroundTarget (const Eigen::Quaternionf& q);
     void zoom (float d);
 
@@ -174,6 +203,8 @@ class CameraBody
     mutable Matrix4f inverseModelViewMatrix;
     mutable bool inverseModelViewCached;
 
+    void finishRays (CameraRays& rays, bool transformed) const;
+
     void calcMatrices() const;
     virtual void calcViewMatrix() const;
     virtual void calcInverseView() const;
@@ -0,0 +1,78 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// Primary rays for a rectangle of pixels, stored as structure of arrays
+//
+// Ray i belongs to pixel (x + i % width, y + i / width). Only origins and directions
+// are stored, so a tile of rays costs 32 bytes each instead of a full wabi::Ray3f with
+// its hit record, and every component can be processed a packet at a time.
+struct CameraRays
+{
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    Eigen::ArrayXf originX, originY, originZ;
+    Eigen::ArrayXf dirX, dirY, dirZ;
+
+    // sub-pixel position of each ray in [0, 1), 0.5 is the pixel centre
+    Eigen::ArrayXf jitterU, jitterV;
+
+    Eigen::Index size() const { return dirX.size(); }
+
+    void resize (uint32_t tileX, uint32_t tileY, uint32_t tileWidth, uint32_t tileHeight)
+    {
+        x = tileX;
+        y = tileY;
+        width = tileWidth;
+        height = tileHeight;
+
+        Eigen::Index count = Eigen::Index (tileWidth) * tileHeight;
+        for (Eigen::ArrayXf* a : {&originX, &originY, &originZ, &dirX, &dirY, &dirZ, &jitterU, &jitterV})
+            a->resize (count);
+    }
+
+    wabi::Ray3f getRay (Eigen::Index i) const
+    {
+        return wabi::Ray3f (Eigen::Vector3f (originX[i], originY[i], originZ[i]),
+                            Eigen::Vector3f (dirX[i], dirY[i], dirZ[i]));
+    }
+
+    // for the CPU ray queries, t runs over the Ray3 defaults
+    void toStream (wabi::RayStreamf& stream) const
+    {
+        stream.resize (size());
+        stream.column (stream.originX) = originX;
+        stream.column (stream.originY) = originY;
+        stream.column (stream.originZ) = originZ;
+        stream.column (stream.dirX) = dirX;
+        stream.column (stream.dirY) = dirY;
+        stream.column (stream.dirZ) = dirZ;
+        stream.column (stream.tMin).setConstant (std::numeric_limits<float>::epsilon());
+        stream.column (stream.tMax).setConstant (std::numeric_limits<float>::max());
+    }
+};
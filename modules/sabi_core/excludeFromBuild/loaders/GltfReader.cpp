@@ -3,157 +3,382 @@
 using Eigen::Vector3f;
 using sabi::Surface;
 
+// widen an index buffer to 32 bits and rebase it onto the mesh's shared vertex range
+static void copyIndices (const uint8_t* source, uint32_t* destination, size_t count, uint32_t baseVertex)
+{
+    size_t i = 0;
+#if SABI_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i base = _mm_set1_epi32 (static_cast<int> (baseVertex));
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (source + i));
+        __m128i lo = _mm_unpacklo_epi8 (v, zero);
+        __m128i hi = _mm_unpackhi_epi8 (v, zero);
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (destination + i), _mm_add_epi32 (_mm_unpacklo_epi16 (lo, zero), base));
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (destination + i + 4), _mm_add_epi32 (_mm_unpackhi_epi16 (lo, zero), base));
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (destination + i + 8), _mm_add_epi32 (_mm_unpacklo_epi16 (hi, zero), base));
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (destination + i + 12), _mm_add_epi32 (_mm_unpackhi_epi16 (hi, zero), base));
+    }
+#endif
+    for (; i < count; ++i)
+        destination[i] = source[i] + baseVertex;
+}
+
+static void copyIndices (const uint16_t* source, uint32_t* destination, size_t count, uint32_t baseVertex)
+{
+    size_t i = 0;
+#if SABI_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i base = _mm_set1_epi32 (static_cast<int> (baseVertex));
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (source + i));
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (destination + i), _mm_add_epi32 (_mm_unpacklo_epi16 (v, zero), base));
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (destination + i + 4), _mm_add_epi32 (_mm_unpackhi_epi16 (v, zero), base));
+    }
+#endif
+    for (; i < count; ++i)
+        destination[i] = source[i] + baseVertex;
+}
+
+static void copyIndices (const uint32_t* source, uint32_t* destination, size_t count, uint32_t baseVertex)
+{
+    if (baseVertex == 0)
+    {
+        std::memcpy (destination, source, count * sizeof (uint32_t));
+        return;
+    }
+
+    size_t i = 0;
+#if SABI_SSE2
+    const __m128i base = _mm_set1_epi32 (static_cast<int> (baseVertex));
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (source + i));
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (destination + i), _mm_add_epi32 (v, base));
+    }
+#endif
+    for (; i < count; ++i)
+        destination[i] = source[i] + baseVertex;
+}
+
 void GltfReader::read (const std::filesystem::path& filePath)
 {
     cgltf_options options = {};
     cgltf_data* data = nullptr;
     cgltf_result result = cgltf_parse_file (&options, filePath.string().c_str(), &data);
 
-    if (result == cgltf_result_success)
+    if (result != cgltf_result_success)
     {
-        result = cgltf_load_buffers (&options, data, filePath.string().c_str());
-        if (result != cgltf_result_success)
+        LOG (DBUG) << "Failed to read GLTF file: " << filePath;
+        return;
+    }
+
+    result = cgltf_load_buffers (&options, data, filePath.string().c_str());
+    if (result != cgltf_result_success)
+    {
+        LOG (DBUG) << "Failed to load external buffers.";
+        cgltf_free (data);
+        return;
+    }
+
+    // resolve the scene graph once instead of searching it for every mesh
+    std::vector<Eigen::Affine3f> worldTransforms;
+    computeWorldTransforms (data, worldTransforms);
+
+    // decode every mesh exactly once, meshes are independent so they can be decoded in parallel
+    uint32_t firstMesh = static_cast<uint32_t> (meshBuffers.size());
+    meshBuffers.resize (firstMesh + data->meshes_count);
+    mace::TaskScheduler::get().parallel_for (0, static_cast<uint32_t> (data->meshes_count), 1,
+                                             [&] (uint32_t start, uint32_t end)
+                                             {
+                                                 for (uint32_t i = start; i < end; ++i)
+                                                 {
+                                                     MeshBuffers& mesh = meshBuffers[firstMesh + i];
+                                                     decodeMesh (data->meshes[i], mesh);
+                                                     mesh.transform = Eigen::Affine3f::Identity();
+                                                 }
+                                             });
+
+    // every node that references a mesh is an instance of it, they all share the one decode
+    std::vector<bool> used (data->meshes_count, false);
+    for (cgltf_size i = 0; i < data->nodes_count; ++i)
+    {
+        const cgltf_node& node = data->nodes[i];
+        if (!node.mesh) continue;
+
+        cgltf_size mesh = node.mesh - data->meshes;
+        instances.push_back (MeshInstance{static_cast<uint32_t> (firstMesh + mesh), worldTransforms[i]});
+        used[mesh] = true;
+    }
+
+    // a mesh no node uses still gets loaded, untransformed
+    for (cgltf_size i = 0; i < data->meshes_count; ++i)
+    {
+        if (!used[i])
+            instances.push_back (MeshInstance{static_cast<uint32_t> (firstMesh + i), Eigen::Affine3f::Identity()});
+    }
+}
+
+void GltfReader::computeWorldTransforms (const cgltf_data* data, std::vector<Eigen::Affine3f>& worldTransforms)
+{
+    worldTransforms.assign (data->nodes_count, Eigen::Affine3f::Identity());
+
+    // depth first from every root so a parent is always finished before its children
+    std::vector<const cgltf_node*> stack;
+    stack.reserve (data->nodes_count);
+    for (cgltf_size i = 0; i < data->nodes_count; ++i)
+    {
+        if (data->nodes[i].parent == nullptr)
+            stack.push_back (&data->nodes[i]);
+    }
+
+    while (!stack.empty())
+    {
+        const cgltf_node* node = stack.back();
+        stack.pop_back();
+
+        cgltf_size index = node - data->nodes;
+        Eigen::Affine3f localTransform = getLocalTransform (*node);
+
+        if (node->parent)
+            worldTransforms[index] = worldTransforms[node->parent - data->nodes] * localTransform;
+        else
+            worldTransforms[index] = localTransform;
+
+        for (cgltf_size c = 0; c < node->children_count; ++c)
+            stack.push_back (node->children[c]);
+    }
+}
+
+Eigen::Affine3f GltfReader::getLocalTransform (const cgltf_node& node)
+{
+    Eigen::Affine3f localTransform = Eigen::Affine3f::Identity();
+
+    if (node.has_matrix)
+    {
+        // glTF matrices are column major, same as Eigen's default
+        localTransform.matrix() = Eigen::Map<const Eigen::Matrix4f> (node.matrix);
+    }
+    else
+    {
+        if (node.has_translation)
+            localTransform.translate (Eigen::Vector3f (node.translation[0], node.translation[1], node.translation[2]));
+        if (node.has_rotation)
+            localTransform.rotate (Eigen::Quaternionf (node.rotation[3], node.rotation[0], node.rotation[1], node.rotation[2]));
+        if (node.has_scale)
+            localTransform.scale (Eigen::Vector3f (node.scale[0], node.scale[1], node.scale[2]));
+    }
+
+    return localTransform;
+}
+
+void GltfReader::decodeMesh (const cgltf_mesh& cgltfMesh, MeshBuffers& mesh)
+{
+    struct PrimitiveAccessors
+    {
+        const cgltf_primitive* primitive = nullptr;
+        const cgltf_accessor* position = nullptr;
+        const cgltf_accessor* normal = nullptr;
+        const cgltf_accessor* uv = nullptr;
+        uint32_t baseVertex = 0;
+    };
+
+    // find every primitive's accessors first so V, N and the uvs are sized once
+    // and each primitive decodes into its own range of the shared vertex buffers
+    std::vector<PrimitiveAccessors> primitives;
+    primitives.reserve (cgltfMesh.primitives_count);
+
+    uint32_t vertexCount = 0;
+    bool hasNormals = true;
+    bool hasUVs = false;
+
+    for (cgltf_size j = 0; j < cgltfMesh.primitives_count; ++j)
+    {
+        const cgltf_primitive& primitive = cgltfMesh.primitives[j];
+        if (primitive.type != cgltf_primitive_type_triangles)
         {
-            LOG (DBUG) << "Failed to load external buffers.";
-            cgltf_free (data);
-            return;
+            LOG (DBUG) << "Skipping non triangle primitive in " << (cgltfMesh.name ? cgltfMesh.name : "unnamed mesh");
+            continue;
         }
-        // Loop through each mesh
-        for (cgltf_size i = 0; i < data->meshes_count; ++i)
+
+        PrimitiveAccessors p;
+        p.primitive = &primitive;
+
+        for (cgltf_size k = 0; k < primitive.attributes_count; ++k)
         {
-            cgltf_mesh& cgltfMesh = data->meshes[i];
-            MeshBuffers mesh;
+            const cgltf_attribute& attribute = primitive.attributes[k];
+
+            if (attribute.type == cgltf_attribute_type_position)
+                p.position = attribute.data;
+            else if (attribute.type == cgltf_attribute_type_normal)
+                p.normal = attribute.data;
+            else if (attribute.type == cgltf_attribute_type_texcoord && attribute.index == 0)
+                p.uv = attribute.data;
+        }
 
-            // Loop through each primitive in the mesh
-            for (cgltf_size j = 0; j < cgltfMesh.primitives_count; ++j)
-            {
-                cgltf_primitive& primitive = cgltfMesh.primitives[j];
-                Surface surface;
-
-                cgltf_accessor* vertexAccessor = nullptr;
-                cgltf_accessor* normalAccessor = nullptr;
-                cgltf_accessor* uvAccessor = nullptr;
-                cgltf_accessor* indexAccessor = primitive.indices;
-
-                // Loop through each attribute in the primitive
-                for (cgltf_size k = 0; k < primitive.attributes_count; ++k)
-                {
-                    cgltf_attribute& attribute = primitive.attributes[k];
-
-                    if (attribute.type == cgltf_attribute_type_position)
-                    {
-                        vertexAccessor = attribute.data;
-                    }
-                    else if (attribute.type == cgltf_attribute_type_normal)
-                    {
-                        normalAccessor = attribute.data;
-                    }
-                    else if (attribute.type == cgltf_attribute_type_texcoord)
-                    {
-                        uvAccessor = attribute.data;
-                    }
-
-                    // Search for the node referencing the current mesh
-                    Eigen::Affine3f transform = Eigen::Affine3f::Identity();
-                    for (cgltf_size k = 0; k < data->nodes_count; ++k)
-                    {
-                        if (data->nodes[k].mesh == &cgltfMesh)
-                        {
-                            cgltf_node* node = &data->nodes[k];
-                            while (node)
-                            {
-                                Eigen::Affine3f localTransform = Eigen::Affine3f::Identity();
-                                localTransform.translate (Eigen::Vector3f (node->translation[0], node->translation[1], node->translation[2]));
-                                localTransform.rotate (Eigen::Quaternionf (node->rotation[3], node->rotation[0], node->rotation[1], node->rotation[2]));
-                                localTransform.scale (Eigen::Vector3f (node->scale[0], node->scale[1], node->scale[2]));
-
-                                transform = localTransform * transform;
-                                node = node->parent;
-                            }
-                            break; // Exit the loop once the node is found
-                        }
-                    }
-
-                    mesh.transform = transform;
-                }
-
-                // Fill in vertex and normal data
-                if (vertexAccessor)
-                {
-                    mesh.V.resize (3, vertexAccessor->count);
-                    getVertexAttributes (mesh.V, vertexAccessor);
-                }
-
-                if (normalAccessor)
-                {
-                    mesh.N.resize (3, normalAccessor->count);
-                    getVertexAttributes (mesh.N, normalAccessor);
-                }
-
-                // Fill in index data
-                if (indexAccessor)
-                {
-                    surface.F.resize (3, indexAccessor->count / 3); // Assuming triangles
-                    getTriangleIndices (surface.F, indexAccessor);
-                }
-
-                // Fill in uv data
-                if (uvAccessor)
-                {
-                    surface.uvs.resize (uvAccessor->count);
-                    getUVs (surface.uvs, uvAccessor);
-                }
-
-                // Fill in material data
-                surface.material = *primitive.material;
-
-                // Add the surface to the list of surfaces for this mesh
-                mesh.surfaces.push_back (surface);
-            }
+        if (p.position == nullptr || p.position->count == 0) continue;
 
-            // Search for the node referencing the current mesh
-            Eigen::Affine3f transform = Eigen::Affine3f::Identity();
-            for (cgltf_size k = 0; k < data->nodes_count; ++k)
-            {
-                if (data->nodes[k].mesh == &cgltfMesh)
-                {
-                    cgltf_node* node = &data->nodes[k];
-                    while (node)
-                    {
-                        Eigen::Affine3f localTransform = Eigen::Affine3f::Identity();
-
-                        if (node->has_matrix)
-                        {
-                            localTransform.matrix() << node->matrix[0], node->matrix[1], node->matrix[2], node->matrix[3],
-                                node->matrix[4], node->matrix[5], node->matrix[6], node->matrix[7],
-                                node->matrix[8], node->matrix[9], node->matrix[10], node->matrix[11],
-                                node->matrix[12], node->matrix[13], node->matrix[14], node->matrix[15];
-                        }
-                        else
-                        {
-                            localTransform.translate (Eigen::Vector3f (node->translation[0], node->translation[1], node->translation[2]));
-                            localTransform.rotate (Eigen::Quaternionf (node->rotation[3], node->rotation[0], node->rotation[1], node->rotation[2]));
-                            localTransform.scale (Eigen::Vector3f (node->scale[0], node->scale[1], node->scale[2]));
-                        }
-
-                        transform = localTransform * transform;
-                        node = node->parent;
-                    }
-                    break; // Exit the loop once the node is found
-                }
-            }
-            //mace::matStr4f (transform, DBUG, "Mesh transform");
+        p.baseVertex = vertexCount;
+        vertexCount += static_cast<uint32_t> (p.position->count);
 
-            // Store the world transform for this mesh
-            mesh.transform = transform;
+        hasNormals = hasNormals && p.normal && p.normal->count == p.position->count;
+        hasUVs = hasUVs || (p.uv && p.uv->count == p.position->count);
 
-            // Add to the list of all mesh mesh
-            meshBuffers.push_back (mesh);
+        primitives.push_back (p);
+    }
+
+    mesh.V.resize (3, vertexCount);
+    mesh.N.resize (3, hasNormals ? vertexCount : 0);
+    mesh.surfaces.resize (primitives.size());
+
+    // uvs are per mesh vertex so they all live on the first surface
+    std::vector<Vector2f> uvs;
+    if (hasUVs)
+        uvs.assign (vertexCount, Vector2f::Zero());
+
+    for (size_t j = 0; j < primitives.size(); ++j)
+    {
+        const PrimitiveAccessors& p = primitives[j];
+        Surface& surface = mesh.surfaces[j];
+
+        decodeFloats (p.position, mesh.V.col (p.baseVertex).data(), 3);
+
+        if (hasNormals)
+            decodeFloats (p.normal, mesh.N.col (p.baseVertex).data(), 3);
+
+        if (hasUVs && p.uv && p.uv->count == p.position->count)
+            decodeFloats (p.uv, uvs[p.baseVertex].data(), 2);
+
+        const cgltf_accessor* indexAccessor = p.primitive->indices;
+        if (indexAccessor)
+        {
+            surface.F.resize (3, indexAccessor->count / 3);
+            decodeIndices (indexAccessor, surface.F.data(), surface.F.size(), p.baseVertex);
+        }
+        else
+        {
+            // non indexed primitives are a plain triangle list
+            surface.F.resize (3, p.position->count / 3);
+            for (Eigen::Index i = 0; i < surface.F.size(); ++i)
+                surface.F.data()[i] = p.baseVertex + static_cast<uint32_t> (i);
         }
+
+        // Fill in material data, primitives without one get an empty material
+        surface.material = p.primitive->material ? *p.primitive->material : cgltf_material{};
     }
-    else
+
+    if (hasUVs)
+        mesh.surfaces[0].uvs = std::move (uvs);
+}
+
+void GltfReader::decodeFloats (const cgltf_accessor* accessor, float* destination, cgltf_size components)
+{
+    if (cgltf_num_components (accessor->type) != components)
     {
-        LOG (DBUG) << "Failed to read GLTF file: " << filePath;
+        LOG (DBUG) << "Accessor components do not match destination.";
+        std::memset (destination, 0, accessor->count * components * sizeof (float));
+        return;
+    }
+
+    const uint8_t* source = (accessor->is_sparse || accessor->buffer_view == nullptr) ? nullptr : cgltf_buffer_view_data (accessor->buffer_view);
+
+    // plain float data is read in place, a column major 3 x N matrix has the same
+    // layout as a packed float3 buffer so that case is a single memcpy
+    if (source && accessor->component_type == cgltf_component_type_r_32f)
+    {
+        source += accessor->offset;
+        size_t elementSize = components * sizeof (float);
+
+        if (accessor->stride == elementSize)
+        {
+            std::memcpy (destination, source, accessor->count * elementSize);
+        }
+        else
+        {
+            // interleaved vertex data
+            for (cgltf_size i = 0; i < accessor->count; ++i)
+                std::memcpy (destination + i * components, source + i * accessor->stride, elementSize);
+        }
+        return;
+    }
+
+    // sparse, normalized integer and missing buffer views go through cgltf which
+    // also writes tightly packed floats, so it still lands straight in the destination
+    cgltf_size expected = accessor->count * components;
+    cgltf_size unpacked = cgltf_accessor_unpack_floats (accessor, destination, expected);
+    if (unpacked != expected)
+        LOG (DBUG) << "Failed to unpack all floats. Expected " << expected << ", got " << unpacked;
+}
+
+void GltfReader::decodeIndices (const cgltf_accessor* accessor, uint32_t* destination, cgltf_size count, uint32_t baseVertex)
+{
+    count = std::min (count, accessor->count);
+
+    const uint8_t* source = (accessor->is_sparse || accessor->buffer_view == nullptr) ? nullptr : cgltf_buffer_view_data (accessor->buffer_view);
+    if (source)
+    {
+        source += accessor->offset;
+        cgltf_size componentSize = cgltf_component_size (accessor->component_type);
+
+        if (accessor->stride == componentSize)
+        {
+            switch (accessor->component_type)
+            {
+                case cgltf_component_type_r_8u:
+                    copyIndices (source, destination, count, baseVertex);
+                    return;
+                case cgltf_component_type_r_16u:
+                    copyIndices (reinterpret_cast<const uint16_t*> (source), destination, count, baseVertex);
+                    return;
+                case cgltf_component_type_r_32u:
+                    copyIndices (reinterpret_cast<const uint32_t*> (source), destination, count, baseVertex);
+                    return;
+                default:
+                    break;
+            }
+        }
+
+        // strided index data
+        for (cgltf_size i = 0; i < count; ++i)
+            destination[i] = static_cast<uint32_t> (cgltf_accessor_read_index (accessor, i)) + baseVertex;
+        return;
+    }
+
+    // sparse index data, the base indices (zeros without a buffer view) with the
+    // substitutions written over them. cgltf only unpacks sparse accessors as floats,
+    // which stops being exact past 2^24, so both arrays are read as plain index accessors
+    cgltf_accessor base = *accessor;
+    base.is_sparse = false;
+    for (cgltf_size i = 0; i < count; ++i)
+        destination[i] = static_cast<uint32_t> (cgltf_accessor_read_index (&base, i)) + baseVertex;
+
+    const cgltf_accessor_sparse& sparse = accessor->sparse;
+
+    cgltf_accessor sparseIndices{};
+    sparseIndices.type = cgltf_type_scalar;
+    sparseIndices.component_type = sparse.indices_component_type;
+    sparseIndices.buffer_view = sparse.indices_buffer_view;
+    sparseIndices.offset = sparse.indices_byte_offset;
+    sparseIndices.stride = cgltf_component_size (sparse.indices_component_type);
+
+    cgltf_accessor sparseValues{};
+    sparseValues.type = cgltf_type_scalar;
+    sparseValues.component_type = accessor->component_type;
+    sparseValues.buffer_view = sparse.values_buffer_view;
+    sparseValues.offset = sparse.values_byte_offset;
+    sparseValues.stride = cgltf_component_size (accessor->component_type);
+
+    for (cgltf_size i = 0; i < sparse.count; ++i)
+    {
+        cgltf_size target = cgltf_accessor_read_index (&sparseIndices, i);
+        if (target >= count)
+        {
+            LOG (DBUG) << "Sparse index " << target << " is outside the " << count << " indices";
+            continue;
+        }
+        destination[target] = static_cast<uint32_t> (cgltf_accessor_read_index (&sparseValues, i)) + baseVertex;
     }
 }
 
@@ -229,113 +454,3 @@ void GltfReader::debug()
         }
     }
 }
-
-void GltfReader::getUVs (std::vector<Vector2f>& vec, cgltf_accessor* accessor)
-{
-    size_t numUVs = accessor->count;
-    std::vector<float> temp (numUVs * 2);
-    cgltf_size num_floats = cgltf_accessor_unpack_floats (accessor, &temp[0], temp.size());
-
-    if (num_floats != temp.size())
-    {
-        LOG (DBUG) << "Failed to unpack all floats. Expected " << temp.size() << ", got " << num_floats;
-        return;
-    }
-
-    vec.resize (numUVs);
-    for (size_t i = 0; i < numUVs; ++i)
-    {
-        float u = (float)temp[i * 2];
-        float v = (float)temp[i * 2 + 1];
-        vec[i] = Vector2f (u, v);
-    }
-}
-void GltfReader::getTriangleIndices (MatrixXu& matrix, cgltf_accessor* accessor)
-{
-    if (accessor == nullptr)
-    {
-        LOG (DBUG) << "Invalid accessor.";
-        return;
-    }
-
-    if (accessor->buffer_view == nullptr || accessor->buffer_view->buffer == nullptr)
-    {
-        LOG (DBUG) << "Invalid buffer or buffer view.";
-        return;
-    }
-
-    size_t numTriangles = accessor->count / 3;
-    matrix.resize (3, numTriangles);
-
-    // Corrected stride calculation
-    cgltf_size stride = accessor->stride ? accessor->stride : cgltf_size (accessor->component_type);
-
-    uint8_t* buffer = (uint8_t*)accessor->buffer_view->buffer->data;
-    uint8_t* offset_ptr = buffer + accessor->offset + accessor->buffer_view->offset;
-
-    if (accessor->component_type == cgltf_component_type_r_16u)
-    {
-        for (size_t i = 0; i < numTriangles; ++i)
-        {
-            uint16_t* idx = reinterpret_cast<uint16_t*> (offset_ptr + i * 3 * stride);
-            for (size_t j = 0; j < 3; ++j)
-            {
-                matrix (j, i) = static_cast<unsigned int> (idx[j]);
-            }
-        }
-    }
-    else if (accessor->component_type == cgltf_component_type_r_32u)
-    {
-        for (size_t i = 0; i < numTriangles; ++i)
-        {
-            uint32_t* idx = reinterpret_cast<uint32_t*> (offset_ptr + i * 3 * stride);
-            for (size_t j = 0; j < 3; ++j)
-            {
-                matrix (j, i) = idx[j];
-            }
-        }
-    }
-    else
-    {
-        LOG (DBUG) << "Unsupported index component type.";
-    }
-}
-
-void GltfReader::getVertexAttributes (Eigen::MatrixXf& matrix, const cgltf_accessor* accessor)
-{
-    if (accessor == nullptr)
-    {
-        LOG (DBUG) << "Invalid accessor.";
-        return;
-    }
-
-    if (accessor->buffer_view == nullptr || accessor->buffer_view->buffer == nullptr)
-    {
-        LOG (DBUG) << "Invalid buffer or buffer view.";
-        return;
-    }
-
-    size_t components = cgltf_num_components (accessor->type);
-    if (components != matrix.rows())
-    {
-        LOG (DBUG) << "Accessor components do not match matrix rows.";
-        return;
-    }
-
-    std::vector<float> temp (components * accessor->count);
-    cgltf_size num_floats = cgltf_accessor_unpack_floats (accessor, &temp[0], temp.size());
-
-    if (num_floats != temp.size())
-    {
-        LOG (DBUG) << "Failed to unpack all floats. Expected " << temp.size() << ", got " << num_floats;
-        return;
-    }
-
-    for (size_t i = 0; i < components; ++i)
-    {
-        for (size_t j = 0; j < accessor->count; ++j)
-        {
-            matrix (i, j) = temp[j * components + i];
-        }
-    }
-}
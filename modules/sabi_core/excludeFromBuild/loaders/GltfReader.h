@@ -28,6 +28,7 @@ SOFTWARE.
 using Eigen::MatrixXf;
 using Eigen::Vector2f;
 using sabi::MeshBuffers;
+using sabi::MeshInstance;
 
 class GltfReader
 {
@@ -35,15 +36,28 @@ class GltfReader
     void read (const std::filesystem::path& filePath);
     void debug();
 
+    // every glTF mesh decoded once, untransformed
     const std::vector<MeshBuffers>& getMeshes() const { return meshBuffers; }
     std::vector<MeshBuffers>& getMeshes() { return meshBuffers; }
 
+    // one per node that references a mesh, a mesh no node uses gets one untransformed instance
+    const std::vector<MeshInstance>& getInstances() const { return instances; }
+    std::vector<MeshInstance>& getInstances() { return instances; }
+
  private:
     std::vector<MeshBuffers> meshBuffers;
+    std::vector<MeshInstance> instances;
     
-    void getVertexAttributes (Eigen::MatrixXf& matrix, const cgltf_accessor* accessor);
-    void getTriangleIndices (MatrixXu& matrix, cgltf_accessor* accessor);
-    void getUVs (std::vector<Vector2f>& vec, cgltf_accessor* accessor);
+    // world transform of every node, resolved once in parent before child order
+    void computeWorldTransforms (const cgltf_data* data, std::vector<Eigen::Affine3f>& worldTransforms);
+    Eigen::Affine3f getLocalTransform (const cgltf_node& node);
+
+    void decodeMesh (const cgltf_mesh& cgltfMesh, MeshBuffers& mesh);
+
+    // decode straight into the destination, reading the buffer in place when it's tightly packed
+    // and falling back to cgltf's unpacking for sparse, normalized or other component types
+    void decodeFloats (const cgltf_accessor* accessor, float* destination, cgltf_size components);
+    void decodeIndices (const cgltf_accessor* accessor, uint32_t* destination, cgltf_size count, uint32_t baseVertex);
     void debugMaterial (const cgltf_material* material);
     
 };
@@ -0,0 +1,198 @@
+#include "IngestPipeline.h"
+
+IngestPipeline::IngestPipeline (IngestStages&& stages, uint32_t maxInFlight, uint32_t maxCommitsPerUpdate) :
+    stages (std::move (stages)),
+    maxInFlight (std::max (1u, maxInFlight)),
+    maxCommitsPerUpdate (std::max (1u, maxCommitsPerUpdate))
+{
+}
+
+IngestPipeline::~IngestPipeline()
+{
+    // the workers hold a pointer to us so wait for every one of them
+    ++generation;
+    pending.clear();
+
+    std::deque<IngestJobRef> jobs;
+    while (inFlight > 0)
+    {
+        takeReady (jobs, true);
+        inFlight -= static_cast<uint32_t> (jobs.size());
+        jobs.clear();
+    }
+}
+
+void IngestPipeline::submit (const std::filesystem::path& path)
+{
+    IngestJobRef job = std::make_shared<IngestJob>();
+    job->id = nextId++;
+    job->path = path;
+
+    pending.push_back (job);
+    ++progress.submitted;
+
+    dispatch();
+}
+
+void IngestPipeline::cancel()
+{
+    {
+        // under the lock so a worker can't slip a stale job into ready after this
+        std::lock_guard<std::mutex> lock (readyMutex);
+        ++generation;
+
+        // finished but not yet committed
+        for (auto& job : ready)
+            job->cancelled = true;
+    }
+
+    uint32_t dropped = static_cast<uint32_t> (pending.size()) + inFlight;
+    progress.cancelled += static_cast<uint32_t> (pending.size());
+    pending.clear();
+
+    // in flight jobs are counted when they come back through update()
+    if (dropped)
+        cancelEmitter.fire (dropped);
+}
+
+void IngestPipeline::update()
+{
+    std::deque<IngestJobRef> jobs;
+    takeReady (jobs, false);
+
+    bool changed = !jobs.empty();
+    uint32_t commits = 0;
+    while (!jobs.empty())
+    {
+        // over budget, put the rest back for the next update
+        if (commits == maxCommitsPerUpdate)
+        {
+            std::lock_guard<std::mutex> lock (readyMutex);
+            ready.insert (ready.begin(), jobs.begin(), jobs.end());
+            break;
+        }
+
+        IngestJobRef job = jobs.front();
+        jobs.pop_front();
+        --inFlight;
+
+        progress.lastPath = job->path;
+
+        if (job->cancelled)
+        {
+            ++progress.cancelled;
+            continue;
+        }
+
+        if (job->error.empty() && stages.commit)
+        {
+            try
+            {
+                stages.commit (*job);
+                ++commits;
+            }
+            catch (std::exception& e)
+            {
+                job->error = e.what();
+            }
+        }
+
+        if (job->error.empty())
+        {
+            ++progress.committed;
+        }
+        else
+        {
+            ++progress.failed;
+            LOG (CRITICAL) << "Failed to import " << job->path.generic_string() << ": " << job->error;
+        }
+    }
+
+    dispatch();
+
+    if (changed)
+        progressEmitter.fire (progress);
+}
+
+void IngestPipeline::flush()
+{
+    while (!isIdle())
+    {
+        {
+            // sleep until a worker has something for us
+            std::unique_lock<std::mutex> lock (readyMutex);
+            readyCondition.wait (lock, [this]()
+                                 { return !ready.empty(); });
+        }
+        update();
+    }
+}
+
+void IngestPipeline::dispatch()
+{
+    mace::TaskScheduler& scheduler = mace::TaskScheduler::get();
+    uint64_t jobGeneration = generation.load();
+
+    while (!pending.empty() && inFlight < maxInFlight)
+    {
+        IngestJobRef job = pending.front();
+        pending.pop_front();
+        ++inFlight;
+
+        scheduler.submit ([this, job, jobGeneration]()
+                          { runCpuStages (job, jobGeneration); });
+    }
+}
+
+void IngestPipeline::runCpuStages (IngestJobRef job, uint64_t jobGeneration)
+{
+    const IngestStageTask* cpuStages[] = {&stages.parse, &stages.process, &stages.materials};
+
+    for (const IngestStageTask* stage : cpuStages)
+    {
+        // give up between stages once the job has been cancelled
+        if (generation.load() != jobGeneration)
+        {
+            job->cancelled = true;
+            break;
+        }
+
+        if (!*stage) continue;
+
+        try
+        {
+            (*stage) (*job);
+        }
+        catch (std::exception& e)
+        {
+            job->error = e.what();
+            break;
+        }
+    }
+
+    // the parsed source is only needed by the CPU stages
+    job->source = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock (readyMutex);
+        if (generation.load() != jobGeneration)
+            job->cancelled = true;
+
+        ready.push_back (job);
+
+        // notify before unlocking, the destructor may be waiting to free us
+        readyCondition.notify_all();
+    }
+}
+
+bool IngestPipeline::takeReady (std::deque<IngestJobRef>& jobs, bool wait)
+{
+    std::unique_lock<std::mutex> lock (readyMutex);
+    if (wait)
+        readyCondition.wait (lock, [this]()
+                             { return !ready.empty(); });
+
+    jobs.insert (jobs.end(), ready.begin(), ready.end());
+    ready.clear();
+    return !jobs.empty();
+}
@@ -0,0 +1,123 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+// Staged import of scene files so a big drop doesn't stall the frame loop
+//
+//   parse -> process -> materials    worker threads, a job runs its CPU stages back to back
+//   commit                           caller's thread, from update()
+//
+// At most maxInFlight jobs are between dispatch and commit at any time, which
+// bounds how much parsed data can pile up waiting for the main thread. Signals
+// are only fired from update() and cancel() so slots may touch the UI.
+
+using IngestJobRef = std::shared_ptr<struct IngestJob>;
+
+struct IngestJob
+{
+    uint64_t id = 0;
+    std::filesystem::path path;
+
+    std::shared_ptr<void> source = nullptr;           // parse output, whatever the loader needs to keep until process
+    MeshCacheViewRef meshes = nullptr;                // process output
+    wabi::TriangleBVHRef bvh = nullptr;               // process output, CPU copy of the uploaded triangles for picking
+    std::vector<std::filesystem::path> texturePaths;  // materials output, one per material, empty if it has no texture
+    std::vector<mace::DecodedImageRef> images;        // decoded textures, parallel to texturePaths, nullptr if none
+
+    std::string error;
+    bool cancelled = false;
+};
+
+struct IngestProgress
+{
+    uint32_t submitted = 0;
+    uint32_t committed = 0;
+    uint32_t failed = 0;
+    uint32_t cancelled = 0;
+    std::filesystem::path lastPath; // most recently finished job
+
+    uint32_t finished() const { return committed + failed + cancelled; }
+    bool isIdle() const { return finished() == submitted; }
+};
+
+using IngestStageTask = std::function<void (IngestJob& job)>;
+using OnIngestProgressSignal = Nano::Signal<void (const IngestProgress&)>;
+using OnIngestCancelSignal = Nano::Signal<void (uint32_t droppedJobs)>;
+
+// any stage may be empty, a throwing stage fails the job
+struct IngestStages
+{
+    IngestStageTask parse;     // read the source file
+    IngestStageTask process;   // welding, normals, bounds
+    IngestStageTask materials; // resolve and decode textures
+    IngestStageTask commit;    // upload and create bodies, runs on the thread calling update()
+};
+
+class IngestPipeline : Noncopyable
+{
+ public:
+    OnIngestProgressSignal progressEmitter;
+    OnIngestCancelSignal cancelEmitter;
+
+ public:
+    IngestPipeline (IngestStages&& stages, uint32_t maxInFlight = 4, uint32_t maxCommitsPerUpdate = 1);
+    ~IngestPipeline();
+
+    void submit (const std::filesystem::path& path);
+
+    // drops queued jobs and discards in flight ones when they come back
+    void cancel();
+
+    // commits finished jobs, dispatches queued ones and reports progress
+    void update();
+
+    // calls update until every submitted job has finished
+    void flush();
+
+    bool isIdle() const { return progress.isIdle(); }
+    const IngestProgress& getProgress() const { return progress; }
+
+ private:
+    IngestStages stages;
+    uint32_t maxInFlight = 4;
+    uint32_t maxCommitsPerUpdate = 1;
+
+    // owned by the thread calling update()
+    std::deque<IngestJobRef> pending;
+    uint32_t inFlight = 0;
+    uint64_t nextId = 0;
+    IngestProgress progress;
+
+    // filled by the workers
+    std::mutex readyMutex;
+    std::condition_variable readyCondition;
+    std::deque<IngestJobRef> ready;
+
+    // bumped by cancel, jobs dispatched under an older generation are dropped
+    std::atomic<uint64_t> generation = 0;
+
+    void dispatch();
+    void runCpuStages (IngestJobRef job, uint64_t jobGeneration);
+    bool takeReady (std::deque<IngestJobRef>& jobs, bool wait);
+};
@@ -0,0 +1,454 @@
+#include "MeshCache.h"
+
+// on disk records, see the layout in MeshCache.h
+struct MeshCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t meshCount;
+    uint32_t surfaceCount;
+    uint32_t materialCount;
+    uint64_t pathHash;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t contentHash;
+    uint64_t fileSize;
+};
+
+struct MeshRecord
+{
+    uint32_t vertexCount;
+    uint32_t faceNormalCount;
+    uint32_t firstSurface;
+    uint32_t surfaceCount;
+    uint64_t V;  // offsets into the file, 0 when absent
+    uint64_t N;
+    uint64_t FN;
+    float bounds[6];
+    float transform[16];
+    uint32_t mesh;
+    uint32_t padding;
+};
+
+struct SurfaceRecord
+{
+    uint32_t triangleCount;
+    uint32_t uvCount;
+    int32_t materialRef;
+    uint32_t padding;
+    uint64_t F;
+    uint64_t UV;
+    uint64_t materialIDs;
+};
+
+struct MaterialRecord
+{
+    int32_t sourceIndex;
+    float diffuse[3];
+    uint64_t name;
+    uint64_t texture;
+    uint32_t nameLength;
+    uint32_t textureLength;
+    uint32_t linearDiffuse;
+    uint32_t padding;
+};
+
+// no padding the compiler adds on its own, store() zeroes the explicit
+// fields so the same meshes always write the same bytes
+static_assert (sizeof (MeshCacheHeader) == 64 && sizeof (MeshRecord) == 136 &&
+                   sizeof (SurfaceRecord) == 40 && sizeof (MaterialRecord) == 48,
+               "nbmesh records changed size, bump MeshCache::VERSION");
+
+static constexpr char NBMESH_MAGIC[8] = {'N', 'B', 'M', 'E', 'S', 'H', '\0', '\0'};
+
+// word at a time so hashing a large source file doesn't cost more than reading it
+static uint64_t hashContent (const uint8_t* bytes, size_t count)
+{
+    uint64_t hash = 0x9E3779B97F4A7C15ull ^ count;
+    size_t words = count / sizeof (uint64_t);
+    for (size_t i = 0; i < words; ++i)
+    {
+        uint64_t w;
+        std::memcpy (&w, bytes + i * sizeof (uint64_t), sizeof (uint64_t));
+        hash = (hash ^ (w * 0xBF58476D1CE4E5B9ull)) * 0x94D049BB133111EBull;
+        hash ^= hash >> 29;
+    }
+    return mace::hashBytes (bytes + words * sizeof (uint64_t), count % sizeof (uint64_t), hash);
+}
+
+MeshCacheViewRef MeshCacheView::fromMeshes (std::vector<MeshBuffers>&& source, std::vector<MaterialRef>&& materialRefs,
+                                            const std::vector<MeshInstance>& instances)
+{
+    MeshCacheViewRef view = std::make_shared<MeshCacheView>();
+    view->ownedMeshes = std::make_shared<std::vector<MeshBuffers>> (std::move (source));
+    view->materials = std::move (materialRefs);
+
+    const std::vector<MeshBuffers>& meshes = *view->ownedMeshes;
+    std::vector<CachedMesh> unique;
+    unique.reserve (meshes.size());
+    for (const MeshBuffers& mesh : meshes)
+    {
+        Eigen::AlignedBox3f bounds;
+        if (mesh.V.cols())
+        {
+            bounds.min() = mesh.V.rowwise().minCoeff();
+            bounds.max() = mesh.V.rowwise().maxCoeff();
+        }
+
+        CachedMesh cached{
+            Eigen::Map<const MatrixXf> (mesh.V.data(), 3, mesh.V.cols()),
+            Eigen::Map<const MatrixXf> (mesh.N.data(), 3, mesh.N.cols()),
+            Eigen::Map<const MatrixXf> (mesh.FN.data(), 3, mesh.FN.cols()),
+            bounds,
+            mesh.transform};
+
+        for (const Surface& surface : mesh.surfaces)
+        {
+            cached.surfaces.push_back (CachedSurface{
+                Eigen::Map<const MatrixXu> (surface.F.data(), 3, surface.F.cols()),
+                Eigen::Map<const MatrixXf> (surface.uvs.empty() ? nullptr : surface.uvs[0].data(), 2, surface.uvs.size()),
+                surface.materialIDs.empty() ? nullptr : surface.materialIDs.data(),
+                surface.materialRef});
+        }
+
+        cached.mesh = static_cast<uint32_t> (unique.size());
+        unique.push_back (std::move (cached));
+    }
+
+    if (instances.empty())
+    {
+        view->meshes = std::move (unique);
+        return view;
+    }
+
+    // the maps are only views, every instance of a mesh shares its buffers
+    view->meshes.reserve (instances.size());
+    for (const MeshInstance& instance : instances)
+    {
+        if (instance.mesh >= unique.size())
+            throw std::out_of_range ("Instance of mesh " + std::to_string (instance.mesh) + " but there are only " + std::to_string (unique.size()));
+
+        view->meshes.push_back (unique[instance.mesh]);
+        view->meshes.back().transform = instance.transform;
+    }
+
+    return view;
+}
+
+std::filesystem::path MeshCache::getCachePath (const std::filesystem::path& source) const
+{
+    if (cacheFolder.empty())
+    {
+        std::filesystem::path cachePath (source);
+        cachePath += EXTENSION;
+        return cachePath;
+    }
+
+    // files with the same name in different folders must not collide in a shared cache folder
+    std::string canonical = std::filesystem::weakly_canonical (source).generic_string();
+    uint64_t pathHash = mace::hashBytes (canonical.data(), canonical.size());
+
+    std::stringstream name;
+    name << source.stem().string() << "_" << std::hex << pathHash << EXTENSION;
+    return cacheFolder / name.str();
+}
+
+MeshCacheKey MeshCache::makeKey (const std::filesystem::path& source, bool withContent) const
+{
+    MeshCacheKey key;
+
+    std::string canonical = std::filesystem::weakly_canonical (source).generic_string();
+    key.pathHash = mace::hashBytes (canonical.data(), canonical.size());
+    key.sourceSize = std::filesystem::file_size (source);
+    key.sourceTime = std::filesystem::last_write_time (source).time_since_epoch().count();
+
+    if (withContent)
+    {
+        mace::MappedFileRef file = mace::MappedFile::open (source);
+        if (file) key.contentHash = hashContent (file->data(), file->size());
+    }
+
+    return key;
+}
+
+MeshCacheViewRef MeshCache::load (const std::filesystem::path& source) const
+{
+    std::filesystem::path cachePath = getCachePath (source);
+
+    std::error_code ec;
+    if (!std::filesystem::exists (cachePath, ec) || !std::filesystem::exists (source, ec))
+        return nullptr;
+
+    mace::MappedFileRef file = mace::MappedFile::open (cachePath);
+    if (!file || file->size() < sizeof (MeshCacheHeader))
+        return nullptr;
+
+    const uint8_t* base = file->data();
+    const uint64_t fileSize = file->size();
+
+    MeshCacheHeader header;
+    std::memcpy (&header, base, sizeof (MeshCacheHeader));
+
+    if (std::memcmp (header.magic, NBMESH_MAGIC, sizeof (NBMESH_MAGIC)) != 0 ||
+        header.version != VERSION || header.fileSize != fileSize)
+    {
+        LOG (DBUG) << "Ignoring incompatible mesh cache " << cachePath.generic_string();
+        return nullptr;
+    }
+
+    MeshCacheKey key = makeKey (source, false);
+    if (header.pathHash != key.pathHash || header.sourceSize != key.sourceSize || header.sourceTime != key.sourceTime)
+        return nullptr;
+
+    if (verifyContent && header.contentHash != makeKey (source, true).contentHash)
+        return nullptr;
+
+    // every section has to lie inside the file, a truncated cache is just a miss
+    auto inFile = [fileSize] (uint64_t offset, uint64_t bytes)
+    { return offset <= fileSize && bytes <= fileSize - offset; };
+
+    uint64_t recordBytes = header.meshCount * sizeof (MeshRecord) +
+                           header.surfaceCount * sizeof (SurfaceRecord) +
+                           header.materialCount * sizeof (MaterialRecord);
+    if (!inFile (mace::alignCacheOffset (sizeof (MeshCacheHeader)), recordBytes))
+        return nullptr;
+
+    uint64_t offset = mace::alignCacheOffset (sizeof (MeshCacheHeader));
+    const MeshRecord* meshRecords = reinterpret_cast<const MeshRecord*> (base + offset);
+    offset = mace::alignCacheOffset (offset + header.meshCount * sizeof (MeshRecord));
+    const SurfaceRecord* surfaceRecords = reinterpret_cast<const SurfaceRecord*> (base + offset);
+    offset = mace::alignCacheOffset (offset + header.surfaceCount * sizeof (SurfaceRecord));
+    const MaterialRecord* materialRecords = reinterpret_cast<const MaterialRecord*> (base + offset);
+
+    MeshCacheViewRef view = std::make_shared<MeshCacheView>();
+    view->file = file;
+
+    for (uint32_t i = 0; i < header.materialCount; ++i)
+    {
+        const MaterialRecord& r = materialRecords[i];
+        if (!inFile (r.name, r.nameLength) || !inFile (r.texture, r.textureLength))
+            return nullptr;
+
+        MaterialRef material;
+        material.sourceIndex = r.sourceIndex;
+        material.name.assign (reinterpret_cast<const char*> (base + r.name), r.nameLength);
+        material.texture.assign (reinterpret_cast<const char*> (base + r.texture), r.textureLength);
+        material.diffuse = Eigen::Vector3f (r.diffuse[0], r.diffuse[1], r.diffuse[2]);
+        material.linearDiffuse = r.linearDiffuse != 0;
+        view->materials.push_back (std::move (material));
+    }
+
+    for (uint32_t i = 0; i < header.meshCount; ++i)
+    {
+        const MeshRecord& r = meshRecords[i];
+
+        uint64_t vertexBytes = uint64_t (r.vertexCount) * 3 * sizeof (float);
+        uint64_t faceNormalBytes = uint64_t (r.faceNormalCount) * 3 * sizeof (float);
+        if (!inFile (r.V, vertexBytes) || (r.N && !inFile (r.N, vertexBytes)) || (r.FN && !inFile (r.FN, faceNormalBytes)) ||
+            uint64_t (r.firstSurface) + r.surfaceCount > header.surfaceCount)
+            return nullptr;
+
+        Eigen::Affine3f transform;
+        std::memcpy (transform.matrix().data(), r.transform, sizeof (r.transform));
+
+        CachedMesh mesh{
+            Eigen::Map<const MatrixXf> (reinterpret_cast<const float*> (base + r.V), 3, r.vertexCount),
+            Eigen::Map<const MatrixXf> (r.N ? reinterpret_cast<const float*> (base + r.N) : nullptr, 3, r.N ? r.vertexCount : 0),
+            Eigen::Map<const MatrixXf> (r.FN ? reinterpret_cast<const float*> (base + r.FN) : nullptr, 3, r.FN ? r.faceNormalCount : 0),
+            Eigen::AlignedBox3f (Eigen::Vector3f (r.bounds[0], r.bounds[1], r.bounds[2]), Eigen::Vector3f (r.bounds[3], r.bounds[4], r.bounds[5])),
+            transform};
+        mesh.mesh = r.mesh;
+
+        for (uint32_t s = r.firstSurface; s < r.firstSurface + r.surfaceCount; ++s)
+        {
+            const SurfaceRecord& sr = surfaceRecords[s];
+            if (!inFile (sr.F, uint64_t (sr.triangleCount) * 3 * sizeof (uint32_t)) ||
+                (sr.UV && (sr.uvCount != r.vertexCount || !inFile (sr.UV, uint64_t (sr.uvCount) * 2 * sizeof (float)))) ||
+                (sr.materialIDs && !inFile (sr.materialIDs, sr.triangleCount)) ||
+                sr.materialRef >= int32_t (header.materialCount))
+                return nullptr;
+
+            mesh.surfaces.push_back (CachedSurface{
+                Eigen::Map<const MatrixXu> (reinterpret_cast<const uint32_t*> (base + sr.F), 3, sr.triangleCount),
+                Eigen::Map<const MatrixXf> (sr.UV ? reinterpret_cast<const float*> (base + sr.UV) : nullptr, 2, sr.UV ? sr.uvCount : 0),
+                sr.materialIDs ? base + sr.materialIDs : nullptr,
+                sr.materialRef});
+        }
+
+        view->meshes.push_back (std::move (mesh));
+    }
+
+    return view;
+}
+
+bool MeshCache::store (const std::filesystem::path& source, const std::vector<MeshBuffers>& meshes, const std::vector<MaterialRef>& materials,
+                       const std::vector<MeshInstance>& instances) const
+{
+    try
+    {
+        std::filesystem::path cachePath = getCachePath (source);
+        if (!cacheFolder.empty())
+            std::filesystem::create_directories (cacheFolder);
+
+        MeshCacheKey key = makeKey (source, verifyContent);
+
+        for (const MeshInstance& instance : instances)
+        {
+            if (instance.mesh >= meshes.size())
+                throw std::out_of_range ("Instance of mesh " + std::to_string (instance.mesh) + " but there are only " + std::to_string (meshes.size()));
+        }
+
+        // one record per instance, or per mesh when there are none
+        std::vector<MeshRecord> meshRecords (instances.empty() ? meshes.size() : instances.size());
+        std::vector<SurfaceRecord> surfaceRecords;
+        std::vector<MaterialRecord> materialRecords (materials.size());
+
+        for (const MeshBuffers& mesh : meshes)
+            surfaceRecords.resize (surfaceRecords.size() + mesh.surfaces.size());
+
+        // padding fields included, nothing left over from the heap goes to disk
+        std::memset (meshRecords.data(), 0, meshRecords.size() * sizeof (MeshRecord));
+        std::memset (surfaceRecords.data(), 0, surfaceRecords.size() * sizeof (SurfaceRecord));
+        std::memset (materialRecords.data(), 0, materialRecords.size() * sizeof (MaterialRecord));
+
+        // lay out the records first, then the strings, then the bulk data
+        uint64_t offset = mace::alignCacheOffset (sizeof (MeshCacheHeader));
+        offset = mace::alignCacheOffset (offset + meshRecords.size() * sizeof (MeshRecord));
+        offset = mace::alignCacheOffset (offset + surfaceRecords.size() * sizeof (SurfaceRecord));
+        offset = mace::alignCacheOffset (offset + materialRecords.size() * sizeof (MaterialRecord));
+
+        // (offset, pointer, bytes) of everything after the records, in file order
+        struct Block
+        {
+            uint64_t offset;
+            const void* data;
+            uint64_t bytes;
+        };
+        std::vector<Block> blocks;
+
+        auto place = [&] (const void* data, uint64_t bytes, bool aligned) -> uint64_t
+        {
+            if (bytes == 0) return 0;
+            if (aligned) offset = mace::alignCacheOffset (offset);
+            blocks.push_back (Block{offset, data, bytes});
+            offset += bytes;
+            return blocks.back().offset;
+        };
+
+        for (size_t i = 0; i < materials.size(); ++i)
+        {
+            const MaterialRef& m = materials[i];
+            MaterialRecord& r = materialRecords[i];
+            r.sourceIndex = m.sourceIndex;
+            r.diffuse[0] = m.diffuse.x();
+            r.diffuse[1] = m.diffuse.y();
+            r.diffuse[2] = m.diffuse.z();
+            r.linearDiffuse = m.linearDiffuse ? 1 : 0;
+            r.nameLength = static_cast<uint32_t> (m.name.size());
+            r.textureLength = static_cast<uint32_t> (m.texture.size());
+            r.name = place (m.name.data(), m.name.size(), false);
+            r.texture = place (m.texture.data(), m.texture.size(), false);
+        }
+
+        // the data of each mesh is placed once, its instances' records all point at it
+        std::vector<MeshRecord> sharedRecords (meshes.size());
+        std::memset (sharedRecords.data(), 0, sharedRecords.size() * sizeof (MeshRecord));
+        uint32_t surfaceIndex = 0;
+        for (size_t i = 0; i < meshes.size(); ++i)
+        {
+            const MeshBuffers& mesh = meshes[i];
+            MeshRecord& r = sharedRecords[i];
+            r.mesh = static_cast<uint32_t> (i);
+
+            r.vertexCount = static_cast<uint32_t> (mesh.V.cols());
+            r.faceNormalCount = static_cast<uint32_t> (mesh.FN.cols());
+            r.firstSurface = surfaceIndex;
+            r.surfaceCount = static_cast<uint32_t> (mesh.surfaces.size());
+            r.V = place (mesh.V.data(), mesh.V.size() * sizeof (float), true);
+            r.N = mesh.N.cols() == mesh.V.cols() ? place (mesh.N.data(), mesh.N.size() * sizeof (float), true) : 0;
+            r.FN = place (mesh.FN.data(), mesh.FN.size() * sizeof (float), true);
+
+            Eigen::Vector3f lo = Eigen::Vector3f::Zero();
+            Eigen::Vector3f hi = Eigen::Vector3f::Zero();
+            if (mesh.V.cols())
+            {
+                lo = mesh.V.rowwise().minCoeff();
+                hi = mesh.V.rowwise().maxCoeff();
+            }
+            std::memcpy (r.bounds, lo.data(), 3 * sizeof (float));
+            std::memcpy (r.bounds + 3, hi.data(), 3 * sizeof (float));
+            std::memcpy (r.transform, mesh.transform.matrix().data(), sizeof (r.transform));
+
+            for (const Surface& surface : mesh.surfaces)
+            {
+                SurfaceRecord& sr = surfaceRecords[surfaceIndex++];
+                sr.triangleCount = static_cast<uint32_t> (surface.F.cols());
+                bool hasUVs = !surface.uvs.empty() && surface.uvs.size() == mesh.V.cols();
+                sr.uvCount = hasUVs ? static_cast<uint32_t> (surface.uvs.size()) : 0;
+                sr.materialRef = surface.materialRef;
+                sr.padding = 0;
+                sr.F = place (surface.F.data(), surface.F.size() * sizeof (uint32_t), true);
+                sr.UV = hasUVs ? place (surface.uvs[0].data(), surface.uvs.size() * 2 * sizeof (float), true) : 0;
+                sr.materialIDs = surface.materialIDs.size() == surface.F.cols() ? place (surface.materialIDs.data(), surface.materialIDs.size(), true) : 0;
+            }
+        }
+
+        if (instances.empty())
+        {
+            meshRecords = sharedRecords;
+        }
+        else
+        {
+            for (size_t i = 0; i < instances.size(); ++i)
+            {
+                meshRecords[i] = sharedRecords[instances[i].mesh];
+                std::memcpy (meshRecords[i].transform, instances[i].transform.matrix().data(), sizeof (meshRecords[i].transform));
+            }
+        }
+
+        MeshCacheHeader header = {};
+        std::memcpy (header.magic, NBMESH_MAGIC, sizeof (NBMESH_MAGIC));
+        header.version = VERSION;
+        header.meshCount = static_cast<uint32_t> (meshRecords.size());
+        header.surfaceCount = static_cast<uint32_t> (surfaceRecords.size());
+        header.materialCount = static_cast<uint32_t> (materialRecords.size());
+        header.pathHash = key.pathHash;
+        header.sourceSize = key.sourceSize;
+        header.sourceTime = key.sourceTime;
+        header.contentHash = key.contentHash;
+        header.fileSize = offset;
+
+        return mace::writeFileAtomically (cachePath, [&] (std::ofstream& out)
+                                          {
+            uint64_t written = 0;
+            auto write = [&] (uint64_t at, const void* data, uint64_t bytes)
+            {
+                static const char zeros[mace::CACHE_FILE_ALIGNMENT] = {};
+                while (written < at)
+                {
+                    uint64_t pad = std::min<uint64_t> (at - written, mace::CACHE_FILE_ALIGNMENT);
+                    out.write (zeros, pad);
+                    written += pad;
+                }
+                out.write (static_cast<const char*> (data), bytes);
+                written += bytes;
+            };
+
+            uint64_t at = 0;
+            write (at, &header, sizeof (header));
+            at = mace::alignCacheOffset (sizeof (MeshCacheHeader));
+            write (at, meshRecords.data(), meshRecords.size() * sizeof (MeshRecord));
+            at = mace::alignCacheOffset (at + meshRecords.size() * sizeof (MeshRecord));
+            write (at, surfaceRecords.data(), surfaceRecords.size() * sizeof (SurfaceRecord));
+            at = mace::alignCacheOffset (at + surfaceRecords.size() * sizeof (SurfaceRecord));
+            write (at, materialRecords.data(), materialRecords.size() * sizeof (MaterialRecord));
+
+            for (const Block& block : blocks)
+                write (block.offset, block.data, block.bytes); });
+    }
+    catch (std::exception& e)
+    {
+        LOG (CRITICAL) << "Mesh cache write failed: " << e.what();
+        return false;
+    }
+}
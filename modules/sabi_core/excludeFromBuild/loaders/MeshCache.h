@@ -0,0 +1,128 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+// Versioned binary cache for MeshBuffers (.nbmesh)
+//
+// Layout, every section 16 byte aligned:
+//   MeshCacheHeader
+//   MeshRecord[meshCount], one per instance, instances of a mesh point at the same data
+//   SurfaceRecord[surfaceCount]
+//   MaterialRecord[materialCount]
+//   string bytes (material names and texture paths)
+//   vertex and index data
+//
+// A cache file is valid for a source when the canonical path hash, size and
+// modification time stored in its header all match. Loading maps the file
+// and hands out Eigen::Map views into it, nothing is copied.
+//
+// Content verification is off by default. Every editor and exporter that rewrites a
+// source moves its modification time, and hashing the whole source on each load
+// would cost a good part of what the cache saves. Turn it on where sources can be
+// replaced with their old timestamps kept, by restoring an archive or a timestamp
+// preserving copy.
+
+using MeshCacheViewRef = std::shared_ptr<class MeshCacheView>;
+
+struct MeshCacheKey
+{
+    uint64_t pathHash = 0;
+    uint64_t sourceSize = 0;
+    int64_t sourceTime = 0;
+    uint64_t contentHash = 0; // only filled when content verification is on
+};
+
+struct CachedSurface
+{
+    Eigen::Map<const MatrixXu> F;   // 3 x triangleCount
+    Eigen::Map<const MatrixXf> UV;  // 2 x vertexCount, empty if the mesh has no uvs
+    const uint8_t* materialIDs;     // per triangle index into the material table or nullptr
+    int32_t materialRef;            // index into the material table or -1
+};
+
+struct CachedMesh
+{
+    Eigen::Map<const MatrixXf> V;  // 3 x vertexCount
+    Eigen::Map<const MatrixXf> N;  // 3 x vertexCount or empty
+    Eigen::Map<const MatrixXf> FN; // 3 x triangleCount or empty
+    Eigen::AlignedBox3f bounds;
+    Eigen::Affine3f transform;
+    std::vector<CachedSurface> surfaces;
+    uint32_t mesh = 0; // which stored mesh the data belongs to, the same for every instance of it
+};
+
+// Read only views of the meshes in a cache file, or of meshes still in memory
+// so loaders can consume both the same way. There is one CachedMesh per instance,
+// with no instances given every mesh is placed once by its own transform
+class MeshCacheView
+{
+ public:
+    static MeshCacheViewRef fromMeshes (std::vector<MeshBuffers>&& meshes, std::vector<MaterialRef>&& materials,
+                                        const std::vector<MeshInstance>& instances = {});
+
+    const std::vector<CachedMesh>& getMeshes() const { return meshes; }
+    const std::vector<MaterialRef>& getMaterials() const { return materials; }
+
+ private:
+    friend class MeshCache;
+
+    // whatever owns the memory the maps point into
+    mace::MappedFileRef file = nullptr;
+    std::shared_ptr<std::vector<MeshBuffers>> ownedMeshes = nullptr;
+
+    std::vector<CachedMesh> meshes;
+    std::vector<MaterialRef> materials;
+};
+
+class MeshCache
+{
+ public:
+    static constexpr uint32_t VERSION = 4; // 2: multi primitive glTF meshes keep every surface, 3: material colour space, 4: shared instances
+    static constexpr const char* EXTENSION = ".nbmesh";
+
+ public:
+    // an empty cacheFolder writes the cache next to the source file,
+    // verifyContent also checks a hash of the source's bytes
+    MeshCache (const std::filesystem::path& cacheFolder = std::filesystem::path(), bool verifyContent = false) :
+        cacheFolder (cacheFolder),
+        verifyContent (verifyContent)
+    {
+    }
+
+    std::filesystem::path getCachePath (const std::filesystem::path& source) const;
+
+    // returns nullptr if there is no cache file or it is stale
+    MeshCacheViewRef load (const std::filesystem::path& source) const;
+
+    // writes to a temporary file and renames it so a crash can't leave a half written cache
+    // each mesh's data is written once however many instances place it
+    bool store (const std::filesystem::path& source, const std::vector<MeshBuffers>& meshes, const std::vector<MaterialRef>& materials,
+                const std::vector<MeshInstance>& instances = {}) const;
+
+ private:
+    std::filesystem::path cacheFolder;
+    bool verifyContent = false;
+
+    MeshCacheKey makeKey (const std::filesystem::path& source, bool withContent) const;
+};
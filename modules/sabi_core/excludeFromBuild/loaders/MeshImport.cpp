@@ -0,0 +1,676 @@
+#include "MeshImport.h"
+
+using Eigen::Vector3f;
+using rapidobj::Attributes;
+using rapidobj::Index;
+using rapidobj::Material;
+using rapidobj::MaterialLibrary;
+
+// faces and vertices handed to a worker at a time
+constexpr uint32_t NORMALS_GRAIN_SIZE = 1024;
+
+// normals shorter than this are degenerate
+constexpr double RCPOVERFLOW = 5.56268464626800345e-309;
+
+// Compressed sparse row vertex to face corner adjacency.
+// corners[offsets[v]] to corners[offsets[v + 1] - 1] are the face corners (3 * face + i)
+// that reference vertex v, in ascending face order
+struct VertexFaceAdjacency
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> corners;
+};
+
+void build_vertex_face_adjacency (const MatrixXu& F, uint32_t vertexCount, VertexFaceAdjacency& adj)
+{
+    const uint32_t cornerCount = (uint32_t)F.size();
+    const uint32_t* const indices = F.data(); // column major so corner c is face c / 3
+
+    adj.offsets.assign (vertexCount + 1, 0);
+    adj.corners.resize (cornerCount);
+
+    // count the corners that reference each vertex
+    for (uint32_t c = 0; c < cornerCount; ++c)
+        ++adj.offsets[indices[c] + 1];
+
+    // prefix sum turns the counts into offsets
+    for (uint32_t v = 0; v < vertexCount; ++v)
+        adj.offsets[v + 1] += adj.offsets[v];
+
+    // scatter the corners into their vertex's range
+    std::vector<uint32_t> cursor (adj.offsets.begin(), adj.offsets.end() - 1);
+    for (uint32_t c = 0; c < cornerCount; ++c)
+        adj.corners[cursor[indices[c]]++] = c;
+}
+
+// Generate normals for mesh without atomics
+// Pass 1 computes the face normals and the angle at each face corner,
+// pass 2 visits every vertex once and sums its incident faces from the adjacency
+uint32_t generate_normals_gather (const MatrixXu& F, const MatrixXf& V, MatrixXf& N, MatrixXf& FN)
+{
+    ScopedStopWatch sw ("GENERATE NORMALS GATHER"); // Start timer
+
+    std::atomic<uint32_t> badFaces (0); // Counter for degenerate faces
+
+    N.resize (V.rows(), V.cols()); // Prepare vertex normal matrix
+
+    FN.resize (F.rows(), F.cols()); // Prepare face normal matrix
+    FN.setZero();
+
+    MatrixXf angles (3, F.cols()); // angle weight of each face corner, zero for degenerate faces
+
+    VertexFaceAdjacency adj;
+    build_vertex_face_adjacency (F, (uint32_t)V.cols(), adj);
+
+    mace::TaskScheduler& scheduler = mace::TaskScheduler::get(); // shared process wide workers
+
+    scheduler.parallel_for (0u, (uint32_t)F.cols(), NORMALS_GRAIN_SIZE,
+                    [&] (const uint32_t start, const uint32_t end)
+                    {
+                        for (uint32_t f = start; f < end; ++f)
+                        {
+                            Vector3f p0 = V.col (F (0, f)),
+                                     p1 = V.col (F (1, f)),
+                                     p2 = V.col (F (2, f));
+
+                            Vector3f fn = (p1 - p0).cross (p2 - p0);
+                            Float norm = fn.norm();
+                            if (norm < RCPOVERFLOW)
+                            {
+                                badFaces++;
+                                angles.col (f).setZero();
+                                continue;
+                            }
+                            FN.col (f) = fn / norm;
+
+                            for (int i = 0; i < 3; ++i)
+                            {
+                                Vector3f v0 = V.col (F (i, f)),
+                                         d0 = V.col (F ((i + 1) % 3, f)) - v0,
+                                         d1 = V.col (F ((i + 2) % 3, f)) - v0;
+
+                                angles (i, f) = wabi::fast_acos (d0.dot (d1) / std::sqrt (d0.squaredNorm() * d1.squaredNorm()));
+                            }
+                        }
+                    });
+
+    // Gather and normalize the vertex normals, parallel_for returns once every face is done
+    scheduler.parallel_for (0u, (uint32_t)V.cols(), NORMALS_GRAIN_SIZE,
+                    [&] (const uint32_t start, const uint32_t end)
+                    {
+                        const Float* const weights = angles.data();
+                        for (uint32_t i = start; i < end; ++i)
+                        {
+                            Vector3f n = Vector3f::Zero();
+                            for (uint32_t k = adj.offsets[i]; k < adj.offsets[i + 1]; ++k)
+                            {
+                                uint32_t c = adj.corners[k];
+                                n += FN.col (c / 3) * weights[c];
+                            }
+
+                            Float norm = n.norm();
+                            if (norm < RCPOVERFLOW)
+                            {
+                                N.col (i) = Vector3f::UnitX();
+                            }
+                            else
+                            {
+                                N.col (i) = n / norm;
+                            }
+                        }
+                    });
+
+    return badFaces.load();
+}
+
+// Generate normals for mesh
+// replaced TBB with mace::TaskScheduler, math from Instant Meshes https://github.com/wjakob/instant-meshes
+uint32_t generate_normals_scatter (const MatrixXu& F, const MatrixXf& V, MatrixXf& N, MatrixXf& FN)
+{
+    ScopedStopWatch sw ("GENERATE NORMALS SCATTER"); // Start timer
+
+    std::atomic<uint32_t> badFaces (0); // Counter for degenerate faces
+
+    N.resize (V.rows(), V.cols()); // Prepare vertex normal matrix
+    N.setZero();
+
+    FN.resize (F.rows(), F.cols()); // Prepare face normal matrix
+    FN.setZero();
+
+    mace::TaskScheduler& scheduler = mace::TaskScheduler::get(); // shared process wide workers
+
+    // Multi-threaded computation of face and vertex normals
+    auto map = [&] (const uint32_t start, const uint32_t end)
+    {
+        for (uint32_t f = start; f < end; ++f)
+        {
+            Vector3f fn = Vector3f::Zero();
+            for (int i = 0; i < 3; ++i)
+            {
+                Vector3f v0 = V.col (F (i, f)),
+                         v1 = V.col (F ((i + 1) % 3, f)),
+                         v2 = V.col (F ((i + 2) % 3, f)),
+                         d0 = v1 - v0,
+                         d1 = v2 - v0;
+
+                if (i == 0)
+                {
+                    fn = d0.cross (d1);
+                    Float norm = fn.norm();
+                    if (norm < RCPOVERFLOW)
+                    {
+                        badFaces++;
+                        break;
+                    }
+                    FN.col (f) = fn.normalized();
+                    fn /= norm;
+                }
+
+                Float angle = wabi::fast_acos (d0.dot (d1) / std::sqrt (d0.squaredNorm() * d1.squaredNorm()));
+                for (uint32_t k = 0; k < 3; ++k)
+                    mace::atomicAdd (&N.coeffRef (k, F (i, f)), fn[k] * angle);
+            }
+        }
+    };
+
+    // parallel_for blocks until every chunk is done so the normalize pass sees all the sums
+    scheduler.parallel_for (0u, (uint32_t)F.cols(), NORMALS_GRAIN_SIZE, map); // Execute in parallel
+
+    // Normalize the vertex normals
+    scheduler.parallel_for (0u, (uint32_t)V.cols(), NORMALS_GRAIN_SIZE,
+                    [&] (const uint32_t start, const uint32_t end)
+                    {
+                        for (uint32_t i = start; i < end; ++i)
+                        {
+                            Float norm = N.col (i).norm();
+                            if (norm < RCPOVERFLOW)
+                            {
+                                N.col (i) = Vector3f::UnitX();
+                            }
+                            else
+                            {
+                                N.col (i) /= norm;
+                            }
+                        }
+                    });
+
+    return badFaces.load();
+}
+
+uint32_t generate_normals (const MatrixXu& F, const MatrixXf& V, MatrixXf& N, MatrixXf& FN, NormalAccumulation mode)
+{
+    uint32_t badFaces = mode == NormalAccumulation::Gather ? generate_normals_gather (F, V, N, FN)
+                                                           : generate_normals_scatter (F, V, N, FN);
+    if (badFaces)
+        LOG (DBUG) << badFaces << " of " << F.cols() << " faces are degenerate and have no face normal";
+
+    return badFaces;
+}
+
+void getMaterialIdList (const rapidobj::Result& result, std::vector<uint8_t>& materialIDs)
+{
+    uint32_t index = 0;
+
+    for (auto& s : result.shapes)
+    {
+        for (auto& id : s.mesh.material_ids)
+        {
+            // faces without a material (id -1) use the first one
+            if (index < materialIDs.size())
+                materialIDs[index] = static_cast<uint8_t> (id < 0 ? 0 : id);
+            ++index;
+        }
+    }
+}
+
+// Flat open addressing table that welds OBJ corners sharing the same
+// position, texcoord and normal indices into a single vertex
+class ObjVertexWelder
+{
+ public:
+    explicit ObjVertexWelder (size_t expectedVertices)
+    {
+        size_t capacity = 64;
+        while (capacity < expectedVertices * 2)
+            capacity <<= 1;
+
+        slots.resize (capacity);
+    }
+
+    // returns the welded vertex index for this corner, assigning
+    // nextVertex if the combination hasn't been seen before
+    std::pair<uint32_t, bool> insert (const Index& key, uint32_t nextVertex)
+    {
+        // keep the load factor at or below 0.5 so probe chains stay short
+        if ((count + 1) * 2 > slots.size())
+            grow();
+
+        size_t mask = slots.size() - 1;
+        for (size_t slot = hash (key) & mask;; slot = (slot + 1) & mask)
+        {
+            Slot& s = slots[slot];
+            if (s.vertex == EMPTY_SLOT)
+            {
+                s.key = key;
+                s.vertex = nextVertex;
+                ++count;
+                return std::make_pair (nextVertex, true);
+            }
+
+            if (s.key.position_index == key.position_index &&
+                s.key.texcoord_index == key.texcoord_index &&
+                s.key.normal_index == key.normal_index)
+            {
+                return std::make_pair (s.vertex, false);
+            }
+        }
+    }
+
+ private:
+    static constexpr uint32_t EMPTY_SLOT = std::numeric_limits<uint32_t>::max();
+
+    struct Slot
+    {
+        Index key;
+        uint32_t vertex = EMPTY_SLOT;
+    };
+
+    std::vector<Slot> slots;
+    size_t count = 0;
+
+    static size_t hash (const Index& key)
+    {
+        uint64_t h = uint32_t (key.position_index) * 0x9E3779B97F4A7C15ull;
+        h ^= (uint32_t (key.texcoord_index) + 0x7F4A7C15ull + (h << 6) + (h >> 2)) * 0xBF58476D1CE4E5B9ull;
+        h ^= (uint32_t (key.normal_index) + 0x94D049BBull + (h << 6) + (h >> 2)) * 0x94D049BB133111EBull;
+        return size_t (h ^ (h >> 31));
+    }
+
+    void grow()
+    {
+        std::vector<Slot> old (slots.size() * 2);
+        old.swap (slots);
+
+        size_t mask = slots.size() - 1;
+        for (const Slot& s : old)
+        {
+            if (s.vertex == EMPTY_SLOT) continue;
+
+            size_t slot = hash (s.key) & mask;
+            while (slots[slot].vertex != EMPTY_SLOT)
+                slot = (slot + 1) & mask;
+            slots[slot] = s;
+        }
+    }
+};
+
+// triangle order is preserved so getMaterialIdList still lines up with F
+void objToMeshBuffers (const rapidobj::Result& result, MeshBuffers& mesh, std::vector<uint32_t>& sourcePositions)
+{
+    const Attributes& attributes = result.attributes;
+
+    size_t triangleCount = 0;
+    for (const auto& s : result.shapes)
+        triangleCount += s.mesh.num_face_vertices.size();
+
+    Surface surface;
+    surface.F.resize (3, triangleCount);
+
+    // every OBJ position is used at least once in a typical mesh so it makes a good first guess
+    size_t capacity = std::max<size_t> (attributes.positions.size() / 3, 16);
+    mesh.V.resize (3, capacity);
+    MatrixXf N (3, capacity);
+    surface.uvs.resize (capacity);
+    sourcePositions.clear();
+    sourcePositions.reserve (capacity);
+
+    ObjVertexWelder welder (capacity);
+    uint32_t vertexCount = 0;
+    bool allNormals = true;
+
+    uint32_t* f = surface.F.data();
+    for (const auto& s : result.shapes)
+    {
+        assert (s.mesh.indices.size() == s.mesh.num_face_vertices.size() * 3);
+
+        for (const Index& index : s.mesh.indices)
+        {
+            auto [vertex, isNew] = welder.insert (index, vertexCount);
+            if (isNew)
+            {
+                if (vertexCount == capacity)
+                {
+                    capacity *= 2;
+                    mesh.V.conservativeResize (Eigen::NoChange, capacity);
+                    N.conservativeResize (Eigen::NoChange, capacity);
+                    surface.uvs.resize (capacity);
+                }
+
+                const float* p = &attributes.positions[index.position_index * 3];
+                mesh.V.col (vertex) = Vector3f (p[0], p[1], p[2]);
+
+                if (index.texcoord_index >= 0)
+                {
+                    const float* t = &attributes.texcoords[index.texcoord_index * 2];
+                    surface.uvs[vertex] = Eigen::Vector2f (t[0], t[1]);
+                }
+                else
+                    surface.uvs[vertex] = Eigen::Vector2f::Zero();
+
+                if (index.normal_index >= 0)
+                {
+                    const float* n = &attributes.normals[index.normal_index * 3];
+                    N.col (vertex) = Vector3f (n[0], n[1], n[2]);
+                }
+                else
+                    allNormals = false;
+
+                sourcePositions.push_back (index.position_index);
+                ++vertexCount;
+            }
+
+            *f++ = vertex;
+        }
+    }
+
+    mesh.V.conservativeResize (Eigen::NoChange, vertexCount);
+    surface.uvs.resize (vertexCount);
+
+    if (allNormals && vertexCount > 0)
+    {
+        N.conservativeResize (Eigen::NoChange, vertexCount);
+        mesh.N = std::move (N);
+    }
+    else
+        mesh.N.resize (3, 0);
+
+    mesh.transform.setIdentity();
+    mesh.surfaces.clear();
+    mesh.surfaces.push_back (std::move (surface));
+}
+
+// Welding splits vertices along uv seams so normals generated on the welded mesh
+// would show those seams. Generate them on the OBJ's position only topology
+// instead and copy them out to the welded vertices
+void generate_welded_normals (const rapidobj::Result& result, const MatrixXu& F, const std::vector<uint32_t>& sourcePositions,
+                                     MatrixXf& N, MatrixXf& FN)
+{
+    const Attributes& attributes = result.attributes;
+    MatrixXf positions = Eigen::Map<const MatrixXf> (attributes.positions.data(), 3, attributes.positions.size() / 3);
+
+    MatrixXu positionF (3, F.cols());
+    const uint32_t* welded = F.data();
+    uint32_t* source = positionF.data();
+    for (Eigen::Index i = 0; i < F.size(); ++i)
+        source[i] = sourcePositions[welded[i]];
+
+    MatrixXf positionN;
+    generate_normals (positionF, positions, positionN, FN);
+
+    N.resize (3, sourcePositions.size());
+    for (size_t i = 0; i < sourcePositions.size(); ++i)
+        N.col (i) = positionN.col (sourcePositions[i]);
+}
+
+std::optional<std::filesystem::path> resolveTexturePath (const std::string& texture, const std::filesystem::path& materialFolder)
+{
+    if (texture.empty()) return std::nullopt;
+
+    std::filesystem::path imagePath (texture);
+    if (imagePath.is_absolute())
+        return imagePath;
+
+    return mace::DirectoryIndexService::get().find (materialFolder, imagePath.filename().string());
+}
+
+std::shared_ptr<rapidobj::Result> parseObjFile (const std::filesystem::path& filePath)
+{
+    // MaterialLibrary Load policy Optional lets it load a obj file without a material and not crash
+    MaterialLibrary ml = MaterialLibrary::Default (rapidobj::Load::Optional);
+
+    auto parsed = std::make_shared<rapidobj::Result> (rapidobj::ParseFile (filePath.generic_string(), ml));
+    rapidobj::Result& result = *parsed;
+
+    if (result.error)
+    {
+        LOG (CRITICAL) << result.error.code.message();
+        throw std::runtime_error ("Load failed: " + filePath.generic_string());
+    }
+
+    rapidobj::Triangulate (result);
+    if (result.error)
+    {
+        LOG (CRITICAL) << result.error.code.message();
+        throw std::runtime_error ("triangulation failed: " + filePath.generic_string());
+    }
+
+    return parsed;
+}
+
+MeshCacheViewRef processObjResult (const std::filesystem::path& filePath, const rapidobj::Result& result, const MeshCache& meshCache)
+{
+    // weld the corners into vertices and fill V, F and the uvs in one pass
+    std::vector<MeshBuffers> meshes (1);
+    MeshBuffers& mesh = meshes[0];
+    std::vector<uint32_t> sourcePositions;
+    objToMeshBuffers (result, mesh, sourcePositions);
+
+    Surface& surf = mesh.surfaces[0];
+
+    // use the file's normals if every corner has one
+    if (mesh.N.cols() != mesh.V.cols())
+        generate_welded_normals (result, surf.F, sourcePositions, mesh.N, mesh.FN);
+
+    // generate material list, 1 materialID per triangle
+    surf.materialIDs.resize (surf.F.cols());
+    getMaterialIdList (result, surf.materialIDs);
+
+    std::vector<MaterialRef> materials;
+    materials.reserve (result.materials.size());
+    for (size_t i = 0; i < result.materials.size(); ++i)
+    {
+        const Material& m = result.materials[i];
+
+        MaterialRef ref;
+        ref.sourceIndex = static_cast<int32_t> (i);
+        ref.name = m.name;
+        ref.texture = m.diffuse_texname;
+        ref.diffuse = Vector3f (m.diffuse[0], m.diffuse[1], m.diffuse[2]);
+        materials.push_back (std::move (ref));
+    }
+
+    if (!meshCache.store (filePath, meshes, materials))
+        LOG (DBUG) << "Could not write mesh cache for " << filePath.generic_string();
+
+    return MeshCacheView::fromMeshes (std::move (meshes), std::move (materials));
+}
+
+std::shared_ptr<GltfScene> parseGltfFile (const std::filesystem::path& filePath)
+{
+    GltfReader reader;
+    reader.read (filePath);
+
+    auto scene = std::make_shared<GltfScene>();
+    scene->meshes = std::move (reader.getMeshes());
+    scene->instances = std::move (reader.getInstances());
+    return scene;
+}
+
+MeshCacheViewRef processGltfMeshes (const std::filesystem::path& filePath, GltfScene& scene, const MeshCache& meshCache)
+{
+    std::vector<MeshBuffers>& meshes = scene.meshes;
+    std::vector<MaterialRef> materials;
+
+    for (auto& mesh : meshes)
+    {
+        if (mesh.surfaces.empty()) continue;
+
+        // use the file's normals if it has them for every vertex, otherwise
+        // generate them over the triangles of all the surfaces
+        if (mesh.N.cols() != mesh.V.cols())
+        {
+            if (mesh.surfaces.size() == 1)
+            {
+                generate_normals (mesh.surfaces[0].F, mesh.V, mesh.N, mesh.FN);
+            }
+            else
+            {
+                Eigen::Index triangleCount = 0;
+                for (const auto& s : mesh.surfaces)
+                    triangleCount += s.F.cols();
+
+                MatrixXu F (3, triangleCount);
+                Eigen::Index offset = 0;
+                for (const auto& s : mesh.surfaces)
+                {
+                    F.middleCols (offset, s.F.cols()) = s.F;
+                    offset += s.F.cols();
+                }
+                generate_normals (F, mesh.V, mesh.N, mesh.FN);
+            }
+        }
+        assert (mesh.V.cols() == mesh.N.cols());
+
+        for (auto& s : mesh.surfaces)
+        {
+            const cgltf_material& material = s.material;
+            const cgltf_pbr_metallic_roughness& pbr = material.pbr_metallic_roughness;
+
+            MaterialRef ref;
+            ref.name = material.name ? material.name : "";
+            if (material.has_pbr_metallic_roughness)
+            {
+                ref.diffuse = Vector3f (pbr.base_color_factor[0], pbr.base_color_factor[1], pbr.base_color_factor[2]);
+                ref.linearDiffuse = true;
+                if (pbr.base_color_texture.texture && pbr.base_color_texture.texture->image && pbr.base_color_texture.texture->image->uri)
+                    ref.texture = pbr.base_color_texture.texture->image->uri;
+            }
+
+            s.materialRef = static_cast<int32_t> (materials.size());
+            materials.push_back (std::move (ref));
+        }
+    }
+
+    if (!meshCache.store (filePath, meshes, materials, scene.instances))
+        LOG (DBUG) << "Could not write mesh cache for " << filePath.generic_string();
+
+    return MeshCacheView::fromMeshes (std::move (meshes), std::move (materials), scene.instances);
+}
+
+void ingestParse (IngestJob& job, const MeshCache& meshCache)
+{
+    if (!std::filesystem::exists (job.path))
+        throw std::runtime_error ("Load failed because file does not exist: " + job.path.generic_string());
+
+    job.meshes = meshCache.load (job.path);
+    if (job.meshes) return;
+
+    if (hasObjExtension (job.path))
+        job.source = parseObjFile (job.path);
+    else if (hasGltfExtension (job.path))
+        job.source = parseGltfFile (job.path);
+    else
+        throw std::runtime_error ("Unsupported file type: " + job.path.generic_string());
+}
+
+void getModelPlacement (const std::filesystem::path& filePath, const Eigen::AlignedBox3f& bounds, Vector3f& center, float& scale)
+{
+    center = Vector3f::Zero();
+    scale = 1.0f;
+
+    std::string name = filePath.stem().string();
+    if (name.find ("static") == 0 || name.find ("STATIC") == 0) return;
+
+    Vector3f edges = bounds.max() - bounds.min();
+    center = bounds.center();
+    scale = 0.5f / edges.maxCoeff();
+}
+
+Eigen::AlignedBox3f getPlacedBounds (const MeshCacheView& view)
+{
+    Eigen::AlignedBox3f bounds;
+    for (const CachedMesh& mesh : view.getMeshes())
+    {
+        if (mesh.surfaces.empty() || !mesh.V.cols()) continue;
+
+        MatrixXf placed = (mesh.transform.linear() * mesh.V).colwise() + mesh.transform.translation();
+        bounds.extend (Eigen::AlignedBox3f (placed.rowwise().minCoeff(), placed.rowwise().maxCoeff()));
+    }
+    return bounds;
+}
+
+wabi::TriangleBVHRef buildMeshBVH (const std::filesystem::path& filePath, const MeshCacheView& view)
+{
+    Eigen::Index vertexCount = 0;
+    Eigen::Index triangleCount = 0;
+    for (const CachedMesh& mesh : view.getMeshes())
+    {
+        if (mesh.surfaces.empty()) continue;
+
+        vertexCount += mesh.V.cols();
+        for (const CachedSurface& s : mesh.surfaces)
+            triangleCount += s.F.cols();
+    }
+
+    Vector3f center;
+    float scale;
+    getModelPlacement (filePath, getPlacedBounds (view), center, scale);
+
+    // in the order the geometry uploads them
+    MatrixXf V (3, vertexCount);
+    MatrixXu F (3, triangleCount);
+    Eigen::Index vertexOffset = 0;
+    Eigen::Index triangleOffset = 0;
+    for (const CachedMesh& mesh : view.getMeshes())
+    {
+        if (mesh.surfaces.empty()) continue;
+
+        V.middleCols (vertexOffset, mesh.V.cols()) = ((mesh.transform.linear() * mesh.V).colwise() + (mesh.transform.translation() - center)) * scale;
+        for (const CachedSurface& s : mesh.surfaces)
+        {
+            F.middleCols (triangleOffset, s.F.cols()) = s.F.array() + static_cast<uint32_t> (vertexOffset);
+            triangleOffset += s.F.cols();
+        }
+        vertexOffset += mesh.V.cols();
+    }
+
+    wabi::TriangleBVHRef bvh = std::make_shared<wabi::TriangleBVH>();
+    bvh->build (V, F);
+    return bvh;
+}
+
+void ingestProcess (IngestJob& job, const MeshCache& meshCache)
+{
+    if (!job.meshes)
+    {
+        if (hasObjExtension (job.path))
+            job.meshes = processObjResult (job.path, *std::static_pointer_cast<rapidobj::Result> (job.source), meshCache);
+        else
+            job.meshes = processGltfMeshes (job.path, *std::static_pointer_cast<GltfScene> (job.source), meshCache);
+    }
+
+    // built here on a worker so nothing has to be read back from the device for picking
+    job.bvh = buildMeshBVH (job.path, *job.meshes);
+}
+
+void ingestMaterials (IngestJob& job, mace::DecodedImageCache& decodedImages)
+{
+    const std::vector<MaterialRef>& materials = job.meshes->getMaterials();
+    std::filesystem::path materialFolder (job.path.parent_path());
+
+    job.texturePaths.assign (materials.size(), std::filesystem::path());
+    job.images.assign (materials.size(), nullptr);
+
+    mace::TaskScheduler::get().parallel_for (0, static_cast<uint32_t> (materials.size()), 1,
+                                             [&] (uint32_t start, uint32_t end)
+                                             {
+                                                 for (uint32_t i = start; i < end; ++i)
+                                                 {
+                                                     auto fullPath = resolveTexturePath (materials[i].texture, materialFolder);
+                                                     if (!fullPath) continue;
+
+                                                     job.texturePaths[i] = fullPath.value();
+                                                     job.images[i] = decodedImages.acquire (fullPath.value());
+                                                 }
+                                             });
+}
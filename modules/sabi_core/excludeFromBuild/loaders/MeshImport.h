@@ -0,0 +1,93 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+// The CPU side of scene import, the parse, process and materials stages of an
+// IngestPipeline. Everything here runs on worker threads so none of it may
+// touch CUDA or OptiX, the renderer only sees the finished IngestJob.
+
+// every mesh in a glTF file once, and the nodes that place them
+struct GltfScene
+{
+    std::vector<MeshBuffers> meshes;
+    std::vector<MeshInstance> instances;
+};
+
+// Selects how generate_normals accumulates the angle weighted face normals into N
+enum class NormalAccumulation
+{
+    Scatter, // each face atomically adds into its 3 vertex normals
+    Gather   // each vertex sums its incident faces through a vertex to face adjacency, no atomics
+};
+
+// angle weighted vertex normals and face normals, math from Instant Meshes https://github.com/wjakob/instant-meshes
+// gather is the default since it scales with core count on dense meshes.
+// Returns how many faces were degenerate, they're left with a zero face normal and
+// add nothing to their vertices. A vertex no face adds to gets +X
+uint32_t generate_normals (const MatrixXu& F, const MatrixXf& V, MatrixXf& N, MatrixXf& FN,
+                           NormalAccumulation mode = NormalAccumulation::Gather);
+
+// Converts a triangulated rapidobj result into a MeshBuffers with a single Surface
+// in one linear pass over the face corners. Corners are welded on their
+// (position, texcoord, normal) indices so uvs and normals no longer have to share
+// the position's index. sourcePositions maps each welded vertex back to its OBJ
+// position index. mesh.N is only filled when every corner carries a normal.
+void objToMeshBuffers (const rapidobj::Result& result, MeshBuffers& mesh, std::vector<uint32_t>& sourcePositions);
+
+// finds a texture referenced by a material, relative names are looked up
+// by filename in the shared index of materialFolder
+std::optional<std::filesystem::path> resolveTexturePath (const std::string& texture, const std::filesystem::path& materialFolder);
+
+std::shared_ptr<rapidobj::Result> parseObjFile (const std::filesystem::path& filePath);
+
+// welds the corners and generates normals, then writes the result to
+// the cache so the next start can skip all of that
+MeshCacheViewRef processObjResult (const std::filesystem::path& filePath, const rapidobj::Result& result, const MeshCache& meshCache);
+
+std::shared_ptr<GltfScene> parseGltfFile (const std::filesystem::path& filePath);
+
+// generates normals and material refs, then writes the result to the cache
+MeshCacheViewRef processGltfMeshes (const std::filesystem::path& filePath, GltfScene& scene, const MeshCache& meshCache);
+
+// parse stage: map the cached mesh if there is a valid one, otherwise read the source file
+void ingestParse (IngestJob& job, const MeshCache& meshCache);
+
+// dynamic models are centered on the origin with their largest edge half a unit long,
+// files whose name starts with "static" keep the coordinates they were modelled in
+void getModelPlacement (const std::filesystem::path& filePath, const Eigen::AlignedBox3f& bounds, Eigen::Vector3f& center, float& scale);
+
+// the model's bounds with every placement's transform applied
+Eigen::AlignedBox3f getPlacedBounds (const MeshCacheView& view);
+
+// the triangles the renderer uploads for a model, every placement of every
+// mesh with its transform baked in and placed by getModelPlacement
+wabi::TriangleBVHRef buildMeshBVH (const std::filesystem::path& filePath, const MeshCacheView& view);
+
+// process stage: welding, normals, bounds and the cache write, then the CPU BVH,
+// which is all there is to do on a cache hit
+void ingestProcess (IngestJob& job, const MeshCache& meshCache);
+
+// materials stage: find and decode every material's texture, materials
+// sharing an image share the decoded pixels
+void ingestMaterials (IngestJob& job, mace::DecodedImageCache& decodedImages);
@@ -0,0 +1,576 @@
+#include "CpuPathTracer.h"
+
+// the helpers below are common_device.h's, which only compiles for the GPU
+
+static constexpr float PT_PI = 3.14159265358979323846f;
+
+// Shared::probToSampleEnvLight is only used when there are area lights as well,
+// which the kernels don't have yet, so the sky dome is always picked
+static constexpr float PT_MISS_BSDF_DENSITY = 0.25f;
+
+// ( 0, 0,  1) <=> phi:      0
+// (-1, 0,  0) <=> phi: 1/2 pi
+// ( 0, 0, -1) <=> phi:   1 pi
+// ( 1, 0,  0) <=> phi: 3/2 pi
+static Eigen::Vector3f fromPolarYUp (float phi, float theta)
+{
+    float sinTheta = std::sin (theta);
+    return Eigen::Vector3f (-std::sin (phi) * sinTheta, std::cos (theta), std::cos (phi) * sinTheta);
+}
+
+static void toPolarYUp (const Eigen::Vector3f& v, float& phi, float& theta)
+{
+    theta = std::acos (std::clamp (v.y(), -1.0f, 1.0f));
+    phi = std::fmod (std::atan2 (-v.x(), v.z()) + 2 * PT_PI, 2 * PT_PI);
+}
+
+static void makeCoordinateSystem (const Eigen::Vector3f& normal, Eigen::Vector3f& tangent, Eigen::Vector3f& bitangent)
+{
+    float sign = normal.z() >= 0 ? 1.0f : -1.0f;
+    const float a = -1 / (sign + normal.z());
+    const float b = normal.x() * normal.y() * a;
+    tangent = Eigen::Vector3f (1 + sign * normal.x() * normal.x() * a, sign * b, -sign * normal.x());
+    bitangent = Eigen::Vector3f (b, sign + normal.y() * normal.y() * a, -normal.y());
+}
+
+// A Fast and Robust Method for Avoiding Self-Intersection, Ray Tracing Gems, 2019
+static Eigen::Vector3f offsetRayOrigin (const Eigen::Vector3f& p, const Eigen::Vector3f& geometricNormal)
+{
+    constexpr float kOrigin = 1.0f / 32.0f;
+    constexpr float kFloatScale = 1.0f / 65536.0f;
+    constexpr float kIntScale = 256.0f;
+
+    Eigen::Vector3f offset;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (std::abs (p[axis]) < kOrigin)
+        {
+            offset[axis] = p[axis] + kFloatScale * geometricNormal[axis];
+            continue;
+        }
+        int32_t offsetInInt = static_cast<int32_t> (kIntScale * geometricNormal[axis]);
+        int32_t bits;
+        std::memcpy (&bits, &p[axis], sizeof (float));
+        bits += (p[axis] < 0 ? -1 : 1) * offsetInInt;
+        std::memcpy (&offset[axis], &bits, sizeof (float));
+    }
+    return offset;
+}
+
+static void concentricSampleDisk (float u0, float u1, float& dx, float& dy)
+{
+    float r, theta;
+    float sx = 2 * u0 - 1;
+    float sy = 2 * u1 - 1;
+
+    if (sx == 0 && sy == 0)
+    {
+        dx = 0;
+        dy = 0;
+        return;
+    }
+    if (sx >= -sy)
+    {
+        if (sx > sy)
+        {
+            r = sx;
+            theta = sy / sx;
+        }
+        else
+        {
+            r = sy;
+            theta = 2 - sx / sy;
+        }
+    }
+    else
+    {
+        if (sx > sy)
+        {
+            r = -sy;
+            theta = 6 + sx / sy;
+        }
+        else
+        {
+            r = -sx;
+            theta = 4 + sy / sx;
+        }
+    }
+    theta *= PT_PI / 4;
+    dx = r * std::cos (theta);
+    dy = r * std::sin (theta);
+}
+
+static Eigen::Vector3f cosineSampleHemisphere (float u0, float u1)
+{
+    float x, y;
+    concentricSampleDisk (u0, u1, x, y);
+    return Eigen::Vector3f (x, y, std::sqrt (std::max (0.0f, 1.0f - x * x - y * y)));
+}
+
+// linear filtering the way CUDA textures do it, texel centres sit at half integers
+static Eigen::Vector3f sampleBilinear (const float* rgba, uint32_t width, uint32_t height, float u, float v, bool wrap)
+{
+    float x = u * width - 0.5f;
+    float y = v * height - 0.5f;
+    float x0 = std::floor (x);
+    float y0 = std::floor (y);
+    float fx = x - x0;
+    float fy = y - y0;
+
+    auto texel = [&] (int64_t tx, int64_t ty)
+    {
+        if (wrap)
+        {
+            tx = ((tx % width) + width) % width;
+            ty = ((ty % height) + height) % height;
+        }
+        else
+        {
+            tx = std::clamp<int64_t> (tx, 0, width - 1);
+            ty = std::clamp<int64_t> (ty, 0, height - 1);
+        }
+        const float* p = rgba + (size_t (ty) * width + size_t (tx)) * 4;
+        return Eigen::Vector3f (p[0], p[1], p[2]);
+    };
+
+    int64_t ix = static_cast<int64_t> (x0);
+    int64_t iy = static_cast<int64_t> (y0);
+    return (1 - fy) * ((1 - fx) * texel (ix, iy) + fx * texel (ix + 1, iy)) +
+           fy * ((1 - fx) * texel (ix, iy + 1) + fx * texel (ix + 1, iy + 1));
+}
+
+struct CpuPathTracer::PathState
+{
+    Eigen::Vector3f alpha = Eigen::Vector3f::Ones();
+    Eigen::Vector3f contribution = Eigen::Vector3f::Zero();
+    Eigen::Vector3f origin;
+    Eigen::Vector3f direction;
+    uint32_t pathLength = 1;
+    bool terminate = false;
+};
+
+PathTracerView PathTracerView::fromCamera (CameraBody& camera)
+{
+    // refreshes the camera's basis vectors
+    camera.getViewMatrix();
+
+    PathTracerView view;
+    view.eye = camera.getEyePoint();
+    view.right = camera.getRight();
+    view.up = camera.getUp();
+    view.forward = camera.getFoward();
+    view.fovY = camera.getVerticalFOVradians();
+    view.aspect = camera.getSensor()->getPixelAspectRatio();
+
+    Eigen::Vector2i resolution = camera.getSensor()->getPixelResolution();
+    view.width = static_cast<uint32_t> (resolution.x());
+    view.height = static_cast<uint32_t> (resolution.y());
+    return view;
+}
+
+CpuPathTracer::CpuPathTracer (const PathTracerSettings& settings) :
+    settings (settings)
+{
+}
+
+uint32_t CpuPathTracer::addMesh (PathTracerMesh&& mesh)
+{
+    if (mesh.N.cols() && mesh.N.cols() != mesh.V.cols())
+        throw std::runtime_error ("CpuPathTracer mesh normals don't match its vertices");
+
+    const PathTracerMaterial& material = mesh.material;
+    if (material.texture.size())
+    {
+        if (material.texture.size() != size_t (material.textureWidth) * material.textureHeight * 4)
+            throw std::runtime_error ("CpuPathTracer texture size doesn't match its dimensions");
+        if (mesh.UV.cols() != mesh.V.cols())
+            throw std::runtime_error ("CpuPathTracer textured meshes need a uv per vertex");
+    }
+
+    Mesh& m = meshes.emplace_back();
+    m.data = std::move (mesh);
+    m.bvh = std::make_shared<wabi::TriangleBVH>();
+    m.bvh->build (m.data.V, m.data.F);
+
+    return static_cast<uint32_t> (meshes.size() - 1);
+}
+
+uint32_t CpuPathTracer::addInstance (uint32_t mesh, const Pose& worldTransform)
+{
+    uint32_t instance = scene.addInstance (meshes.at (mesh).bvh, worldTransform);
+    if (instance >= instanceMeshes.size())
+        instanceMeshes.resize (instance + 1);
+    instanceMeshes[instance] = mesh;
+
+    sceneChanged = true;
+    restart();
+    return instance;
+}
+
+void CpuPathTracer::removeInstance (uint32_t instance)
+{
+    scene.removeInstance (instance);
+    sceneChanged = true;
+    restart();
+}
+
+void CpuPathTracer::setTransform (uint32_t instance, const Pose& worldTransform)
+{
+    scene.setTransform (instance, worldTransform);
+    sceneChanged = true;
+    restart();
+}
+
+void CpuPathTracer::setEnvironment (mace::EnvLightDataRef newEnv)
+{
+    if (newEnv && (!newEnv->distribution || newEnv->rgba.size() != size_t (newEnv->width) * newEnv->height * 4))
+        throw std::runtime_error ("CpuPathTracer needs a sky dome with its importance map");
+
+    env = newEnv;
+
+    envRows.clear();
+    envDistribution = EnvLightDistribution2D();
+    if (env)
+    {
+        const mace::EnvLightDistribution& dist = *env->distribution;
+        envRows.reserve (dist.height);
+
+#if USE_ALIAS_TABLE_ENV_LIGHT
+        size_t entryCount = size_t (dist.width) * dist.height;
+        rowAliases.resize (entryCount);
+        rowValueMaps.resize (entryCount);
+        marginalAliases.resize (dist.height);
+        marginalValueMaps.resize (dist.height);
+
+        for (uint32_t row = 0; row < dist.height; ++row)
+        {
+            size_t offset = size_t (row) * dist.width;
+            buildAliasTable (dist.rowPDFs.data() + offset, dist.width, rowAliases.data() + offset, rowValueMaps.data() + offset);
+            envRows.emplace_back (dist.rowPDFs.data() + offset, rowAliases.data() + offset, rowValueMaps.data() + offset,
+                                  dist.rowIntegrals[row], dist.width);
+        }
+
+        buildAliasTable (dist.marginalPDF.data(), dist.height, marginalAliases.data(), marginalValueMaps.data());
+        EnvLightDistribution1D marginal (dist.marginalPDF.data(), marginalAliases.data(), marginalValueMaps.data(), dist.integral, dist.height);
+#else
+        for (uint32_t row = 0; row < dist.height; ++row)
+            envRows.emplace_back (dist.rowPDFs.data() + size_t (row) * dist.width, dist.rowCDFs.data() + size_t (row) * (dist.width + 1),
+                                  dist.rowIntegrals[row], dist.width);
+
+        EnvLightDistribution1D marginal (dist.marginalPDF.data(), dist.marginalCDF.data(), dist.integral, dist.height);
+#endif
+        envDistribution = EnvLightDistribution2D (envRows.data(), marginal);
+    }
+
+    restart();
+}
+
+void CpuPathTracer::setSettings (const PathTracerSettings& newSettings)
+{
+    if (newSettings.tileSize == 0 || newSettings.maxPathLength == 0)
+        throw std::runtime_error ("CpuPathTracer tile size and path length must be at least 1");
+
+    bool reseed = newSettings.seed != settings.seed;
+    settings = newSettings;
+    if (reseed) rngWidth = rngHeight = 0;
+    restart();
+}
+
+void CpuPathTracer::resetRandomNumbers (uint32_t width, uint32_t height)
+{
+    // the same states the Renderer puts in its rngBuffer
+    std::mt19937_64 rng (settings.seed);
+    rngStates.resize (size_t (width) * height);
+    for (PCG32RNG& state : rngStates)
+        state.setState (rng());
+
+    rngWidth = width;
+    rngHeight = height;
+    restart();
+}
+
+void CpuPathTracer::render (CameraBody& camera)
+{
+    if (camera.isDirty())
+    {
+        restart();
+        camera.setDirty (false);
+    }
+
+    OIIO::ImageBuf& image = camera.getSensorPixels();
+    const OIIO::ImageSpec& spec = image.spec();
+    float* pixels = static_cast<float*> (image.localpixels());
+    if (!pixels || spec.format != OIIO::TypeDesc::FLOAT || spec.nchannels != 4)
+        throw std::runtime_error ("CpuPathTracer renders into a float RGBA camera sensor");
+
+    render (PathTracerView::fromCamera (camera), pixels);
+}
+
+void CpuPathTracer::render (const PathTracerView& view, float* rgba)
+{
+    if (view.width == 0 || view.height == 0) return;
+
+    if (view.width != rngWidth || view.height != rngHeight)
+        resetRandomNumbers (view.width, view.height);
+
+    if (sceneChanged)
+    {
+        // refit when only transforms moved, a full build after adds and removes
+        scene.refit();
+        sceneChanged = false;
+    }
+
+    const float curWeight = 1.0f / (1 + accumFrames);
+    const bool accumulate = accumFrames > 0;
+
+    const uint32_t tileSize = settings.tileSize;
+    const uint32_t tilesX = (view.width + tileSize - 1) / tileSize;
+    const uint32_t tilesY = (view.height + tileSize - 1) / tileSize;
+
+    mace::TaskScheduler::get().parallel_for (0, tilesX * tilesY, 1, [&] (uint32_t start, uint32_t end)
+                                             {
+        for (uint32_t tile = start; tile < end; ++tile)
+        {
+            uint32_t x0 = (tile % tilesX) * tileSize;
+            uint32_t y0 = (tile / tilesX) * tileSize;
+            uint32_t x1 = std::min (x0 + tileSize, view.width);
+            uint32_t y1 = std::min (y0 + tileSize, view.height);
+
+            for (uint32_t y = y0; y < y1; ++y)
+            {
+                for (uint32_t x = x0; x < x1; ++x)
+                {
+                    size_t pixel = size_t (y) * view.width + x;
+                    float* out = rgba + pixel * 4;
+
+                    Eigen::Vector3f contribution = tracePath (view, x, y, rngStates[pixel]);
+
+                    Eigen::Vector3f previous = accumulate ? Eigen::Vector3f (out[0], out[1], out[2]) : Eigen::Vector3f::Zero();
+                    Eigen::Vector3f color = (1 - curWeight) * previous + curWeight * contribution;
+
+                    // the kernel's markers for broken samples
+                    if (color.array().isNaN().any())
+                        color = Eigen::Vector3f (1000000.0f, 0.0f, 0.0f);
+                    else if (color.array().isInf().any())
+                        color = Eigen::Vector3f (0.0f, 1000000.0f, 0.0f);
+                    else if ((color.array() < 0.0f).any())
+                        color = Eigen::Vector3f (0.0f, 0.0f, 1000000.0f);
+
+                    out[0] = color.x();
+                    out[1] = color.y();
+                    out[2] = color.z();
+                    out[3] = 1.0f;
+                }
+            }
+        } });
+
+    ++accumFrames;
+}
+
+// the pathTracing raygen
+Eigen::Vector3f CpuPathTracer::tracePath (const PathTracerView& view, uint32_t x, uint32_t y, PCG32RNG& rng) const
+{
+    float jx = rng.getFloat0cTo1o();
+    float jy = rng.getFloat0cTo1o();
+
+    float sx = (x + jx) / view.width;
+    float sy = (y + jy) / view.height;
+
+    float vh = 2 * std::tan (view.fovY * 0.5f);
+    float vw = view.aspect * vh;
+
+    // Renderer::updateCamera negates right for the kernels' orientation matrix
+    PathState path;
+    path.origin = view.eye;
+    path.direction = (-view.right * (vw * (0.5f - sx)) + view.up * (vh * (0.5f - sy)) + view.forward).normalized();
+
+    for (;;)
+    {
+        wabi::Ray3f ray (path.origin, path.direction, 0.0f, std::numeric_limits<float>::max());
+        if (scene.intersect (ray))
+            shade (ray, path, rng);
+        else
+            miss (path.direction, path);
+
+        if (path.terminate || path.pathLength >= settings.maxPathLength)
+            break;
+
+        ++path.pathLength;
+    }
+
+    return path.contribution;
+}
+
+// the shading closest hit program
+void CpuPathTracer::shade (const wabi::Ray3f& ray, PathState& path, PCG32RNG& rng) const
+{
+    uint32_t instance = static_cast<uint32_t> (ray.hitBodyID);
+    const PathTracerMesh& mesh = meshes[instanceMeshes[instance]].data;
+    const Pose& pose = scene.getTransform (instance);
+    const uint32_t f = static_cast<uint32_t> (ray.hitPolyID);
+
+    float b1 = ray.bary1;
+    float b2 = ray.bary2;
+    float b0 = 1 - (b1 + b2);
+
+    Eigen::Vector3f p[3];
+    for (int corner = 0; corner < 3; ++corner)
+        p[corner] = pose * Eigen::Vector3f (mesh.V.col (mesh.F (corner, f)));
+
+    Eigen::Vector3f positionInWorld = b0 * p[0] + b1 * p[1] + b2 * p[2];
+    Eigen::Vector3f geometricNormal = (p[1] - p[0]).cross (p[2] - p[0]).normalized();
+
+    Eigen::Vector3f shadingNormal = geometricNormal;
+    if (mesh.N.cols())
+    {
+        Eigen::Vector3f n = b0 * mesh.N.col (mesh.F (0, f)) + b1 * mesh.N.col (mesh.F (1, f)) + b2 * mesh.N.col (mesh.F (2, f));
+        shadingNormal = (pose.linear().inverse().transpose() * n).normalized();
+    }
+    if (!shadingNormal.allFinite())
+        shadingNormal = Eigen::Vector3f (0, 0, 1);
+
+    // the meshes carry no tangents so the frame is always built around the normal
+    Eigen::Vector3f tangent, bitangent;
+    makeCoordinateSystem (shadingNormal, tangent, bitangent);
+    bitangent = shadingNormal.cross (tangent);
+
+    // rows are the tangent, bitangent and normal, toLocal is frame * v and fromLocal frame^T * v
+    Eigen::Matrix3f frame;
+    frame.row (0) = tangent;
+    frame.row (1) = bitangent;
+    frame.row (2) = shadingNormal;
+
+    Eigen::Vector3f vOut = (-path.direction).normalized();
+    float frontHit = vOut.dot (geometricNormal) >= 0.0f ? 1.0f : -1.0f;
+
+    positionInWorld = offsetRayOrigin (positionInWorld, frontHit * geometricNormal);
+    Eigen::Vector3f vOutLocal = frame * vOut;
+
+    Eigen::Vector3f albedo = mesh.material.albedo;
+    if (mesh.material.texture.size())
+    {
+        Eigen::Vector2f uv = b0 * mesh.UV.col (mesh.F (0, f)) + b1 * mesh.UV.col (mesh.F (1, f)) + b2 * mesh.UV.col (mesh.F (2, f));
+        albedo = sampleBilinear (mesh.material.texture.data(), mesh.material.textureWidth, mesh.material.textureHeight, uv.x(), uv.y(), true);
+    }
+
+    path.contribution += path.alpha.cwiseProduct (nextEventEstimation (positionInWorld, vOutLocal, frame, albedo, rng));
+
+    // LambertBRDF::sampleThroughput, the cosine and density cancel
+    float u0 = rng.getFloat0cTo1o();
+    float u1 = rng.getFloat0cTo1o();
+    Eigen::Vector3f vInLocal = cosineSampleHemisphere (u0, u1);
+    if (vOutLocal.z() <= 0.0f)
+        vInLocal.z() *= -1;
+    path.alpha = path.alpha.cwiseProduct (albedo);
+
+    path.origin = positionInWorld;
+    path.direction = frame.transpose() * vInLocal;
+    path.terminate = false;
+}
+
+// the miss program
+void CpuPathTracer::miss (const Eigen::Vector3f& direction, PathState& path) const
+{
+    path.terminate = true;
+
+    if (!env)
+    {
+        path.contribution += path.alpha.cwiseProduct (Eigen::Vector3f (0.01f, 0.015f, 0.02f));
+        return;
+    }
+
+    float posPhi, theta;
+    toPolarYUp (direction.normalized(), posPhi, theta);
+
+    float phi = posPhi + settings.envLightRotation;
+    phi = phi - std::floor (phi / (2 * PT_PI)) * 2 * PT_PI;
+    float u = phi / (2 * PT_PI);
+    float v = theta / PT_PI;
+
+    Eigen::Vector3f luminance = std::pow (10.0f, settings.log10EnvLightPowerCoeff) * lookupEnvironment (u, v);
+    if (path.pathLength > 1)
+    {
+        // coming off a surface, the bsdf density is the kernel's placeholder
+        float uvPDF = evaluateEnvironmentPDF (u, v);
+        float lightPDensity = uvPDF / (2 * PT_PI * PT_PI * std::sin (theta));
+        float bsdfPDensity = PT_MISS_BSDF_DENSITY;
+        float misWeight = (bsdfPDensity * bsdfPDensity) / (bsdfPDensity * bsdfPDensity + lightPDensity * lightPDensity);
+
+        path.contribution += path.alpha.cwiseProduct (luminance) * misWeight;
+    }
+    else
+        path.contribution = luminance;
+}
+
+// performNextEventEstimation and computeDirectLightingFromEnvironment
+Eigen::Vector3f CpuPathTracer::nextEventEstimation (const Eigen::Vector3f& shadingPoint, const Eigen::Vector3f& vOutLocal,
+                                                    const Eigen::Matrix3f& frame, const Eigen::Vector3f& albedo, PCG32RNG& rng) const
+{
+    // the light selection number is drawn even with one light so the sequence matches the kernel
+    rng.getFloat0cTo1o();
+    float u0 = rng.getFloat0cTo1o();
+    float u1 = rng.getFloat0cTo1o();
+
+    if (!env) return Eigen::Vector3f::Zero();
+
+    float u, v, uvPDF;
+    sampleEnvironment (u0, u1, u, v, uvPDF);
+
+    float phi = 2 * PT_PI * u;
+    float theta = PT_PI * v;
+    if (theta == 0.0f) return Eigen::Vector3f::Zero();
+
+    float posPhi = phi - settings.envLightRotation;
+    posPhi = posPhi - std::floor (posPhi / (2 * PT_PI)) * 2 * PT_PI;
+
+    // a light at infinity, its position is the direction to it and it faces back at us
+    Eigen::Vector3f lightPosition = fromPolarYUp (posPhi, theta);
+    Eigen::Vector3f lightNormal = -lightPosition;
+    float areaPDensity = uvPDF / (2 * PT_PI * PT_PI * std::sin (theta));
+    if (areaPDensity <= 0.0f) return Eigen::Vector3f::Zero();
+
+    Eigen::Vector3f emittance = PT_PI * std::pow (10.0f, settings.log10EnvLightPowerCoeff) * lookupEnvironment (u, v);
+
+    float dist2 = lightPosition.squaredNorm();
+    Eigen::Vector3f shadowRay = lightPosition / std::sqrt (dist2);
+    Eigen::Vector3f vInLocal = frame * shadowRay;
+
+    // MIS against LambertBRDF::evaluatePDF
+    float lpCos = std::abs (shadowRay.dot (lightNormal));
+    float bsdfPDensity = (vOutLocal.z() * vInLocal.z() > 0 ? std::abs (vInLocal.z()) / PT_PI : 0.0f) * lpCos / dist2;
+    if (!std::isfinite (bsdfPDensity))
+        bsdfPDensity = 0.0f;
+    float misWeight = (areaPDensity * areaPDensity) / (bsdfPDensity * bsdfPDensity + areaPDensity * areaPDensity);
+
+    float lightCos = -shadowRay.dot (lightNormal);
+    float surfaceCos = vInLocal.z();
+    if (lightCos <= 0.0f) return Eigen::Vector3f::Zero();
+
+    wabi::Ray3f visibility (shadingPoint, shadowRay, 0.0f, 1e+10f * 0.9999f);
+    if (scene.intersectAny (visibility)) return Eigen::Vector3f::Zero();
+
+    Eigen::Vector3f Le = emittance / PT_PI;
+    Eigen::Vector3f fsValue = vOutLocal.z() * vInLocal.z() > 0 ? Eigen::Vector3f (albedo / PT_PI) : Eigen::Vector3f::Zero();
+    float G = lightCos * std::abs (surfaceCos) / dist2;
+
+    return fsValue.cwiseProduct (Le) * G * (misWeight / areaPDensity);
+}
+
+Eigen::Vector3f CpuPathTracer::lookupEnvironment (float u, float v) const
+{
+    return sampleBilinear (env->rgba.data(), env->width, env->height, u, v, false);
+}
+
+void CpuPathTracer::sampleEnvironment (float u0, float u1, float& u, float& v, float& uvPDF) const
+{
+    envDistribution.sample (u0, u1, &u, &v, &uvPDF);
+}
+
+float CpuPathTracer::evaluateEnvironmentPDF (float u, float v) const
+{
+    const mace::EnvLightDistribution& dist = *env->distribution;
+
+    uint32_t row = std::min (static_cast<uint32_t> (v * dist.height), dist.height - 1);
+    uint32_t column = std::min (static_cast<uint32_t> (u * dist.width), dist.width - 1);
+    return dist.marginalPDF[row] * dist.rowPDFs[size_t (row) * dist.width + column];
+}
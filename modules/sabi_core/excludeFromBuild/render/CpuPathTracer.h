@@ -0,0 +1,174 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// CPU reference path tracer, the algorithm of the IBL sandbox's optix_kernels.cu
+//
+// The pathTracing raygen, Lambert BRDF and next event estimation of the sky dome with
+// MIS, up to maxPathLength bounces. Every pixel has its own PCG32 generator seeded the way
+// the Renderer seeds its rngBuffer, so the image doesn't depend on the thread count or the
+// tile size and two renders of the same scene are identical. Rays go through a
+// wabi::InstanceBVH and tiles of pixels are spread over the mace::TaskScheduler.
+//
+// Where it differs from the kernels: albedo textures are sampled from their base level
+// rather than a ray cone LOD, there's no denoiser and without a sky dome misses get the
+// miss program's ambient colour and next event estimation is skipped.
+//
+// The sky dome is sampled with the kernels' own distribution classes from common_shared.h,
+// alias tables or CDFs as USE_ALIAS_TABLE_ENV_LIGHT picks for both.
+
+struct PathTracerSettings
+{
+    uint32_t maxPathLength = 10;
+    uint32_t tileSize = 16;
+
+    // the Renderer's defaults
+    float log10EnvLightPowerCoeff = 0.25f;
+    float envLightRotation = 0.0f;
+    uint64_t seed = 591842031321323413ull;
+};
+
+struct PathTracerMaterial
+{
+    // Shared::MaterialData's default
+    Eigen::Vector3f albedo = Eigen::Vector3f (0.0f, 0.0f, 0.5f);
+
+    // optional base colour as RGBA floats, used instead of albedo when there is one
+    uint32_t textureWidth = 0;
+    uint32_t textureHeight = 0;
+    std::vector<float> texture;
+};
+
+// geometry in its own space, any number of instances share it
+struct PathTracerMesh
+{
+    MatrixXf V;  // 3 x vertices
+    MatrixXf N;  // 3 x vertices, leave empty for flat shading
+    MatrixXf UV; // 2 x vertices, only read when the material has a texture
+    MatrixXu F;  // 3 x triangles
+    PathTracerMaterial material;
+};
+
+// a pinhole camera the way Renderer::updateCamera hands it to the kernels
+struct PathTracerView
+{
+    Eigen::Vector3f eye = Eigen::Vector3f::Zero();
+    Eigen::Vector3f right = Eigen::Vector3f::UnitX();
+    Eigen::Vector3f up = Eigen::Vector3f::UnitY();
+    Eigen::Vector3f forward = Eigen::Vector3f::UnitZ();
+    float fovY = 0.785398f;
+    float aspect = 1.0f;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    static PathTracerView fromCamera (CameraBody& camera);
+};
+
+class CpuPathTracer : Noncopyable
+{
+ public:
+    CpuPathTracer (const PathTracerSettings& settings = PathTracerSettings());
+    ~CpuPathTracer() = default;
+
+    // builds the mesh's BLAS, returns the index addInstance() takes
+    uint32_t addMesh (PathTracerMesh&& mesh);
+
+    // instances are placed like the IAS children, changing them restarts the average
+    uint32_t addInstance (uint32_t mesh, const Pose& worldTransform);
+    void removeInstance (uint32_t instance);
+    void setTransform (uint32_t instance, const Pose& worldTransform);
+
+    // the clamped sky dome and its importance map from mace::EnvLightPreprocessor, nullptr for none
+    void setEnvironment (mace::EnvLightDataRef env);
+
+    const PathTracerSettings& getSettings() const { return settings; }
+    void setSettings (const PathTracerSettings& newSettings);
+
+    // one sample per pixel folded into the running average, one launch of the raygen.
+    // The first writes the camera's sensor image, the second width * height RGBA floats
+    void render (CameraBody& camera);
+    void render (const PathTracerView& view, float* rgba);
+
+    // the next render starts a new average
+    void restart() { accumFrames = 0; }
+    uint32_t getAccumulatedFrames() const { return accumFrames; }
+
+ private:
+    using PCG32RNG = shared::PCG32RNG;
+
+#if USE_ALIAS_TABLE_ENV_LIGHT
+    using EnvLightDistribution1D = shared::AliasRegularConstantContinuousDistribution1D;
+    using EnvLightDistribution2D = shared::AliasRegularConstantContinuousDistribution2D;
+#else
+    using EnvLightDistribution1D = shared::RegularConstantContinuousDistribution1D;
+    using EnvLightDistribution2D = shared::RegularConstantContinuousDistribution2D;
+#endif
+
+    struct Mesh
+    {
+        PathTracerMesh data;
+        wabi::TriangleBVHRef bvh = nullptr;
+    };
+
+    struct PathState;
+
+    PathTracerSettings settings;
+    std::vector<Mesh> meshes;
+    std::vector<uint32_t> instanceMeshes; // instance index to mesh
+    wabi::InstanceBVH scene;
+    bool sceneChanged = false;
+
+    mace::EnvLightDataRef env = nullptr;
+
+    // the env's distribution as the kernels see it, set up by setEnvironment the way
+    // the SkyDomeHandler sets up the device one but pointing at host memory
+    std::vector<EnvLightDistribution1D> envRows;
+    EnvLightDistribution2D envDistribution;
+
+#if USE_ALIAS_TABLE_ENV_LIGHT
+    // from common_host.h's buildAliasTable, the same tables the kernels get
+    std::vector<shared::AliasTableEntry<float>> rowAliases; // width per row of the importance map
+    std::vector<shared::AliasValueMap<float>> rowValueMaps;
+    std::vector<shared::AliasTableEntry<float>> marginalAliases;
+    std::vector<shared::AliasValueMap<float>> marginalValueMaps;
+#endif
+
+    std::vector<PCG32RNG> rngStates;
+    uint32_t rngWidth = 0;
+    uint32_t rngHeight = 0;
+    uint32_t accumFrames = 0;
+
+    void resetRandomNumbers (uint32_t width, uint32_t height);
+    Eigen::Vector3f tracePath (const PathTracerView& view, uint32_t x, uint32_t y, PCG32RNG& rng) const;
+    void shade (const wabi::Ray3f& ray, PathState& path, PCG32RNG& rng) const;
+    void miss (const Eigen::Vector3f& direction, PathState& path) const;
+    Eigen::Vector3f nextEventEstimation (const Eigen::Vector3f& shadingPoint, const Eigen::Vector3f& vOutLocal,
+                                         const Eigen::Matrix3f& shadingFrame, const Eigen::Vector3f& albedo, PCG32RNG& rng) const;
+
+    Eigen::Vector3f lookupEnvironment (float u, float v) const;
+    void sampleEnvironment (float u0, float u1, float& u, float& v, float& uvPDF) const;
+    float evaluateEnvironmentPDF (float u, float v) const;
+
+}; // end class CpuPathTracer
@@ -10,5 +10,11 @@ namespace sabi
 
 // mesh
 #include "excludeFromBuild/loaders/GltfReader.cpp"
+#include "excludeFromBuild/loaders/MeshCache.cpp"
+#include "excludeFromBuild/loaders/IngestPipeline.cpp"
+#include "excludeFromBuild/loaders/MeshImport.cpp"
+
+// render
+#include "excludeFromBuild/render/CpuPathTracer.cpp"
 
 } // namespace sabi
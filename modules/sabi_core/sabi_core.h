@@ -27,6 +27,15 @@ SOFTWARE.
 #include <rapidobj/rapidobj.hpp>
 #include <cgltfReader/cgltf.h>
 
+// the kernels' random numbers, sky dome distributions and alias tables for the CPU path tracer
+#include <common_host.h>
+
+// SSE2 is baseline on every x64 target
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SABI_SSE2 1
+#endif
+
 // cereal
 #include <cereal/cereal.hpp>
 #include <cereal/types/vector.hpp>
@@ -59,13 +68,26 @@ namespace cereal
 
 namespace sabi
 {
+    // enough of a source material to find it again
+    // without keeping the parsed file around
+    struct MaterialRef
+    {
+        int32_t sourceIndex = -1; // material index in the source file
+        std::string name;
+        std::string texture; // base color texture as referenced by the file
+        Eigen::Vector3f diffuse = Eigen::Vector3f::Ones();
+        bool linearDiffuse = false; // glTF base colour factors are linear, MTL Kd is sRGB
+    };
+
     // a Surface is a group of triangles with
     // a unique Material
     struct Surface
     {
         MatrixXu F; // triangle indices
         cgltf_material material;
-        std::vector<Eigen::Vector2f> uvs; // UV coordinates
+        std::vector<Eigen::Vector2f> uvs; // UV coordinates, one per mesh vertex. Multi primitive glTF meshes keep them all on the first surface
+        std::vector<uint8_t> materialIDs; // optional per triangle material, indexes a MaterialRef list
+        int32_t materialRef = -1;         // indexes a MaterialRef list
     };
 
     struct MeshBuffers
@@ -77,9 +99,21 @@ namespace sabi
         Eigen::Affine3f transform;
     };
 
+    // one placement of a mesh, instances of the same mesh share its buffers
+    struct MeshInstance
+    {
+        uint32_t mesh = 0; // index into the list of MeshBuffers
+        Eigen::Affine3f transform = Eigen::Affine3f::Identity();
+    };
+
 // camera
 #include "excludeFromBuild/camera/CameraSensor.h"
+#include "excludeFromBuild/camera/CameraRays.h"
 #include "excludeFromBuild/camera/CameraBody.h"
 #include "excludeFromBuild/loaders/GltfReader.h"
+#include "excludeFromBuild/loaders/MeshCache.h"
+#include "excludeFromBuild/loaders/IngestPipeline.h"
+#include "excludeFromBuild/loaders/MeshImport.h"
+#include "excludeFromBuild/render/CpuPathTracer.h"
 
 } // namespace sabi
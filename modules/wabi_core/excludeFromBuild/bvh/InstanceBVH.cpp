@@ -0,0 +1,360 @@
+#include "InstanceBVH.h"
+
+uint32_t InstanceBVH::addInstance (TriangleBVHRef blas, const Pose& worldTransform)
+{
+    if (!blas)
+        throw std::runtime_error ("InstanceBVH instances need a BLAS");
+
+    uint32_t index;
+    if (freeSlots.empty())
+    {
+        index = static_cast<uint32_t> (instances.size());
+        instances.emplace_back();
+    }
+    else
+    {
+        index = freeSlots.back();
+        freeSlots.pop_back();
+    }
+
+    Instance& instance = instances[index];
+    instance.blas = std::move (blas);
+    updateInstance (instance, worldTransform);
+
+    ++activeCount;
+    dirty = true;
+    return index;
+}
+
+void InstanceBVH::removeInstance (uint32_t index)
+{
+    if (index >= instances.size() || !instances[index].blas) return;
+
+    instances[index] = Instance();
+    freeSlots.push_back (index);
+
+    --activeCount;
+    dirty = true;
+}
+
+void InstanceBVH::clear()
+{
+    instances.clear();
+    freeSlots.clear();
+    nodes.clear();
+    leafOrder.clear();
+    activeCount = 0;
+    dirty = false;
+}
+
+void InstanceBVH::setTransform (uint32_t index, const Pose& worldTransform)
+{
+    Instance& instance = instances.at (index);
+    if (!instance.blas) return;
+
+    updateInstance (instance, worldTransform);
+}
+
+void InstanceBVH::updateInstance (Instance& instance, const Pose& worldTransform)
+{
+    instance.worldTransform = worldTransform;
+    instance.worldToObject = worldTransform.inverse();
+
+    // the BLAS box moved into the world, centre and half extents are cheaper than 8 corners
+    Eigen::AlignedBox3f local = instance.blas->getBounds();
+    if (local.isEmpty())
+    {
+        instance.worldBounds.setEmpty();
+        return;
+    }
+
+    Eigen::Vector3f center = worldTransform * local.center();
+    Eigen::Vector3f halfExtent = worldTransform.linear().cwiseAbs() * (local.sizes() * 0.5f);
+    instance.worldBounds = Eigen::AlignedBox3f (center - halfExtent, center + halfExtent);
+}
+
+void InstanceBVH::build()
+{
+    nodes.clear();
+    leafOrder.clear();
+    dirty = false;
+
+    for (uint32_t i = 0; i < instances.size(); ++i)
+    {
+        if (instances[i].blas)
+            leafOrder.push_back (i);
+    }
+    if (leafOrder.empty()) return;
+
+    nodes.reserve (2 * leafOrder.size());
+    nodes.emplace_back();
+    buildNode (0, 0, static_cast<uint32_t> (leafOrder.size()), 0);
+}
+
+void InstanceBVH::buildNode (uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth)
+{
+    constexpr float TRAVERSAL_COST = 1.0f;
+    constexpr float INSTANCE_COST = 1.0f;
+
+    Eigen::AlignedBox3f bounds;
+    Eigen::AlignedBox3f centroidBounds;
+    for (uint32_t i = first; i < first + count; ++i)
+    {
+        const Eigen::AlignedBox3f& b = instances[leafOrder[i]].worldBounds;
+        bounds.extend (b);
+        if (!b.isEmpty()) centroidBounds.extend (b.center());
+    }
+
+    nodes[nodeIndex].boundsMin = bounds.min();
+    nodes[nodeIndex].boundsMax = bounds.max();
+    nodes[nodeIndex].leftOrFirst = first;
+    nodes[nodeIndex].instanceCount = count;
+    if (count == 1) return;
+
+    auto centroid = [this] (uint32_t index, int axis)
+    {
+        const Eigen::AlignedBox3f& b = instances[index].worldBounds;
+        return b.isEmpty() ? 0.0f : b.center()[axis];
+    };
+
+    // half the surface area, an empty box counts as nothing
+    auto area = [] (const Eigen::AlignedBox3f& b)
+    {
+        if (b.isEmpty()) return 0.0f;
+        Eigen::Vector3f e = b.sizes();
+        return e.x() * e.y() + e.y() * e.z() + e.z() * e.x();
+    };
+
+    auto begin = leafOrder.begin() + first;
+    auto end = begin + count;
+
+    int bestAxis = 0;
+    uint32_t bestSplit = count / 2;
+    float bestCost = std::numeric_limits<float>::max();
+
+    if (depth < SAH_DEPTH)
+    {
+        // sweep the instances sorted by centroid along each axis, there are few enough
+        // of them that the exact SAH is affordable
+        std::vector<float> rightAreas (count);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            std::sort (begin, end, [&] (uint32_t a, uint32_t b)
+                       { return centroid (a, axis) < centroid (b, axis); });
+
+            Eigen::AlignedBox3f right;
+            for (uint32_t i = count - 1; i > 0; --i)
+            {
+                right.extend (instances[leafOrder[first + i]].worldBounds);
+                rightAreas[i] = area (right);
+            }
+
+            Eigen::AlignedBox3f left;
+            for (uint32_t i = 1; i < count; ++i)
+            {
+                left.extend (instances[leafOrder[first + i - 1]].worldBounds);
+                float cost = area (left) * i + rightAreas[i] * (count - i);
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = i;
+                }
+            }
+        }
+
+        float nodeArea = area (bounds);
+        float splitCost = nodeArea > 0.0f ? TRAVERSAL_COST + INSTANCE_COST * bestCost / nodeArea : TRAVERSAL_COST + INSTANCE_COST * count;
+        if (count <= MAX_LEAF_SIZE && INSTANCE_COST * count <= splitCost) return;
+    }
+    else
+    {
+        // median of the widest centroid axis
+        Eigen::Vector3f extent = Eigen::Vector3f::Zero();
+        if (!centroidBounds.isEmpty()) extent = centroidBounds.sizes();
+        extent.maxCoeff (&bestAxis);
+    }
+
+    std::nth_element (begin, begin + bestSplit, end, [&] (uint32_t a, uint32_t b)
+                      { return centroid (a, bestAxis) < centroid (b, bestAxis); });
+
+    uint32_t left = static_cast<uint32_t> (nodes.size());
+    nodes.emplace_back();
+    nodes.emplace_back();
+    nodes[nodeIndex].leftOrFirst = left;
+    nodes[nodeIndex].instanceCount = 0;
+
+    buildNode (left, first, bestSplit, depth + 1);
+    buildNode (left + 1, first + bestSplit, count - bestSplit, depth + 1);
+}
+
+void InstanceBVH::refit()
+{
+    if (dirty)
+    {
+        build();
+        return;
+    }
+
+    for (Instance& instance : instances)
+    {
+        if (instance.blas)
+            updateInstance (instance, instance.worldTransform);
+    }
+
+    // children always come after their parent
+    for (size_t i = nodes.size(); i-- > 0;)
+        refitNode (nodes[i]);
+}
+
+void InstanceBVH::refitNode (Node& node) const
+{
+    Eigen::AlignedBox3f bounds;
+    if (node.isLeaf())
+    {
+        for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.instanceCount; ++i)
+            bounds.extend (instances[leafOrder[i]].worldBounds);
+    }
+    else
+    {
+        for (uint32_t child = node.leftOrFirst; child < node.leftOrFirst + 2; ++child)
+            bounds.extend (Eigen::AlignedBox3f (nodes[child].boundsMin, nodes[child].boundsMax));
+    }
+    node.boundsMin = bounds.min();
+    node.boundsMax = bounds.max();
+}
+
+Eigen::AlignedBox3f InstanceBVH::getBounds() const
+{
+    if (nodes.empty()) return Eigen::AlignedBox3f();
+    return Eigen::AlignedBox3f (nodes[0].boundsMin, nodes[0].boundsMax);
+}
+
+bool InstanceBVH::intersect (Ray3f& ray) const
+{
+    return traverse<false> (ray);
+}
+
+bool InstanceBVH::intersectAny (Ray3f& ray) const
+{
+    return traverse<true> (ray);
+}
+
+float InstanceBVH::intersectBounds (const Node& node, const Eigen::Vector3f& origin, const Eigen::Vector3f& invDir, float tMin, float tMax)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float t1 = (node.boundsMin[axis] - origin[axis]) * invDir[axis];
+        float t2 = (node.boundsMax[axis] - origin[axis]) * invDir[axis];
+        tMin = std::max (tMin, std::min (t1, t2));
+        tMax = std::min (tMax, std::max (t1, t2));
+    }
+    return tMin <= tMax ? tMin : std::numeric_limits<float>::infinity();
+}
+
+template <bool ANY_HIT>
+bool InstanceBVH::traverse (Ray3f& ray) const
+{
+    if (nodes.empty()) return false;
+
+    Eigen::Vector3f invDir;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float d = std::abs (ray.dir[axis]) < 1e-20f ? std::copysign (1e-20f, ray.dir[axis]) : ray.dir[axis];
+        invDir[axis] = 1.0f / d;
+    }
+
+    const float tMin = ray.tMin;
+    float tMax = ray.tMax;
+    if (intersectBounds (nodes[0], ray.origin, invDir, tMin, tMax) == std::numeric_limits<float>::infinity()) return false;
+
+    struct Entry
+    {
+        uint32_t node;
+        float t;
+    };
+    Entry stack[MAX_DEPTH];
+    uint32_t stackSize = 0;
+
+    TriangleBVH::Hit hit;
+    const Instance* hitInstance = nullptr;
+    uint32_t hitIndex = 0;
+
+    uint32_t current = 0;
+    for (;;)
+    {
+        const Node& node = nodes[current];
+        if (node.isLeaf())
+        {
+            for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.instanceCount; ++i)
+            {
+                const Instance& instance = instances[leafOrder[i]];
+                if (!instance.blas) continue; // removed since the last build
+
+                // not renormalized so t means the same thing in both spaces
+                Eigen::Vector3f origin = instance.worldToObject * ray.origin;
+                Eigen::Vector3f dir = instance.worldToObject.linear() * ray.dir;
+
+                TriangleBVH::Hit h;
+                bool found = ANY_HIT ? instance.blas->intersectAny (origin, dir, tMin, tMax, h)
+                                     : instance.blas->intersect (origin, dir, tMin, tMax, h);
+                if (!found) continue;
+
+                tMax = h.t;
+                hit = h;
+                hitInstance = &instance;
+                hitIndex = leafOrder[i];
+                if constexpr (ANY_HIT) break;
+            }
+            if (ANY_HIT && hitInstance) break;
+        }
+        else
+        {
+            uint32_t near = node.leftOrFirst;
+            uint32_t far = near + 1;
+            float tNear = intersectBounds (nodes[near], ray.origin, invDir, tMin, tMax);
+            float tFar = intersectBounds (nodes[far], ray.origin, invDir, tMin, tMax);
+            if (tFar < tNear)
+            {
+                std::swap (near, far);
+                std::swap (tNear, tFar);
+            }
+
+            if (tNear != std::numeric_limits<float>::infinity())
+            {
+                if (tFar != std::numeric_limits<float>::infinity())
+                    stack[stackSize++] = Entry{far, tFar};
+                current = near;
+                continue;
+            }
+        }
+
+        bool done = true;
+        while (stackSize > 0)
+        {
+            Entry entry = stack[--stackSize];
+            if (entry.t <= tMax)
+            {
+                current = entry.node;
+                done = false;
+                break;
+            }
+        }
+        if (done) break;
+    }
+
+    if (!hitInstance) return false;
+
+    ray.wasHit = true;
+    ray.distToHit = hit.t;
+    ray.hitBodyID = hitIndex;
+    ray.hitPolyID = hitInstance->blas->getPolyID (hit);
+    ray.bary1 = hit.u;
+    ray.bary2 = hit.v;
+    ray.bary0 = 1.0f - hit.u - hit.v;
+    ray.hitPoint = ray (hit.t);
+
+    // normals go through the inverse transpose
+    ray.surfaceNormal = (hitInstance->worldToObject.linear().transpose() * hitInstance->blas->getGeometricNormal (hit)).normalized();
+    return true;
+}
@@ -0,0 +1,118 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// CPU two level acceleration structure, the counterpart of the OptiX IAS
+//
+// Each instance is a shared TriangleBVH (the BLAS, one per geometry like a GAS) placed
+// in the world by a Pose, so any number of instances of the same geometry cost one BLAS.
+// The top level tree is built over the world bounds of the instances. When only the
+// transforms change, refit() recomputes those bounds and the node bounds bottom up
+// in O(instances) and keeps the tree's shape. Adding or removing instances needs a build().
+//
+// Rays are moved into each instance's space without renormalizing, so distances come
+// back in world units. Hits report the instance index from addInstance() as hitBodyID,
+// and hitPoint and surfaceNormal are in world space.
+
+using TriangleBVHRef = std::shared_ptr<TriangleBVH>;
+
+class InstanceBVH : Noncopyable
+{
+ public:
+    struct Node
+    {
+        Eigen::Vector3f boundsMin;
+        uint32_t leftOrFirst = 0; // left child of an inner node, or first entry of a leaf in the leaf order
+        Eigen::Vector3f boundsMax;
+        uint32_t instanceCount = 0; // 0 for inner nodes
+
+        bool isLeaf() const { return instanceCount > 0; }
+    };
+    static_assert (sizeof (Node) == 32, "BVH nodes should be 32 bytes");
+
+    // leaves can hold a few instances when they overlap too much to be worth splitting
+    static constexpr uint32_t MAX_LEAF_SIZE = 4;
+
+    // below this depth nodes are split at the median, which keeps the traversal stack bounded
+    static constexpr uint32_t SAH_DEPTH = 32;
+    static constexpr uint32_t MAX_DEPTH = 64;
+
+ public:
+    InstanceBVH() = default;
+    ~InstanceBVH() = default;
+
+    // returns a stable index, freed indices are reused by later instances
+    uint32_t addInstance (TriangleBVHRef blas, const Pose& worldTransform);
+    void removeInstance (uint32_t index);
+    void clear();
+
+    void setTransform (uint32_t index, const Pose& worldTransform);
+    const Pose& getTransform (uint32_t index) const { return instances.at (index).worldTransform; }
+    const TriangleBVHRef& getBLAS (uint32_t index) const { return instances.at (index).blas; }
+
+    // full SAH build of the top level, needed after adding or removing instances
+    void build();
+
+    // new world bounds for every instance after setTransform(), the tree keeps its shape
+    void refit();
+
+    // true once instances were added or removed since the last build
+    bool needsBuild() const { return dirty; }
+
+    // same contract as TriangleBVH
+    bool intersect (Ray3f& ray) const;
+    bool intersectAny (Ray3f& ray) const;
+
+    uint32_t getInstanceCount() const { return activeCount; }
+    const std::vector<Node>& getNodes() const { return nodes; }
+    Eigen::AlignedBox3f getBounds() const;
+
+ private:
+    struct Instance
+    {
+        TriangleBVHRef blas = nullptr; // null for a free slot
+        Pose worldTransform = Pose::Identity();
+        Pose worldToObject = Pose::Identity();
+        Eigen::AlignedBox3f worldBounds;
+    };
+
+    std::vector<Instance> instances;
+    std::vector<uint32_t> freeSlots;
+    uint32_t activeCount = 0;
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> leafOrder; // instance indices, leaves point into this
+    bool dirty = false;
+
+    void updateInstance (Instance& instance, const Pose& worldTransform);
+    void buildNode (uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth);
+    void refitNode (Node& node) const;
+
+    static float intersectBounds (const Node& node, const Eigen::Vector3f& origin, const Eigen::Vector3f& invDir, float tMin, float tMax);
+
+    template <bool ANY_HIT>
+    bool traverse (Ray3f& ray) const;
+
+}; // end class InstanceBVH
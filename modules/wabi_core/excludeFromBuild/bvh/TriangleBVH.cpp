@@ -0,0 +1,590 @@
+#include "TriangleBVH.h"
+
+namespace
+{
+    constexpr float TRAVERSAL_COST = 1.0f;
+    constexpr float INTERSECTION_COST = 1.0f;
+
+    // nodes with more triangles than these are binned with parallel_for and built as tasks
+    constexpr uint32_t PARALLEL_BINNING = 1 << 16;
+    constexpr uint32_t PARALLEL_SUBTREE = 1 << 12;
+    constexpr uint32_t TRIANGLES_PER_TASK = 1 << 14;
+    constexpr uint32_t RAYS_PER_TASK = 1 << 10;
+
+    constexpr uint32_t MAX_BINS = 64;
+
+    struct Bounds
+    {
+        Eigen::Vector3f lo = Eigen::Vector3f::Constant (std::numeric_limits<float>::max());
+        Eigen::Vector3f hi = Eigen::Vector3f::Constant (-std::numeric_limits<float>::max());
+
+        void grow (const Eigen::Vector3f& p)
+        {
+            lo = lo.cwiseMin (p);
+            hi = hi.cwiseMax (p);
+        }
+
+        void grow (const Bounds& b)
+        {
+            lo = lo.cwiseMin (b.lo);
+            hi = hi.cwiseMax (b.hi);
+        }
+
+        // half the surface area, the factor of 2 doesn't change any SAH decision
+        float area() const
+        {
+            if (lo.x() > hi.x()) return 0.0f;
+            Eigen::Vector3f e = hi - lo;
+            return e.x() * e.y() + e.y() * e.z() + e.z() * e.x();
+        }
+    };
+
+    // A triangle's bounds and its column in F. The builder partitions these
+    // in place so every pass over a node reads memory front to back.
+    struct PrimitiveRef
+    {
+        Eigen::Vector3f lo;
+        uint32_t triangle;
+        Eigen::Vector3f hi;
+        uint32_t unused;
+
+        Eigen::Vector3f centroid() const { return (lo + hi) * 0.5f; }
+    };
+
+    // left uninitialized so a node only pays for the bins it uses, see resetBins()
+    struct Bin
+    {
+        Eigen::Vector3f lo;
+        Eigen::Vector3f hi;
+        uint32_t count;
+
+        void reset()
+        {
+            lo.setConstant (std::numeric_limits<float>::max());
+            hi.setConstant (-std::numeric_limits<float>::max());
+            count = 0;
+        }
+
+        void add (const PrimitiveRef& ref)
+        {
+            lo = lo.cwiseMin (ref.lo);
+            hi = hi.cwiseMax (ref.hi);
+            ++count;
+        }
+
+        void add (const Bin& b)
+        {
+            lo = lo.cwiseMin (b.lo);
+            hi = hi.cwiseMax (b.hi);
+            count += b.count;
+        }
+
+        Bounds bounds() const
+        {
+            Bounds b;
+            b.lo = lo;
+            b.hi = hi;
+            return b;
+        }
+    };
+
+    // maps a centroid to its bin, the partition has to use exactly the same math as the binning
+    struct BinMapping
+    {
+        Eigen::Vector3f lo;
+        Eigen::Vector3f scale;
+        uint32_t binCount;
+
+        uint32_t operator() (const Eigen::Vector3f& centroid, int axis) const
+        {
+            float b = (centroid[axis] - lo[axis]) * scale[axis];
+            return std::min (binCount - 1, static_cast<uint32_t> (std::max (0.0f, b)));
+        }
+    };
+
+    struct Split
+    {
+        int axis = -1;
+        uint32_t position = 0; // first bin on the right
+        float cost = std::numeric_limits<float>::max();
+        Bounds left;
+        Bounds right;
+        BinMapping mapping;
+    };
+
+    class TriangleBVHBuilder
+    {
+     public:
+        using Node = TriangleBVH::Node;
+
+        TriangleBVHBuilder (const TriangleBVHSettings& settings, std::vector<Node>& nodes,
+                            std::vector<PrimitiveRef>& refs) :
+            settings (settings),
+            nodes (nodes),
+            refs (refs)
+        {
+        }
+
+        // pairs of children are handed out from here, the root is node 0
+        std::atomic<uint32_t> nodesUsed = 1;
+        std::atomic<uint32_t> maxDepth = 0;
+
+        void buildNode (uint32_t nodeIndex, uint32_t depth)
+        {
+            uint32_t deepest = maxDepth.load (std::memory_order_relaxed);
+            while (depth > deepest && !maxDepth.compare_exchange_weak (deepest, depth, std::memory_order_relaxed))
+            {
+            }
+
+            Node& node = nodes[nodeIndex];
+            uint32_t first = node.leftOrFirst;
+            uint32_t count = node.triangleCount;
+            if (count <= 1 || depth + 1 >= TriangleBVH::MAX_DEPTH) return;
+
+            Bounds nodeBounds;
+            nodeBounds.lo = node.boundsMin;
+            nodeBounds.hi = node.boundsMax;
+
+            Split split = findSplit (first, count);
+
+            // coincident centroids can't be split by binning, they stay in one leaf however many there are
+            if (split.axis < 0) return;
+
+            float leafCost = INTERSECTION_COST * count * nodeBounds.area();
+            if (split.cost >= leafCost && count <= settings.maxLeafSize) return;
+
+            PrimitiveRef* begin = refs.data() + first;
+            PrimitiveRef* middle = std::partition (begin, begin + count, [&] (const PrimitiveRef& ref)
+                                                   { return split.mapping (ref.centroid(), split.axis) < split.position; });
+            uint32_t leftCount = static_cast<uint32_t> (middle - begin);
+            if (leftCount == 0 || leftCount == count) return;
+
+            uint32_t left = nodesUsed.fetch_add (2, std::memory_order_relaxed);
+            nodes[left] = Node{split.left.lo, first, split.left.hi, leftCount};
+            nodes[left + 1] = Node{split.right.lo, first + leftCount, split.right.hi, count - leftCount};
+
+            node.leftOrFirst = left;
+            node.triangleCount = 0;
+
+            if (settings.parallel && count >= PARALLEL_SUBTREE)
+            {
+                mace::TaskScheduler::get().parallel_for (0, 2, 1, [&] (uint32_t start, uint32_t end)
+                                                         {
+                                                             for (uint32_t child = start; child < end; ++child)
+                                                                 buildNode (left + child, depth + 1); });
+            }
+            else
+            {
+                buildNode (left, depth + 1);
+                buildNode (left + 1, depth + 1);
+            }
+        }
+
+     private:
+        const TriangleBVHSettings& settings;
+        std::vector<Node>& nodes;
+        std::vector<PrimitiveRef>& refs;
+
+        static BinMapping mappingFor (const Bounds& centroidBounds, uint32_t binCount)
+        {
+            BinMapping m;
+            m.lo = centroidBounds.lo;
+            m.binCount = binCount;
+            Eigen::Vector3f extent = centroidBounds.hi - centroidBounds.lo;
+            for (int axis = 0; axis < 3; ++axis)
+                m.scale[axis] = extent[axis] > 0.0f ? binCount / extent[axis] : 0.0f;
+            return m;
+        }
+
+        static void resetBins (Bin (&bins)[3][MAX_BINS], uint32_t binCount)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                for (uint32_t b = 0; b < binCount; ++b)
+                    bins[axis][b].reset();
+            }
+        }
+
+        template <typename Body>
+        void forRange (uint32_t first, uint32_t count, const Body& body)
+        {
+            if (settings.parallel && count >= PARALLEL_BINNING)
+                mace::TaskScheduler::get().parallel_for (first, first + count, TRIANGLES_PER_TASK, body);
+            else
+                body (first, first + count);
+        }
+
+        Split findSplit (uint32_t first, uint32_t count)
+        {
+            std::mutex mutex;
+
+            Bounds centroidBounds;
+            forRange (first, count, [&] (uint32_t start, uint32_t end)
+                      {
+                          Bounds local;
+                          for (uint32_t i = start; i < end; ++i)
+                              local.grow (refs[i].centroid());
+                          std::lock_guard<std::mutex> lock (mutex);
+                          centroidBounds.grow (local); });
+
+            // small nodes don't need all the bins, most of them would be empty
+            const uint32_t binCount = std::min (settings.binCount, count);
+            const BinMapping m = mappingFor (centroidBounds, binCount);
+
+            auto binTriangles = [&] (uint32_t start, uint32_t end, Bin (&target)[3][MAX_BINS])
+            {
+                for (uint32_t i = start; i < end; ++i)
+                {
+                    const PrimitiveRef& ref = refs[i];
+                    Eigen::Vector3f centroid = ref.centroid();
+                    for (int axis = 0; axis < 3; ++axis)
+                        target[axis][m (centroid, axis)].add (ref);
+                }
+            };
+
+            Bin bins[3][MAX_BINS];
+            resetBins (bins, binCount);
+            if (settings.parallel && count >= PARALLEL_BINNING)
+            {
+                mace::TaskScheduler::get().parallel_for (first, first + count, TRIANGLES_PER_TASK, [&] (uint32_t start, uint32_t end)
+                                                         {
+                                                             Bin local[3][MAX_BINS];
+                                                             resetBins (local, binCount);
+                                                             binTriangles (start, end, local);
+
+                                                             std::lock_guard<std::mutex> lock (mutex);
+                                                             for (int axis = 0; axis < 3; ++axis)
+                                                             {
+                                                                 for (uint32_t b = 0; b < binCount; ++b)
+                                                                     bins[axis][b].add (local[axis][b]);
+                                                             } });
+            }
+            else
+            {
+                binTriangles (first, first + count, bins);
+            }
+
+            Bounds all;
+            for (uint32_t b = 0; b < binCount; ++b)
+                all.grow (bins[0][b].bounds());
+            const float nodeArea = all.area();
+
+            Split best;
+            best.mapping = m;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                if (m.scale[axis] == 0.0f) continue;
+
+                // sweep from the right, then from the left evaluating each plane between bins
+                Bin right[MAX_BINS];
+                right[binCount - 1] = bins[axis][binCount - 1];
+                for (uint32_t b = binCount - 1; b > 1; --b)
+                {
+                    right[b - 1] = right[b];
+                    right[b - 1].add (bins[axis][b - 1]);
+                }
+
+                Bin left = bins[axis][0];
+                for (uint32_t b = 1; b < binCount; ++b)
+                {
+                    if (b > 1) left.add (bins[axis][b - 1]);
+                    if (left.count == 0 || right[b].count == 0) continue;
+
+                    float cost = TRAVERSAL_COST * nodeArea +
+                                 INTERSECTION_COST * (left.bounds().area() * left.count + right[b].bounds().area() * right[b].count);
+                    if (cost < best.cost)
+                    {
+                        best.axis = axis;
+                        best.position = b;
+                        best.cost = cost;
+                        best.left = left.bounds();
+                        best.right = right[b].bounds();
+                    }
+                }
+            }
+            return best;
+        }
+    };
+
+} // namespace
+
+void TriangleBVH::build (const MatrixXf& V, const MatrixXu& F, const TriangleBVHSettings& settings)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    if (settings.binCount < 2 || settings.binCount > MAX_BINS)
+        throw std::runtime_error ("TriangleBVH bin count must be between 2 and " + std::to_string (MAX_BINS));
+
+    nodes.clear();
+    triangles.clear();
+    polyIDs.clear();
+    stats = Stats();
+
+    const uint32_t triangleCount = static_cast<uint32_t> (F.cols());
+    if (triangleCount == 0) return;
+
+    const uint32_t vertexCount = static_cast<uint32_t> (V.cols());
+    std::vector<PrimitiveRef> refs (triangleCount);
+
+    auto forAll = [&] (const mace::TaskScheduler::RangeTask& body)
+    {
+        if (settings.parallel)
+            mace::TaskScheduler::get().parallel_for (0, triangleCount, TRIANGLES_PER_TASK, body);
+        else
+            body (0, triangleCount);
+    };
+
+    forAll ([&] (uint32_t start, uint32_t end)
+            {
+                for (uint32_t i = start; i < end; ++i)
+                {
+                    if (F (0, i) >= vertexCount || F (1, i) >= vertexCount || F (2, i) >= vertexCount)
+                        throw std::runtime_error ("TriangleBVH triangle " + std::to_string (i) + " indexes past the last vertex");
+
+                    Bounds b;
+                    for (int corner = 0; corner < 3; ++corner)
+                        b.grow (V.col (F (corner, i)));
+                    refs[i] = PrimitiveRef{b.lo, i, b.hi, 0};
+                } });
+
+    Bounds rootBounds;
+    for (const PrimitiveRef& ref : refs)
+    {
+        rootBounds.lo = rootBounds.lo.cwiseMin (ref.lo);
+        rootBounds.hi = rootBounds.hi.cwiseMax (ref.hi);
+    }
+
+    // a binary tree with one triangle per leaf at most has 2n - 1 nodes
+    nodes.resize (2 * size_t (triangleCount));
+    nodes[0] = Node{rootBounds.lo, 0, rootBounds.hi, triangleCount};
+
+    TriangleBVHBuilder builder (settings, nodes, refs);
+    builder.buildNode (0, 0);
+    nodes.resize (builder.nodesUsed.load());
+
+    // triangles in leaf order so a leaf reads them front to back
+    triangles.resize (triangleCount);
+    polyIDs.resize (triangleCount);
+    forAll ([&] (uint32_t start, uint32_t end)
+            {
+                for (uint32_t i = start; i < end; ++i)
+                {
+                    uint32_t f = refs[i].triangle;
+                    polyIDs[i] = f;
+                    Triangle& tri = triangles[i];
+                    tri.v0 = V.col (F (0, f));
+                    tri.edge1 = V.col (F (1, f)) - tri.v0;
+                    tri.edge2 = V.col (F (2, f)) - tri.v0;
+                } });
+
+    stats.nodeCount = static_cast<uint32_t> (nodes.size());
+    stats.maxDepth = builder.maxDepth.load();
+
+    float rootArea = rootBounds.area();
+    double cost = 0.0;
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        const Node& node = nodes[i];
+        Bounds b;
+        b.lo = node.boundsMin;
+        b.hi = node.boundsMax;
+        if (node.isLeaf())
+        {
+            ++stats.leafCount;
+            cost += INTERSECTION_COST * b.area() * node.triangleCount;
+        }
+        else
+        {
+            cost += TRAVERSAL_COST * b.area();
+        }
+    }
+    stats.sahCost = rootArea > 0.0f ? static_cast<float> (cost / rootArea) : 0.0f;
+    stats.buildMilliseconds = std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now() - startTime).count();
+}
+
+Eigen::AlignedBox3f TriangleBVH::getBounds() const
+{
+    if (nodes.empty()) return Eigen::AlignedBox3f();
+    return Eigen::AlignedBox3f (nodes[0].boundsMin, nodes[0].boundsMax);
+}
+
+bool TriangleBVH::intersect (Ray3f& ray) const
+{
+    Hit hit;
+    if (!traverse<false> (ray.origin, ray.dir, ray.tMin, ray.tMax, hit)) return false;
+    storeHit (hit, ray);
+    return true;
+}
+
+bool TriangleBVH::intersectAny (Ray3f& ray) const
+{
+    Hit hit;
+    if (!traverse<true> (ray.origin, ray.dir, ray.tMin, ray.tMax, hit)) return false;
+    storeHit (hit, ray);
+    return true;
+}
+
+bool TriangleBVH::intersect (const Eigen::Vector3f& origin, const Eigen::Vector3f& dir, float tMin, float tMax, Hit& hit) const
+{
+    return traverse<false> (origin, dir, tMin, tMax, hit);
+}
+
+bool TriangleBVH::intersectAny (const Eigen::Vector3f& origin, const Eigen::Vector3f& dir, float tMin, float tMax, Hit& hit) const
+{
+    return traverse<true> (origin, dir, tMin, tMax, hit);
+}
+
+void TriangleBVH::intersect (const RayStreamf& rays, HitStreamf& hits) const
+{
+    intersectStream<false> (rays, hits);
+}
+
+void TriangleBVH::intersectAny (const RayStreamf& rays, HitStreamf& hits) const
+{
+    intersectStream<true> (rays, hits);
+}
+
+template <bool ANY_HIT>
+void TriangleBVH::intersectStream (const RayStreamf& rays, HitStreamf& hits) const
+{
+    hits.resize (rays.size());
+    if (isEmpty()) return;
+
+    mace::TaskScheduler::get().parallel_for (0, static_cast<uint32_t> (rays.size()), RAYS_PER_TASK, [&] (uint32_t start, uint32_t end)
+                                             {
+                                                 for (uint32_t i = start; i < end; ++i)
+                                                 {
+                                                     Hit hit;
+                                                     if (traverse<ANY_HIT> (rays.getOrigin (i), rays.getDir (i), rays.tMin[i], rays.tMax[i], hit))
+                                                         hits.setHit (i, hit.t, bodyID, polyIDs[hit.triangle], hit.u, hit.v);
+                                                 } });
+}
+
+void TriangleBVH::storeHit (const Hit& hit, Ray3f& ray) const
+{
+    ray.wasHit = true;
+    ray.distToHit = hit.t;
+    ray.hitBodyID = bodyID;
+    ray.hitPolyID = getPolyID (hit);
+    ray.bary1 = hit.u;
+    ray.bary2 = hit.v;
+    ray.bary0 = 1.0f - hit.u - hit.v;
+    ray.hitPoint = ray (hit.t);
+    ray.surfaceNormal = getGeometricNormal (hit).normalized();
+}
+
+// slab test, returns where the ray enters the box or infinity if it misses it within [tMin, tMax]
+float TriangleBVH::intersectBounds (const Node& node, const Eigen::Vector3f& origin, const Eigen::Vector3f& invDir, float tMin, float tMax)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float t1 = (node.boundsMin[axis] - origin[axis]) * invDir[axis];
+        float t2 = (node.boundsMax[axis] - origin[axis]) * invDir[axis];
+        tMin = std::max (tMin, std::min (t1, t2));
+        tMax = std::min (tMax, std::max (t1, t2));
+    }
+    return tMin <= tMax ? tMin : std::numeric_limits<float>::infinity();
+}
+
+// Moller-Trumbore, u and v are the barycentrics of the second and third vertex
+bool TriangleBVH::intersectTriangle (const Triangle& tri, const Eigen::Vector3f& origin, const Eigen::Vector3f& dir,
+                                     float tMin, float tMax, float& t, float& u, float& v)
+{
+    Eigen::Vector3f p = dir.cross (tri.edge2);
+    float det = tri.edge1.dot (p);
+    if (std::abs (det) < 1e-30f) return false;
+
+    float invDet = 1.0f / det;
+    Eigen::Vector3f s = origin - tri.v0;
+    u = s.dot (p) * invDet;
+    if (u < 0.0f || u > 1.0f) return false;
+
+    Eigen::Vector3f q = s.cross (tri.edge1);
+    v = dir.dot (q) * invDet;
+    if (v < 0.0f || u + v > 1.0f) return false;
+
+    t = tri.edge2.dot (q) * invDet;
+    return t >= tMin && t < tMax;
+}
+
+template <bool ANY_HIT>
+bool TriangleBVH::traverse (const Eigen::Vector3f& origin, const Eigen::Vector3f& dir, float tMin, float tMax, Hit& hit) const
+{
+    if (nodes.empty()) return false;
+
+    // zero components would give 0 * inf in the slab test
+    Eigen::Vector3f invDir;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float d = std::abs (dir[axis]) < 1e-20f ? std::copysign (1e-20f, dir[axis]) : dir[axis];
+        invDir[axis] = 1.0f / d;
+    }
+
+    if (intersectBounds (nodes[0], origin, invDir, tMin, tMax) == std::numeric_limits<float>::infinity()) return false;
+
+    struct Entry
+    {
+        uint32_t node;
+        float t;
+    };
+    Entry stack[MAX_DEPTH];
+    uint32_t stackSize = 0;
+
+    bool found = false;
+    uint32_t current = 0;
+    for (;;)
+    {
+        const Node& node = nodes[current];
+        if (node.isLeaf())
+        {
+            uint32_t end = node.leftOrFirst + node.triangleCount;
+            for (uint32_t i = node.leftOrFirst; i < end; ++i)
+            {
+                float t, u, v;
+                if (intersectTriangle (triangles[i], origin, dir, tMin, tMax, t, u, v))
+                {
+                    tMax = t;
+                    hit.t = t;
+                    hit.u = u;
+                    hit.v = v;
+                    hit.triangle = i;
+                    found = true;
+                    if constexpr (ANY_HIT) return true;
+                }
+            }
+        }
+        else
+        {
+            // nearer child first, the other one waits on the stack
+            uint32_t near = node.leftOrFirst;
+            uint32_t far = near + 1;
+            float tNear = intersectBounds (nodes[near], origin, invDir, tMin, tMax);
+            float tFar = intersectBounds (nodes[far], origin, invDir, tMin, tMax);
+            if (tFar < tNear)
+            {
+                std::swap (near, far);
+                std::swap (tNear, tFar);
+            }
+
+            if (tNear != std::numeric_limits<float>::infinity())
+            {
+                if (tFar != std::numeric_limits<float>::infinity())
+                    stack[stackSize++] = Entry{far, tFar};
+                current = near;
+                continue;
+            }
+        }
+
+        // skip anything that starts beyond the closest hit so far
+        for (;;)
+        {
+            if (stackSize == 0) return found;
+            Entry entry = stack[--stackSize];
+            if (entry.t <= tMax)
+            {
+                current = entry.node;
+                break;
+            }
+        }
+    }
+}
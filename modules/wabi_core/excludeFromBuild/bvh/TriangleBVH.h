@@ -0,0 +1,147 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// CPU bounding volume hierarchy over a triangle mesh
+//
+// For picking, collision probes, tests and machines without a GPU. The builder bins
+// triangle centroids and splits by the surface area heuristic, big nodes are binned
+// with parallel_for and big subtrees are built as tasks on the mace::TaskScheduler.
+// Nodes are 32 bytes, the children of an inner node sit next to each other.
+//
+// Queries fill in the same hit fields as the OptiX path: wasHit, distToHit, hitBodyID,
+// hitPolyID (the column of F), bary0/1/2, hitPoint and the geometric surfaceNormal.
+// A built BVH is read only and can be queried from any number of threads.
+
+struct TriangleBVHSettings
+{
+    uint32_t binCount = 16;
+
+    // leaves this small or smaller are kept whenever splitting doesn't pay
+    uint32_t maxLeafSize = 8;
+
+    // use the TaskScheduler for the build
+    bool parallel = true;
+};
+
+class TriangleBVH : Noncopyable
+{
+ public:
+    struct Node
+    {
+        Eigen::Vector3f boundsMin;
+        uint32_t leftOrFirst = 0; // left child of an inner node, the right one is next to it, or first triangle of a leaf
+        Eigen::Vector3f boundsMax;
+        uint32_t triangleCount = 0; // 0 for inner nodes
+
+        bool isLeaf() const { return triangleCount > 0; }
+    };
+    static_assert (sizeof (Node) == 32, "BVH nodes should be 32 bytes");
+
+    // deepest a tree is allowed to get, the traversal stack is this big
+    static constexpr uint32_t MAX_DEPTH = 64;
+
+    // a hit in the BVH's own space, t is in units of the query direction
+    struct Hit
+    {
+        float t = std::numeric_limits<float>::max();
+        float u = 0.0f;
+        float v = 0.0f;
+        uint32_t triangle = 0; // leaf order, getPolyID() turns it into a column of F
+    };
+
+    struct Stats
+    {
+        uint32_t nodeCount = 0;
+        uint32_t leafCount = 0;
+        uint32_t maxDepth = 0;
+        float sahCost = 0.0f;
+        double buildMilliseconds = 0.0;
+    };
+
+ public:
+    TriangleBVH() = default;
+    ~TriangleBVH() = default;
+
+    // V is 3 x vertices and F is 3 x triangles, like the rest of the mesh code
+    void build (const MatrixXf& V, const MatrixXu& F, const TriangleBVHSettings& settings = TriangleBVHSettings());
+
+    // reported as hitBodyID
+    void setBodyID (BodyID id) { bodyID = id; }
+    BodyID getBodyID() const { return bodyID; }
+
+    // closest hit in [ray.tMin, ray.tMax), the hit fields are only touched on a hit
+    bool intersect (Ray3f& ray) const;
+
+    // stops at the first hit it finds, for shadow and visibility probes
+    bool intersectAny (Ray3f& ray) const;
+
+    // the same for a whole stream, hits is resized to match and split across the TaskScheduler
+    void intersect (const RayStreamf& rays, HitStreamf& hits) const;
+    void intersectAny (const RayStreamf& rays, HitStreamf& hits) const;
+
+    // for callers that move rays into the BVH's space themselves, like InstanceBVH.
+    // dir doesn't have to be normalized and hit is only touched on a hit
+    bool intersect (const Eigen::Vector3f& origin, const Eigen::Vector3f& dir, float tMin, float tMax, Hit& hit) const;
+    bool intersectAny (const Eigen::Vector3f& origin, const Eigen::Vector3f& dir, float tMin, float tMax, Hit& hit) const;
+    PolyID getPolyID (const Hit& hit) const { return polyIDs[hit.triangle]; }
+
+    // not normalized, its length is twice the triangle's area
+    Eigen::Vector3f getGeometricNormal (const Hit& hit) const { return triangles[hit.triangle].edge1.cross (triangles[hit.triangle].edge2); }
+
+    bool isEmpty() const { return triangles.empty(); }
+    uint32_t getTriangleCount() const { return static_cast<uint32_t> (triangles.size()); }
+    const std::vector<Node>& getNodes() const { return nodes; }
+    Eigen::AlignedBox3f getBounds() const;
+    const Stats& getStats() const { return stats; }
+
+ private:
+    // precomputed for Moller-Trumbore, stored in leaf order
+    struct Triangle
+    {
+        Eigen::Vector3f v0;
+        Eigen::Vector3f edge1;
+        Eigen::Vector3f edge2;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Triangle> triangles;
+    std::vector<uint32_t> polyIDs; // leaf order to column of F
+    BodyID bodyID = INVALID_ID;
+    Stats stats;
+
+    static float intersectBounds (const Node& node, const Eigen::Vector3f& origin, const Eigen::Vector3f& invDir, float tMin, float tMax);
+    static bool intersectTriangle (const Triangle& tri, const Eigen::Vector3f& origin, const Eigen::Vector3f& dir,
+                                   float tMin, float tMax, float& t, float& u, float& v);
+
+    template <bool ANY_HIT>
+    bool traverse (const Eigen::Vector3f& origin, const Eigen::Vector3f& dir, float tMin, float tMax, Hit& hit) const;
+
+    template <bool ANY_HIT>
+    void intersectStream (const RayStreamf& rays, HitStreamf& hits) const;
+
+    void storeHit (const Hit& hit, Ray3f& ray) const;
+
+}; // end class TriangleBVH
@@ -0,0 +1,65 @@
+#include "RayArena.h"
+
+RayArena::RayArena (size_t chunkBytes) :
+    chunkBytes (std::max (chunkBytes, ALIGNMENT))
+{
+}
+
+RayArena::~RayArena()
+{
+    release();
+}
+
+void* RayArena::allocate (size_t bytes)
+{
+    bytes = std::max (ALIGNMENT, (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1));
+
+    // chunks kept from before the last reset are used up in order
+    while (current < chunks.size())
+    {
+        Chunk& chunk = chunks[current];
+        if (offset + bytes <= chunk.size)
+        {
+            void* p = chunk.data + offset;
+            offset += bytes;
+            bytesAllocated += bytes;
+            return p;
+        }
+        ++current;
+        offset = 0;
+    }
+
+    Chunk chunk;
+    chunk.size = std::max (chunkBytes, bytes);
+    chunk.data = static_cast<std::byte*> (::operator new (chunk.size, std::align_val_t (ALIGNMENT)));
+    chunks.push_back (chunk);
+
+    current = chunks.size() - 1;
+    offset = bytes;
+    bytesAllocated += bytes;
+    return chunk.data;
+}
+
+void RayArena::reset()
+{
+    current = 0;
+    offset = 0;
+    bytesAllocated = 0;
+}
+
+void RayArena::release()
+{
+    for (Chunk& chunk : chunks)
+        ::operator delete (chunk.data, std::align_val_t (ALIGNMENT));
+
+    chunks.clear();
+    reset();
+}
+
+size_t RayArena::getCapacity() const
+{
+    size_t capacity = 0;
+    for (const Chunk& chunk : chunks)
+        capacity += chunk.size;
+    return capacity;
+}
@@ -0,0 +1,72 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// Bump allocator for ray and hit streams
+//
+// Memory comes out of large cache line aligned chunks and is never freed one
+// allocation at a time. reset() hands every chunk back for reuse in one go, so a
+// query that runs every frame stops touching the system allocator after the first
+// one. Not thread safe, give each thread or each query its own arena.
+class RayArena : Noncopyable
+{
+ public:
+    static constexpr size_t ALIGNMENT = 64;
+    static constexpr size_t DEFAULT_CHUNK_BYTES = 4 * 1024 * 1024;
+
+    explicit RayArena (size_t chunkBytes = DEFAULT_CHUNK_BYTES);
+    ~RayArena();
+
+    // aligned to ALIGNMENT and valid until the next reset()
+    void* allocate (size_t bytes);
+
+    template <typename T>
+    T* allocate (size_t count)
+    {
+        return static_cast<T*> (allocate (count * sizeof (T)));
+    }
+
+    // everything allocated so far is invalid, the chunks are kept
+    void reset();
+
+    // frees the chunks too
+    void release();
+
+    size_t getBytesAllocated() const { return bytesAllocated; }
+    size_t getCapacity() const;
+
+ private:
+    struct Chunk
+    {
+        std::byte* data = nullptr;
+        size_t size = 0;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t chunkBytes = DEFAULT_CHUNK_BYTES;
+    size_t current = 0; // chunk being carved up
+    size_t offset = 0;   // into the current chunk
+    size_t bytesAllocated = 0;
+};
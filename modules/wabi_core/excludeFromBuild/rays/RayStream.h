@@ -0,0 +1,284 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// Structure of arrays ray and hit containers
+//
+// Ray3 carries its hit record around with it, so a RayBundle of them drags 100+ bytes
+// per ray through the cache when a traversal only needs origin, direction and the
+// t interval. RayStream keeps just those, one array per component, and HitStream
+// keeps the hit records that a query writes, so each pass touches only what it uses.
+//
+// Every array starts on a 64 byte boundary, column() wraps one as an aligned Eigen
+// array for vector math. The memory comes from a RayArena, either one shared by the
+// caller or one the stream owns. A stream on a shared arena must not outlive its
+// next reset().
+
+template <typename T>
+class RayStream
+{
+ public:
+    using Vector3 = Eigen::Matrix<T, 3, 1>;
+    using Column = Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>, Eigen::Aligned64>;
+    using ConstColumn = Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>, Eigen::Aligned64>;
+
+    RayStream() = default;
+
+    explicit RayStream (size_t capacity) :
+        ownArena (std::make_unique<RayArena> (streamBytes (capacity)))
+    {
+        allocate (capacity, *ownArena);
+    }
+
+    RayStream (size_t capacity, RayArena& arena)
+    {
+        allocate (capacity, arena);
+    }
+
+    T* originX = nullptr;
+    T* originY = nullptr;
+    T* originZ = nullptr;
+    T* dirX = nullptr;
+    T* dirY = nullptr;
+    T* dirZ = nullptr;
+    T* tMin = nullptr;
+    T* tMax = nullptr;
+
+    size_t size() const { return count; }
+    size_t getCapacity() const { return capacity; }
+    bool empty() const { return count == 0; }
+
+    void clear() { count = 0; }
+
+    // the new rays are left uninitialized
+    void resize (size_t newCount)
+    {
+        if (newCount > capacity)
+            throw std::runtime_error ("RayStream resized past its capacity of " + std::to_string (capacity));
+        count = newCount;
+    }
+
+    size_t append (const Vector3& origin, const Vector3& dir,
+                   T start = std::numeric_limits<T>::epsilon(), T end = std::numeric_limits<T>::max())
+    {
+        size_t i = count;
+        resize (count + 1);
+        set (i, origin, dir, start, end);
+        return i;
+    }
+
+    size_t append (const Ray3<T>& ray)
+    {
+        return append (ray.origin, ray.dir, ray.tMin, ray.tMax);
+    }
+
+    void set (size_t i, const Vector3& origin, const Vector3& dir,
+              T start = std::numeric_limits<T>::epsilon(), T end = std::numeric_limits<T>::max())
+    {
+        originX[i] = origin.x();
+        originY[i] = origin.y();
+        originZ[i] = origin.z();
+        dirX[i] = dir.x();
+        dirY[i] = dir.y();
+        dirZ[i] = dir.z();
+        tMin[i] = start;
+        tMax[i] = end;
+    }
+
+    Vector3 getOrigin (size_t i) const { return Vector3 (originX[i], originY[i], originZ[i]); }
+    Vector3 getDir (size_t i) const { return Vector3 (dirX[i], dirY[i], dirZ[i]); }
+
+    // the first size() entries of one of the arrays above
+    Column column (T* array) { return Column (array, count); }
+    ConstColumn column (const T* array) const { return ConstColumn (array, count); }
+
+ private:
+    std::unique_ptr<RayArena> ownArena;
+    size_t count = 0;
+    size_t capacity = 0;
+
+    static size_t arrayBytes (size_t capacity)
+    {
+        return (capacity * sizeof (T) + RayArena::ALIGNMENT - 1) & ~(RayArena::ALIGNMENT - 1);
+    }
+
+    static size_t streamBytes (size_t capacity) { return 8 * arrayBytes (capacity); }
+
+    void allocate (size_t newCapacity, RayArena& arena)
+    {
+        capacity = newCapacity;
+        std::byte* block = static_cast<std::byte*> (arena.allocate (streamBytes (capacity)));
+
+        size_t stride = arrayBytes (capacity);
+        T** arrays[] = {&originX, &originY, &originZ, &dirX, &dirY, &dirZ, &tMin, &tMax};
+        for (T** array : arrays)
+        {
+            *array = reinterpret_cast<T*> (block);
+            block += stride;
+        }
+    }
+};
+
+// One hit record per ray of the RayStream it was made for. A miss has t at
+// std::numeric_limits<T>::max() and invalid IDs. u and v are the barycentrics
+// of the second and third triangle vertex, like Ray3's bary1 and bary2.
+template <typename T>
+class HitStream
+{
+ public:
+    using Column = typename RayStream<T>::Column;
+    using ConstColumn = typename RayStream<T>::ConstColumn;
+
+    HitStream() = default;
+
+    explicit HitStream (size_t capacity) :
+        ownArena (std::make_unique<RayArena> (streamBytes (capacity)))
+    {
+        allocate (capacity, *ownArena);
+    }
+
+    HitStream (size_t capacity, RayArena& arena)
+    {
+        allocate (capacity, arena);
+    }
+
+    T* t = nullptr;
+    T* u = nullptr;
+    T* v = nullptr;
+    BodyID* bodyID = nullptr;
+    PolyID* polyID = nullptr;
+
+    size_t size() const { return count; }
+    size_t getCapacity() const { return capacity; }
+
+    // sized to match a RayStream, every record starts out as a miss
+    void resize (size_t newCount)
+    {
+        if (newCount > capacity)
+            throw std::runtime_error ("HitStream resized past its capacity of " + std::to_string (capacity));
+        count = newCount;
+        for (size_t i = 0; i < count; ++i)
+            setMiss (i);
+    }
+
+    void setMiss (size_t i)
+    {
+        t[i] = std::numeric_limits<T>::max();
+        u[i] = v[i] = T (0);
+        bodyID[i] = INVALID_ID;
+        polyID[i] = INVALID_ID;
+    }
+
+    void setHit (size_t i, T distance, BodyID body, PolyID poly, T baryU, T baryV)
+    {
+        t[i] = distance;
+        u[i] = baryU;
+        v[i] = baryV;
+        bodyID[i] = body;
+        polyID[i] = poly;
+    }
+
+    bool wasHit (size_t i) const { return t[i] < std::numeric_limits<T>::max(); }
+
+    Column column (T* array) { return Column (array, count); }
+    ConstColumn column (const T* array) const { return ConstColumn (array, count); }
+
+ private:
+    std::unique_ptr<RayArena> ownArena;
+    size_t count = 0;
+    size_t capacity = 0;
+
+    static size_t arrayBytes (size_t capacity, size_t elementSize)
+    {
+        return (capacity * elementSize + RayArena::ALIGNMENT - 1) & ~(RayArena::ALIGNMENT - 1);
+    }
+
+    static size_t streamBytes (size_t capacity)
+    {
+        return 3 * arrayBytes (capacity, sizeof (T)) + arrayBytes (capacity, sizeof (BodyID)) + arrayBytes (capacity, sizeof (PolyID));
+    }
+
+    void allocate (size_t newCapacity, RayArena& arena)
+    {
+        capacity = newCapacity;
+        std::byte* block = static_cast<std::byte*> (arena.allocate (streamBytes (capacity)));
+
+        t = reinterpret_cast<T*> (block);
+        u = reinterpret_cast<T*> (block += arrayBytes (capacity, sizeof (T)));
+        v = reinterpret_cast<T*> (block += arrayBytes (capacity, sizeof (T)));
+        bodyID = reinterpret_cast<BodyID*> (block += arrayBytes (capacity, sizeof (T)));
+        polyID = reinterpret_cast<PolyID*> (block += arrayBytes (capacity, sizeof (BodyID)));
+    }
+};
+
+using RayStreamf = RayStream<float>;
+using RayStreamd = RayStream<double>;
+using HitStreamf = HitStream<float>;
+using HitStreamd = HitStream<double>;
+
+// RayBundle to streams, hits gets the hit records too when it isn't null
+template <typename T>
+void toStreams (const std::vector<Ray3<T>>& rays, RayStream<T>& stream, HitStream<T>* hits = nullptr)
+{
+    stream.resize (rays.size());
+    if (hits) hits->resize (rays.size());
+
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        const Ray3<T>& ray = rays[i];
+        stream.set (i, ray.origin, ray.dir, ray.tMin, ray.tMax);
+        if (hits && ray.wasHit)
+            hits->setHit (i, ray.distToHit, ray.hitBodyID, ray.hitPolyID, ray.bary1, ray.bary2);
+    }
+}
+
+// and back, Ray3's hit point is rebuilt from t and its surface normal is left
+// at zero since the streams don't carry one
+template <typename T>
+void toRayBundle (const RayStream<T>& stream, const HitStream<T>* hits, std::vector<Ray3<T>>& rays)
+{
+    rays.clear();
+    rays.reserve (stream.size());
+
+    for (size_t i = 0; i < stream.size(); ++i)
+    {
+        Ray3<T>& ray = rays.emplace_back (stream.getOrigin (i), stream.getDir (i), stream.tMin[i], stream.tMax[i]);
+
+        // the constructor normalizes, keep the direction exactly as it was
+        ray.dir = stream.getDir (i);
+
+        if (hits && hits->wasHit (i))
+        {
+            ray.wasHit = true;
+            ray.distToHit = hits->t[i];
+            ray.hitBodyID = hits->bodyID[i];
+            ray.hitPolyID = hits->polyID[i];
+            ray.bary1 = hits->u[i];
+            ray.bary2 = hits->v[i];
+            ray.bary0 = T (1) - ray.bary1 - ray.bary2;
+            ray.hitPoint = ray (ray.distToHit);
+        }
+    }
+}
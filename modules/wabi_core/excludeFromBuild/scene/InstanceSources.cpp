@@ -0,0 +1,56 @@
+#include "InstanceSources.h"
+
+void InstanceSources::addInstance (const std::string& source, const std::string& instance)
+{
+    // an instance made again from another source moves over
+    if (isInstance (instance))
+        remove (instance);
+
+    instancesOf[source].push_back (instance);
+    sourceOf[instance] = source;
+}
+
+std::vector<std::string> InstanceSources::remove (const std::string& name)
+{
+    std::vector<std::string> removed;
+
+    auto source = sourceOf.find (name);
+    if (source != sourceOf.end())
+    {
+        // order among the instances doesn't matter, swap it out
+        std::vector<std::string>& siblings = instancesOf[source->second];
+        auto it = std::find (siblings.begin(), siblings.end(), name);
+        if (it != siblings.end())
+        {
+            *it = std::move (siblings.back());
+            siblings.pop_back();
+        }
+        if (siblings.empty())
+            instancesOf.erase (source->second);
+        sourceOf.erase (source);
+    }
+
+    auto instances = instancesOf.find (name);
+    if (instances != instancesOf.end())
+    {
+        removed = std::move (instances->second);
+        instancesOf.erase (instances);
+        for (const std::string& instance : removed)
+            sourceOf.erase (instance);
+    }
+
+    removed.push_back (name);
+    return removed;
+}
+
+void InstanceSources::clear()
+{
+    instancesOf.clear();
+    sourceOf.clear();
+}
+
+uint32_t InstanceSources::getInstanceCount (const std::string& source) const
+{
+    auto it = instancesOf.find (source);
+    return it == instancesOf.end() ? 0 : static_cast<uint32_t> (it->second.size());
+}
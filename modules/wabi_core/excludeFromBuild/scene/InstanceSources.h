@@ -0,0 +1,53 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+// Which instances borrow each source's geometry
+//
+// An instance shares the GAS, BLAS and materials of the node it was made from,
+// so the source can't give them back while any of its instances is still in the
+// scene. remove() says everything that has to go along with a node, the
+// instances first and the node itself last, and forgets all of them.
+// Nodes are known by name, the way the SceneHandler keeps them.
+
+class InstanceSources : Noncopyable
+{
+ public:
+    InstanceSources() = default;
+    ~InstanceSources() = default;
+
+    void addInstance (const std::string& source, const std::string& instance);
+
+    // name's instances followed by name, a node with none comes back on its own
+    std::vector<std::string> remove (const std::string& name);
+    void clear();
+
+    uint32_t getInstanceCount (const std::string& source) const;
+    bool isInstance (const std::string& name) const { return sourceOf.count (name) > 0; }
+
+ private:
+    std::unordered_map<std::string, std::vector<std::string>> instancesOf;
+    std::unordered_map<std::string, std::string> sourceOf;
+
+}; // end class InstanceSources
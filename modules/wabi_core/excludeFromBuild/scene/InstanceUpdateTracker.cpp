@@ -0,0 +1,30 @@
+#include "InstanceUpdateTracker.h"
+
+bool InstanceUpdateTracker::needsRebuild() const
+{
+    return topologyChanged || (settings.updatesBeforeRebuild && updatesSinceRebuild >= settings.updatesBeforeRebuild);
+}
+
+ASOperation InstanceUpdateTracker::plan (TransformTable& transforms)
+{
+    batch.clear();
+    batch.reserve (transforms.getDirtyCount());
+    transforms.forEachDirty ([this] (TransformHandle handle)
+                             { batch.push_back (handle); });
+    transforms.clearDirty();
+
+    // nothing moved, even a loose tree can wait
+    if (batch.empty() && !topologyChanged) return ASOperation::None;
+
+    if (needsRebuild())
+    {
+        topologyChanged = false;
+        updatesSinceRebuild = 0;
+        ++rebuildCount;
+        return ASOperation::Rebuild;
+    }
+
+    ++updatesSinceRebuild;
+    ++updateCount;
+    return ASOperation::Update;
+}
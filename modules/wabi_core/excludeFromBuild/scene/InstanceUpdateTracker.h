@@ -0,0 +1,104 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// Decides what an instance acceleration structure has to do each frame
+//
+// Reads the dirty bits of a TransformTable and hands the transforms that moved to
+// a backend in one batch, then has it refit (update) the tree. Only adding or
+// removing instances, or too many refits in a row, costs a full rebuild, and a
+// frame where nothing moved costs nothing. The backend is anything with
+//
+//   void setTransforms (const TransformHandle* handles, uint32_t count, const TransformTable& transforms);
+//   void update();
+//   void rebuild();
+//
+// and keeps the transforms it's given, so a rebuild only needs the ones that changed.
+// In the IBL sandbox it's the optixu IAS plus the CPU picking scene, in the tests a mock.
+
+enum class ASOperation
+{
+    None,
+    Update,
+    Rebuild
+};
+
+struct InstanceUpdateSettings
+{
+    // refits let the tree get looser as instances move, rebuild after this many, 0 for never
+    uint32_t updatesBeforeRebuild = 0;
+};
+
+class InstanceUpdateTracker : Noncopyable
+{
+ public:
+    InstanceUpdateTracker (const InstanceUpdateSettings& settings = InstanceUpdateSettings()) :
+        settings (settings) {}
+    ~InstanceUpdateTracker() = default;
+
+    // instances were added or removed, the next flush() rebuilds
+    void markTopologyChanged() { topologyChanged = true; }
+    bool needsRebuild() const;
+
+    // pushes what moved since the last flush() to the backend and clears the table's dirty bits
+    template <typename Backend>
+    ASOperation flush (TransformTable& transforms, Backend& backend)
+    {
+        ASOperation op = plan (transforms);
+        if (op == ASOperation::None) return op;
+
+        if (!batch.empty())
+            backend.setTransforms (batch.data(), static_cast<uint32_t> (batch.size()), transforms);
+
+        if (op == ASOperation::Rebuild)
+            backend.rebuild();
+        else
+            backend.update();
+
+        return op;
+    }
+
+    // the handles the last flush() sent, in handle order
+    const std::vector<TransformHandle>& getLastBatch() const { return batch; }
+
+    uint32_t getUpdatesSinceRebuild() const { return updatesSinceRebuild; }
+    uint64_t getUpdateCount() const { return updateCount; }
+    uint64_t getRebuildCount() const { return rebuildCount; }
+
+    const InstanceUpdateSettings& getSettings() const { return settings; }
+    void setSettings (const InstanceUpdateSettings& newSettings) { settings = newSettings; }
+
+ private:
+    InstanceUpdateSettings settings;
+    std::vector<TransformHandle> batch; // reused every frame
+    bool topologyChanged = false;
+    uint32_t updatesSinceRebuild = 0;
+    uint64_t updateCount = 0;
+    uint64_t rebuildCount = 0;
+
+    // gathers the batch, clears the dirty bits and picks the operation
+    ASOperation plan (TransformTable& transforms);
+
+}; // end class InstanceUpdateTracker
@@ -0,0 +1,99 @@
+#include "TransformTable.h"
+
+TransformHandle TransformTable::allocate (const Pose& pose)
+{
+    TransformHandle handle;
+    if (freeSlots.empty())
+    {
+        handle = size();
+        transforms.emplace_back();
+        if (handle % 64 == 0)
+        {
+            liveBits.push_back (0);
+            dirtyBits.push_back (0);
+        }
+    }
+    else
+    {
+        handle = freeSlots.back();
+        freeSlots.pop_back();
+    }
+
+    transforms[handle] = pose.matrix().block<3, 4> (0, 0);
+    liveBits[handle >> 6] |= uint64_t (1) << (handle & 63);
+    ++liveCount;
+
+    markDirty (handle);
+    return handle;
+}
+
+void TransformTable::release (TransformHandle handle)
+{
+    if (!isLive (handle))
+        throw std::runtime_error ("TransformTable handle " + std::to_string (handle) + " is not in use");
+
+    // a released slot has nothing left to upload
+    if (isDirty (handle))
+    {
+        dirtyBits[handle >> 6] &= ~(uint64_t (1) << (handle & 63));
+        --dirtyCount;
+    }
+
+    liveBits[handle >> 6] &= ~(uint64_t (1) << (handle & 63));
+    --liveCount;
+    freeSlots.push_back (handle);
+}
+
+void TransformTable::clear()
+{
+    transforms.clear();
+    liveBits.clear();
+    dirtyBits.clear();
+    freeSlots.clear();
+    liveCount = 0;
+    dirtyCount = 0;
+}
+
+bool TransformTable::set (TransformHandle handle, const Pose& pose, float epsilon)
+{
+    return set (handle, Transform (pose.matrix().block<3, 4> (0, 0)), epsilon);
+}
+
+bool TransformTable::set (TransformHandle handle, const Transform& transform, float epsilon)
+{
+    Transform& current = transforms[handle];
+    if ((current - transform).cwiseAbs().maxCoeff() <= epsilon) return false;
+
+    current = transform;
+    markDirty (handle);
+    return true;
+}
+
+Pose TransformTable::getPose (TransformHandle handle) const
+{
+    Pose pose = Pose::Identity();
+    pose.matrix().block<3, 4> (0, 0) = transforms[handle];
+    return pose;
+}
+
+void TransformTable::markDirty (TransformHandle handle)
+{
+    uint64_t& word = dirtyBits[handle >> 6];
+    uint64_t bit = uint64_t (1) << (handle & 63);
+    if (word & bit) return;
+
+    word |= bit;
+    ++dirtyCount;
+}
+
+void TransformTable::markAllDirty()
+{
+    dirtyBits = liveBits;
+    dirtyCount = liveCount;
+}
+
+void TransformTable::clearDirty()
+{
+    std::fill (dirtyBits.begin(), dirtyBits.end(), 0);
+    dirtyCount = 0;
+}
@@ -0,0 +1,116 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+// Dense table of instance transforms, the layout the IAS wants
+//
+// Every transform is a row major 3x4 matrix, the same 12 floats as
+// OptixInstance::transform, stored back to back so data() can be copied to the
+// GPU as is. Owners hold a TransformHandle, an index into the table that stays
+// put until it's released, and released slots are reused. A dirty bit per slot
+// records what was written since the last clearDirty(), so the consumer only
+// touches the transforms that moved. set() only marks a slot dirty when the
+// value changes by more than its epsilon, sleeping bodies cost nothing.
+//
+// Not thread safe, one thread writes and reads it.
+
+using TransformHandle = uint32_t;
+constexpr TransformHandle INVALID_TRANSFORM = std::numeric_limits<uint32_t>::max();
+
+class TransformTable : Noncopyable
+{
+ public:
+    using Transform = MatrixRowMajor34f;
+    static_assert (sizeof (Transform) == 12 * sizeof (float), "transforms must pack into one upload");
+
+ public:
+    TransformTable() = default;
+    ~TransformTable() = default;
+
+    // a new slot holding pose, dirty so the first update picks it up
+    TransformHandle allocate (const Pose& pose);
+    void release (TransformHandle handle);
+    void clear();
+
+    // returns true and marks the slot dirty if any element moved more than epsilon.
+    // Smaller changes aren't stored so drift still adds up to a write eventually
+    bool set (TransformHandle handle, const Pose& pose, float epsilon = 0.0f);
+    bool set (TransformHandle handle, const Transform& transform, float epsilon = 0.0f);
+
+    const Transform& get (TransformHandle handle) const { return transforms[handle]; }
+    Pose getPose (TransformHandle handle) const;
+
+    // 12 floats for one slot, or size() * 12 for the whole table
+    const float* data (TransformHandle handle) const { return transforms[handle].data(); }
+    const float* data() const { return transforms.empty() ? nullptr : transforms[0].data(); }
+
+    bool isLive (TransformHandle handle) const { return handle < size() && testBit (liveBits, handle); }
+    bool isDirty (TransformHandle handle) const { return handle < size() && testBit (dirtyBits, handle); }
+
+    // slots including released ones
+    uint32_t size() const { return static_cast<uint32_t> (transforms.size()); }
+    uint32_t getLiveCount() const { return liveCount; }
+    uint32_t getDirtyCount() const { return dirtyCount; }
+
+    void markDirty (TransformHandle handle);
+    void markAllDirty();
+    void clearDirty();
+
+    // f (handle) for every dirty slot in handle order, a word of the bitset at a time
+    template <typename F>
+    void forEachDirty (F&& f) const
+    {
+        for (size_t word = 0; word < dirtyBits.size(); ++word)
+        {
+            uint64_t bits = dirtyBits[word];
+            while (bits)
+            {
+                f (static_cast<TransformHandle> (word * 64 + lowestBit (bits)));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+ private:
+    std::vector<Transform, Eigen::aligned_allocator<Transform>> transforms;
+    std::vector<uint64_t> liveBits;
+    std::vector<uint64_t> dirtyBits;
+    std::vector<TransformHandle> freeSlots;
+    uint32_t liveCount = 0;
+    uint32_t dirtyCount = 0;
+
+    static bool testBit (const std::vector<uint64_t>& bits, uint32_t i) { return (bits[i >> 6] >> (i & 63)) & 1; }
+
+    static uint32_t lowestBit (uint64_t bits)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64 (&index, bits);
+        return static_cast<uint32_t> (index);
+#else
+        return static_cast<uint32_t> (__builtin_ctzll (bits));
+#endif
+    }
+
+}; // end class TransformTable
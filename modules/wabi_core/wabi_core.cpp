@@ -6,5 +6,11 @@ namespace wabi
 {
 
 #include "excludeFromBuild/math/Maths.cpp"
+#include "excludeFromBuild/rays/RayArena.cpp"
+#include "excludeFromBuild/bvh/TriangleBVH.cpp"
+#include "excludeFromBuild/bvh/InstanceBVH.cpp"
+#include "excludeFromBuild/scene/TransformTable.cpp"
+#include "excludeFromBuild/scene/InstanceUpdateTracker.cpp"
+#include "excludeFromBuild/scene/InstanceSources.cpp"
 
 } // namespace wabi
@@ -25,6 +25,11 @@ SOFTWARE.
 
 #include "../mace_core/mace_core.h"
 
+// _BitScanForward64 for the TransformTable dirty bits
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 using Eigen::Matrix;
 using Pose = Eigen::Affine3f;
 using Scale = Eigen::Vector3f;
@@ -65,4 +70,17 @@ namespace wabi
 #include "excludeFromBuild/math/Maths.h"
 #include "excludeFromBuild/math/MathUtil.h"
 
+// rays
+#include "excludeFromBuild/rays/RayArena.h"
+#include "excludeFromBuild/rays/RayStream.h"
+
+// bvh
+#include "excludeFromBuild/bvh/TriangleBVH.h"
+#include "excludeFromBuild/bvh/InstanceBVH.h"
+
+// scene
+#include "excludeFromBuild/scene/TransformTable.h"
+#include "excludeFromBuild/scene/InstanceUpdateTracker.h"
+#include "excludeFromBuild/scene/InstanceSources.h"
+
 } // namespace wabi
\ No newline at end of file
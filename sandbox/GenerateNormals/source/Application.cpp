@@ -46,11 +46,129 @@ inline float fast_acos (float x)
     return negate * (float)M_PI + ret;
 }
 
+// Selects how generate_normals accumulates the angle weighted face normals into N
+enum class NormalAccumulation
+{
+    Scatter, // each face atomically adds into its 3 vertex normals
+    Gather   // each vertex sums its incident faces through a vertex to face adjacency, no atomics
+};
+
+// Compressed sparse row vertex to face corner adjacency.
+// corners[offsets[v]] to corners[offsets[v + 1] - 1] are the face corners (3 * face + i)
+// that reference vertex v, in ascending face order
+struct VertexFaceAdjacency
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> corners;
+};
+
+inline void build_vertex_face_adjacency (const MatrixXu& F, uint32_t vertexCount, VertexFaceAdjacency& adj)
+{
+    const uint32_t cornerCount = (uint32_t)F.size();
+    const uint32_t* const indices = F.data(); // column major so corner c is face c / 3
+
+    adj.offsets.assign (vertexCount + 1, 0);
+    adj.corners.resize (cornerCount);
+
+    // count the corners that reference each vertex
+    for (uint32_t c = 0; c < cornerCount; ++c)
+        ++adj.offsets[indices[c] + 1];
+
+    // prefix sum turns the counts into offsets
+    for (uint32_t v = 0; v < vertexCount; ++v)
+        adj.offsets[v + 1] += adj.offsets[v];
+
+    // scatter the corners into their vertex's range
+    std::vector<uint32_t> cursor (adj.offsets.begin(), adj.offsets.end() - 1);
+    for (uint32_t c = 0; c < cornerCount; ++c)
+        adj.corners[cursor[indices[c]]++] = c;
+}
+
+// Generate normals for mesh without atomics
+// Pass 1 computes the face normals and the angle at each face corner,
+// pass 2 visits every vertex once and sums its incident faces from the adjacency
+uint32_t generate_normals_gather (const MatrixXu& F, const MatrixXf& V, MatrixXf& N, MatrixXf& FN)
+{
+    ScopedStopWatch sw ("GENERATE NORMALS GATHER"); // Start timer
+
+    std::atomic<uint32_t> badFaces (0); // Counter for degenerate faces
+
+    N.resize (V.rows(), V.cols()); // Prepare vertex normal matrix
+
+    FN.resize (F.rows(), F.cols()); // Prepare face normal matrix
+    FN.setZero();
+
+    MatrixXf angles (3, F.cols()); // angle weight of each face corner, zero for degenerate faces
+
+    VertexFaceAdjacency adj;
+    build_vertex_face_adjacency (F, (uint32_t)V.cols(), adj);
+
+    mace::TaskScheduler& scheduler = mace::TaskScheduler::get(); // shared process wide workers
+
+    scheduler.parallel_for (0u, (uint32_t)F.cols(), GRAIN_SIZE,
+                    [&] (const uint32_t start, const uint32_t end)
+                    {
+                        for (uint32_t f = start; f < end; ++f)
+                        {
+                            Vector3f p0 = V.col (F (0, f)),
+                                     p1 = V.col (F (1, f)),
+                                     p2 = V.col (F (2, f));
+
+                            Vector3f fn = (p1 - p0).cross (p2 - p0);
+                            Float norm = fn.norm();
+                            if (norm < RCPOVERFLOW)
+                            {
+                                badFaces++;
+                                angles.col (f).setZero();
+                                continue;
+                            }
+                            FN.col (f) = fn / norm;
+
+                            for (int i = 0; i < 3; ++i)
+                            {
+                                Vector3f v0 = V.col (F (i, f)),
+                                         d0 = V.col (F ((i + 1) % 3, f)) - v0,
+                                         d1 = V.col (F ((i + 2) % 3, f)) - v0;
+
+                                angles (i, f) = fast_acos (d0.dot (d1) / std::sqrt (d0.squaredNorm() * d1.squaredNorm()));
+                            }
+                        }
+                    });
+
+    // Gather and normalize the vertex normals, parallel_for returns once every face is done
+    scheduler.parallel_for (0u, (uint32_t)V.cols(), GRAIN_SIZE,
+                    [&] (const uint32_t start, const uint32_t end)
+                    {
+                        const Float* const weights = angles.data();
+                        for (uint32_t i = start; i < end; ++i)
+                        {
+                            Vector3f n = Vector3f::Zero();
+                            for (uint32_t k = adj.offsets[i]; k < adj.offsets[i + 1]; ++k)
+                            {
+                                uint32_t c = adj.corners[k];
+                                n += FN.col (c / 3) * weights[c];
+                            }
+
+                            Float norm = n.norm();
+                            if (norm < RCPOVERFLOW)
+                            {
+                                N.col (i) = Vector3f::UnitX();
+                            }
+                            else
+                            {
+                                N.col (i) = n / norm;
+                            }
+                        }
+                    });
+
+    return badFaces.load();
+}
+
 // Generate normals for mesh
-// replaced TBB with BS_thread_pool, math from Instant Meshes https://github.com/wjakob/instant-meshes
-void generate_normals (const MatrixXu& F, const MatrixXf& V, MatrixXf& N, MatrixXf& FN)
+// replaced TBB with mace::TaskScheduler, math from Instant Meshes https://github.com/wjakob/instant-meshes
+uint32_t generate_normals_scatter (const MatrixXu& F, const MatrixXf& V, MatrixXf& N, MatrixXf& FN)
 {
-    ScopedStopWatch sw ("GENERATE NORMALS"); // Start timer
+    ScopedStopWatch sw ("GENERATE NORMALS SCATTER"); // Start timer
 
     std::atomic<uint32_t> badFaces (0); // Counter for degenerate faces
 
@@ -60,7 +178,7 @@ void generate_normals (const MatrixXu& F, const MatrixXf& V, MatrixXf& N, Matrix
     FN.resize (F.rows(), F.cols()); // Prepare face normal matrix
     FN.setZero();
 
-    BS::thread_pool pool; // Initialize thread pool
+    mace::TaskScheduler& scheduler = mace::TaskScheduler::get(); // shared process wide workers
 
     // Multi-threaded computation of face and vertex normals
     auto map = [&] (const uint32_t start, const uint32_t end)
@@ -96,13 +214,11 @@ void generate_normals (const MatrixXu& F, const MatrixXf& V, MatrixXf& N, Matrix
         }
     };
 
-    pool.push_loop (0u, (uint32_t)F.cols(), map, GRAIN_SIZE); // Execute in parallel
-
-    // must wait here because the normalize task depends on this task being completed
-    pool.wait_for_tasks();                                  
+    // parallel_for blocks until every chunk is done so the normalize pass sees all the sums
+    scheduler.parallel_for (0u, (uint32_t)F.cols(), GRAIN_SIZE, map); // Execute in parallel
 
     // Normalize the vertex normals
-    pool.push_loop (0u, (uint32_t)V.cols(),
+    scheduler.parallel_for (0u, (uint32_t)V.cols(), GRAIN_SIZE,
                     [&] (const uint32_t start, const uint32_t end)
                     {
                         for (uint32_t i = start; i < end; ++i)
@@ -119,7 +235,18 @@ void generate_normals (const MatrixXu& F, const MatrixXf& V, MatrixXf& N, Matrix
                         }
                     });
 
-    pool.wait_for_tasks(); // Wait for tasks to complete
+    return badFaces.load();
+}
+
+// Generate normals for mesh, gather is the default since it scales with core count on dense meshes.
+// Returns how many faces were degenerate
+uint32_t generate_normals (const MatrixXu& F, const MatrixXf& V, MatrixXf& N, MatrixXf& FN,
+                           NormalAccumulation mode = NormalAccumulation::Gather)
+{
+    if (mode == NormalAccumulation::Gather)
+        return generate_normals_gather (F, V, N, FN);
+    else
+        return generate_normals_scatter (F, V, N, FN);
 }
 
 // Function to report errors from RapidObj
@@ -252,7 +379,18 @@ class Application : public Jahley::App
 
             MatrixXf N;  // vertex normals
             MatrixXf FN; // face normals
-            generate_normals (F, V, N, FN);
+            uint32_t badFaces = generate_normals (F, V, N, FN);
+            LOG (DBUG) << badFaces << " degenerate faces";
+
+            // the scatter path sums in a different order so only expect agreement within tolerance
+            MatrixXf scatterN;
+            MatrixXf scatterFN;
+            generate_normals (F, V, scatterN, scatterFN, NormalAccumulation::Scatter);
+
+            float maxError = (N - scatterN).cwiseAbs().maxCoeff();
+            LOG (DBUG) << "Max difference between gather and scatter vertex normals: " << maxError;
+            if (maxError > 1e-5f)
+                LOG (CRITICAL) << "Gather and scatter vertex normals do not match";
 
 #if 1
             LOG (DBUG) << "--------------------- Face normals";
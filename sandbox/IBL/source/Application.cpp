@@ -44,11 +44,19 @@ class Application : public Jahley::App
         view->physicsStateEmitter.connect<&Model::setPhysicsEngineSate> (model);
         model.physicsStateEmitter.connect<&View::setPhysicsEngineState> (*view);
         view->getCanvas()->inputEmitter.connect<&App::onInputEvent> (*this);
+        controller.pickEmitter.connect<&Model::onPick> (model);
+
+        // Esc cancels the files still importing, Delete removes the picked node
+        view->cancelEmitter.connect<&Model::cancelIngest> (model);
+        view->deleteEmitter.connect<&Model::removePicked> (model);
     }
 
     void update() override
     {
-        // update physics before rendering
+        // commit any files the ingest workers have finished
+        model.updateIngest();
+
+        // physics steps on its own thread, this only takes its latest poses
         model.updatePhysics();
         model.render();
 
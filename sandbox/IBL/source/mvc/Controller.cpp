@@ -6,6 +6,18 @@
 
 const float moveFactor = 0.0075f;
 
+// the render can be a different size than the window showing it, so
+// window coordinates are scaled to the sensor and kept on it
+static Eigen::Vector2i toSensorPixel (const InputEvent& input, const Eigen::Vector2i& resolution)
+{
+    float scaleX = input.getWindowWidth() > 0.0f ? resolution.x() / input.getWindowWidth() : 1.0f;
+    float scaleY = input.getWindowHeight() > 0.0f ? resolution.y() / input.getWindowHeight() : 1.0f;
+
+    int x = static_cast<int> (input.getX() * scaleX);
+    int y = static_cast<int> (input.getY() * scaleY);
+    return Eigen::Vector2i (std::clamp (x, 0, resolution.x() - 1), std::clamp (y, 0, resolution.y() - 1));
+}
+
 void Controller::onInputEvent (const InputEvent& input, CameraHandle& camera)
 {
     mouseCoords = Eigen::Vector2f (input.getX(), input.getY());
@@ -59,6 +71,13 @@ void Controller::onInputEvent (const InputEvent& input, CameraHandle& camera)
             {
                 camera->setDirty (true);
                 buttonPressed = InputEvent::MouseButton::Right;
+
+                Eigen::Vector2i resolution = camera->getSensor()->getPixelResolution();
+                if (mouseCoords.x() >= 0.0f && mouseCoords.y() >= 0.0f && resolution.x() > 0 && resolution.y() > 0)
+                {
+                    Eigen::Vector2i pixel = toSensorPixel (input, resolution);
+                    pickEmitter.fire (camera->generateRay (static_cast<uint32_t> (pixel.x()), static_cast<uint32_t> (pixel.y())));
+                }
             }
 
             break;
@@ -29,9 +29,14 @@ SOFTWARE.
 using mace::InputEvent;
 using mace::MouseMode;
 using sabi::CameraHandle;
+using OnPickSignal = Nano::Signal<void (const wabi::Ray3f&)>;
 
 class Controller
 {
+ public:
+    // world space ray under the mouse when the right button goes down
+    OnPickSignal pickEmitter;
+
  public:
     Controller() = default;
     ~Controller() = default;
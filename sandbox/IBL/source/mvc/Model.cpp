@@ -1,16 +1,50 @@
 #include "Model.h"
 #include "mace_core/mace_core.h"
+#include "../renderer/geometry/GeometryUtilities.h"
+
+// parsed but not yet committed files, bounds the memory a big drop can take
+constexpr uint32_t MAX_INGEST_JOBS_IN_FLIGHT = 4;
+
+// GPU uploads and GAS builds per frame
+constexpr uint32_t MAX_INGEST_COMMITS_PER_FRAME = 1;
 
 void Model::init (CameraHandle& camera, const std::string& resourceFolder, const std::string& repoFolder, const std::string& commonFolder)
 {
     try
     {
+        // leave Newton's worker threads their own cores so a scene drop
+        // doesn't oversubscribe the machine while the simulation is running
+        uint32_t hardwareThreads = std::max (1u, std::thread::hardware_concurrency());
+        uint32_t physicsThreads = static_cast<uint32_t> (newton.getWorkerThreadCount());
+
+        mace::TaskSchedulerSettings schedulerSettings;
+        schedulerSettings.threadCount = hardwareThreads > physicsThreads + 2 ? hardwareThreads - physicsThreads - 1 : 1;
+        mace::TaskScheduler::configure (schedulerSettings);
+
         // compile the optix kernels using NVCC
         nvcc.compile (resourceFolder, repoFolder);
 
         renderer.init (resourceFolder);
         renderer.setCamera (camera);
 
+        // parse, mesh processing and texture decode run on the workers,
+        // only the commit touches the renderer and physics engine
+        const sabi::MeshCache& meshCache = renderer.getMeshCache();
+        mace::DecodedImageCacheRef decodedImages = renderer.getDecodedImageCache();
+
+        sabi::IngestStages stages;
+        stages.parse = [&meshCache] (sabi::IngestJob& job)
+        { sabi::ingestParse (job, meshCache); };
+        stages.process = [&meshCache] (sabi::IngestJob& job)
+        { sabi::ingestProcess (job, meshCache); };
+        stages.materials = [decodedImages] (sabi::IngestJob& job)
+        { sabi::ingestMaterials (job, *decodedImages); };
+        stages.commit = [this] (sabi::IngestJob& job)
+        { commitIngestJob (job); };
+
+        ingest = std::make_unique<sabi::IngestPipeline> (std::move (stages), MAX_INGEST_JOBS_IN_FLIGHT, MAX_INGEST_COMMITS_PER_FRAME);
+        ingest->progressEmitter.connect<&Model::onIngestProgress> (*this);
+
         // add environment hdr
         std::string hdrPath = commonFolder + "/skydome.hdr";
         OIIO::ImageBuf hdr (hdrPath);
@@ -27,6 +61,9 @@ void Model::init (CameraHandle& camera, const std::string& resourceFolder, const
         // add a gltf box
         std::filesystem::path box (commonFolder + "/BoxTextured/BoxTextured.gltf");
         processPath (box);
+
+        // the startup scene should be there on the first frame
+        ingest->flush();
     }
     catch (std::exception& e)
     {
@@ -41,16 +78,16 @@ void Model::render()
 
 void Model::updatePhysics()
 {
-    if (newton.update (engineState))
+    // picks up the physics thread's latest step, never waits for it
+    if (newton.update (engineState, renderer.getTransforms()))
     {
         renderer.updateMotion();
     }
 
-    // after a Reset, change the engine state back to Paused
-    // and update the renderer
+    // after a Reset, change the engine state back to Paused,
+    // the start poses arrive with the physics thread's next snapshot
     if (engineState == PhysicsEngineState (PhysicsEngineState::Reset))
     {
-        renderer.updateMotion();
         engineState = PhysicsEngineState (PhysicsEngineState::Paused);
 
         // the View's version of PhysicsEngineState is still set to Reset
@@ -74,48 +111,99 @@ void Model::processPath (const std::filesystem::path& p)
     else
     {
         if (hasGltfExtension (p) || hasObjExtension (p))
-        {
-            OptiXGeometryRef g = OptiXTriangleMesh<shared::Vertex, shared::Triangle, Shared::GeometryData>::create();
-            g->fromFile (p);
-
-            OptiXNode node = OptiXRenderable::create();
-            node->g = g;
-
-            node->st.worldTransform.setIdentity();
-            node->st.makeCurrentPoseStartPose();
-
-            node->name = p.stem().string();
-
-            if (isStaticBody (p))
-            {
-                node->desc.bodyType = BodyType::Static;
-                node->desc.shape = CollisionShape::Mesh;
-                node->desc.mass = 0.0f;
-                node->st.worldTransform.translation() = Eigen::Vector3f (0.0, -1.0f, 0.0f);
-                node->st.makeCurrentPoseStartPose();
-            }
-
-            // add the node to the renderer
-            renderer.addRenderableNode (node, p);
-
-            // add a weak node to the physics engine
-            newton.addBody (node, engineState);
-
-            //  add a stack of geomety instances to renderer
-            //  don't make static instances
-            if (!node->isStaticBody())
-            {
-                uint32_t instanceCount = 60;
-                GeometryInstances instances (instanceCount);
-                renderer.addRenderableGeometryInstances (node, instances);
-
-                // add to newton
-                newton.addGeometryInstances (node, instances, engineState);
-            }
-        }
+            ingest->submit (p);
     }
 }
 
+void Model::updateIngest()
+{
+    ingest->update();
+}
+
+void Model::cancelIngest()
+{
+    ingest->cancel();
+}
+
+void Model::commitIngestJob (sabi::IngestJob& job)
+{
+    const std::filesystem::path& p = job.path;
+
+    // the geometry is built from the job's meshes, the file isn't read again
+    OptiXGeometryRef g = OptiXTriangleMesh<shared::Vertex, shared::Triangle, Shared::GeometryData>::create();
+
+    OptiXNode node = OptiXRenderable::create();
+    node->g = g;
+
+    node->st.worldTransform.setIdentity();
+    node->st.makeCurrentPoseStartPose();
+
+    node->name = p.stem().string();
+
+    if (isStaticBody (p))
+    {
+        node->desc.bodyType = BodyType::Static;
+        node->desc.shape = CollisionShape::Mesh;
+        node->desc.mass = 0.0f;
+        node->st.worldTransform.translation() = Eigen::Vector3f (0.0, -1.0f, 0.0f);
+        node->st.makeCurrentPoseStartPose();
+    }
+
+    // add the node to the renderer
+    renderer.addRenderableNode (node, job);
+
+    // add a weak node to the physics engine
+    newton.addBody (node);
+
+    //  add a stack of geomety instances to renderer
+    //  don't make static instances
+    if (!node->isStaticBody())
+    {
+        uint32_t instanceCount = 60;
+        GeometryInstances instances (instanceCount);
+        renderer.addRenderableGeometryInstances (node, instances);
+
+        // add to newton
+        newton.addGeometryInstances (node, instances);
+    }
+}
+
+void Model::removeNodes (const std::vector<std::string>& names)
+{
+    // the renderer takes their instances too, physics drops the slots of everything that
+    // went before the next update could write to a transform handle that's been given back
+    for (const OptiXNode& node : renderer.removeRenderableNodes (names))
+        newton.removeBody (node);
+}
+
+void Model::removePicked()
+{
+    if (pickedName.empty()) return;
+
+    LOG (DBUG) << "Removing " << pickedName;
+    removeNodes ({pickedName});
+    pickedName.clear();
+}
+
+void Model::onIngestProgress (const sabi::IngestProgress& progress)
+{
+    LOG (DBUG) << "Imported " << progress.finished() << " of " << progress.submitted << ": " << progress.lastPath.filename().string();
+}
+
+void Model::onPick (const wabi::Ray3f& ray)
+{
+    wabi::Ray3f r = ray;
+    OptiXNode node = renderer.pick (r);
+    if (!node)
+    {
+        pickedName.clear();
+        return;
+    }
+
+    pickedName = node->name;
+    LOG (DBUG) << "Picked " << node->name << " at " << r.hitPoint.transpose();
+}
+
 void Model::onDrop (const std::vector<std::string>& filenames)
 {
     for (const auto& filename : filenames)
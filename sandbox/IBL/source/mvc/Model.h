@@ -45,12 +45,31 @@ class Model : public Observer
     void updatePhysics();
     void onDrop (const std::vector<std::string>& filenames);
     void setPhysicsEngineSate (PhysicsEngineState state) { engineState = state; }
+    void onPick (const wabi::Ray3f& ray);
+
+    // takes the nodes and their instances out of the scene and the physics world, unknown names are skipped
+    void removeNodes (const std::vector<std::string>& names);
+
+    // removes the node picked last, if it's still there
+    void removePicked();
+
+    // commits whatever the ingest workers have finished, call once per frame
+    void updateIngest();
+    void cancelIngest();
+
+    // progress and cancellation of dropped files
+    sabi::OnIngestProgressSignal& getIngestProgressEmitter() { return ingest->progressEmitter; }
+    sabi::OnIngestCancelSignal& getIngestCancelEmitter() { return ingest->cancelEmitter; }
 
  private:
     CudaCompiler nvcc;
     Renderer renderer;
     NewtonEngine newton;
     PhysicsEngineState engineState = PhysicsEngineState::Paused;
+    std::unique_ptr<sabi::IngestPipeline> ingest = nullptr;
+    std::string pickedName; // empty when the last pick missed
 
     void processPath (const std::filesystem::path& p);
+    void commitIngestJob (sabi::IngestJob& job);
+    void onIngestProgress (const sabi::IngestProgress& progress);
 };
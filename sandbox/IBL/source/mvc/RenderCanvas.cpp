@@ -331,6 +331,7 @@ bool RenderCanvas::mouse_button_event (const Vector2i& p, int button, bool down,
 
     e.setX (p.x());
     e.setY (p.y());
+    e.setWindowSize (m_size.x(), m_size.y());
 
     e.setMouseMode (mouseMode);
     inputEmitter.fire (e);
@@ -108,7 +108,21 @@ bool View::drop_event (const std::vector<std::string>& filenames)
 
 bool View::keyboard_event (int key, int scancode, int action, int modifiers)
 {
-    return false;
+    if (action != GLFW_PRESS) return false;
+
+    switch (key)
+    {
+        case GLFW_KEY_ESCAPE:
+            cancelEmitter.fire();
+            return true;
+
+        case GLFW_KEY_DELETE:
+            deleteEmitter.fire();
+            return true;
+
+        default:
+            return false;
+    }
 }
 
 void View::draw_contents()
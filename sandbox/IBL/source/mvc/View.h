@@ -48,12 +48,15 @@ using namespace nanogui;
 
 using OnDropSignal = Nano::Signal<void (const std::vector<std::string>&)>;
 using OnPhyicsEngineChangeSignal = Nano::Signal<void (PhysicsEngineState)>;
+using OnKeyCommandSignal = Nano::Signal<void()>;
 
 class View : public nanogui::Screen, public Observer
 {
  public:
     OnDropSignal dropEmitter;
     OnPhyicsEngineChangeSignal physicsStateEmitter;
+    OnKeyCommandSignal cancelEmitter; // Esc
+    OnKeyCommandSignal deleteEmitter; // Delete
 
  public:
     View (const DesktopWindowSettings& settings);
@@ -0,0 +1,56 @@
+#include "BodySpawner.h"
+
+std::vector<ndBodyDynamic*> BodySpawner::create (const ndShapeInstance& shape, float mass, const Pose* poses, uint32_t count)
+{
+    std::vector<ndBodyDynamic*> bodies (count, nullptr);
+    if (!count) return bodies;
+
+    // what ndBodyKinematic::SetMassMatrix (mass, shape) works out for every body
+    ndMatrix inertia (shape.CalculateInertia());
+    ndVector centreOfMass (inertia.m_posit);
+    for (ndInt32 i = 0; i < 3; ++i)
+        inertia[i] = inertia[i].Scale (mass);
+
+    ndVector principal (inertia.EigenVectors());
+    inertia = ndGetIdentityMatrix();
+    inertia[0][0] = principal[0];
+    inertia[1][1] = principal[1];
+    inertia[2][2] = principal[2];
+
+    for (uint32_t i = 0; i < count; ++i)
+        bodies[i] = new ndBodyDynamic();
+
+    try
+    {
+        mace::TaskScheduler::get().parallel_for (0, count, GRAIN_SIZE, [&] (uint32_t start, uint32_t end)
+                                                 {
+            for (uint32_t i = start; i < end; ++i)
+            {
+                ndBodyDynamic* const body = bodies[i];
+                body->SetCollisionShape (shape);
+                body->SetCentreOfMass (centreOfMass);
+                body->SetMassMatrix (mass, inertia);
+
+                ndMatrix pose;
+                eigenToNewton (poses[i], pose);
+                body->SetMatrix (pose);
+            } });
+    }
+    catch (...)
+    {
+        for (ndBodyDynamic* body : bodies)
+            delete body;
+        throw;
+    }
+
+    return bodies;
+}
+
+void BodySpawner::commit (ndWorld& world, const std::vector<ndBodyDynamic*>& bodies)
+{
+    for (ndBodyDynamic* body : bodies)
+    {
+        ndSharedPtr<ndBody> bodyPtr (body);
+        world.AddBody (bodyPtr);
+    }
+}
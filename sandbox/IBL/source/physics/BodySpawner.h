@@ -0,0 +1,49 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "PhysicsUtilities.h"
+
+// Creates many dynamic bodies that share one collision shape
+//
+// The shape's mass properties are worked out once rather than per body and the
+// bodies are set up in parallel chunks on the mace::TaskScheduler. Newton hands
+// out body ids from an unguarded counter, so the bodies themselves are still
+// allocated one after another. Only the thread that steps the world may add
+// them, commit() does that in one pass.
+
+class BodySpawner
+{
+ public:
+    static constexpr uint32_t GRAIN_SIZE = 256;
+
+ public:
+    // count bodies at poses, not yet in any world. The shape is used with the scale it has
+    static std::vector<ndBodyDynamic*> create (const ndShapeInstance& shape, float mass, const Pose* poses, uint32_t count);
+
+    // the world owns them from here
+    static void commit (ndWorld& world, const std::vector<ndBodyDynamic*>& bodies);
+
+}; // end class BodySpawner
@@ -2,14 +2,16 @@
 
 #include "NewtonCallbacks.h"
 
-using Eigen::Matrix3f;
 using Eigen::Quaternionf;
 
 // ctor
-NewtonCallbacks::NewtonCallbacks (OptiXWeakNode weakNode) :
+NewtonCallbacks::NewtonCallbacks (OptiXWeakNode weakNode, PhysicsContext* ctx) :
     ndBodyNotify (ndVector (ndFloat32 (0.0f), -10.0f, ndFloat32 (0.0f), ndFloat32 (0.0f))),
-    weakNode (weakNode)
+    weakNode (weakNode),
+    ctx (ctx)
 {
+    if (!weakNode.expired())
+        slot = weakNode.lock()->physicsIndex;
 }
 
 // dtor
@@ -21,27 +23,26 @@ void NewtonCallbacks::OnTransform (ndInt32 threadIndex, const ndMatrix& matrix)
 {
     if (weakNode.expired()) return;
 
-    OptiXNode node = weakNode.lock();
+    TransformSnapshot& poses = ctx->bodyPoses;
 
     ndBody* const body = GetBody();
     ndMatrix t (matrix);
     ndQuaternion r (body->GetRotation());
 
-    Quaternionf q (r.m_w, r.m_x, r.m_y, r.m_z);
-    node->st.worldTransform.translation() = Vector3f (t.m_posit.m_x, t.m_posit.m_y, t.m_posit.m_z);
-    node->st.worldTransform.linear() = Matrix3f (q);
+    poses.positions[slot] = Vector3f (t.m_posit.m_x, t.m_posit.m_y, t.m_posit.m_z);
+    poses.rotations[slot] = Quaternionf (r.m_w, r.m_x, r.m_y, r.m_z);
 
     ndBodyKinematic* const kinematic = body->GetAsBodyKinematic();
     if (kinematic)
     {
         // FIXME make this real
         float cutOff = -20.0f;
-        if (node->st.worldTransform.translation().y() < cutOff)
+        if (poses.positions[slot].y() < cutOff)
         {
             // put them to sleep if they're out of sight
             kinematic->SetSleepState (1);
         }
-        node->desc.sleepState = kinematic->GetSleepState();
+        poses.sleeping[slot] = kinematic->GetSleepState();
     }
 }
 
@@ -49,8 +50,6 @@ void NewtonCallbacks::OnApplyExternalForce (ndInt32 threadIndex, ndFloat32 times
 {
     if (weakNode.expired()) return;
 
-    OptiXNode node = weakNode.lock();
-
     ndBodyKinematic* const body = GetBody()->GetAsBodyKinematic();
 
     if (body && body->GetInvMass() > 0.0f)
@@ -64,6 +63,6 @@ void NewtonCallbacks::OnApplyExternalForce (ndInt32 threadIndex, ndFloat32 times
     ndBodyKinematic* const kinematic = body->GetAsBodyKinematic();
     if (kinematic)
     {
-        node->desc.sleepState = kinematic->GetSleepState();
+        ctx->bodyPoses.sleeping[slot] = kinematic->GetSleepState();
     }
 }
@@ -28,11 +28,13 @@ SOFTWARE.
 #include <ndContactCallback.h>
 
 #include "../scene/RenderableNode.h"
+#include "PhysicsContext.h"
 
 class NewtonCallbacks : public ndBodyNotify
 {
  public:
-    NewtonCallbacks (OptiXWeakNode weakNode);
+    // the node's physicsIndex must already be set
+    NewtonCallbacks (OptiXWeakNode weakNode, PhysicsContext* ctx);
     ~NewtonCallbacks();
 
     void OnTransform (ndInt32 threadIndex, const ndMatrix& matrix) override;
@@ -44,4 +46,9 @@ class NewtonCallbacks : public ndBodyNotify
 
  private:
     OptiXWeakNode weakNode;
+
+    // Newton calls back on its worker threads, so poses go into this body's
+    // slot of the step's snapshot instead of the node the renderer is reading
+    PhysicsContext* ctx = nullptr;
+    uint32_t slot = 0;
 }; // end class NewtonCallbacks
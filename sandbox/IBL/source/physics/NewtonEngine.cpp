@@ -1,73 +1,192 @@
-
 #include "NewtonEngine.h"
 #include "handlers/NewtonHandlers.h"
 #include "NewtonWorld.h"
 
-static ndUnsigned64 m_prevTime = 0;
-
 // ctor
 NewtonEngine::NewtonEngine()
 {
     ctx = std::make_shared<PhysicsContext>();
     ctx->init();
+
+    startTime = std::chrono::steady_clock::now();
+    physicsThread = std::thread ([this]()
+                                 { physicsLoop(); });
 }
 
 // dtor
 NewtonEngine::~NewtonEngine()
 {
+    quit = true;
+    if (physicsThread.joinable())
+        physicsThread.join();
 }
 
-bool NewtonEngine::update (PhysicsEngineState state)
+bool NewtonEngine::update (PhysicsEngineState state, wabi::TransformTable& transforms)
 {
-    ndFloat32 timestep = dGetElapsedSeconds();
+    running = state == PhysicsEngineState (PhysicsEngineState::Running);
 
-    if (state == PhysicsEngineState (PhysicsEngineState::Running))
-    {
-        double updateTime = ctx->newtonWorld->advanceTime (timestep);
-        return true;
-    }
-    else if (state == PhysicsEngineState (PhysicsEngineState::Reset))
+    if (state == PhysicsEngineState (PhysicsEngineState::Reset))
     {
         LOG (DBUG) << "Reset Newton";
-        resetEngine();
+        resetRequested = true;
     }
-    
-    return false;
-}
 
-void NewtonEngine::addBody (OptiXWeakNode weakNode, PhysicsEngineState engineState)
-{
-    try
+    // every publish carries the step before it too, so however many steps went out
+    // since the last frame the blend is always between two consecutive ones
+    TransformSnapshots& snapshots = ctx->snapshots;
+    bool fresh = snapshots.acquire();
+
+    const TransformSnapshot& latest = snapshots.front().latest;
+    const TransformSnapshot& previous = snapshots.front().previous;
+
+    float blend = 1.0f;
+    if (interpolate && latest.generation == previous.generation && latest.step > previous.step && latest.time > previous.time)
     {
-        ctx->handlers->body->addBody (weakNode, engineState);
-        ctx->weakNodes.push_back (weakNode);
+        double t = (getSeconds() - latest.time) / (latest.time - previous.time);
+        blend = static_cast<float> (std::clamp (t, 0.0, 1.0));
     }
-    catch (std::exception& e)
+
+    // nothing new and the last blend already reached the latest step
+    bool moved = fresh || lastBlend < 1.0f;
+    lastBlend = blend;
+    if (!moved) return false;
+
+    // bodies that didn't move leave their slot clean. One asleep in both steps is
+    // written once more, so it lands on its final pose, and then skipped until it wakes
+    bool changed = false;
+    bool sameRun = latest.generation == previous.generation;
+    uint32_t count = std::min (latest.size(), static_cast<uint32_t> (bodyTransforms.size()));
+    for (uint32_t slot = 0; slot < count; ++slot)
     {
-        LOG (CRITICAL) << e.what();
+        wabi::TransformHandle handle = bodyTransforms[slot];
+        if (!transforms.isLive (handle)) continue;
+
+        bool asleep = sameRun && latest.sleeping[slot] && slot < previous.size() && previous.sleeping[slot];
+        if (asleep && settled[slot]) continue;
+
+        changed |= transforms.set (handle, latest.interpolate (previous, slot, blend), transformEpsilon);
+        settled[slot] = asleep;
     }
+
+    return changed;
 }
 
-void NewtonEngine::addGeometryInstances (OptiXWeakNode instancedFrom, GeometryInstances& instances, PhysicsEngineState engineState)
+void NewtonEngine::addBody (OptiXWeakNode weakNode)
 {
-    try
-    {
-        ctx->handlers->body->addGeometryInstances (instancedFrom, instances, engineState);
+    if (weakNode.expired()) return;
+
+    // slots are handed out here on the render thread so it always knows where a pose goes
+    BodyStart start = addSlot (weakNode.lock());
+
+    ctx->handlers->body->addBody (weakNode, start);
+}
+
+void NewtonEngine::addGeometryInstances (OptiXWeakNode instancedFrom, GeometryInstances& instances)
+{
+    if (instancedFrom.expired()) return;
+
+    BodyStarts starts;
+    starts.reserve (instances.size());
+    for (auto& node : instances)
+        starts.push_back (addSlot (node));
 
-        for (auto& node : instances)
+    ctx->handlers->body->addGeometryInstances (instancedFrom, instances, starts);
+}
+
+void NewtonEngine::removeBody (OptiXNode node)
+{
+    if (!node || node->physicsIndex >= bodyTransforms.size()) return;
+
+    // the handle goes back to the scene's table and may be handed to the next node added
+    bodyTransforms[node->physicsIndex] = wabi::INVALID_TRANSFORM;
+    settled[node->physicsIndex] = 0;
+
+    ctx->handlers->body->removeBody (node->physicsIndex);
+}
+
+// slots are handed out in the order the physics thread adds the bodies. The start
+// state is read from the node here, the physics thread only ever sees the copy
+BodyStart NewtonEngine::addSlot (OptiXNode node)
+{
+    node->physicsIndex = static_cast<uint32_t> (bodyTransforms.size());
+    bodyTransforms.push_back (node->isStaticBody() ? wabi::INVALID_TRANSFORM : node->transformHandle);
+    settled.push_back (0);
+
+    BodyStart start;
+    start.pose = node->st.startTransform;
+    start.scale = node->st.startScale;
+    start.mass = node->desc.mass;
+    return start;
+}
+
+void NewtonEngine::physicsLoop()
+{
+    using Clock = std::chrono::steady_clock;
+
+    NewtonWorld& world = *ctx->newtonWorld;
+    const Clock::duration stepDuration = std::chrono::duration_cast<Clock::duration> (std::chrono::duration<double> (world.getStepSize()));
+
+    uint64_t step = 0;
+    Clock::time_point nextStep = Clock::now();
+
+    while (!quit)
+    {
+        try
         {
-            ctx->weakNodes.push_back (node);
+            uint32_t bodyCount = ctx->bodyPoses.size();
+            ctx->handlers->body->flushPending();
+            bool changed = ctx->bodyPoses.size() != bodyCount;
+
+            if (resetRequested.exchange (false))
+            {
+                resetEngine();
+                changed = true;
+            }
+
+            if (running)
+            {
+                // accelerated runs a few steps back to back and then waits like a normal one
+                uint32_t stepCount = world.isAccelerated() ? ACCELERATED_PHYSICS_STEPS : 1;
+                for (uint32_t i = 0; i < stepCount; ++i)
+                {
+                    world.step();
+                    publishSnapshot (++step);
+                }
+            }
+            else if (changed)
+            {
+                publishSnapshot (step);
+            }
         }
-    }
-    catch (std::exception& e)
-    {
-        LOG (CRITICAL) << e.what();
+        catch (std::exception& e)
+        {
+            LOG (CRITICAL) << e.what();
+        }
+
+        // if it fell more than MAX_PHYSICS_STEPS behind, throw the extra time away
+        nextStep += stepDuration;
+        Clock::time_point now = Clock::now();
+        if (now > nextStep + stepDuration * MAX_PHYSICS_STEPS)
+            nextStep = now;
+
+        std::this_thread::sleep_until (nextStep);
     }
 }
 
-void NewtonEngine::dResetTimer()
+void NewtonEngine::publishSnapshot (uint64_t step)
 {
-    m_prevTime = ndGetTimeInMicroseconds();
+    TransformSteps& steps = ctx->snapshots.back();
+    steps.previous.copyFrom (published);
+
+    TransformSnapshot& snapshot = steps.latest;
+    snapshot.copyFrom (ctx->bodyPoses);
+    snapshot.step = step;
+    snapshot.generation = generation;
+    snapshot.time = getSeconds();
+
+    ctx->snapshots.publish();
+
+    published.copyFrom (snapshot);
 }
 
 void NewtonEngine::resetEngine()
@@ -75,17 +194,19 @@ void NewtonEngine::resetEngine()
     ctx->newtonWorld->Sync();
     ctx->newtonWorld->ClearCache();
 
-    for (auto& n : ctx->weakNodes)
-    {
-        if (n.expired()) continue;
+    // the start poses go out with the next snapshot
+    ++generation;
 
-        OptiXNode node = n.lock();
+    // by slot, removed bodies have left a nullptr behind
+    for (uint32_t slot = 0; slot < ctx->bodies.size(); ++slot)
+    {
+        ndBodyDynamic* const ndBody = ctx->bodies[slot];
+        if (!ndBody) continue;
 
-        node->st.resetToStartPose();
-        node->desc.sleepState = 0;
+        const BodyStart& start = ctx->bodyStarts[slot];
 
-        ndBodyDynamic* const ndBody = static_cast<ndBodyDynamic*> (node->getUserdata());
-        if (!ndBody) continue;
+        ctx->bodyPoses.setPose (slot, start.pose);
+        ctx->bodyPoses.sleeping[slot] = 0;
 
         // 4th component not zero was cause of not working
         ndVector zero = ndVector (0.0f, 0.0f, 0.0f, 0.0f);
@@ -99,25 +220,19 @@ void NewtonEngine::resetEngine()
         ndBody->SetSleepState (1);
 
         ndMatrix startPose;
-        eigenToNewton (node->st.startTransform, startPose);
+        eigenToNewton (start.pose, startPose);
         ndBody->SetMatrix (startPose);
 
         ndShapeInstance& shape = ndBody->GetCollisionShape();
-        Eigen::Vector3f s = node->st.startScale;
+        const Scale& s = start.scale;
 
         shape.SetScale (ndVector (s.x(), s.y(), s.z(), 1.0f));
 
-        ndBody->SetMassMatrix (node->desc.mass, shape);
+        ndBody->SetMassMatrix (start.mass, shape);
     }
 }
 
-ndFloat32 NewtonEngine::dGetElapsedSeconds()
+double NewtonEngine::getSeconds() const
 {
-    const ndFloat64 TICKS2SEC = 1.0e-6f;
-    ndUnsigned64 microseconds = ndGetTimeInMicroseconds();
-
-    ndFloat32 timeStep = ndFloat32 ((ndFloat64)(microseconds - m_prevTime) * TICKS2SEC);
-    m_prevTime = microseconds;
-
-    return timeStep;
-}
\ No newline at end of file
+    return std::chrono::duration<double> (std::chrono::steady_clock::now() - startTime).count();
+}
@@ -28,23 +28,62 @@ SOFTWARE.
 #include "PhysicsUtilities.h"
 #include "PhysicsContext.h"
 
+// Newton steps on its own thread at a fixed rate and publishes the body poses after
+// every step into a lock free triple buffer. The render thread picks up the latest
+// whole step in update(), so frame time is render time alone and nothing the
+// renderer reads is written while it reads it.
 class NewtonEngine
 {
  public:
     NewtonEngine();
     ~NewtonEngine();
 
-    // Updates physics simulation based on the engine state
-    bool update (PhysicsEngineState state);
-    void addBody (OptiXWeakNode weakNode, PhysicsEngineState engineState);
-    void addGeometryInstances (OptiXWeakNode instancedFrom, GeometryInstances& instances, PhysicsEngineState engineState);
+    // Called once a frame on the render thread. Hands the engine state to the physics
+    // thread and writes the latest published poses into the transform table, returns true if any moved
+    bool update (PhysicsEngineState state, wabi::TransformTable& transforms);
+
+    // queued for the physics thread, they're in the world by its next step.
+    // The nodes must already have their transform handles
+    void addBody (OptiXWeakNode weakNode);
+    void addGeometryInstances (OptiXWeakNode instancedFrom, GeometryInstances& instances);
+
+    // call before the renderer releases the node's transform handle. Its slot stops
+    // being written straight away, the body leaves the world on the physics thread
+    void removeBody (OptiXNode node);
+
+    int getWorkerThreadCount() const { return ctx->workerThreads; }
+
+    // blend the two latest steps instead of jumping from one to the next,
+    // the picture then runs up to one step behind the simulation
+    void setInterpolation (bool state) { interpolate = state; }
+
+    // moves smaller than this in any transform element aren't written, so they don't touch the IAS
+    void setTransformEpsilon (float epsilon) { transformEpsilon = epsilon; }
 
  private:
     PhysicsContextPtr ctx = nullptr;
 
-    ndFloat32 dGetElapsedSeconds();
-    void dResetTimer();
+    // physics thread
+    std::thread physicsThread;
+    std::atomic<bool> quit = false;
+    std::atomic<bool> running = false;
+    std::atomic<bool> resetRequested = false;
+    std::chrono::steady_clock::time_point startTime;
+    uint32_t generation = 0;
+    TransformSnapshot published; // the last step that went out, sent again as the next one's previous
+
+    // render thread
+    std::vector<wabi::TransformHandle> bodyTransforms; // by physicsIndex, INVALID_TRANSFORM for static bodies
+    std::vector<uint8_t> settled;                      // by physicsIndex, asleep and its final pose written
+    float lastBlend = 1.0f;
+    float transformEpsilon = 1.0e-5f;
+    bool interpolate = true;
+
+    BodyStart addSlot (OptiXNode node);
 
+    void physicsLoop();
+    void publishSnapshot (uint64_t step);
     void resetEngine();
+    double getSeconds() const;
 
 }; // end class NewtonEngine
@@ -3,9 +3,6 @@
 #include "NewtonCallbacks.h"
 #include "handlers/NewtonHandlers.h"
 
-#define MAX_PHYSICS_STEPS 1
-#define MAX_PHYSICS_FPS 60.0f
-
 // ctor
 NewtonWorld::NewtonWorld (PhysicsContextPtr ctx) :
     ndWorld(),
@@ -19,38 +16,13 @@ NewtonWorld::~NewtonWorld()
 {
 }
 
-double NewtonWorld::advanceTime (ndFloat32 timestep)
+void NewtonWorld::step()
 {
-    const ndFloat32 descreteStep = (1.0f / MAX_PHYSICS_FPS);
-
-    if (acceleratedUpdate)
-    {
-        Update (descreteStep);
-    }
-    else
-    {
-        ndInt32 maxSteps = MAX_PHYSICS_STEPS;
-        timeAccumulator += timestep;
-
-        // if the time step is more than max timestep par frame, throw away the extra steps.
-        if (timeAccumulator > descreteStep * (ndFloat32)maxSteps)
-        {
-            ndFloat32 steps = ndFloor (timeAccumulator / descreteStep) - (ndFloat32)maxSteps;
-            ndAssert (steps >= 0.0f);
-            timeAccumulator -= descreteStep * steps;
-        }
+    Update (getStepSize());
 
-        while (timeAccumulator > descreteStep)
-        {
-            Update (descreteStep);
-            timeAccumulator -= descreteStep;
-        }
-    }
-    if (ctx->synchronousPhysicsUpdate)
-    {
-        Sync();
-    }
-    return 0.0;
+    // Update() only starts the step on Newton's thread, wait for the
+    // transforms so the snapshot that gets published is a whole step
+    Sync();
 }
 
 void NewtonWorld::NormalUpdates()
@@ -70,5 +42,5 @@ void NewtonWorld::PreUpdate (ndFloat32 timestep)
 
 void NewtonWorld::PostUpdate (ndFloat32 timestep)
 {
-    ctx->handlers->body->onPostUpdate (timestep);
+    // bodies are added by the physics thread between steps, see NewtonBodyHandler::flushPending()
 }
@@ -27,20 +27,32 @@ SOFTWARE.
 #include "PhysicsUtilities.h"
 #include "PhysicsContext.h"
 
+// the physics thread steps at a fixed rate and runs at most
+// MAX_PHYSICS_STEPS back to back to catch up before dropping time
+#define MAX_PHYSICS_STEPS 1
+#define MAX_PHYSICS_FPS 60.0f
+
+// accelerated updates run this many steps in each fixed step's time
+#define ACCELERATED_PHYSICS_STEPS 4
+
 class NewtonWorld : public ndWorld
 {
  public:
     NewtonWorld (PhysicsContextPtr ctx);
     ~NewtonWorld();
 
-    double advanceTime (ndFloat32 timestep);
+    // one fixed step, returns when every body callback has run
+    void step();
+    ndFloat32 getStepSize() const { return 1.0f / MAX_PHYSICS_FPS; }
+
+    // accelerated updates run ahead of real time, ACCELERATED_PHYSICS_STEPS per fixed step
     void NormalUpdates();
     void AccelerateUpdates();
+    bool isAccelerated() const { return acceleratedUpdate; }
 
  private:
     PhysicsContextPtr ctx = nullptr;
-    ndFloat32 timeAccumulator = 0.0f;
-    bool acceleratedUpdate = false;
+    std::atomic<bool> acceleratedUpdate = false;
 
     void PreUpdate (ndFloat32 timestep) override;
     void PostUpdate (ndFloat32 timestep) override;
@@ -26,6 +26,7 @@ SOFTWARE.
 #include "sabi_core/sabi_core.h"
 #include <ndNewton.h>
 #include "../scene/RenderableNode.h"
+#include "TransformSnapshot.h"
 
 // Forward declaration and type alias for a shared_ptr to PhysicsContext
 using PhysicsContextPtr = std::shared_ptr<class PhysicsContext>;
@@ -34,11 +35,18 @@ using PhysicsContextPtr = std::shared_ptr<class PhysicsContext>;
 struct NewtonHandlers;
 class NewtonWorld;
 
-class PhysicsContext : public std::enable_shared_from_this<PhysicsContext>
+// what a body is added with and goes back to on reset. Copied from its node on the
+// render thread when the slot is handed out, so the physics thread never reads SpaceTime
+struct BodyStart
 {
- public:
-    using WeakNodes = std::vector<OptiXWeakNode>;
+    Pose pose = Pose::Identity();
+    Scale scale = Scale::Ones();
+    float mass = 0.0f;
+};
+using BodyStarts = std::vector<BodyStart, Eigen::aligned_allocator<BodyStart>>;
 
+class PhysicsContext : public std::enable_shared_from_this<PhysicsContext>
+{
  public:
     // Returns shared_ptr to this object
     PhysicsContextPtr getPtr() { return shared_from_this(); }
@@ -52,12 +60,23 @@ class PhysicsContext : public std::enable_shared_from_this<PhysicsContext>
     std::unique_ptr<NewtonHandlers> handlers = nullptr;
 
     std::unique_ptr<NewtonWorld> newtonWorld = nullptr;
-    bool synchronousPhysicsUpdate = false;
 
     int solverPasses = 4;
     int solverSubSteps = 2;
     int workerThreads = 10;
     ndWorld::ndSolverModes solverMode = ndWorld::ndSimdAvx2Solver;
 
-    WeakNodes weakNodes;
+    // the physics thread publishes into it after every step, the render thread reads the latest
+    TransformSnapshots snapshots;
+
+    // everything below belongs to the physics thread once it's running
+
+    // by physicsIndex, filled in as the queued bodies are added
+    BodyStarts bodyStarts;
+
+    // by physicsIndex, nullptr until the body is added and again once it's removed
+    std::vector<ndBodyDynamic*> bodies;
+
+    // the body callbacks write here during a step, each into its own slot
+    TransformSnapshot bodyPoses;
 };
@@ -0,0 +1,95 @@
+/*
+MIT License
+
+Copyright (c) 2023 Steve Hurley
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <mace_core/mace_core.h>
+
+// Body poses at the end of one physics step, indexed by OptiXRenderable::physicsIndex.
+// The physics thread fills one and publishes it through a TransformSnapshots
+// triple buffer, the render thread reads the latest complete one and never
+// sees a step half written.
+struct TransformSnapshot
+{
+    uint64_t step = 0;       // physics steps taken when it was published
+    uint32_t generation = 0; // bumped by every reset, poses don't blend across one
+    double time = 0.0;       // seconds on the physics thread's clock
+
+    std::vector<Eigen::Vector3f> positions;
+    std::vector<Eigen::Quaternionf, Eigen::aligned_allocator<Eigen::Quaternionf>> rotations;
+    std::vector<uint8_t> sleeping;
+
+    uint32_t size() const { return static_cast<uint32_t> (positions.size()); }
+
+    void resize (uint32_t bodyCount)
+    {
+        positions.resize (bodyCount, Eigen::Vector3f::Zero());
+        rotations.resize (bodyCount, Eigen::Quaternionf::Identity());
+        sleeping.resize (bodyCount, 0);
+    }
+
+    // copies the poses without giving up the capacity already there
+    void copyFrom (const TransformSnapshot& other)
+    {
+        step = other.step;
+        generation = other.generation;
+        time = other.time;
+        positions.assign (other.positions.begin(), other.positions.end());
+        rotations.assign (other.rotations.begin(), other.rotations.end());
+        sleeping.assign (other.sleeping.begin(), other.sleeping.end());
+    }
+
+    void setPose (uint32_t body, const Eigen::Affine3f& pose)
+    {
+        positions[body] = pose.translation();
+        rotations[body] = Eigen::Quaternionf (pose.rotation());
+    }
+
+    // blend of previous and this snapshot, t = 0 is previous, 1 is this one.
+    // bodies previous doesn't have yet snap to this snapshot
+    Eigen::Affine3f interpolate (const TransformSnapshot& previous, uint32_t body, float t) const
+    {
+        Eigen::Affine3f pose = Eigen::Affine3f::Identity();
+        if (body >= previous.size() || t >= 1.0f)
+        {
+            pose.translation() = positions[body];
+            pose.linear() = rotations[body].toRotationMatrix();
+            return pose;
+        }
+
+        pose.translation() = previous.positions[body] + t * (positions[body] - previous.positions[body]);
+        pose.linear() = previous.rotations[body].slerp (t, rotations[body]).toRotationMatrix();
+        return pose;
+    }
+};
+
+// a step and the one published just before it travel together, so the render
+// thread always blends two consecutive steps however many it missed in between
+struct TransformSteps
+{
+    TransformSnapshot previous;
+    TransformSnapshot latest;
+};
+
+using TransformSnapshots = mace::TripleBuffer<TransformSteps>;
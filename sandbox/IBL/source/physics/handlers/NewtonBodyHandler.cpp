@@ -1,8 +1,8 @@
-
 #include "NewtonBodyHandler.h"
 #include "NewtonHandlers.h"
 #include "../NewtonCallbacks.h"
 #include "../NewtonWorld.h"
+#include "../BodySpawner.h"
 
 // ctor
 NewtonBodyHandler::NewtonBodyHandler (PhysicsContextPtr ctx) :
@@ -15,76 +15,70 @@ NewtonBodyHandler::~NewtonBodyHandler()
 {
 }
 
-void NewtonBodyHandler::addBody (OptiXWeakNode weakNode, PhysicsEngineState engineState)
+void NewtonBodyHandler::addBody (OptiXWeakNode weakNode, const BodyStart& start)
 {
     if (weakNode.expired()) return;
 
-    // if the engine is running, bodies have to be added on Newton's thread
-    if (engineState == PhysicsEngineState::Running)
-        pendingAdds.enqueue (weakNode.lock());
-    else
-        addBodyToEngine (weakNode);
+    pendingAdds.enqueue (PendingBodies{GeometryInstances{weakNode.lock()}, BodyStarts{start}});
 }
 
-void NewtonBodyHandler::addGeometryInstances (OptiXWeakNode instancedFrom, GeometryInstances& instances, PhysicsEngineState engineState)
+void NewtonBodyHandler::addGeometryInstances (OptiXWeakNode instancedFrom, GeometryInstances& instances, const BodyStarts& starts)
 {
     if (instancedFrom.expired()) return;
 
-    OptiXNode fromNode = instancedFrom.lock();
-    ndBodyDynamic* const fromBody = static_cast<ndBodyDynamic*> (fromNode->getUserdata());
-
-    if (engineState != PhysicsEngineState::Running)
-    {
-        for (auto& node : instances)
-        {
-            ndMatrix startPose;
-            eigenToNewton (node->st.worldTransform, startPose);
-
-            ndShapeInstance shapeInst = fromBody->GetAsBodyKinematic()->GetCollisionShape();
-
-            // set the scale
-            Scale s = node->st.scale;
-            ndVector scale = ndVector (s.x(), s.y(), s.z(), 0.0f);
-            shapeInst.SetScale (scale);
+    // same queue as the bodies so an instance always comes after the body it was made from
+    if (!instances.empty())
+        pendingAdds.enqueue (PendingBodies{instances, starts});
+}
 
-            ndBodyDynamic* const body = new ndBodyDynamic();
-            body->SetCollisionShape (shapeInst);
-            body->SetMassMatrix (node->desc.mass, shapeInst);
-            node->setUserData (body);
-            body->SetMatrix (startPose);
+void NewtonBodyHandler::removeBody (uint32_t physicsIndex)
+{
+    pendingRemoves.enqueue (physicsIndex);
+}
 
-            body->SetNotifyCallback (new NewtonCallbacks (node));
+void NewtonBodyHandler::flushPending()
+{
+    TransformSnapshot& poses = ctx->bodyPoses;
 
-            ndSharedPtr<ndBody> bodyPtr (body);
-            ctx->newtonWorld->AddBody (bodyPtr);
-        }
-    }
-    else
+    PendingBodies pending;
+    while (pendingAdds.try_dequeue (pending))
     {
-        for (auto& node : instances)
+        const GeometryInstances& batch = pending.nodes;
+
+        // the slots start at the nodes' start poses so static bodies, which Newton
+        // never calls back for, and bodies that fail to add still show up where they were put
+        uint32_t slotCount = poses.size();
+        for (auto& node : batch)
+            slotCount = std::max (slotCount, node->physicsIndex + 1);
+        if (slotCount > poses.size())
+            poses.resize (slotCount);
+        if (slotCount > ctx->bodyStarts.size())
+            ctx->bodyStarts.resize (slotCount);
+
+        for (size_t i = 0; i < batch.size(); ++i)
         {
-            pendingGeometryInstances.enqueue (node);
+            uint32_t slot = batch[i]->physicsIndex;
+            ctx->bodyStarts[slot] = pending.starts[i];
+            poses.setPose (slot, pending.starts[i].pose);
+            poses.sleeping[slot] = 0;
         }
-    }
-}
 
-void NewtonBodyHandler::onPostUpdate (ndFloat32 timestep)
-{
-    while (pendingAdds.size_approx())
-    {
-        OptiXNode node;
-        bool found = pendingAdds.try_dequeue (node);
-        if (found)
-            addBodyToEngine (node);
+        try
+        {
+            if (batch.size() == 1 && !batch.front()->isInstance())
+                addBodyToEngine (batch.front());
+            else
+                spawnGeometryInstances (batch);
+        }
+        catch (std::exception& e)
+        {
+            LOG (CRITICAL) << e.what();
+        }
     }
 
-    while (pendingGeometryInstances.size_approx())
-    {
-        OptiXNode node;
-        bool found = pendingGeometryInstances.try_dequeue (node);
-        if (found)
-            addGeometryInstanceToEngine (node->instancedFrom, node);
-    }
+    uint32_t physicsIndex;
+    while (pendingRemoves.try_dequeue (physicsIndex))
+        removeFromWorld (physicsIndex);
 }
 
 void NewtonBodyHandler::addBodyToEngine (OptiXWeakNode weakNode)
@@ -92,28 +86,12 @@ void NewtonBodyHandler::addBodyToEngine (OptiXWeakNode weakNode)
     if (weakNode.expired()) return;
 
     OptiXNode node = weakNode.lock();
-    ndMatrix startPose;
-    eigenToNewton (node->st.worldTransform, startPose);
 
     ndShapeInstance shapeInst = ctx->handlers->ops->createCollisionShape (weakNode);
     if (shapeInst.GetShape() == nullptr)
         throw std::runtime_error ("Failed to create a collision shape for " + node->name);
 
-    // set the scale
-    Scale s = node->st.scale;
-    ndVector scale = ndVector (s.x(), s.y(), s.z(), 0.0f);
-    shapeInst.SetScale (scale);
-
-    ndBodyDynamic* const body = new ndBodyDynamic();
-    body->SetCollisionShape (shapeInst);
-    body->SetMassMatrix (node->desc.mass, shapeInst);
-    node->setUserData (body);
-    body->SetMatrix (startPose);
-
-    body->SetNotifyCallback (new NewtonCallbacks (node));
-
-    ndSharedPtr<ndBody> bodyPtr (body);
-    ctx->newtonWorld->AddBody (bodyPtr);
+    addToWorld (node, shapeInst);
 }
 
 void NewtonBodyHandler::addGeometryInstanceToEngine (OptiXWeakNode instanceFrom, OptiXWeakNode weakNode)
@@ -123,26 +101,102 @@ void NewtonBodyHandler::addGeometryInstanceToEngine (OptiXWeakNode instanceFrom,
     OptiXNode node = weakNode.lock();
     OptiXNode fromNode = instanceFrom.lock();
 
-    ndMatrix startPose;
-    eigenToNewton (node->st.worldTransform, startPose);
+    ndBodyDynamic* const fromBody = getBody (fromNode->physicsIndex);
+    if (!fromBody) return;
+
+    ndShapeInstance shapeInst = fromBody->GetAsBodyKinematic()->GetCollisionShape();
 
-    ndBodyDynamic* const fromBody = static_cast<ndBodyDynamic*> (fromNode->getUserdata());
+    addToWorld (node, shapeInst);
+}
+
+// a batch of instances of one node, their bodies are set up together and added in one pass
+void NewtonBodyHandler::spawnGeometryInstances (const GeometryInstances& instances)
+{
+    OptiXNode fromNode = instances.front()->instancedFrom.lock();
+    if (!fromNode) return;
+
+    ndBodyDynamic* const fromBody = getBody (fromNode->physicsIndex);
+    if (!fromBody) return;
+
+    // they share the shape when they share the scale and mass, the odd one out goes in on its own
+    const BodyStart& first = ctx->bodyStarts[instances.front()->physicsIndex];
+    const Scale scale = first.scale;
+    const float mass = first.mass;
+
+    GeometryInstances spawned;
+    std::vector<Pose, Eigen::aligned_allocator<Pose>> poses;
+    spawned.reserve (instances.size());
+    poses.reserve (instances.size());
+    for (auto& node : instances)
+    {
+        const BodyStart& start = ctx->bodyStarts[node->physicsIndex];
+        if (start.scale == scale && start.mass == mass)
+        {
+            spawned.push_back (node);
+            poses.push_back (start.pose);
+        }
+        else
+        {
+            addGeometryInstanceToEngine (fromNode, node);
+        }
+    }
 
     ndShapeInstance shapeInst = fromBody->GetAsBodyKinematic()->GetCollisionShape();
+    shapeInst.SetScale (ndVector (scale.x(), scale.y(), scale.z(), 0.0f));
+
+    std::vector<ndBodyDynamic*> bodies = BodySpawner::create (shapeInst, mass, poses.data(), static_cast<uint32_t> (poses.size()));
+    for (size_t i = 0; i < bodies.size(); ++i)
+    {
+        setBody (spawned[i]->physicsIndex, bodies[i]);
+        bodies[i]->SetNotifyCallback (new NewtonCallbacks (spawned[i], ctx.get()));
+    }
+
+    BodySpawner::commit (*ctx->newtonWorld, bodies);
+}
+
+void NewtonBodyHandler::addToWorld (OptiXNode node, ndShapeInstance& shapeInst)
+{
+    const BodyStart& start = ctx->bodyStarts[node->physicsIndex];
+
+    ndMatrix startPose;
+    eigenToNewton (start.pose, startPose);
 
     // set the scale
-    Scale s = node->st.scale;
+    const Scale& s = start.scale;
     ndVector scale = ndVector (s.x(), s.y(), s.z(), 0.0f);
     shapeInst.SetScale (scale);
 
     ndBodyDynamic* const body = new ndBodyDynamic();
     body->SetCollisionShape (shapeInst);
-    body->SetMassMatrix (node->desc.mass, shapeInst);
-    node->setUserData (body);
+    body->SetMassMatrix (start.mass, shapeInst);
+    setBody (node->physicsIndex, body);
     body->SetMatrix (startPose);
 
-    body->SetNotifyCallback (new NewtonCallbacks (node));
+    body->SetNotifyCallback (new NewtonCallbacks (node, ctx.get()));
 
     ndSharedPtr<ndBody> bodyPtr (body);
     ctx->newtonWorld->AddBody (bodyPtr);
 }
+
+void NewtonBodyHandler::removeFromWorld (uint32_t physicsIndex)
+{
+    ndBodyDynamic* const body = getBody (physicsIndex);
+    if (!body) return;
+
+    // Newton deletes it at the start of the next step, instances
+    // made from it keep their own copies of its collision shape
+    ctx->newtonWorld->RemoveBody (body);
+    ctx->bodies[physicsIndex] = nullptr;
+}
+
+ndBodyDynamic* NewtonBodyHandler::getBody (uint32_t physicsIndex) const
+{
+    return physicsIndex < ctx->bodies.size() ? ctx->bodies[physicsIndex] : nullptr;
+}
+
+void NewtonBodyHandler::setBody (uint32_t physicsIndex, ndBodyDynamic* body)
+{
+    if (physicsIndex >= ctx->bodies.size())
+        ctx->bodies.resize (physicsIndex + 1, nullptr);
+    ctx->bodies[physicsIndex] = body;
+}
@@ -40,23 +40,44 @@ class NewtonBodyHandler
     NewtonBodyHandler (PhysicsContextPtr ctx);
     ~NewtonBodyHandler();
 
-    void addBody (OptiXWeakNode weakNode, PhysicsEngineState engineState);
-    void addGeometryInstances (OptiXWeakNode instancedFrom, GeometryInstances& instances, PhysicsEngineState engineState);
+    // bodies are only queued here, the physics thread adds them to the world
+    // between steps in flushPending() so nothing else ever touches the world.
+    // The instances go in as one batch sharing their source's collision shape,
+    // each with the start state taken from its node when its slot was handed out
+    void addBody (OptiXWeakNode weakNode, const BodyStart& start);
+    void addGeometryInstances (OptiXWeakNode instancedFrom, GeometryInstances& instances, const BodyStarts& starts);
 
-    void onPostUpdate (ndFloat32 timestep);
+    // queued by slot, after the adds so a body added and removed in one frame still goes.
+    // Nothing here holds the node, so it's always let go of on the render thread
+    void removeBody (uint32_t physicsIndex);
+
+    void flushPending();
+
+    // nullptr for slots whose body isn't in the world, physics thread only
+    ndBodyDynamic* getBody (uint32_t physicsIndex) const;
 
  private:
     PhysicsContextPtr ctx = nullptr;
 
-    // must use thread safe containers when engine is running because Newton's
-    // thread may be popping while the addNewBody thread is pushing
-    RenderableStack pendingAdds;
-    RenderableStack pendingGeometryInstances;
+    struct PendingBodies
+    {
+        GeometryInstances nodes;
+        BodyStarts starts; // one per node
+    };
+
+    // must use thread safe containers because the physics thread
+    // may be popping while the main thread is pushing.
+    // One queue for bodies and batches keeps them in the order their slots were handed out
+    moodycamel::ConcurrentQueue<PendingBodies> pendingAdds;
     RenderableStack pendingPoses;
-    RenderableStack pendingRemoves;
+    moodycamel::ConcurrentQueue<uint32_t> pendingRemoves;
     RenderableStack pendingPropertyUpdates;
 
     void addBodyToEngine (OptiXWeakNode weakNode);
     void addGeometryInstanceToEngine (OptiXWeakNode instanceFrom, OptiXWeakNode weakNode);
+    void addToWorld (OptiXNode node, ndShapeInstance& shapeInst);
+    void removeFromWorld (uint32_t physicsIndex);
+    void setBody (uint32_t physicsIndex, ndBodyDynamic* body);
+    void spawnGeometryInstances (const GeometryInstances& instances);
 
 }; // end class NewtonBodyHandler
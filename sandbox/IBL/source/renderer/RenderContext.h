@@ -61,4 +61,16 @@ class RenderContext : public std::enable_shared_from_this<RenderContext>
 
     CameraHandle camera = nullptr;
     std::filesystem::path resourceFolder;
+
+    // binary cache of imported meshes, lives in resourceFolder/mesh_cache
+    sabi::MeshCache meshCache;
+
+    // decoded texture pixels shared by the ingest workers and the TextureHandler
+    mace::DecodedImageCacheRef decodedImages = mace::DecodedImageCache::create();
+
+    // prebuilt texture mip chains, lives in resourceFolder/mip_cache
+    std::filesystem::path mipCacheFolder;
+
+    // environment light importance distributions, lives in resourceFolder/env_cache
+    std::filesystem::path envCacheFolder;
 };
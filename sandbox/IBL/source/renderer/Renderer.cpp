@@ -30,6 +30,9 @@ void Renderer::init (const std::filesystem::path& resourceFolder)
         ctx->init();
 
         ctx->resourceFolder = resourceFolder;
+        ctx->meshCache = sabi::MeshCache (resourceFolder / "mesh_cache");
+        ctx->mipCacheFolder = resourceFolder / "mip_cache";
+        ctx->envCacheFolder = resourceFolder / "env_cache";
 
         // Initialize the random number generator
         rngBuffer.initialize (ctx->cuCtx, cudau::BufferType::Device, ctx->renderSize.x(), ctx->renderSize.y());
@@ -146,13 +149,9 @@ void Renderer::render()
 
 void Renderer::addSkyDomeImage (const OIIO::ImageBuf&& image)
 {
-    // FIXME
-    if (image.spec().nchannels != 3)
-    {
+    if (!ctx->handlers->skydome->addSkyDomeImage (std::move (image)))
         return;
-    }
 
-    ctx->handlers->skydome->addSkyDomeImage (std::move (image));
     plp.envLightTexture = ctx->handlers->skydome->getEviroTexture();
     ctx->handlers->skydome->getImportanceMap().getDeviceType (&plp.envLightImportanceMap);
 
@@ -160,7 +159,7 @@ void Renderer::addSkyDomeImage (const OIIO::ImageBuf&& image)
     CUDADRV_CHECK (cuMemcpyHtoD (plpOnDevice, &plp, sizeof (plp)));
 }
 
-void Renderer::addRenderableNode (OptiXNode node, const std::filesystem::path& path)
+void Renderer::addRenderableNode (OptiXNode node, const sabi::IngestJob& job)
 {
     MaterialInfo materialInfo;
     materialInfo.entryPoint = EntryPointType::pathtrace;
@@ -169,11 +168,10 @@ void Renderer::addRenderableNode (OptiXNode node, const std::filesystem::path& p
     materialInfo.rayTypeSearch = Shared::RayType_Search;
     materialInfo.rayTypeVisibility = Shared::RayType_Visibility;
 
-    node->g->fromFile (path);
-    if(hasObjExtension(path))
-        node->g->createObjGeometry (ctx, node->st, materialInfo);
-    if (hasGltfExtension (path))
-        node->g->createGltfGeometry (ctx, node->st, materialInfo);
+    if (hasObjExtension (job.path))
+        node->g->createObjGeometry (ctx, node->st, materialInfo, job);
+    if (hasGltfExtension (job.path))
+        node->g->createGltfGeometry (ctx, node->st, materialInfo, job);
 
     node->g->createGAS (ctx, Shared::NumRayTypes);
 
@@ -207,14 +205,29 @@ void Renderer::addRenderableGeometryInstances (OptiXNode instancedFrom, Geometry
     restartRender = true;
 }
 
-void Renderer::removeRenderableNode (const std::string& name)
+GeometryInstances Renderer::removeRenderableNode (const std::string& name)
+{
+    GeometryInstances removed = ctx->handlers->scene->removeNode (name, EntryPointType::pathtrace);
+
+    // Set the scene dependent SBT
+    ctx->handlers->pl->setSceneDependentSBT (EntryPointType::pathtrace);
+
+    restartRender = true;
+
+    return removed;
+}
+
+// clearing a scene, the IAS is rebuilt once rather than per node
+GeometryInstances Renderer::removeRenderableNodes (const std::vector<std::string>& names)
 {
-    ctx->handlers->scene->removeNode (name, EntryPointType::pathtrace);
+    GeometryInstances removed = ctx->handlers->scene->removeNodes (names, EntryPointType::pathtrace);
 
     // Set the scene dependent SBT
     ctx->handlers->pl->setSceneDependentSBT (EntryPointType::pathtrace);
 
     restartRender = true;
+
+    return removed;
 }
 
 void Renderer::updateMotion()
@@ -35,12 +35,26 @@ class Renderer
     void init (const std::filesystem::path& resourceFolder);
     void setCamera (CameraHandle camera);
 
-    void addRenderableNode (OptiXNode node, const std::filesystem::path& path);
+    // commit stage of the scene ingest, the job has already been through the CPU stages
+    void addRenderableNode (OptiXNode node, const sabi::IngestJob& job);
     void addRenderableGeometryInstances (OptiXNode instancedFrom, GeometryInstances& instances);
-    void removeRenderableNode (const std::string& name);
+
+    // a node's geometry instances are removed with it, returns every node that went
+    GeometryInstances removeRenderableNode (const std::string& name);
+    GeometryInstances removeRenderableNodes (const std::vector<std::string>& names);
+
     void addSkyDomeImage (const OIIO::ImageBuf&& image);
     void updateMotion();
 
+    // the world pose of every node, indexed by OptiXRenderable::transformHandle
+    wabi::TransformTable& getTransforms() { return ctx->handlers->scene->getTransforms(); }
+
+    // CPU query of the rendered scene, for selection
+    OptiXNode pick (wabi::Ray3f& ray) const { return ctx->handlers->scene->pick (ray); }
+
+    const sabi::MeshCache& getMeshCache() const { return ctx->meshCache; }
+    mace::DecodedImageCacheRef getDecodedImageCache() const { return ctx->decodedImages; }
+
     void render();
 
  private:
@@ -33,6 +33,12 @@ namespace Shared
 {
     static constexpr float probToSampleEnvLight = 0.25f;
 
+#if USE_ALIAS_TABLE_ENV_LIGHT
+    using EnvLightDistribution2D = shared::AliasRegularConstantContinuousDistribution2D;
+#else
+    using EnvLightDistribution2D = shared::RegularConstantContinuousDistribution2D;
+#endif
+
     enum RayType
     {
         RayType_Search = 0,
@@ -76,11 +82,13 @@ namespace Shared
     struct MaterialData
     {
         CUtexObject texture;
+        float texelCount; // base level width * height, for picking a mip level
         RGB albedo;
         bool isEmitter;
 
         MaterialData() :
             texture (0),
+            texelCount (0.0f),
             albedo (0.0f, 0.0f, 0.5f),
             isEmitter (false) {}
     };
@@ -112,7 +120,7 @@ namespace Shared
         float envLightPowerCoeff;
         float envLightRotation;
         shared::LightDistribution lightInstDist;
-        shared::RegularConstantContinuousDistribution2D envLightImportanceMap;
+        EnvLightDistribution2D envLightImportanceMap;
         CUtexObject envLightTexture;
     };
 
@@ -262,6 +262,37 @@ CUDA_DEVICE_FUNCTION CUDA_INLINE RGB performNextEventEstimation (
     return ret; // Return the final lighting contribution
 }
 
+// Ray cone texture level of detail, Akenine-Moller et al. 2019 "Texture Level of Detail
+// Strategies for Real-Time Ray Tracing". The cone spreads by one pixel's angle from
+// wherever this ray started, which is exact for camera rays and sharper than it
+// should be after a bounce.
+CUDA_DEVICE_FUNCTION CUDA_INLINE float computeTextureLod (
+    const Shared::GeometryData& geomInst, uint32_t primIndex,
+    float texelCount, float hitDistance, float cosTheta)
+{
+    const Triangle& tri = geomInst.triangleBuffer[primIndex];
+    const Vertex& v0 = geomInst.vertexBuffer[tri.index0];
+    const Vertex& v1 = geomInst.vertexBuffer[tri.index1];
+    const Vertex& v2 = geomInst.vertexBuffer[tri.index2];
+
+    const Point3D p0 = transformPointFromObjectToWorldSpace (v0.position);
+    const Point3D p1 = transformPointFromObjectToWorldSpace (v1.position);
+    const Point3D p2 = transformPointFromObjectToWorldSpace (v2.position);
+
+    // texels per unit of world space area on this triangle
+    float worldArea = length (cross (p1 - p0, p2 - p0));
+    float uvArea = std::fabs ((v1.texCoord.x - v0.texCoord.x) * (v2.texCoord.y - v0.texCoord.y) -
+                              (v2.texCoord.x - v0.texCoord.x) * (v1.texCoord.y - v0.texCoord.y));
+    if (worldArea <= 0.0f || uvArea <= 0.0f || texelCount <= 0.0f) return 0.0f;
+
+    float pixelSpread = std::atan (2.0f * std::tan (0.5f * plp.camera.fovY) / plp.imageSize.y);
+    float coneWidth = hitDistance * pixelSpread;
+
+    float lod = 0.5f * log2f (texelCount * uvArea / worldArea) +
+                log2f (coneWidth / std::fmax (std::fabs (cosTheta), 1e-3f));
+    return std::fmax (lod, 0.0f);
+}
+
 // This function calculates various attributes of a surface point
 // given its barycentric coordinates (b1, b2) and the index (primIndex)
 // of the triangle it belongs to. It computes the world-space position,
@@ -604,7 +635,11 @@ CUDA_DEVICE_KERNEL void RT_CH_NAME (shading)()
     // Fetch or calculate albedo
     RGB albedo;
     if (mat.texture)
-        albedo = RGB (getXYZ (tex2DLod<float4> (mat.texture, texCoord.x, texCoord.y, 0.0f)));
+    {
+        float lod = computeTextureLod (geom, hp.primIndex, mat.texelCount, optixGetRayTmax(),
+                                       dot (vOut, geometricNormalInWorld));
+        albedo = RGB (getXYZ (tex2DLod<float4> (mat.texture, texCoord.x, texCoord.y, lod)));
+    }
     else
         albedo = RGB (mat.albedo);
 
@@ -5,183 +5,178 @@ using Eigen::Vector2f;
 using sabi::MeshBuffers;
 using sabi::Surface;
 
+void OptiXGeometry::release (RenderContextPtr ctx)
+{
+    // nothing may reference the materials once they're gone
+    gasData.gas.destroy();
+    geomInst.destroy();
+
+    for (optixu::Material& material : materials)
+        ctx->handlers->mat->destroyMaterial<Shared::MaterialData> (material);
+    materials.clear();
+}
+
 template <typename VertexType, typename TriangleType, typename GeometryData>
-void OptiXTriangleMesh<VertexType, TriangleType, GeometryData>::createGltfGeometry (RenderContextPtr ctx, SpaceTime& st, const MaterialInfo& info)
+void OptiXTriangleMesh<VertexType, TriangleType, GeometryData>::createGltfGeometry (RenderContextPtr ctx, SpaceTime& st, const MaterialInfo& info, const sabi::IngestJob& job)
 {
-    if (!std::filesystem::exists (filePath.generic_string()))
-        throw std::runtime_error ("Load failed because file does not exist: " + filePath.generic_string());
+    if (!job.meshes)
+        throw std::runtime_error ("No meshes were loaded from: " + job.path.generic_string());
 
     geomInst = ctx->scene.createGeometryInstance();
+    cpuBVH = job.bvh;
+
+    // either mapped straight from the .nbmesh file or freshly imported
+    const sabi::MeshCacheViewRef& view = job.meshes;
+    const std::vector<sabi::MaterialRef>& materialRefs = view->getMaterials();
+    assert (job.images.size() == materialRefs.size());
+
+    // a node is one IAS instance over one GAS, so every placement of every mesh is
+    // baked into this one geometry instance with its transform. Each surface of a
+    // mesh gets a material slot and all of that mesh's placements share them
+    constexpr uint32_t NO_SLOT = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> firstSlot;
+    std::vector<int32_t> slotMaterialRefs;
+    size_t vertexCount = 0;
+    size_t triangleCount = 0;
+    for (const auto& mesh : view->getMeshes())
+    {
+        if (mesh.surfaces.empty()) continue;
 
-    sabi::GltfReader reader;
-    reader.read (filePath);
+        vertexCount += mesh.V.cols();
+        for (const auto& s : mesh.surfaces)
+            triangleCount += s.F.cols();
 
-    std::vector<MeshBuffers>& meshes = reader.getMeshes();
+        if (mesh.mesh >= firstSlot.size())
+            firstSlot.resize (mesh.mesh + 1, NO_SLOT);
+        if (firstSlot[mesh.mesh] != NO_SLOT) continue;
 
-    for (auto& mesh : meshes)
-    {
-        // calc the model bounding box
-        st.modelBound.min() = mesh.V.rowwise().minCoeff();
-        st.modelBound.max() = mesh.V.rowwise().maxCoeff();
-
-        Surface surf = mesh.surfaces[0];
-        MatrixXu F = surf.F;
-        MatrixXf N;  // vertex normals
-        MatrixXf FN; // face normals
-        generate_normals (F, mesh.V, N, FN);
-        assert (mesh.V.cols() == N.cols());
-
-         std::string name = filePath.stem().string();
-        if (name.find ("static") != 0 && name.find ("STATIC") != 0) // Case-insensitive check for "static" prefix
-        {
-            // clamp the largest dimension to 1.0f
-            float scale = 1.0f;
-            normalizeSize (st.modelBound, scale);
+        firstSlot[mesh.mesh] = static_cast<uint32_t> (slotMaterialRefs.size());
+        for (const auto& s : mesh.surfaces)
+            slotMaterialRefs.push_back (s.materialRef);
+    }
 
-            scale *= 0.5f;
+    if (!triangleCount)
+        throw std::runtime_error ("No triangles were loaded from: " + job.path.generic_string());
+    if (slotMaterialRefs.size() > std::numeric_limits<uint8_t>::max() + 1)
+        throw std::runtime_error ("Too many materials for one geometry in: " + job.path.generic_string());
 
-            // center vertices on origin
-            centerVertices (mesh.V, st.modelBound, scale);
-        }
+    // the cached vertices are read only so the placements, centering and
+    // scaling are applied while the OptiX vertices are built, the same way job.bvh was
+    st.modelBound = sabi::getPlacedBounds (*view);
+    Vector3f center;
+    float scale;
+    sabi::getModelPlacement (job.path, st.modelBound, center, scale);
 
-        // create OptiX triangles
-        std::vector<TriangleType> triangles;
-        triangles.reserve (F.cols());
-        for (int i = 0; i < F.cols(); ++i)
-        {
-            Vector3u tri = F.col (i);
-           // LOG (DBUG) << tri.x() << ", " << tri.y() << ", " << tri.z();
-            triangles.emplace_back (TriangleType (tri.x(), tri.y(), tri.z()));
-        }
+    std::vector<VertexType> vertices;
+    std::vector<TriangleType> triangles;
+    std::vector<uint8_t> materialIDs;
+    vertices.reserve (vertexCount);
+    triangles.reserve (triangleCount);
+    materialIDs.reserve (triangleCount);
+    for (const auto& mesh : view->getMeshes())
+    {
+        if (mesh.surfaces.empty()) continue;
+
+        const uint32_t baseVertex = static_cast<uint32_t> (vertices.size());
+        const Eigen::Matrix3f normalTransform = mesh.transform.linear().inverse().transpose();
+
+        // uvs are per mesh vertex and live on the first surface
+        const sabi::CachedSurface& surf = mesh.surfaces[0];
 
-        // create OptiX vertices
-        std::vector<VertexType> vertices;
-        vertices.reserve (mesh.V.cols());
         for (int i = 0; i < mesh.V.cols(); ++i)
         {
-            Vector3f v = mesh.V.col (i);
-            Vector3f n = N.col (i);
-            Vector2f uv = surf.uvs[i];
+            Vector3f v = (mesh.transform * Vector3f (mesh.V.col (i)) - center) * scale;
+            Vector3f n = (normalTransform * Vector3f (mesh.N.col (i))).normalized();
+            Vector2f uv = surf.UV.cols() ? Vector2f (surf.UV.col (i)) : Vector2f::Zero();
 
-            //LOG (DBUG) << uv.x() << ", " << uv.y();
             VertexType vertex;
             vertex.position = Point3D (v.x(), v.y(), v.z());
             vertex.normal = Normal3D (n.x(), n.y(), n.z());
             vertex.texCoord = Point2D (uv.x(), uv.y());
-           
 
             vertices.push_back (vertex);
         }
 
-        // initialize gpu buffers
-        triangleBuffer.initialize (ctx->cuCtx, cudau::BufferType::Device, triangles);
-        vertexBuffer.initialize (ctx->cuCtx, cudau::BufferType::Device, vertices);
-
-        GeometryData geomData = {};
-        geomData.vertexBuffer = vertexBuffer.getDevicePointer();
-        geomData.triangleBuffer = triangleBuffer.getDevicePointer();
-
-        geomInst.setVertexBuffer (vertexBuffer);
-        geomInst.setTriangleBuffer (triangleBuffer);
-        geomInst.setNumMaterials (1, optixu::BufferView());
-
-        std::filesystem::path materialFolder (filePath.parent_path());
-        optixu::Material mat = ctx->handlers->mat->createMaterial<Shared::MaterialData> (info, surf.material, materialFolder);
-        geomInst.setMaterial (0, 0, mat);
-
-        geomInst.setGeometryFlags (0, OPTIX_GEOMETRY_FLAG_NONE);
-        geomInst.setUserData (geomData);
+        for (size_t s = 0; s < mesh.surfaces.size(); ++s)
+        {
+            const auto& F = mesh.surfaces[s].F;
+            for (int i = 0; i < F.cols(); ++i)
+            {
+                Vector3u tri = F.col (i);
+                triangles.emplace_back (TriangleType (baseVertex + tri.x(), baseVertex + tri.y(), baseVertex + tri.z()));
+                materialIDs.push_back (static_cast<uint8_t> (firstSlot[mesh.mesh] + s));
+            }
+        }
     }
-}
 
+    // initialize gpu buffers
+    triangleBuffer.initialize (ctx->cuCtx, cudau::BufferType::Device, triangles);
+    vertexBuffer.initialize (ctx->cuCtx, cudau::BufferType::Device, vertices);
 
-template <typename VertexType, typename TriangleType, typename GeometryData>
-void OptiXTriangleMesh<VertexType, TriangleType, GeometryData>::createObjGeometry (RenderContextPtr ctx, SpaceTime& st, const MaterialInfo& info)
-{
-    if (!std::filesystem::exists (filePath.generic_string()))
-        throw std::runtime_error ("Load failed because file does not exist: " + filePath.generic_string());
-
-    geomInst = ctx->scene.createGeometryInstance();
-
-    // MaterialLibrary Load policy Optional lets it load a obj file without a material and not crash
-    MaterialLibrary ml = MaterialLibrary::Default (rapidobj::Load::Optional);
+    GeometryData geomData = {};
+    geomData.vertexBuffer = vertexBuffer.getDevicePointer();
+    geomData.triangleBuffer = triangleBuffer.getDevicePointer();
 
-    rapidobj::Result result = rapidobj::ParseFile (filePath.generic_string(), ml);
+    geomInst.setVertexBuffer (vertexBuffer);
+    geomInst.setTriangleBuffer (triangleBuffer);
 
-    if (result.error)
+    // only need an matIndexBuffer when there's more than 1 slot
+    uint32_t materialCount = static_cast<uint32_t> (slotMaterialRefs.size());
+    if (materialCount > 1)
     {
-        LOG (CRITICAL) << result.error.code.message();
-        throw std::runtime_error ("Load failed: " + filePath.generic_string());
+        matIndexBuffer.initialize (ctx->cuCtx, cudau::BufferType::Device, materialIDs);
+        geomInst.setNumMaterials (materialCount, matIndexBuffer, optixu::IndexSize::k1Byte);
     }
+    else
+        geomInst.setNumMaterials (1, optixu::BufferView());
 
-    rapidobj::Triangulate (result);
-    if (result.error)
+    for (uint32_t slot = 0; slot < materialCount; ++slot)
     {
-        LOG (CRITICAL) << result.error.code.message();
-        throw std::runtime_error ("triangulation failed: " + filePath.generic_string());
+        int32_t ref = slotMaterialRefs[slot];
+
+        optixu::Material mat;
+        if (ref >= 0 && ref < materialRefs.size())
+            mat = ctx->handlers->mat->createMaterial<Shared::MaterialData> (info, materialRefs[ref], job.images[ref]);
+        else
+            mat = ctx->handlers->mat->createDefaultMaterial<Shared::MaterialData> (info);
+        geomInst.setMaterial (0, slot, mat);
+        materials.push_back (mat);
     }
 
-    // get vertex and triangle counts and fill in
-    // the set of unique vertex indices
-    std::unordered_set<int> unique_vertices;
-    std::unordered_set<int> unique_uvs;
-    uint32_t vertexCount, triangleCount;
-    std::tie (vertexCount, triangleCount) = getTotalVertexAndTriangleCounts (result, unique_vertices, unique_uvs);
-
-    std::vector<int32_t> triangleIndices;
-    triangleIndices.reserve (triangleCount * 3);
-    getTriangleIndices (result, triangleIndices);
-
-    uint32_t elementCount = triangleIndices.size();
-    uint32_t tris = elementCount / 3;
-    assert (tris == triangleCount);
-
-    MatrixXu F; // faces (triangles in this case)
-    F.resize (3, triangleCount);
-    std::memcpy (F.data(), triangleIndices.data(), elementCount * sizeof (int));
-
-    MatrixXf V; // vertex positions
-    V.resize (3, vertexCount);
-    getVertexPositions (result, V, unique_vertices);
+    geomInst.setGeometryFlags (0, OPTIX_GEOMETRY_FLAG_NONE);
+    geomInst.setUserData (geomData);
+}
 
-    // calc the model bounding box
-    st.modelBound.min() = V.rowwise().minCoeff();
-    st.modelBound.max() = V.rowwise().maxCoeff();
+template <typename VertexType, typename TriangleType, typename GeometryData>
+void OptiXTriangleMesh<VertexType, TriangleType, GeometryData>::createObjGeometry (RenderContextPtr ctx, SpaceTime& st, const MaterialInfo& info, const sabi::IngestJob& job)
+{
+    if (!job.meshes)
+        throw std::runtime_error ("No meshes were loaded from: " + job.path.generic_string());
 
-    MatrixXf N;  // vertex normals
-    MatrixXf FN; // face normals
-    generate_normals (F, V, N, FN);
+    geomInst = ctx->scene.createGeometryInstance();
+    cpuBVH = job.bvh;
+
+    // either mapped straight from the .nbmesh file or freshly imported
+    const sabi::MeshCacheViewRef& view = job.meshes;
+
+    const sabi::CachedMesh& mesh = view->getMeshes()[0];
+    const sabi::CachedSurface& surf = mesh.surfaces[0];
+    const auto& F = surf.F; // faces (triangles in this case)
+    const auto& V = mesh.V; // vertex positions
+    const auto& N = mesh.N; // vertex normals
+    uint32_t vertexCount = V.cols();
+    uint32_t triangleCount = F.cols();
     assert (V.cols() == N.cols());
 
-    MatrixXf UV;
-    if (unique_uvs.size() == vertexCount)
-    {
-        UV.resize (2, unique_uvs.size());
-        getUVs (result, UV, unique_uvs);
-    }
-    else
-    {
-        // else fill with Vector::Zero
-        UV.resize (2, vertexCount);
-        for (int i = 0; i < vertexCount; ++i)
-        {
-            UV.col (i) = Vector2f::Zero();
-        }
-    }
-
-    // normalize and center dyanmic bodies only
-    std::string name = filePath.stem().string();
-    if (name.find ("static") != 0 && name.find ("STATIC") != 0) // Case-insensitive check for "static" prefix
-    {
-        // clamp the largest dimension to 1.0f
-        float scale = 1.0f;
-        normalizeSize (st.modelBound, scale);
+    // the model bounding box was computed when the mesh was cached
+    st.modelBound = mesh.bounds;
 
-        scale *= 0.5f;
+    // the cached vertices are read only so centering and scaling
+    // is applied while the OptiX vertices are built, the same way job.bvh was
+    Vector3f center;
+    float scale;
+    sabi::getModelPlacement (job.path, st.modelBound, center, scale);
 
-        // center vertices on origin
-        centerVertices (V, st.modelBound, scale);
-    }
     // create OptiX triangles
     std::vector<TriangleType> triangles;
     triangles.reserve (F.cols());
@@ -196,9 +191,9 @@ void OptiXTriangleMesh<VertexType, TriangleType, GeometryData>::createObjGeometr
     vertices.reserve (V.cols());
     for (int i = 0; i < vertexCount; ++i)
     {
-        Vector3f v = V.col (i);
+        Vector3f v = (Vector3f (V.col (i)) - center) * scale;
         Vector3f n = N.col (i);
-        Vector2f uv = UV.col (i);
+        Vector2f uv = surf.UV.cols() ? Vector2f (surf.UV.col (i)) : Vector2f::Zero();
 
         VertexType vertex;
         vertex.position = Point3D(v.x(), v.y(), v.z());
@@ -212,48 +207,25 @@ void OptiXTriangleMesh<VertexType, TriangleType, GeometryData>::createObjGeometr
     triangleBuffer.initialize (ctx->cuCtx, cudau::BufferType::Device, triangles);
     vertexBuffer.initialize (ctx->cuCtx, cudau::BufferType::Device, vertices);
 
-    // generate material list, 1 materialID per triangle
-    std::vector<uint8_t> materialIDs (triangleCount);
-    getMaterialIdList (result, materialIDs);
-
-    // 1 material ID per triangle
-    assert (F.cols() == materialIDs.size());
+    // materials are stored in material id order so the
+    // per triangle ids index straight into them
+    const std::vector<sabi::MaterialRef>& materialRefs = view->getMaterials();
+    assert (job.images.size() == materialRefs.size());
+    uint32_t materialCount = materialRefs.size() ? materialRefs.size() : 1;
 
-    // find the number of unique materials
-    std::unordered_set<int> uniqueMaterials;
-    uint32_t materialCount = 0;
-    for (const auto& id : materialIDs)
-    {
-        if (uniqueMaterials.insert (id).second)
-        {
-            ++materialCount;
-        }
-    }
+    materials.clear();
+    materials.reserve (materialCount);
 
     // looks like a bug in RapidObj that results.materials doesn't get filled in
-    if (result.materials.size() == 0)
-        materialCount = 1;
-
-    std::vector<optixu::Material> materials;
-    if (materialCount > 1)
-    {
-        materials.reserve (materialCount);
-    }
-
-    if (result.materials.size() == 0)
+    if (materialRefs.size() == 0)
     {
-        materialCount = 1;
         materials.push_back (ctx->handlers->mat->createDefaultMaterial<Shared::MaterialData> (info));
     }
     else
     {
-        // td::filesystem::path parentDir = filePath.parent_path();
-        std::filesystem::path materialFolder (filePath.parent_path());
-        for (auto& id : uniqueMaterials)
-        {
-            if (id >= 0 && id < result.materials.size())
-                materials.push_back (ctx->handlers->mat->createMaterial<Shared::MaterialData> (info, result.materials[id], materialFolder));
-        }
+        // textures were decoded by the ingest materials stage
+        for (size_t i = 0; i < materialRefs.size(); ++i)
+            materials.push_back (ctx->handlers->mat->createMaterial<Shared::MaterialData> (info, materialRefs[i], job.images[i]));
     }
 
     GeometryData geomData = {};
@@ -264,15 +236,20 @@ void OptiXTriangleMesh<VertexType, TriangleType, GeometryData>::createObjGeometr
     geomInst.setTriangleBuffer (triangleBuffer);
 
     // only need an matIndexBuffer when there's more than 1 material
-    if (materialCount > 1)
+    if (materialCount > 1 && surf.materialIDs)
     {
+        // 1 material ID per triangle
+        std::vector<uint8_t> materialIDs (surf.materialIDs, surf.materialIDs + triangleCount);
         matIndexBuffer.initialize (ctx->cuCtx, cudau::BufferType::Device, materialIDs);
         geomInst.setNumMaterials (materialCount, matIndexBuffer, optixu::IndexSize::k1Byte);
     }
     else
+    {
+        materialCount = 1;
         geomInst.setNumMaterials (1, optixu::BufferView());
+    }
 
-    for (int i = 0; i < materials.size(); ++i)
+    for (int i = 0; i < materialCount; ++i)
     {
         geomInst.setMaterial (0, i, materials[i]);
     }
@@ -281,7 +258,6 @@ void OptiXTriangleMesh<VertexType, TriangleType, GeometryData>::createObjGeometr
     geomInst.setUserData (geomData);
 }
 
-
 template <typename VertexType, typename TriangleType, typename GeometryData>
 void OptiXTriangleMesh<VertexType, TriangleType, GeometryData>::extractVertexPositions (MatrixXf& V)
 {
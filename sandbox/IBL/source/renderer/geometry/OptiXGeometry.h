@@ -42,11 +42,9 @@ class OptiXGeometry
     }
 
     // Virtual functions requiring implementation
-    virtual void createGltfGeometry (RenderContextPtr ctx, SpaceTime& st, const MaterialInfo& info) {}
-    virtual void createObjGeometry (RenderContextPtr ctx, SpaceTime& st, const MaterialInfo& info) {}
-
-    // Some geometry can be parsed from a file
-    virtual void fromFile (const std::filesystem::path& path) {}
+    // build from a job that has been through the CPU ingest stages
+    virtual void createGltfGeometry (RenderContextPtr ctx, SpaceTime& st, const MaterialInfo& info, const sabi::IngestJob& job) {}
+    virtual void createObjGeometry (RenderContextPtr ctx, SpaceTime& st, const MaterialInfo& info, const sabi::IngestJob& job) {}
 
     virtual void extractVertexPositions (MatrixXf& V) {}
     virtual void extractTriangleIndices (MatrixXu& F) {}
@@ -72,10 +70,19 @@ class OptiXGeometry
 
     GAS& getGAS() { return gasData; }
 
+    // frees the GAS, the geometry instance and the materials, giving their
+    // textures back. Only once the node is out of the scene
+    void release (RenderContextPtr ctx);
+
+    // CPU copy of the GAS for picking and raycasts, built by the ingest
+    // process stage from the host meshes and shared by every instance
+    const wabi::TriangleBVHRef& getBVH() const { return cpuBVH; }
+
  protected:
     GAS gasData;
-    std::filesystem::path filePath;
+    wabi::TriangleBVHRef cpuBVH = nullptr;
     optixu::GeometryInstance geomInst;
+    std::vector<optixu::Material> materials;
     cudau::TypedBuffer<uint8_t> matIndexBuffer;
 };
 
@@ -94,9 +101,8 @@ class OptiXTriangleMesh : public OptiXGeometry
         vertexBuffer.finalize();
     }
 
-    void createGltfGeometry (RenderContextPtr ctx, SpaceTime& st, const MaterialInfo& info) override;
-    void createObjGeometry (RenderContextPtr ctx, SpaceTime& st, const MaterialInfo& info) override;
-    void fromFile (const std::filesystem::path& path) override { filePath = path; }
+    void createGltfGeometry (RenderContextPtr ctx, SpaceTime& st, const MaterialInfo& info, const sabi::IngestJob& job) override;
+    void createObjGeometry (RenderContextPtr ctx, SpaceTime& st, const MaterialInfo& info, const sabi::IngestJob& job) override;
     void extractVertexPositions (MatrixXf& V) override;
     void extractTriangleIndices (MatrixXu& F) override;
 
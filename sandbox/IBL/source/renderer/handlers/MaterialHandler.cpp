@@ -33,17 +33,10 @@ optixu::Material MaterialHandler::createMaterial (const MaterialInfo& info, rapi
     MaterialData data = {};
     if (material.diffuse_texname != "")
     {
-        std::filesystem::path imagePath (material.diffuse_texname);
-        if (imagePath.is_absolute())
-        {
-            data.texture = ctx->handlers->texture->createCudaTextureFromImage (imagePath);
-        }
-        else
-        {
-            auto fullPath = FileServices::findFileInFolder (materialFolder, material.diffuse_texname);
-            if (fullPath)
-                data.texture = ctx->handlers->texture->createCudaTextureFromImage (fullPath.value());
-        }
+        auto fullPath = sabi::resolveTexturePath (material.diffuse_texname, materialFolder);
+        if (fullPath)
+            data.texture = ctx->handlers->texture->createCudaTextureFromImage (fullPath.value());
+        data.texelCount = ctx->handlers->texture->getTexelCount (data.texture);
     }
 
     data.albedo = RGB (sRGB_degamma_s (material.diffuse[0]), sRGB_degamma_s (material.diffuse[1]), sRGB_degamma_s (material.diffuse[2]));
@@ -76,23 +69,10 @@ optixu::Material MaterialHandler::createMaterial (const MaterialInfo& info, cons
     MaterialData data = {};
     if (material.has_pbr_metallic_roughness && pbr.base_color_texture.texture)
     {
-        
-        std::string textureName = pbr.base_color_texture.texture->image->uri;
-        
-        std::filesystem::path imagePath (textureName);
-        if (imagePath.is_absolute())
-        {
-            data.texture = ctx->handlers->texture->createCudaTextureFromImage (imagePath);
-        }
-        else
-        {
-            
-            std::filesystem::path p (textureName);
-
-            auto fullPath = FileServices::findFileInFolder (materialFolder, p.filename().string());
-            if (fullPath)
-                data.texture = ctx->handlers->texture->createCudaTextureFromImage (fullPath.value());
-        }
+        auto fullPath = sabi::resolveTexturePath (pbr.base_color_texture.texture->image->uri, materialFolder);
+        if (fullPath)
+            data.texture = ctx->handlers->texture->createCudaTextureFromImage (fullPath.value());
+        data.texelCount = ctx->handlers->texture->getTexelCount (data.texture);
     }
     data.albedo = RGB (sRGB_degamma_s (1.0f), sRGB_degamma_s (0.5f), sRGB_degamma_s (0.0f));
 
@@ -101,6 +81,43 @@ optixu::Material MaterialHandler::createMaterial (const MaterialInfo& info, cons
     return mat;
 }
 
+template <typename MaterialData>
+optixu::Material MaterialHandler::createMaterial (const MaterialInfo& info, const sabi::MaterialRef& material, const mace::DecodedImageRef& texture)
+{
+    // Retrieve pipeline using entry point type from the MaterialInfo struct.
+    auto pl = ctx->handlers->pl->getPipeline (info.entryPoint);
+
+    // Create a new Optix material.
+    optixu::Material mat = ctx->optCtx.createMaterial();
+
+    // Maybe set hit group for shading
+    if (info.shadingProg != ProgramType::Invalid && info.rayTypeSearch != INVALID_RAY_TYPE)
+        mat.setHitGroup (info.rayTypeSearch, pl->hitPrograms[info.shadingProg]);
+
+    // Maybe set hit group for visibility
+    if (info.visibilityProg != ProgramType::Invalid && info.rayTypeVisibility != INVALID_RAY_TYPE)
+        mat.setHitGroup (info.rayTypeVisibility, pl->hitPrograms[info.visibilityProg]);
+
+    MaterialData data = {};
+    if (texture)
+    {
+        data.texture = ctx->handlers->texture->acquireTexture (texture);
+        data.texelCount = ctx->handlers->texture->getTexelCount (data.texture);
+    }
+
+    // glTF factors are linear already, only MTL colours need decoding
+    const Eigen::Vector3f& diffuse = material.diffuse;
+    if (material.linearDiffuse)
+        data.albedo = RGB (diffuse.x(), diffuse.y(), diffuse.z());
+    else
+        data.albedo = RGB (sRGB_degamma_s (diffuse.x()), sRGB_degamma_s (diffuse.y()), sRGB_degamma_s (diffuse.z()));
+
+    // Set user data on the Optix material.
+    mat.setUserData (data);
+
+    return mat;
+}
+
 template <typename MaterialData>
 optixu::Material MaterialHandler::createDefaultMaterial (const MaterialInfo& info)
 {
@@ -127,6 +144,21 @@ optixu::Material MaterialHandler::createDefaultMaterial (const MaterialInfo& inf
     return mat;
 }
 
+template <typename MaterialData>
+void MaterialHandler::destroyMaterial (optixu::Material& material)
+{
+    if (!material) return;
+
+    MaterialData data = {};
+    material.getUserData (&data);
+    if (data.texture)
+        ctx->handlers->texture->releaseTexture (data.texture);
+
+    material.destroy();
+}
+
 template optixu::Material MaterialHandler::createMaterial<Shared::MaterialData> (const MaterialInfo&, rapidobj::Material&, const std::filesystem::path&);
 template optixu::Material MaterialHandler::createMaterial<Shared::MaterialData> (const MaterialInfo&, const cgltf_material& material, const std::filesystem::path&);
-template optixu::Material MaterialHandler::createDefaultMaterial<Shared::MaterialData> (const MaterialInfo&);
\ No newline at end of file
+template optixu::Material MaterialHandler::createMaterial<Shared::MaterialData> (const MaterialInfo&, const sabi::MaterialRef&, const mace::DecodedImageRef&);
+template optixu::Material MaterialHandler::createDefaultMaterial<Shared::MaterialData> (const MaterialInfo&);
+template void MaterialHandler::destroyMaterial<Shared::MaterialData> (optixu::Material&);
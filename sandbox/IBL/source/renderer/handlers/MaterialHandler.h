@@ -43,9 +43,18 @@ class MaterialHandler
     template <typename MaterialData>
     optixu::Material createMaterial (const MaterialInfo& info, const cgltf_material& material, const std::filesystem::path& materialFolder);
 
+    // for materials coming out of the mesh cache, texture is the already decoded
+    // base color image or nullptr
+    template <typename MaterialData>
+    optixu::Material createMaterial (const MaterialInfo& info, const sabi::MaterialRef& material, const mace::DecodedImageRef& texture);
+
     template <typename MaterialData>
     optixu::Material createDefaultMaterial (const MaterialInfo& info);
 
+    // gives the material's texture back to the TextureHandler and destroys it
+    template <typename MaterialData>
+    void destroyMaterial (optixu::Material& material);
+
  private:
     RenderContextPtr ctx = nullptr;
 };
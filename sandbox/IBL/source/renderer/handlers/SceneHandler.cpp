@@ -11,7 +11,12 @@ SceneHandler::~SceneHandler()
 {
     LOG (DBUG) << _FN_;
 
-    // clear the nodes map which will destroy all optixu::Instances
+    // the registry owns the optixu::Instances, the nodes only hold handles
+    for (optixu::Instance& instance : iasSlots)
+        instance.destroy();
+    iasSlots.clear();
+    instances.clear();
+    instanceSources.clear();
     nodes.clear();
 
     if (travHandle != 0)
@@ -31,8 +36,9 @@ void SceneHandler::init()
     // Create Instance Acceleration Structure (IAS)
     ias = ctx->scene.createInstanceAccelerationStructure();
 
-    // Set the trade-off for the IAS to prefer fast trace
-    ias.setConfiguration (optixu::ASTradeoff::PreferFastTrace);
+    // Set the trade-off for the IAS to prefer fast trace, moving
+    // instances refit the IAS rather than rebuilding it
+    ias.setConfiguration (optixu::ASTradeoff::PreferFastTrace, optixu::AllowUpdate::Yes);
 }
 
 // Create and add an instance to the scene
@@ -41,30 +47,11 @@ void SceneHandler::createInstance (OptiXNode node, EntryPointType type)
     if (travHandle == 0)
         init();
 
-    // Create a new OptiX instance
-    optixu::Instance instance = ctx->scene.createInstance();
-
-    // Set the Geometry Acceleration Structure (GAS)
-    instance.setChild (node->g->getGAS().gas);
-
-    // Set the instance transform using the given pose
-    const Eigen::Matrix4f& m = node->st.worldTransform.matrix();
-    MatrixRowMajor34f t = m.block<3, 4> (0, 0);
-    instance.setTransform (t.data());
-
-    // Add the instance to the IAS
-    ias.addChild (instance);
-
-    node->instance = instance;
-    node->iasIndex = ias.findChildIndex (instance);
-
-    nodes[node->name] = node;
+    addInstance (node, node->g->getGAS().gas, node->g->getBVH());
 
     GAS& gasData = node->g->getGAS();
     gasData.gas.rebuild (ctx->cuStr, gasData.gasMem, ctx->asBuildScratchMem);
 
-    prepareForBuild();
-
     rebuild (type);
 }
 
@@ -74,89 +61,170 @@ void SceneHandler::createGeometryInstances (GeometryInstances& instances, EntryP
     {
         if (node->instancedFrom.expired()) continue;
 
+        // every instance shares the GAS and BLAS of the node it came from
         OptiXNode instancedFrom = node->instancedFrom.lock();
+        addInstance (node, instancedFrom->g->getGAS().gas, instancedFrom->g->getBVH());
+        instanceSources.addInstance (instancedFrom->name, node->name);
+    }
 
-        // Create a new OptiX instance
-        optixu::Instance instance = ctx->scene.createInstance();
+    rebuild (type);
+}
+
+GeometryInstances SceneHandler::removeNodes (const std::vector<std::string>& nodeNames, EntryPointType type)
+{
+    GeometryInstances removed;
+    for (const std::string& name : nodeNames)
+    {
+        auto it = nodes.find (name);
+        if (it == nodes.end()) continue;
 
-        // Set the Geometry Acceleration Structure (GAS)
-        // using  the instancedFrom node
-        instance.setChild (instancedFrom->g->getGAS().gas);
+        removeNode (it->second, removed);
+    }
 
-        // Set the instance transform using the given pose
-        const Eigen::Matrix4f& m = node->st.worldTransform.matrix();
-        MatrixRowMajor34f t = m.block<3, 4> (0, 0);
-        instance.setTransform (t.data());
+    // one rebuild however many went
+    if (!removed.empty())
+        rebuild (type);
 
-        // Add the instance to the IAS
-        ias.addChild (instance);
+    return removed;
+}
 
-        node->instance = instance;
-        node->iasIndex = ias.findChildIndex (instance);
+void SceneHandler::addInstance (OptiXNode node, optixu::GeometryAccelerationStructure gas, const wabi::TriangleBVHRef& blas)
+{
+    // Create a new OptiX instance and add it to the IAS,
+    // its child index is the registry's dense index
+    optixu::Instance instance = ctx->scene.createInstance();
+    instance.setChild (gas);
+    ias.addChild (instance);
+    iasSlots.push_back (instance);
 
-        nodes[node->name] = node;
-    }
+    nodes[node->name] = node;
 
-    prepareForBuild();
+    addToCpuScene (node, blas);
+    addTransform (node, instance);
 
-    rebuild (type);
+    node->instanceHandle = instances.insert (InstanceEntry{gas, node->transformHandle});
 }
 
-void SceneHandler::removeNode (OptiXNode node)
+void SceneHandler::removeNode (OptiXNode node, GeometryInstances& removed)
+{
+    // the instances go first, the source last so nothing
+    // in the IAS still points at its GAS once it's released
+    for (const std::string& name : instanceSources.remove (node->name))
+    {
+        auto it = nodes.find (name);
+        if (it == nodes.end()) continue;
+
+        removed.push_back (it->second);
+        removeInstance (it->second);
+    }
+}
+
+void SceneHandler::removeInstance (OptiXNode node)
 {
     auto it = nodes.find (node->name);
     if (it == nodes.end()) return;
 
-    optixu::Instance instance = ias.getChild (node->iasIndex);
+    // the last entry is swapped into the hole, it's the only one whose IAS index changes.
+    // IAS children can only be erased, so rather than moving the last child the
+    // instance already sitting in the hole takes on what the last one showed
+    uint32_t moved = instances.erase (node->instanceHandle);
+    if (moved != mace::SlotMap<InstanceEntry>::npos)
+    {
+        const InstanceEntry& entry = instances.at (moved);
+        optixu::Instance& instance = iasSlots[moved];
+        instance.setChild (entry.gas);
+        instance.setTransform (transforms.data (entry.transformHandle));
+        transformTargets[entry.transformHandle].instance = instance;
+    }
+
+    // erasing the last child doesn't shift any others
+    uint32_t last = static_cast<uint32_t> (iasSlots.size()) - 1;
+    ias.removeChildAt (last);
+    iasSlots[last].destroy();
+    iasSlots.pop_back();
 
-    // this might change the iasIndex
-    // of other nodes
-    ias.removeChildAt (node->iasIndex);
+    cpuScene.removeInstance (node->cpuIndex);
+    cpuNodes[node->cpuIndex].reset();
+
+    transforms.release (node->transformHandle);
+    transformTargets[node->transformHandle] = TransformTarget();
+    node->transformHandle = wabi::INVALID_TRANSFORM;
+    node->instanceHandle = mace::SlotHandle();
+
+    // instances only borrow the GAS, the node that owns the geometry hands its
+    // materials and textures back, by now none of its instances are left
+    if (node->g)
+        node->g->release (ctx);
 
     // remove this node from the nodes map and the
-    // reference counted node will self destruct, cleaning
-    // up it's geometry and destroying it's instance
+    // reference counted node will self destruct,
+    // cleaning up it's geometry
     nodes.erase (it);
+}
 
-    // update the iasIndex of remaining nodes because
-    // the index might have changed
-    for (auto it : nodes)
+// what InstanceUpdateTracker drives, the optixu IAS and the CPU picking scene side by side
+struct SceneHandler::IASBackend
+{
+    SceneHandler& scene;
+
+    void setTransforms (const wabi::TransformHandle* handles, uint32_t count, const wabi::TransformTable& transforms)
     {
-        auto node = it.second;
-        if (!node) continue;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            TransformTarget& target = scene.transformTargets[handles[i]];
+            target.instance.setTransform (transforms.data (handles[i]));
+            scene.cpuScene.setTransform (target.cpuIndex, transforms.getPose (handles[i]));
+        }
+    }
 
-        node->iasIndex = ias.findChildIndex (node->instance);
+    // only the transforms changed so both trees keep their shape
+    void update()
+    {
+        scene.cpuScene.refit();
+        scene.ias.update (scene.ctx->cuStr, scene.ctx->asBuildScratchMem);
     }
-}
+
+    void rebuild()
+    {
+        scene.cpuScene.build();
+        scene.prepareForBuild();
+        scene.rebuildIAS();
+    }
+};
 
 bool SceneHandler::updateMotion()
 {
-    bool restartRender = false;
-    uint32_t bodyCount = nodes.size();
+    if (travHandle == 0) return false;
 
-    if (!bodyCount) return restartRender;
-    uint32_t bodiesSleeping = 0;
+    IASBackend backend{*this};
+    return updates.flush (transforms, backend) != wabi::ASOperation::None;
+}
 
-    for (auto& it : nodes)
-    {
-        OptiXNode node = it.second;
+OptiXNode SceneHandler::pick (wabi::Ray3f& ray) const
+{
+    if (!cpuScene.intersect (ray)) return nullptr;
 
-        // Set the instance transform using the given pose
-        const Eigen::Matrix4f& m = node->st.worldTransform.matrix();
-        MatrixRowMajor34f t = m.block<3, 4> (0, 0);
-        node->instance.setTransform (t.data());
+    return cpuNodes[ray.hitBodyID].lock();
+}
 
-        if (node->desc.sleepState)
-            ++bodiesSleeping;
-    }
+void SceneHandler::addToCpuScene (OptiXNode node, const wabi::TriangleBVHRef& blas)
+{
+    node->cpuIndex = cpuScene.addInstance (blas, node->st.worldTransform);
+    if (node->cpuIndex >= cpuNodes.size())
+        cpuNodes.resize (node->cpuIndex + 1);
+    cpuNodes[node->cpuIndex] = node;
+}
 
-    if (bodiesSleeping < bodyCount)
-    {
-        rebuildIAS();
-        restartRender = true;
-    }
+// the node's pose moves into the transform table, from here on that's where it's read and written
+void SceneHandler::addTransform (OptiXNode node, optixu::Instance instance)
+{
+    wabi::TransformHandle handle = transforms.allocate (node->st.worldTransform);
+    node->transformHandle = handle;
+    instance.setTransform (transforms.data (handle));
 
-    return restartRender;
+    if (handle >= transformTargets.size())
+        transformTargets.resize (handle + 1);
+    transformTargets[handle] = TransformTarget{instance, node->cpuIndex};
 }
 
 // Prepare for building the IAS
@@ -166,8 +234,10 @@ void SceneHandler::prepareForBuild()
     OptixAccelBufferSizes bufferSizes;
     ias.prepareForBuild (&bufferSizes);
 
-    if (bufferSizes.tempSizeInBytes > ctx->asBuildScratchMem.sizeInBytes())
-        ctx->asBuildScratchMem.resize (bufferSizes.tempSizeInBytes, 1, ctx->cuStr);
+    // big enough for the refits in between rebuilds too
+    size_t scratchSize = std::max (bufferSizes.tempSizeInBytes, bufferSizes.tempUpdateSizeInBytes);
+    if (scratchSize > ctx->asBuildScratchMem.sizeInBytes())
+        ctx->asBuildScratchMem.resize (scratchSize, 1, ctx->cuStr);
 
     if (iasMem.isInitialized())
     {
@@ -223,15 +293,15 @@ void SceneHandler::resizeSceneDependentSBT (EntryPointType type)
 // Rebuild the IAS after any updates to the instances
 void SceneHandler::rebuildIAS()
 {
-    // Perform the IAS rebuild
+    // Perform the IAS rebuild, the launch is queued behind it on the same stream so there's no need to wait
     travHandle = ias.rebuild (ctx->cuStr, instanceBuffer, iasMem, ctx->asBuildScratchMem);
-
-    // Synchronize the CUDA stream to ensure completion
-    CUDADRV_CHECK (cuStreamSynchronize (ctx->cuStr));
 }
 
 void SceneHandler::rebuild (EntryPointType type)
 {
     resizeSceneDependentSBT (type);
-    rebuildIAS();
+
+    IASBackend backend{*this};
+    updates.markTopologyChanged();
+    updates.flush (transforms, backend);
 }
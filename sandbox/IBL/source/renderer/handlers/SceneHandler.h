@@ -44,21 +44,23 @@ class SceneHandler
     void createInstance (OptiXNode node, EntryPointType type);
     void createGeometryInstances (GeometryInstances& instances, EntryPointType type);
 
-    void removeNode (const std::string& nodeName, EntryPointType type)
+    // A node's geometry instances go with it since they borrow its GAS and materials.
+    // Both return every node that was taken out of the scene
+    GeometryInstances removeNode (const std::string& nodeName, EntryPointType type)
     {
-        auto it = nodes.find (nodeName);
-        if (it != nodes.end())
-            removeNode (it->second);
-        else
-            return;
-
-        resizeSceneDependentSBT (type);
-        prepareForBuild();
-        rebuildIAS();
+        return removeNodes ({nodeName}, type);
     }
 
+    // removes them all and rebuilds once, unknown names are skipped
+    GeometryInstances removeNodes (const std::vector<std::string>& nodeNames, EntryPointType type);
+
+    // pushes the transforms written since the last call to the IAS and the CPU scene,
+    // refitting both, returns false when nothing moved
     bool updateMotion();
 
+    // the world poses of every instance, physics writes here and updateMotion() reads
+    wabi::TransformTable& getTransforms() { return transforms; }
+
     // Prepare Instance Acceleration Structure (IAS) for build
     void prepareForBuild();
 
@@ -71,19 +73,43 @@ class SceneHandler
     // Rebuild the IAS after updates
     void rebuildIAS();
 
+    // instances were added or removed, resizes the SBT and rebuilds the IAS and the CPU scene
     void rebuild (EntryPointType type);
 
     // Get traversable handle for the scene
     OptixTraversableHandle getHandle() { return travHandle; }
 
+    // closest node along a world space ray, or nullptr, the hit fields are filled in on a hit
+    OptiXNode pick (wabi::Ray3f& ray) const;
+
  private:
     // Reference to the render ctx
     RenderContextPtr ctx = nullptr;
 
-    void removeNode (OptiXNode node);
+    // adds the node without rebuilding, so a batch rebuilds once
+    void addInstance (OptiXNode node, optixu::GeometryAccelerationStructure gas, const wabi::TriangleBVHRef& blas);
+
+    // removes the node and its instances without rebuilding
+    void removeNode (OptiXNode node, GeometryInstances& removed);
+    void removeInstance (OptiXNode node);
 
     NodeMap nodes;
 
+    // the instances made from each node, they're removed with it
+    wabi::InstanceSources instanceSources;
+
+    // Every instance in IAS child order. Removal swaps the last entry into the hole
+    // so only that one entry changes index, OptiXRenderable::instanceHandle stays valid
+    struct InstanceEntry
+    {
+        optixu::GeometryAccelerationStructure gas;
+        wabi::TransformHandle transformHandle = wabi::INVALID_TRANSFORM;
+    };
+    mace::SlotMap<InstanceEntry> instances;
+
+    // iasSlots[i] is IAS child i, it shows whichever entry is at dense index i
+    std::vector<optixu::Instance> iasSlots;
+
     // Instance Acceleration Structure (IAS)
     optixu::InstanceAccelerationStructure ias;
 
@@ -96,6 +122,29 @@ class SceneHandler
     // Traversable handle for the scene
     OptixTraversableHandle travHandle = 0;
 
+    // the same instances on the CPU for picking, indexed by cpuIndex
+    wabi::InstanceBVH cpuScene;
+    std::vector<OptiXWeakNode> cpuNodes;
+
+    void addToCpuScene (OptiXNode node, const wabi::TriangleBVHRef& blas);
+
+    // where a transform goes, indexed by TransformHandle so
+    // updateMotion() never has to find the node
+    struct TransformTarget
+    {
+        optixu::Instance instance;
+        uint32_t cpuIndex = 0;
+    };
+
+    wabi::TransformTable transforms;
+    std::vector<TransformTarget> transformTargets;
+
+    void addTransform (OptiXNode node, optixu::Instance instance);
+
+    // decides between a refit and a rebuild, IASBackend carries it out
+    struct IASBackend;
+    wabi::InstanceUpdateTracker updates;
+
     // Initialize the scene
     void init();
 };
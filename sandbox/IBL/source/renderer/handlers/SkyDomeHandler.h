@@ -32,6 +32,13 @@ SOFTWARE.
 
 using SkyDomeHandlerRef = std::shared_ptr<class SkyDomeHandler>;
 
+// host side of Shared::EnvLightDistribution2D
+#if USE_ALIAS_TABLE_ENV_LIGHT
+using EnvLightDistribution2D = AliasRegularConstantContinuousDistribution2D;
+#else
+using EnvLightDistribution2D = RegularConstantContinuousDistribution2D;
+#endif
+
 class SkyDomeHandler
 {
  public:
@@ -42,10 +49,14 @@ class SkyDomeHandler
     SkyDomeHandler (RenderContextPtr ctx);
     ~SkyDomeHandler();
 
-    void addSkyDomeImage (const OIIO::ImageBuf&& image);
-     
+    // replaces the current sky dome, returns false if the image can't be read
+    bool addSkyDomeImage (const OIIO::ImageBuf&& image);
+
+    // resolution of the importance map used to sample the sky dome
+    void setEnvLightOptions (const mace::EnvLightOptions& options) { envLightOptions = options; }
+
     CUtexObject getEviroTexture() { return envLightTexture; }
-    RegularConstantContinuousDistribution2D& getImportanceMap() { return envLightImportanceMap; }
+    EnvLightDistribution2D& getImportanceMap() { return envLightImportanceMap; }
 
     void finalize()
     {
@@ -57,6 +68,7 @@ class SkyDomeHandler
         }
 
         envLightArray.finalize();
+        envLightImportanceMap.finalize (ctx->cuCtx);
     }
 
  private:
@@ -64,6 +76,10 @@ class SkyDomeHandler
 
     cudau::Array envLightArray;
     CUtexObject envLightTexture = 0;
-    RegularConstantContinuousDistribution2D envLightImportanceMap;
+    EnvLightDistribution2D envLightImportanceMap;
+
+    // an 8K lat-long map gets a 2K importance map, plenty to find the sun
+    static constexpr uint32_t DEFAULT_IMPORTANCE_WIDTH = 2048;
+    mace::EnvLightOptions envLightOptions{DEFAULT_IMPORTANCE_WIDTH};
 
 }; // end class SkyDomeHandler
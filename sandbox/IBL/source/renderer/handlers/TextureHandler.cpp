@@ -1,52 +1,115 @@
 #include "TextureHandler.h"
 #include "Handlers.h"
 
-using mace::ImageCacheHandler;
-
 TextureHandler::TextureHandler (RenderContextPtr ctx) :
     ctx (ctx)
 {
-    imageCache = ImageCacheHandler::create();
 }
 
 TextureHandler::~TextureHandler()
 {
+    for (auto& [key, texture] : registry)
+        cuTexObjectDestroy (texture.texObject);
 }
 
 CUtexObject TextureHandler::createCudaTextureFromImage (const std::filesystem::path& fullPath)
 {
-    OIIO::ImageBuf image = imageCache->getCachedImage (fullPath.generic_string(), false);
+    return acquireTexture (ctx->decodedImages->acquire (fullPath));
+}
 
-    OIIO::ImageSpec spec = image.spec();
-    if (spec.format != OIIO::TypeDesc::UINT8) return 0;
+CUtexObject TextureHandler::acquireTexture (const DecodedImageRef& image)
+{
+    if (!image) return 0;
 
-    OIIO::ImageBuf rgba;
-    if (spec.nchannels != 4)
+    auto it = registry.find (image->key);
+    if (it == registry.end())
     {
-        // need to add an alpha channel
-        int channelorder[] = {0, 1, 2, 3};
-        float channelvalues[] = {0 /*ignore*/, 0 /*ignore*/, 0 /*ignore*/, 1.0f};
-        std::string channelnames[] = {"", "", "", "A"};
-        rgba = OIIO::ImageBufAlgo::channels (image, 4, channelorder, channelvalues, channelnames);
-        spec = rgba.spec();
+        GpuTexture texture = upload (*image);
+        if (!texture.texObject) return 0;
+
+        it = registry.emplace (image->key, texture).first;
+        keys[texture.texObject] = image->key;
     }
-    else
-        rgba = image;
 
-    const uint8_t* const linearImageData = static_cast<uint8_t*> (rgba.localpixels());
+    ++it->second.refCount;
+    return it->second.texObject;
+}
+
+void TextureHandler::releaseTexture (CUtexObject texture)
+{
+    auto key = keys.find (texture);
+    if (key == keys.end()) return;
+
+    auto it = registry.find (key->second);
+    if (--it->second.refCount > 0) return;
+
+    CUDADRV_CHECK (cuTexObjectDestroy (it->second.texObject));
+    registry.erase (it);
+    keys.erase (key);
+}
 
-    std::shared_ptr<cudau::Array> array = std::make_shared<cudau::Array>();
-    array->initialize2D (ctx->cuCtx, cudau::ArrayElementType::UInt8, 4,
-                         cudau::ArraySurface::Disable, cudau::ArrayTextureGather::Disable,
-                         spec.width, spec.height, 1);
-    array->write<uint8_t> (linearImageData, spec.width * spec.height * 4);
+float TextureHandler::getTexelCount (CUtexObject texture) const
+{
+    auto key = keys.find (texture);
+    if (key == keys.end()) return 0.0f;
 
+    const GpuTexture& gpuTexture = registry.at (key->second);
+    return float (gpuTexture.width) * float (gpuTexture.height);
+}
+
+TextureHandler::GpuTexture TextureHandler::upload (const mace::DecodedImage& image)
+{
+    GpuTexture texture;
+
+    const OIIO::ImageSpec& spec = image.image.spec();
+    if (spec.format != OIIO::TypeDesc::UINT8 || spec.nchannels != 4) return texture;
+
+    mace::MipChainRef chain = getMipChain (image);
+    if (!chain) return texture;
+
+    texture.width = chain->getWidth();
+    texture.height = chain->getHeight();
+    texture.array = std::make_shared<cudau::Array>();
+    texture.array->initialize2D (ctx->cuCtx, cudau::ArrayElementType::UInt8, 4,
+                                 cudau::ArraySurface::Disable, cudau::ArrayTextureGather::Disable,
+                                 texture.width, texture.height, chain->getLevelCount());
+
+    for (uint32_t level = 0; level < chain->getLevelCount(); ++level)
+        texture.array->write<uint8_t> (chain->getLevelData (level), chain->getLevel (level).bytes, level);
+
+    // trilinear, the shading kernel picks the level from a ray cone
     cudau::TextureSampler texSampler;
-    texSampler.setXyFilterMode (cudau::TextureFilterMode::Point);
-    texSampler.setMipMapFilterMode (cudau::TextureFilterMode::Point);
+    texSampler.setXyFilterMode (cudau::TextureFilterMode::Linear);
+    texSampler.setMipMapFilterMode (cudau::TextureFilterMode::Linear);
     texSampler.setIndexingMode (cudau::TextureIndexingMode::NormalizedCoordinates);
     texSampler.setReadMode (cudau::TextureReadMode::NormalizedFloat_sRGB);
 
-    textures.emplace_back (array);
-    return texSampler.createTextureObject (*array);
+    texture.texObject = texSampler.createTextureObject (*texture.array);
+    return texture;
+}
+
+mace::MipChainRef TextureHandler::getMipChain (const mace::DecodedImage& image)
+{
+    mace::MipChainOptions options;
+    if (ctx->mipCacheFolder.empty())
+        return mace::MipChain::build (image.image, options);
+
+    // keyed on the source file and the filter settings
+    uint64_t sourceKey = mace::MipChain::makeSourceKey (image.path, options);
+
+    std::ostringstream name;
+    name << image.path.stem().string() << "_" << std::hex << sourceKey << mace::MipChain::EXTENSION;
+    std::filesystem::path cachePath = ctx->mipCacheFolder / name.str();
+
+    const OIIO::ImageSpec& spec = image.image.spec();
+    mace::MipChainRef chain = mace::MipChain::load (cachePath, sourceKey);
+    if (chain && chain->getWidth() == uint32_t (spec.width) && chain->getHeight() == uint32_t (spec.height) &&
+        chain->getChannels() == uint32_t (spec.nchannels) && !chain->isFloat())
+        return chain;
+
+    chain = mace::MipChain::build (image.image, options);
+    if (chain && !chain->save (cachePath, sourceKey))
+        LOG (DBUG) << "Failed to cache mip chain for " << image.path.generic_string();
+
+    return chain;
 }
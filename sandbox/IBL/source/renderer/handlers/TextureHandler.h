@@ -26,8 +26,11 @@ SOFTWARE.
 #include "../RenderContext.h"
 
 using TextureHandlerRef = std::shared_ptr<class TextureHandler>;
-using mace::ImageCacheHandlerRef;
+using mace::DecodedImageRef;
 
+// One CUDA texture per decoded image, shared by every material that uses it.
+// Pixels come from the context's DecodedImageCache so an image referenced by
+// many materials is decoded and uploaded once.
 class TextureHandler
 {
  public:
@@ -39,8 +42,33 @@ class TextureHandler
 
     CUtexObject createCudaTextureFromImage (const std::filesystem::path& fullPath);
 
+    // returns the shared texture for this image, uploading it on first use
+    CUtexObject acquireTexture (const DecodedImageRef& image);
+
+    // the texture is destroyed when its last user releases it
+    void releaseTexture (CUtexObject texture);
+
+    size_t getTextureCount() const { return registry.size(); }
+
+    // base level width * height, the shading kernel needs it to pick a mip level
+    float getTexelCount (CUtexObject texture) const;
+
  private:
+    struct GpuTexture
+    {
+        std::shared_ptr<cudau::Array> array = nullptr;
+        CUtexObject texObject = 0;
+        uint32_t refCount = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
     RenderContextPtr ctx = nullptr;
-    ImageCacheHandlerRef imageCache = nullptr;
-    std::vector<std::shared_ptr<cudau::Array>> textures; 
+    std::unordered_map<std::string, GpuTexture> registry; // keyed on the decoded image key
+    std::unordered_map<CUtexObject, std::string> keys;
+
+    GpuTexture upload (const mace::DecodedImage& image);
+
+    // loads the chain from the mip cache or builds and caches it
+    mace::MipChainRef getMipChain (const mace::DecodedImage& image);
 };
@@ -6,5 +6,4 @@ OptiXRenderable::OptiXRenderable()
 
 OptiXRenderable::~OptiXRenderable()
 {
-    instance.destroy();
 }
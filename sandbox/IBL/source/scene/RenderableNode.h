@@ -55,8 +55,10 @@ class OptiXRenderable
     OptiXGeometryRef g = nullptr;
     PhysicsDesc desc;
 
-    optixu::Instance instance;
-    uint32_t iasIndex = 0; // index into IAS children
+    mace::SlotHandle instanceHandle; // into the SceneHandler's instance registry, stays put when others are removed
+    uint32_t cpuIndex = 0; // index into the CPU InstanceBVH
+    uint32_t physicsIndex = 0; // slot in the physics TransformSnapshot
+    wabi::TransformHandle transformHandle = wabi::INVALID_TRANSFORM; // the live world pose in the scene's TransformTable
     std::string name = "unnamed_node";
 
     OptiXWeakNode instancedFrom;
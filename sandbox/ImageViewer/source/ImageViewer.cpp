@@ -31,6 +31,8 @@ void ImageViewer::initialize()
     view3d->set_position (Vector2i (0, 0));
 
     perform_layout();
+
+    imageCache = mace::ImageCacheHandler::create();
 }
 
 bool ImageViewer::mouse_button_event (const nanogui::Vector2i& p, int button, bool down, int modifiers)
@@ -45,14 +47,51 @@ bool ImageViewer::mouse_motion_event (const nanogui::Vector2i& p, const nanogui:
 
 bool ImageViewer::drop_event (const std::vector<std::string>& filenames)
 {
-    return false;
+    if (!imageCache) return false;
+
+    for (const auto& filename : filenames)
+    {
+        if (std::filesystem::is_directory (filename))
+            imageCache->addImageFolderToCache (filename);
+        else if (mace::isSupportedImageFormat (std::filesystem::path (filename).extension().string()))
+            imageCache->addImage (filename);
+    }
+
+    showImage (imageCache->getImage (imageCache->getCurrentIndex()));
+    return true;
 }
 
 bool ImageViewer::keyboard_event (int key, int scancode, int action, int modifiers)
 {
+    if (!imageCache || action == GLFW_RELEASE) return false;
+
+    switch (key)
+    {
+        case GLFW_KEY_RIGHT:
+            showImage (imageCache->getNextImage());
+            return true;
+
+        case GLFW_KEY_LEFT:
+            showImage (imageCache->getPreviousImage());
+            return true;
+    }
+
     return false;
 }
 
+void ImageViewer::showImage (const mace::ImageBufRef& image)
+{
+    if (!image) return;
+
+    // the texture only needs replacing when the size or pixel layout changes
+    const OIIO::ImageSpec& spec = image->spec();
+    bool needsNewTexture = spec.width != shownSpec.width || spec.height != shownSpec.height ||
+                           spec.nchannels != shownSpec.nchannels || spec.format != shownSpec.format;
+
+    canvas->updateRender (*image, needsNewTexture);
+    shownSpec = spec;
+}
+
 void ImageViewer::draw_contents()
 {
     clear();
@@ -66,4 +66,10 @@ class ImageViewer : public nanogui::Screen
  private:
     RenderCanvas* canvas = nullptr;
     Widget* view3d;
+
+    // dropped files and folders, arrow keys step through them
+    mace::ImageCacheHandlerRef imageCache = nullptr;
+    OIIO::ImageSpec shownSpec;
+
+    void showImage (const mace::ImageBufRef& image);
 };
@@ -103,6 +103,24 @@ void RegularConstantContinuousDistribution1DTemplate<RealType>::
     m_isInitialized = true;
 }
 
+template <typename RealType>
+void RegularConstantContinuousDistribution1DTemplate<RealType>::
+    initialize (
+        CUcontext cuContext, cudau::BufferType type,
+        const RealType* PDF, const RealType* CDF, RealType integral, uint32_t numValues)
+{
+    Assert (!m_isInitialized, "Already initialized!");
+    m_numValues = numValues;
+    m_integral = integral;
+
+    m_PDF.initialize (cuContext, type, m_numValues);
+    m_CDF.initialize (cuContext, type, m_numValues + 1);
+    m_PDF.write (PDF, m_numValues);
+    m_CDF.write (CDF, m_numValues + 1);
+
+    m_isInitialized = true;
+}
+
 template class RegularConstantContinuousDistribution1DTemplate<float>;
 
 template <typename RealType>
@@ -140,4 +158,172 @@ void RegularConstantContinuousDistribution2DTemplate<RealType>::
     m_isInitialized = true;
 }
 
+template <typename RealType>
+void RegularConstantContinuousDistribution2DTemplate<RealType>::
+    initialize (
+        CUcontext cuContext, cudau::BufferType type,
+        const RealType* rowPDFs, const RealType* rowCDFs, const RealType* rowIntegrals,
+        const RealType* marginalPDF, const RealType* marginalCDF, RealType integral,
+        uint32_t numD1, uint32_t numD2)
+{
+    Assert (!m_isInitialized, "Already initialized!");
+    m_1DDists = nullptr;
+
+    m_rowPDFs.initialize (cuContext, type, numD1 * numD2);
+    m_rowCDFs.initialize (cuContext, type, (numD1 + 1) * numD2);
+    m_rowPDFs.write (rowPDFs, numD1 * numD2);
+    m_rowCDFs.write (rowCDFs, (numD1 + 1) * numD2);
+
+    // device side rows point into the two shared buffers
+    std::vector<shared::RegularConstantContinuousDistribution1DTemplate<RealType>> rawDists;
+    rawDists.reserve (numD2);
+    for (uint32_t i = 0; i < numD2; ++i)
+    {
+        rawDists.emplace_back (
+            m_rowPDFs.getDevicePointer() + size_t (i) * numD1,
+            m_rowCDFs.getDevicePointer() + size_t (i) * (numD1 + 1),
+            rowIntegrals[i], numD1);
+    }
+    m_raw1DDists.initialize (cuContext, type, rawDists);
+
+    m_top1DDist.initialize (cuContext, type, marginalPDF, marginalCDF, integral, numD2);
+
+    Assert (std::isfinite (m_top1DDist.getIntegral()), "invalid integral value.");
+
+    m_isInitialized = true;
+}
+
 template class RegularConstantContinuousDistribution2DTemplate<float>;
+
+template <typename RealType>
+void AliasRegularConstantContinuousDistribution1DTemplate<RealType>::
+    initialize (
+        CUcontext cuContext, cudau::BufferType type,
+        const RealType* values, uint32_t numValues)
+{
+    RealType sum = 0;
+    for (uint32_t i = 0; i < numValues; ++i)
+        sum += values[i];
+
+    // an empty distribution stays sampleable as a uniform one
+    RealType integral = sum / numValues;
+    std::vector<RealType> PDF (numValues, 1);
+    if (integral > 0)
+    {
+        for (uint32_t i = 0; i < numValues; ++i)
+            PDF[i] = values[i] / integral;
+    }
+
+    initialize (cuContext, type, PDF.data(), integral, numValues);
+}
+
+template <typename RealType>
+void AliasRegularConstantContinuousDistribution1DTemplate<RealType>::
+    initialize (
+        CUcontext cuContext, cudau::BufferType type,
+        const RealType* PDF, RealType integral, uint32_t numValues)
+{
+    Assert (!m_isInitialized, "Already initialized!");
+    m_numValues = numValues;
+    m_integral = integral;
+
+    std::vector<shared::AliasTableEntry<RealType>> aliasTable (m_numValues);
+    std::vector<shared::AliasValueMap<RealType>> valueMaps (m_numValues);
+    buildAliasTable (PDF, m_numValues, aliasTable.data(), valueMaps.data());
+
+    m_PDF.initialize (cuContext, type, m_numValues);
+    m_PDF.write (PDF, m_numValues);
+    m_aliasTable.initialize (cuContext, type, aliasTable);
+    m_valueMaps.initialize (cuContext, type, valueMaps);
+
+    m_isInitialized = true;
+}
+
+template class AliasRegularConstantContinuousDistribution1DTemplate<float>;
+
+template <typename RealType>
+void AliasRegularConstantContinuousDistribution2DTemplate<RealType>::
+    initialize (
+        CUcontext cuContext, cudau::BufferType type,
+        const RealType* values, uint32_t numD1, uint32_t numD2)
+{
+    std::vector<RealType> rowPDFs (size_t (numD1) * numD2, 1);
+    std::vector<RealType> rowIntegrals (numD2);
+    for (uint32_t i = 0; i < numD2; ++i)
+    {
+        const RealType* row = values + size_t (i) * numD1;
+        RealType sum = 0;
+        for (uint32_t j = 0; j < numD1; ++j)
+            sum += row[j];
+
+        rowIntegrals[i] = sum / numD1;
+        if (rowIntegrals[i] > 0)
+        {
+            for (uint32_t j = 0; j < numD1; ++j)
+                rowPDFs[size_t (i) * numD1 + j] = row[j] / rowIntegrals[i];
+        }
+    }
+
+    RealType sum = 0;
+    for (uint32_t i = 0; i < numD2; ++i)
+        sum += rowIntegrals[i];
+
+    RealType integral = sum / numD2;
+    std::vector<RealType> marginalPDF (numD2, 1);
+    if (integral > 0)
+    {
+        for (uint32_t i = 0; i < numD2; ++i)
+            marginalPDF[i] = rowIntegrals[i] / integral;
+    }
+
+    initialize (
+        cuContext, type, rowPDFs.data(), rowIntegrals.data(),
+        marginalPDF.data(), integral, numD1, numD2);
+}
+
+template <typename RealType>
+void AliasRegularConstantContinuousDistribution2DTemplate<RealType>::
+    initialize (
+        CUcontext cuContext, cudau::BufferType type,
+        const RealType* rowPDFs, const RealType* rowIntegrals,
+        const RealType* marginalPDF, RealType integral,
+        uint32_t numD1, uint32_t numD2)
+{
+    Assert (!m_isInitialized, "Already initialized!");
+
+    const size_t numEntries = size_t (numD1) * numD2;
+    std::vector<shared::AliasTableEntry<RealType>> aliasTables (numEntries);
+    std::vector<shared::AliasValueMap<RealType>> valueMaps (numEntries);
+    for (uint32_t i = 0; i < numD2; ++i)
+    {
+        const size_t offset = size_t (i) * numD1;
+        buildAliasTable (rowPDFs + offset, numD1, aliasTables.data() + offset, valueMaps.data() + offset);
+    }
+
+    m_rowPDFs.initialize (cuContext, type, static_cast<uint32_t> (numEntries));
+    m_rowPDFs.write (rowPDFs, static_cast<uint32_t> (numEntries));
+    m_rowAliasTables.initialize (cuContext, type, aliasTables);
+    m_rowValueMaps.initialize (cuContext, type, valueMaps);
+
+    // device side rows point into the shared buffers
+    std::vector<shared::AliasRegularConstantContinuousDistribution1DTemplate<RealType>> rawDists;
+    rawDists.reserve (numD2);
+    for (uint32_t i = 0; i < numD2; ++i)
+    {
+        const size_t offset = size_t (i) * numD1;
+        rawDists.emplace_back (
+            m_rowPDFs.getDevicePointer() + offset,
+            m_rowAliasTables.getDevicePointer() + offset,
+            m_rowValueMaps.getDevicePointer() + offset,
+            rowIntegrals[i], numD1);
+    }
+    m_raw1DDists.initialize (cuContext, type, rawDists);
+
+    m_top1DDist.initialize (cuContext, type, marginalPDF, integral, numD2);
+
+    Assert (std::isfinite (m_top1DDist.getIntegral()), "invalid integral value.");
+
+    m_isInitialized = true;
+}
+
+template class AliasRegularConstantContinuousDistribution2DTemplate<float>;
@@ -205,6 +205,12 @@ class RegularConstantContinuousDistribution1DTemplate
     void initialize (
         CUcontext cuContext, cudau::BufferType type,
         const RealType* values, uint32_t numValues);
+
+    // from a normalized PDF and its CDF (numValues + 1 entries) built elsewhere
+    void initialize (
+        CUcontext cuContext, cudau::BufferType type,
+        const RealType* PDF, const RealType* CDF, RealType integral, uint32_t numValues);
+
     void finalize (CUcontext cuContext)
     {
         if (!m_isInitialized)
@@ -214,6 +220,7 @@ class RegularConstantContinuousDistribution1DTemplate
             m_CDF.finalize();
             m_PDF.finalize();
         }
+        m_isInitialized = false;
     }
 
     RegularConstantContinuousDistribution1DTemplate& operator= (RegularConstantContinuousDistribution1DTemplate&& v)
@@ -243,6 +250,10 @@ class RegularConstantContinuousDistribution2DTemplate
     cudau::TypedBuffer<shared::RegularConstantContinuousDistribution1DTemplate<RealType>> m_raw1DDists;
     RegularConstantContinuousDistribution1DTemplate<RealType>* m_1DDists;
     RegularConstantContinuousDistribution1DTemplate<RealType> m_top1DDist;
+
+    // every row's PDF and CDF in one buffer each when built from precomputed rows
+    cudau::TypedBuffer<RealType> m_rowPDFs;
+    cudau::TypedBuffer<RealType> m_rowCDFs;
     unsigned int m_isInitialized : 1;
 
  public:
@@ -260,21 +271,39 @@ class RegularConstantContinuousDistribution2DTemplate
     void initialize (
         CUcontext cuContext, cudau::BufferType type,
         const RealType* values, uint32_t numD1, uint32_t numD2);
+
+    // from rows and a marginal built on the host, rowPDFs is numD1 * numD2, rowCDFs is
+    // (numD1 + 1) * numD2, the marginal has numD2 entries and its CDF numD2 + 1.
+    // Costs two allocations for the rows instead of two per row.
+    void initialize (
+        CUcontext cuContext, cudau::BufferType type,
+        const RealType* rowPDFs, const RealType* rowCDFs, const RealType* rowIntegrals,
+        const RealType* marginalPDF, const RealType* marginalCDF, RealType integral,
+        uint32_t numD1, uint32_t numD2);
+
     void finalize (CUcontext cuContext)
     {
         if (!m_isInitialized)
             return;
 
-        m_top1DDist.finalize (cuContext);
-
-        for (int i = m_top1DDist.getNumValues() - 1; i >= 0; --i)
+        if (m_1DDists)
+        {
+            for (int i = m_top1DDist.getNumValues() - 1; i >= 0; --i)
+            {
+                m_1DDists[i].finalize (cuContext);
+            }
+            delete[] m_1DDists;
+            m_1DDists = nullptr;
+        }
+        else
         {
-            m_1DDists[i].finalize (cuContext);
+            m_rowCDFs.finalize();
+            m_rowPDFs.finalize();
         }
 
+        m_top1DDist.finalize (cuContext);
         m_raw1DDists.finalize();
-        delete[] m_1DDists;
-        m_1DDists = nullptr;
+        m_isInitialized = false;
     }
 
     bool isInitialized() const { return m_isInitialized; }
@@ -288,6 +317,181 @@ class RegularConstantContinuousDistribution2DTemplate
     }
 };
 
+// Vose's O(n) construction of a Walker alias table. Returns the sum of the weights,
+// all zero weights give a uniform table so sampling never lands on an empty bin.
+template <typename RealType>
+RealType buildAliasTable (
+    const RealType* weights, uint32_t numValues,
+    shared::AliasTableEntry<RealType>* aliasTable, shared::AliasValueMap<RealType>* valueMaps)
+{
+    double sum = 0.0;
+    for (uint32_t i = 0; i < numValues; ++i)
+        sum += weights[i];
+
+    auto setEntry = [&] (uint32_t idx, uint32_t secondIdx, double probToPickFirst)
+    {
+        RealType p = static_cast<RealType> (probToPickFirst);
+        aliasTable[idx] = shared::AliasTableEntry<RealType> (secondIdx, p);
+
+        shared::AliasValueMap<RealType>& valueMap = valueMaps[idx];
+        valueMap.scaleForFirst = p > 0 ? 1 / p : 0;
+        valueMap.scaleForSecond = p < 1 ? 1 / (1 - p) : 0;
+        valueMap.offsetForSecond = p < 1 ? -p / (1 - p) : 0;
+    };
+
+    // probabilities scaled so the average bin holds exactly 1
+    std::vector<double> probs (numValues);
+    std::vector<uint32_t> smaller;
+    std::vector<uint32_t> larger;
+    smaller.reserve (numValues);
+    larger.reserve (numValues);
+    for (uint32_t i = 0; i < numValues; ++i)
+    {
+        probs[i] = sum > 0.0 ? weights[i] * (numValues / sum) : 1.0;
+        if (probs[i] < 1.0)
+            smaller.push_back (i);
+        else
+            larger.push_back (i);
+    }
+
+    // every small bin is topped up by one large bin
+    while (!smaller.empty() && !larger.empty())
+    {
+        uint32_t smallIdx = smaller.back();
+        smaller.pop_back();
+        uint32_t largeIdx = larger.back();
+
+        setEntry (smallIdx, largeIdx, probs[smallIdx]);
+        probs[largeIdx] -= 1.0 - probs[smallIdx];
+        if (probs[largeIdx] < 1.0)
+        {
+            larger.pop_back();
+            smaller.push_back (largeIdx);
+        }
+    }
+
+    // whatever is left is 1 up to rounding
+    for (uint32_t idx : larger)
+        setEntry (idx, idx, 1.0);
+    for (uint32_t idx : smaller)
+        setEntry (idx, idx, 1.0);
+
+    return static_cast<RealType> (sum);
+}
+
+// Same role as RegularConstantContinuousDistribution1DTemplate, sampled through an alias table
+template <typename RealType>
+class AliasRegularConstantContinuousDistribution1DTemplate
+{
+    cudau::TypedBuffer<RealType> m_PDF;
+    cudau::TypedBuffer<shared::AliasTableEntry<RealType>> m_aliasTable;
+    cudau::TypedBuffer<shared::AliasValueMap<RealType>> m_valueMaps;
+
+    RealType m_integral;
+    uint32_t m_numValues;
+    unsigned int m_isInitialized : 1;
+
+ public:
+    AliasRegularConstantContinuousDistribution1DTemplate() :
+        m_integral (0), m_numValues (0), m_isInitialized (false) {}
+
+    void initialize (
+        CUcontext cuContext, cudau::BufferType type,
+        const RealType* values, uint32_t numValues);
+
+    // from a PDF normalized elsewhere
+    void initialize (
+        CUcontext cuContext, cudau::BufferType type,
+        const RealType* PDF, RealType integral, uint32_t numValues);
+
+    void finalize (CUcontext cuContext)
+    {
+        if (!m_isInitialized)
+            return;
+        m_valueMaps.finalize();
+        m_aliasTable.finalize();
+        m_PDF.finalize();
+        m_isInitialized = false;
+    }
+
+    AliasRegularConstantContinuousDistribution1DTemplate& operator= (AliasRegularConstantContinuousDistribution1DTemplate&& v)
+    {
+        m_PDF = std::move (v.m_PDF);
+        m_aliasTable = std::move (v.m_aliasTable);
+        m_valueMaps = std::move (v.m_valueMaps);
+        m_integral = v.m_integral;
+        m_numValues = v.m_numValues;
+        return *this;
+    }
+
+    RealType getIntegral() const { return m_integral; }
+    uint32_t getNumValues() const { return m_numValues; }
+
+    bool isInitialized() const { return m_isInitialized; }
+
+    void getDeviceType (shared::AliasRegularConstantContinuousDistribution1DTemplate<RealType>* instance) const
+    {
+        new (instance) shared::AliasRegularConstantContinuousDistribution1DTemplate<RealType> (
+            m_PDF.getDevicePointer(), m_aliasTable.getDevicePointer(), m_valueMaps.getDevicePointer(),
+            m_integral, m_numValues);
+    }
+};
+
+// Same role as RegularConstantContinuousDistribution2DTemplate, every row's PDF,
+// alias table and value maps live in one buffer each
+template <typename RealType>
+class AliasRegularConstantContinuousDistribution2DTemplate
+{
+    cudau::TypedBuffer<shared::AliasRegularConstantContinuousDistribution1DTemplate<RealType>> m_raw1DDists;
+    AliasRegularConstantContinuousDistribution1DTemplate<RealType> m_top1DDist;
+
+    cudau::TypedBuffer<RealType> m_rowPDFs;
+    cudau::TypedBuffer<shared::AliasTableEntry<RealType>> m_rowAliasTables;
+    cudau::TypedBuffer<shared::AliasValueMap<RealType>> m_rowValueMaps;
+    unsigned int m_isInitialized : 1;
+
+ public:
+    AliasRegularConstantContinuousDistribution2DTemplate() :
+        m_isInitialized (false) {}
+
+    void initialize (
+        CUcontext cuContext, cudau::BufferType type,
+        const RealType* values, uint32_t numD1, uint32_t numD2);
+
+    // from normalized rows and a marginal built on the host, rowPDFs is numD1 * numD2
+    // and the marginal has numD2 entries
+    void initialize (
+        CUcontext cuContext, cudau::BufferType type,
+        const RealType* rowPDFs, const RealType* rowIntegrals,
+        const RealType* marginalPDF, RealType integral,
+        uint32_t numD1, uint32_t numD2);
+
+    void finalize (CUcontext cuContext)
+    {
+        if (!m_isInitialized)
+            return;
+
+        m_rowValueMaps.finalize();
+        m_rowAliasTables.finalize();
+        m_rowPDFs.finalize();
+        m_top1DDist.finalize (cuContext);
+        m_raw1DDists.finalize();
+        m_isInitialized = false;
+    }
+
+    bool isInitialized() const { return m_isInitialized; }
+
+    void getDeviceType (shared::AliasRegularConstantContinuousDistribution2DTemplate<RealType>* instance) const
+    {
+        shared::AliasRegularConstantContinuousDistribution1DTemplate<RealType> top1DDist;
+        m_top1DDist.getDeviceType (&top1DDist);
+        new (instance) shared::AliasRegularConstantContinuousDistribution2DTemplate<RealType> (
+            m_raw1DDists.getDevicePointer(), top1DDist);
+    }
+};
+
 using DiscreteDistribution1D = DiscreteDistribution1DTemplate<float>;
 using RegularConstantContinuousDistribution1D = RegularConstantContinuousDistribution1DTemplate<float>;
 using RegularConstantContinuousDistribution2D = RegularConstantContinuousDistribution2DTemplate<float>;
+using AliasRegularConstantContinuousDistribution1D = AliasRegularConstantContinuousDistribution1DTemplate<float>;
+using AliasRegularConstantContinuousDistribution2D = AliasRegularConstantContinuousDistribution2DTemplate<float>;
@@ -7,6 +7,13 @@
 
 #define USE_PROBABILITY_TEXTURE 0
 
+// 1 samples the sky dome through alias tables in constant time, 0 through a binary
+// search of the row and marginal CDFs. The IBL kernels and sabi::CpuPathTracer both
+// follow it, set it in the build's defines to change both
+#ifndef USE_ALIAS_TABLE_ENV_LIGHT
+#define USE_ALIAS_TABLE_ENV_LIGHT 1
+#endif
+
 namespace shared
 {
     template <typename FuncType>
@@ -291,6 +298,113 @@ namespace shared
 
     using RegularConstantContinuousDistribution2D = RegularConstantContinuousDistribution2DTemplate<float>;
 
+    // Same interface as RegularConstantContinuousDistribution1DTemplate but samples in
+    // constant time with Walker's alias method instead of a binary search over the CDF.
+    // Each bin holds the probability of keeping the sample and the index it aliases to,
+    // the value map rescales the leftover of the primary sample into [0, 1) within
+    // whichever bin was picked.
+    template <typename RealType>
+    class AliasRegularConstantContinuousDistribution1DTemplate
+    {
+        const RealType* m_PDF;
+        const AliasTableEntry<RealType>* m_aliasTable;
+        const AliasValueMap<RealType>* m_valueMaps;
+        RealType m_integral;
+        uint32_t m_numValues;
+
+     public:
+        AliasRegularConstantContinuousDistribution1DTemplate (
+            const RealType* PDF, const AliasTableEntry<RealType>* aliasTable, const AliasValueMap<RealType>* valueMaps,
+            RealType integral, uint32_t numValues) :
+            m_PDF (PDF),
+            m_aliasTable (aliasTable),
+            m_valueMaps (valueMaps),
+            m_integral (integral),
+            m_numValues (numValues)
+        {
+        }
+
+        CUDA_COMMON_FUNCTION AliasRegularConstantContinuousDistribution1DTemplate()
+        {
+        }
+
+        CUDA_COMMON_FUNCTION RealType sample (RealType u, RealType* probDensity) const
+        {
+            Assert (u >= 0 && u < 1, "\"u\": %g must be in range [0, 1).", u);
+
+            uint32_t idx = mapPrimarySampleToDiscrete (u, m_numValues, &u);
+            const AliasTableEntry<RealType>& entry = m_aliasTable[idx];
+            const AliasValueMap<RealType>& valueMap = m_valueMaps[idx];
+            if (u < entry.probToPickFirst)
+            {
+                u = valueMap.scaleForFirst * u;
+            }
+            else
+            {
+                idx = entry.secondIndex;
+                u = valueMap.scaleForSecond * u + valueMap.offsetForSecond;
+            }
+            Assert (idx < m_numValues, "Invalid Index!: %u", idx);
+
+            // rounding can carry the sample over into the next bin, or up to 1 from the
+            // last one. Keep it below 1 and return the density of the bin it ended up in
+            // so it always matches evaluatePDF()
+#if defined(__CUDA_ARCH__)
+            RealType smp = fminf ((idx + u) / m_numValues, nextafterf (1.0f, 0.0f));
+#else
+            RealType smp = std::fmin ((idx + u) / m_numValues, std::nextafter (RealType (1), RealType (0)));
+#endif
+            *probDensity = m_PDF[mapPrimarySampleToDiscrete (smp, m_numValues)];
+            return smp;
+        }
+        CUDA_COMMON_FUNCTION RealType evaluatePDF (RealType smp) const
+        {
+            Assert (smp >= 0 && smp < 1.0, "\"smp\": %g is out of range [0, 1).", smp);
+            uint32_t idx = mapPrimarySampleToDiscrete (smp, m_numValues);
+            return m_PDF[idx];
+        }
+        CUDA_COMMON_FUNCTION RealType integral() const { return m_integral; }
+
+        CUDA_COMMON_FUNCTION uint32_t numValues() const { return m_numValues; }
+    };
+
+    using AliasRegularConstantContinuousDistribution1D = AliasRegularConstantContinuousDistribution1DTemplate<float>;
+
+    // drop in replacement for RegularConstantContinuousDistribution2DTemplate,
+    // two table lookups per sample whatever the resolution
+    template <typename RealType>
+    class AliasRegularConstantContinuousDistribution2DTemplate
+    {
+        const AliasRegularConstantContinuousDistribution1DTemplate<RealType>* m_1DDists;
+        AliasRegularConstantContinuousDistribution1DTemplate<RealType> m_top1DDist;
+
+     public:
+        AliasRegularConstantContinuousDistribution2DTemplate (
+            const AliasRegularConstantContinuousDistribution1DTemplate<RealType>* _1DDists,
+            const AliasRegularConstantContinuousDistribution1DTemplate<RealType>& top1DDist) :
+            m_1DDists (_1DDists),
+            m_top1DDist (top1DDist) {}
+
+        CUDA_COMMON_FUNCTION AliasRegularConstantContinuousDistribution2DTemplate() {}
+
+        CUDA_COMMON_FUNCTION void sample (
+            RealType u0, RealType u1, RealType* d0, RealType* d1, RealType* probDensity) const
+        {
+            RealType topPDF;
+            *d1 = m_top1DDist.sample (u1, &topPDF);
+            uint32_t idx1D = mapPrimarySampleToDiscrete (*d1, m_top1DDist.numValues());
+            *d0 = m_1DDists[idx1D].sample (u0, probDensity);
+            *probDensity *= topPDF;
+        }
+        CUDA_COMMON_FUNCTION RealType evaluatePDF (RealType d0, RealType d1) const
+        {
+            uint32_t idx1D = mapPrimarySampleToDiscrete (d1, m_top1DDist.numValues());
+            return m_top1DDist.evaluatePDF (d1) * m_1DDists[idx1D].evaluatePDF (d0);
+        }
+    };
+
+    using AliasRegularConstantContinuousDistribution2D = AliasRegularConstantContinuousDistribution2DTemplate<float>;
+
     CUDA_COMMON_FUNCTION CUDA_INLINE uint2 computeProbabilityTextureDimentions (uint32_t maxNumElems)
     {
 #if !defined(__CUDA_ARCH__)
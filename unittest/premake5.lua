@@ -27,4 +27,25 @@ end
 	include "tests/OIIO"
 	include "tests/ShockerEigen"
 	include "tests/Cereal"
+	include "tests/IngestPipeline"
+	include "tests/DecodedImageCache"
+	include "tests/DirectoryIndex"
+	include "tests/MipChain"
+	include "tests/EnvLightPreprocessor"
+	include "tests/AliasTable"
+	include "tests/PixelBlockPool"
+	include "tests/CameraRays"
+	include "tests/RayStream"
+	include "tests/TriangleBVH"
+	include "tests/InstanceBVH"
+	include "tests/CpuPathTracer"
+	include "tests/TripleBuffer"
+	include "tests/TransformTable"
+	include "tests/InstanceUpdateTracker"
+	include "tests/SlotMap"
+	include "tests/ImageRegions"
+	include "tests/InstanceSources"
+	include "tests/TaskScheduler"
+	include "tests/MeshCache"
+	include "tests/MeshNormals"
 	
\ No newline at end of file
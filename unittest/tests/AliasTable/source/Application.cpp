@@ -0,0 +1,322 @@
+#include "Jahley.h"
+
+// shocker distributions
+#include <common_host.h>
+
+const std::string APP_NAME = "AliasTable";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+namespace test
+{
+    // host arrays standing in for the device buffers
+    struct AliasTable1D
+    {
+        std::vector<float> PDF;
+        std::vector<shared::AliasTableEntry<float>> entries;
+        std::vector<shared::AliasValueMap<float>> valueMaps;
+        float integral = 0.0f;
+
+        explicit AliasTable1D (const std::vector<float>& weights) :
+            entries (weights.size()),
+            valueMaps (weights.size())
+        {
+            uint32_t numValues = static_cast<uint32_t> (weights.size());
+            float sum = buildAliasTable (weights.data(), numValues, entries.data(), valueMaps.data());
+            integral = sum / numValues;
+            PDF.resize (numValues, 1.0f);
+            if (integral > 0.0f)
+            {
+                for (uint32_t i = 0; i < numValues; ++i)
+                    PDF[i] = weights[i] / integral;
+            }
+        }
+
+        shared::AliasRegularConstantContinuousDistribution1D device() const
+        {
+            return shared::AliasRegularConstantContinuousDistribution1D (
+                PDF.data(), entries.data(), valueMaps.data(), integral, static_cast<uint32_t> (PDF.size()));
+        }
+    };
+
+    // both 2D flavours over the same precomputed distribution
+    struct Distributions2D
+    {
+        mace::EnvLightDistributionRef dist;
+
+        std::vector<shared::AliasTableEntry<float>> rowEntries;
+        std::vector<shared::AliasValueMap<float>> rowValueMaps;
+        std::vector<shared::AliasRegularConstantContinuousDistribution1D> aliasRows;
+        std::unique_ptr<AliasTable1D> aliasMarginal;
+
+        std::vector<shared::RegularConstantContinuousDistribution1D> cdfRows;
+
+        Distributions2D (const std::vector<float>& importance, uint32_t width, uint32_t height)
+        {
+            dist = mace::EnvLightDistribution::build (importance.data(), width, height);
+
+            rowEntries.resize (importance.size());
+            rowValueMaps.resize (importance.size());
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                size_t offset = size_t (y) * width;
+                buildAliasTable (dist->rowPDFs.data() + offset, width, rowEntries.data() + offset, rowValueMaps.data() + offset);
+                aliasRows.emplace_back (
+                    dist->rowPDFs.data() + offset, rowEntries.data() + offset, rowValueMaps.data() + offset,
+                    dist->rowIntegrals[y], width);
+                cdfRows.emplace_back (
+                    dist->rowPDFs.data() + offset, dist->rowCDFs.data() + size_t (y) * (width + 1),
+                    dist->rowIntegrals[y], width);
+            }
+            aliasMarginal = std::make_unique<AliasTable1D> (dist->rowIntegrals);
+        }
+
+        shared::AliasRegularConstantContinuousDistribution2D alias() const
+        {
+            return shared::AliasRegularConstantContinuousDistribution2D (aliasRows.data(), aliasMarginal->device());
+        }
+
+        shared::RegularConstantContinuousDistribution2D cdf() const
+        {
+            shared::RegularConstantContinuousDistribution1D marginal (
+                dist->marginalPDF.data(), dist->marginalCDF.data(), dist->integral, dist->height);
+            return shared::RegularConstantContinuousDistribution2D (cdfRows.data(), marginal);
+        }
+    };
+
+    inline std::vector<float> randomWeights (uint32_t count, uint32_t seed)
+    {
+        std::mt19937 rng (seed);
+        std::uniform_real_distribution<float> dist (0.0f, 1.0f);
+        std::vector<float> weights (count);
+        for (float& w : weights)
+            w = dist (rng) < 0.2f ? 0.0f : std::pow (dist (rng), 4.0f) * 100.0f;
+        return weights;
+    }
+
+    // Pearson's statistic over bins with a nonzero expected count
+    inline double chiSquare (const std::vector<uint32_t>& counts, const std::vector<double>& expected)
+    {
+        double chi2 = 0.0;
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            if (expected[i] > 0.0)
+                chi2 += (counts[i] - expected[i]) * (counts[i] - expected[i]) / expected[i];
+        }
+        return chi2;
+    }
+} // namespace test
+
+TEST_CASE ("Alias tables reproduce the weights exactly")
+{
+    const uint32_t numValues = 257;
+    std::vector<float> weights = test::randomWeights (numValues, 7);
+    test::AliasTable1D table (weights);
+
+    double sum = 0.0;
+    for (float w : weights)
+        sum += w;
+
+    // mass that ends up in each bin: what it keeps plus what others alias to it
+    std::vector<double> mass (numValues, 0.0);
+    for (uint32_t i = 0; i < numValues; ++i)
+    {
+        const shared::AliasTableEntry<float>& entry = table.entries[i];
+        REQUIRE (entry.secondIndex < numValues);
+        mass[i] += entry.probToPickFirst;
+        mass[entry.secondIndex] += 1.0 - entry.probToPickFirst;
+    }
+
+    for (uint32_t i = 0; i < numValues; ++i)
+        CHECK (mass[i] / numValues == doctest::Approx (weights[i] / sum).epsilon (1e-4));
+}
+
+TEST_CASE ("An empty alias table samples uniformly")
+{
+    std::vector<float> weights (16, 0.0f);
+    test::AliasTable1D table (weights);
+
+    CHECK (table.integral == 0.0f);
+    for (uint32_t i = 0; i < weights.size(); ++i)
+    {
+        CHECK (table.entries[i].probToPickFirst == 1.0f);
+        CHECK (table.PDF[i] == 1.0f);
+    }
+}
+
+TEST_CASE ("1D alias sampling follows the target PDF")
+{
+    const uint32_t numValues = 64;
+    const uint32_t numSamples = 1 << 20;
+    std::vector<float> weights = test::randomWeights (numValues, 11);
+    test::AliasTable1D table (weights);
+    shared::AliasRegularConstantContinuousDistribution1D dist = table.device();
+
+    shared::PCG32RNG rng;
+    rng.setState (12345);
+
+    std::vector<uint32_t> counts (numValues, 0);
+    for (uint32_t i = 0; i < numSamples; ++i)
+    {
+        float density;
+        float smp = dist.sample (rng.getFloat0cTo1o(), &density);
+        REQUIRE (smp >= 0.0f);
+        REQUIRE (smp < 1.0f);
+        REQUIRE (density > 0.0f);
+        REQUIRE (density == dist.evaluatePDF (smp));
+        ++counts[shared::mapPrimarySampleToDiscrete (smp, numValues)];
+    }
+
+    std::vector<double> expected (numValues);
+    for (uint32_t i = 0; i < numValues; ++i)
+    {
+        expected[i] = double (table.PDF[i]) / numValues * numSamples;
+        if (weights[i] == 0.0f)
+            CHECK (counts[i] == 0);
+    }
+
+    // 99.9th percentile of chi square with at most 63 degrees of freedom is about 104
+    CHECK (test::chiSquare (counts, expected) < 104.0);
+}
+
+TEST_CASE ("Samples land uniformly within the picked bin")
+{
+    std::vector<float> weights = {1.0f, 3.0f};
+    test::AliasTable1D table (weights);
+    shared::AliasRegularConstantContinuousDistribution1D dist = table.device();
+
+    shared::PCG32RNG rng;
+    rng.setState (99);
+
+    const uint32_t numSamples = 1 << 18;
+    const uint32_t numSubBins = 8;
+    std::vector<uint32_t> counts (numSubBins, 0);
+    uint32_t inSecondBin = 0;
+    for (uint32_t i = 0; i < numSamples; ++i)
+    {
+        float density;
+        float smp = dist.sample (rng.getFloat0cTo1o(), &density);
+        if (smp < 0.5f)
+            continue;
+        ++inSecondBin;
+        ++counts[std::min (numSubBins - 1, uint32_t ((smp - 0.5f) * 2.0f * numSubBins))];
+    }
+
+    std::vector<double> expected (numSubBins, double (inSecondBin) / numSubBins);
+    CHECK (double (inSecondBin) / numSamples == doctest::Approx (0.75).epsilon (0.01));
+    CHECK (test::chiSquare (counts, expected) < 24.3);
+}
+
+TEST_CASE ("Samples at the top of a bin stay below 1")
+{
+    // the leftover of u just under a bin edge can round the sample up to exactly 1
+    std::mt19937 rng (21);
+    for (uint32_t table = 0; table < 2000; ++table)
+    {
+        uint32_t numValues = 1 + rng() % 300;
+        test::AliasTable1D aliasTable (test::randomWeights (numValues, rng()));
+        shared::AliasRegularConstantContinuousDistribution1D dist = aliasTable.device();
+
+        for (uint32_t bin = 1; bin <= numValues; ++bin)
+        {
+            float u = std::nextafter (float (bin) / numValues, 0.0f);
+            for (int step = 0; step < 8 && u < 1.0f; ++step, u = std::nextafter (u, 0.0f))
+            {
+                float density;
+                float smp = dist.sample (u, &density);
+                REQUIRE (smp < 1.0f);
+                REQUIRE (density == dist.evaluatePDF (smp));
+            }
+        }
+    }
+}
+
+TEST_CASE ("2D alias sampling follows the target PDF")
+{
+    const uint32_t width = 32, height = 16;
+    std::vector<float> importance = test::randomWeights (width * height, 3);
+    std::fill (importance.begin() + 5 * width, importance.begin() + 6 * width, 0.0f);
+
+    test::Distributions2D dists (importance, width, height);
+    shared::AliasRegularConstantContinuousDistribution2D alias = dists.alias();
+
+    shared::PCG32RNG rng;
+    rng.setState (777);
+
+    const uint32_t numSamples = 1 << 21;
+    std::vector<uint32_t> counts (width * height, 0);
+    for (uint32_t i = 0; i < numSamples; ++i)
+    {
+        float u, v, density;
+        alias.sample (rng.getFloat0cTo1o(), rng.getFloat0cTo1o(), &u, &v, &density);
+        REQUIRE (density > 0.0f);
+        REQUIRE (density == doctest::Approx (alias.evaluatePDF (u, v)));
+
+        uint32_t x = shared::mapPrimarySampleToDiscrete (u, width);
+        uint32_t y = shared::mapPrimarySampleToDiscrete (v, height);
+        REQUIRE (y != 5);
+        ++counts[y * width + x];
+    }
+
+    std::vector<double> expected (width * height);
+    double total = 0.0;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            float pdf = alias.evaluatePDF ((x + 0.5f) / width, (y + 0.5f) / height);
+            expected[y * width + x] = double (pdf) / (width * height) * numSamples;
+            total += expected[y * width + x];
+        }
+    }
+    CHECK (total == doctest::Approx (numSamples).epsilon (1e-4));
+
+    // 99.9th percentile of chi square with 511 degrees of freedom is about 622
+    CHECK (test::chiSquare (counts, expected) < 622.0);
+}
+
+TEST_CASE ("Alias and CDF distributions agree on the PDF")
+{
+    const uint32_t width = 48, height = 24;
+    std::vector<float> importance = test::randomWeights (width * height, 5);
+
+    test::Distributions2D dists (importance, width, height);
+    shared::AliasRegularConstantContinuousDistribution2D alias = dists.alias();
+    shared::RegularConstantContinuousDistribution2D cdf = dists.cdf();
+
+    shared::PCG32RNG rng;
+    rng.setState (4242);
+    for (uint32_t i = 0; i < 10000; ++i)
+    {
+        float u = rng.getFloat0cTo1o();
+        float v = rng.getFloat0cTo1o();
+        REQUIRE (alias.evaluatePDF (u, v) == doctest::Approx (cdf.evaluatePDF (u, v)));
+
+        // both land on cells of the same density
+        float cu, cv, cdfDensity;
+        cdf.sample (u, v, &cu, &cv, &cdfDensity);
+        REQUIRE (cdfDensity == doctest::Approx (alias.evaluatePDF (cu, cv)));
+    }
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
@@ -0,0 +1,143 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "CameraRays";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using sabi::CameraBody;
+using sabi::CameraRays;
+
+namespace test
+{
+    inline CameraHandle makeCamera (uint32_t width, uint32_t height)
+    {
+        CameraHandle camera = std::make_shared<CameraBody>();
+        camera->getSensor()->setPixelResolution (width, height);
+        camera->setFocalLength (0.035f);
+        camera->lookAt (Eigen::Vector3f (3.0f, 2.0f, -7.0f), Eigen::Vector3f (0.5f, -0.25f, 1.0f));
+        return camera;
+    }
+
+    inline bool sameBits (const Eigen::Vector3f& a, const Eigen::Vector3f& b)
+    {
+        return std::memcmp (a.data(), b.data(), sizeof (Eigen::Vector3f)) == 0;
+    }
+
+    // number of rays in the batch that differ from the scalar path in any bit
+    template <typename Scalar>
+    uint32_t countMismatches (const CameraRays& rays, Scalar&& scalar)
+    {
+        uint32_t mismatches = 0;
+        for (uint32_t row = 0; row < rays.height; ++row)
+        {
+            for (uint32_t column = 0; column < rays.width; ++column)
+            {
+                Eigen::Index i = Eigen::Index (row) * rays.width + column;
+                wabi::Ray3f expected = scalar (rays.x + column, rays.y + row, i);
+                wabi::Ray3f ray = rays.getRay (i);
+                if (!sameBits (expected.origin, ray.origin) || !sameBits (expected.dir, ray.dir))
+                    ++mismatches;
+            }
+        }
+        return mismatches;
+    }
+} // namespace test
+
+TEST_CASE ("Pixel centre rays match generateRay bit for bit")
+{
+    CameraHandle camera = test::makeCamera (1280, 720);
+
+    for (bool transformed : {true, false})
+    {
+        CameraRays rays;
+        camera->generateRays (0, 0, 1280, 720, rays, transformed);
+        REQUIRE (rays.size() == 1280 * 720);
+        CHECK (test::countMismatches (rays, [&] (uint32_t x, uint32_t y, Eigen::Index)
+                                      { return camera->generateRay (x, y, transformed); }) == 0);
+
+        // a ragged tile that doesn't line up with any SIMD width
+        camera->generateRays (333, 101, 67, 13, rays, transformed);
+        REQUIRE (rays.size() == 67 * 13);
+        CHECK (test::countMismatches (rays, [&] (uint32_t x, uint32_t y, Eigen::Index)
+                                      { return camera->generateRay (x, y, transformed); }) == 0);
+    }
+}
+
+TEST_CASE ("Jittered rays match generateRay bit for bit")
+{
+    CameraHandle camera = test::makeCamera (800, 600);
+
+    std::mt19937 rng (17);
+    std::uniform_real_distribution<float> dist (0.0f, 1.0f);
+    auto sampler = [&] (uint32_t, uint32_t) { return Eigen::Vector2f (dist (rng), dist (rng)); };
+
+    for (bool transformed : {true, false})
+    {
+        CameraRays rays;
+        camera->generateRays (40, 500, 129, 100, sampler, rays, transformed);
+        REQUIRE (rays.size() == 129 * 100);
+        CHECK (test::countMismatches (rays, [&] (uint32_t x, uint32_t y, Eigen::Index i)
+                                      { return camera->generateRay (x, y, rays.jitterU[i], rays.jitterV[i], transformed); }) == 0);
+    }
+}
+
+TEST_CASE ("The sampler is called once per pixel in ray order")
+{
+    CameraHandle camera = test::makeCamera (64, 64);
+
+    std::vector<Eigen::Vector2i> visited;
+    auto sampler = [&] (uint32_t x, uint32_t y)
+    {
+        visited.emplace_back (x, y);
+        return Eigen::Vector2f (0.25f, 0.75f);
+    };
+
+    CameraRays rays;
+    camera->generateRays (10, 20, 5, 3, sampler, rays);
+    REQUIRE (visited.size() == 15);
+    CHECK (visited[0] == Eigen::Vector2i (10, 20));
+    CHECK (visited[4] == Eigen::Vector2i (14, 20));
+    CHECK (visited[5] == Eigen::Vector2i (10, 21));
+    CHECK (visited[14] == Eigen::Vector2i (14, 22));
+    CHECK ((rays.jitterU == 0.25f).all());
+    CHECK ((rays.jitterV == 0.75f).all());
+
+    // every ray starts at the eye and has unit length
+    Eigen::Vector3f eye = camera->getPose().translation();
+    for (Eigen::Index i = 0; i < rays.size(); ++i)
+    {
+        wabi::Ray3f ray = rays.getRay (i);
+        CHECK (ray.origin == eye);
+        CHECK (ray.dir.norm() == doctest::Approx (1.0f));
+    }
+
+    // jitter filled in by the caller
+    rays.resize (7, 9, 33, 5);
+    rays.jitterU.setConstant (0.5f);
+    rays.jitterV.setLinSpaced (0.0f, 0.99f);
+    camera->generateJitteredRays (rays);
+    CHECK (test::countMismatches (rays, [&] (uint32_t x, uint32_t y, Eigen::Index i)
+                                  { return camera->generateRay (x, y, rays.jitterU[i], rays.jitterV[i]); }) == 0);
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
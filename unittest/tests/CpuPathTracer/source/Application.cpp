@@ -0,0 +1,285 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "CpuPathTracer";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using sabi::CameraBody;
+using sabi::CpuPathTracer;
+using sabi::PathTracerMesh;
+using sabi::PathTracerSettings;
+using sabi::PathTracerView;
+
+namespace test
+{
+    // a y up square of side 2 * halfSize centred on the origin, facing +y
+    inline PathTracerMesh quad (float halfSize, const Eigen::Vector3f& albedo)
+    {
+        PathTracerMesh mesh;
+        mesh.V.resize (3, 4);
+        mesh.V.col (0) = Eigen::Vector3f (-halfSize, 0.0f, -halfSize);
+        mesh.V.col (1) = Eigen::Vector3f (halfSize, 0.0f, -halfSize);
+        mesh.V.col (2) = Eigen::Vector3f (halfSize, 0.0f, halfSize);
+        mesh.V.col (3) = Eigen::Vector3f (-halfSize, 0.0f, halfSize);
+        mesh.F.resize (3, 2);
+        mesh.F.col (0) = Vector3u (0, 2, 1);
+        mesh.F.col (1) = Vector3u (0, 3, 2);
+        mesh.material.albedo = albedo;
+        return mesh;
+    }
+
+    inline PathTracerMesh triangleSoup (uint32_t count, uint32_t seed)
+    {
+        std::mt19937 rng (seed);
+        std::uniform_real_distribution<float> position (-1.0f, 1.0f);
+        std::uniform_real_distribution<float> offset (-0.3f, 0.3f);
+
+        PathTracerMesh mesh;
+        mesh.V.resize (3, count * 3);
+        mesh.F.resize (3, count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            Eigen::Vector3f center (position (rng), position (rng), position (rng));
+            for (uint32_t corner = 0; corner < 3; ++corner)
+            {
+                mesh.V.col (i * 3 + corner) = center + Eigen::Vector3f (offset (rng), offset (rng), offset (rng));
+                mesh.F (corner, i) = i * 3 + corner;
+            }
+        }
+        mesh.material.albedo = Eigen::Vector3f (0.7f, 0.5f, 0.3f);
+        return mesh;
+    }
+
+    // a sky dome of one colour, importance follows sin theta so sampling is uniform over the sphere
+    inline mace::EnvLightDataRef constantSky (const Eigen::Vector3f& colour, uint32_t width = 64, uint32_t height = 32)
+    {
+        mace::EnvLightDataRef env = std::make_shared<mace::EnvLightData>();
+        env->width = width;
+        env->height = height;
+        env->rgba.resize (size_t (width) * height * 4);
+        for (size_t i = 0; i < size_t (width) * height; ++i)
+        {
+            env->rgba[i * 4 + 0] = colour.x();
+            env->rgba[i * 4 + 1] = colour.y();
+            env->rgba[i * 4 + 2] = colour.z();
+            env->rgba[i * 4 + 3] = 1.0f;
+        }
+
+        std::vector<float> importance (size_t (width) * height);
+        for (uint32_t y = 0; y < height; ++y)
+            std::fill_n (importance.begin() + size_t (y) * width, width, std::sin ((y + 0.5f) / height * 3.14159265f));
+        env->distribution = mace::EnvLightDistribution::build (importance.data(), width, height);
+        return env;
+    }
+
+    // looking straight down at the origin from 2 units up
+    inline PathTracerView topView (uint32_t width, uint32_t height)
+    {
+        PathTracerView view;
+        view.eye = Eigen::Vector3f (0.0f, 2.0f, 0.0f);
+        view.right = Eigen::Vector3f (1.0f, 0.0f, 0.0f);
+        view.up = Eigen::Vector3f (0.0f, 0.0f, 1.0f);
+        view.forward = Eigen::Vector3f (0.0f, -1.0f, 0.0f);
+        view.fovY = 0.5f;
+        view.aspect = float (width) / height;
+        view.width = width;
+        view.height = height;
+        return view;
+    }
+
+    inline Eigen::Vector3f pixel (const std::vector<float>& rgba, uint32_t width, uint32_t x, uint32_t y)
+    {
+        const float* p = rgba.data() + (size_t (y) * width + x) * 4;
+        return Eigen::Vector3f (p[0], p[1], p[2]);
+    }
+} // namespace test
+
+TEST_CASE ("Camera rays that miss see the sky dome")
+{
+    PathTracerSettings settings;
+    settings.log10EnvLightPowerCoeff = 0.5f;
+
+    CpuPathTracer tracer (settings);
+    tracer.setEnvironment (test::constantSky (Eigen::Vector3f (0.25f, 0.5f, 1.0f)));
+
+    PathTracerView view = test::topView (40, 30);
+    view.forward = Eigen::Vector3f (0.3f, 0.4f, 0.5f).normalized();
+    std::vector<float> rgba (40 * 30 * 4, -1.0f);
+    tracer.render (view, rgba.data());
+
+    float coeff = std::pow (10.0f, 0.5f);
+    for (uint32_t y = 0; y < 30; ++y)
+    {
+        for (uint32_t x = 0; x < 40; ++x)
+        {
+            CHECK (test::pixel (rgba, 40, x, y).isApprox (coeff * Eigen::Vector3f (0.25f, 0.5f, 1.0f), 1e-5f));
+            CHECK (rgba[(y * 40 + x) * 4 + 3] == 1.0f);
+        }
+    }
+
+    CHECK_THROWS (tracer.setEnvironment (std::make_shared<mace::EnvLightData>()));
+}
+
+TEST_CASE ("Without a sky dome surfaces pick up the ambient colour")
+{
+    const Eigen::Vector3f ambient (0.01f, 0.015f, 0.02f);
+    const Eigen::Vector3f albedo (0.8f, 0.4f, 0.2f);
+
+    // the quad fills the middle of the view, the rest misses
+    CpuPathTracer tracer;
+    tracer.addInstance (tracer.addMesh (test::quad (0.2f, albedo)), Pose::Identity());
+
+    std::vector<float> rgba (32 * 32 * 4);
+    tracer.render (test::topView (32, 32), rgba.data());
+
+    // every bounce off the quad goes up and misses
+    CHECK (test::pixel (rgba, 32, 16, 16).isApprox (albedo.cwiseProduct (ambient), 1e-5f));
+    CHECK (test::pixel (rgba, 32, 0, 0).isApprox (ambient, 1e-5f));
+}
+
+TEST_CASE ("The image doesn't depend on the tiles")
+{
+    std::vector<std::vector<float>> images;
+    for (uint32_t tileSize : {16u, 7u, 64u})
+    {
+        PathTracerSettings settings;
+        settings.tileSize = tileSize;
+        settings.maxPathLength = 4;
+
+        CpuPathTracer tracer (settings);
+        tracer.setEnvironment (test::constantSky (Eigen::Vector3f (1.0f, 0.9f, 0.8f)));
+
+        uint32_t soup = tracer.addMesh (test::triangleSoup (300, 1));
+        tracer.addInstance (soup, Pose::Identity());
+        Pose pose = Pose::Identity();
+        pose.translate (Eigen::Vector3f (0.5f, -1.0f, 0.25f));
+        tracer.addInstance (soup, pose);
+
+        std::vector<float> rgba (50 * 37 * 4);
+        for (int frame = 0; frame < 2; ++frame)
+            tracer.render (test::topView (50, 37), rgba.data());
+        images.push_back (std::move (rgba));
+    }
+
+    // bit for bit, each pixel owns its random numbers
+    CHECK (images[0] == images[1]);
+    CHECK (images[0] == images[2]);
+}
+
+TEST_CASE ("Frames fold into a running average")
+{
+    auto makeTracer = []
+    {
+        auto tracer = std::make_unique<CpuPathTracer>();
+        tracer->setEnvironment (test::constantSky (Eigen::Vector3f::Ones()));
+        tracer->addInstance (tracer->addMesh (test::triangleSoup (200, 2)), Pose::Identity());
+        return tracer;
+    };
+
+    PathTracerView view = test::topView (24, 24);
+    const size_t count = 24 * 24 * 4;
+
+    // restarting keeps the random numbers going, so b's second image is a's second sample on its own
+    auto a = makeTracer();
+    auto b = makeTracer();
+    std::vector<float> averaged (count), first (count), second (count);
+    a->render (view, averaged.data());
+    a->render (view, averaged.data());
+    b->render (view, first.data());
+    b->restart();
+    b->render (view, second.data());
+
+    CHECK (a->getAccumulatedFrames() == 2);
+    CHECK (b->getAccumulatedFrames() == 1);
+    for (size_t i = 0; i < count; ++i)
+        CHECK (averaged[i] == doctest::Approx (0.5f * first[i] + 0.5f * second[i]));
+
+    // moving an instance starts over
+    a->setTransform (0, Pose (Eigen::Translation3f (0.0f, 0.1f, 0.0f)));
+    CHECK (a->getAccumulatedFrames() == 0);
+}
+
+TEST_CASE ("A lit plane converges to the expected radiance")
+{
+    PathTracerSettings settings;
+    settings.log10EnvLightPowerCoeff = 0.0f;
+
+    const Eigen::Vector3f albedo (0.5f, 0.5f, 0.5f);
+    CpuPathTracer tracer (settings);
+    tracer.setEnvironment (test::constantSky (Eigen::Vector3f::Ones()));
+    tracer.addInstance (tracer.addMesh (test::quad (10.0f, albedo)), Pose::Identity());
+
+    std::vector<float> rgba (16 * 16 * 4);
+    for (int frame = 0; frame < 64; ++frame)
+        tracer.render (test::topView (16, 16), rgba.data());
+
+    // Lambert under a white sky is albedo * 1 when the MIS weights sum to one. The kernels
+    // weight the sky hit with a fixed bsdf density of 0.25, so the expectation is
+    // albedo * (NEE weighted over the hemisphere + the constant sky hit weight)
+    const double pi = 3.14159265358979;
+    const double light = 1.0 / (4.0 * pi);
+    double nee = 0.0;
+    const int steps = 10000;
+    for (int i = 0; i < steps; ++i)
+    {
+        double mu = (i + 0.5) / steps;
+        double bsdf = mu / pi;
+        nee += 2.0 * mu * light * light / (bsdf * bsdf + light * light) / steps;
+    }
+    double skyHit = 0.0625 / (0.0625 + light * light);
+    float expected = static_cast<float> (0.5 * (nee + skyHit));
+
+    Eigen::Vector3f mean = Eigen::Vector3f::Zero();
+    for (uint32_t y = 0; y < 16; ++y)
+        for (uint32_t x = 0; x < 16; ++x)
+            mean += test::pixel (rgba, 16, x, y);
+    mean /= 256.0f;
+
+    CHECK (mean.x() == doctest::Approx (expected).epsilon (0.05));
+    CHECK (mean.y() == doctest::Approx (mean.x()));
+}
+
+TEST_CASE ("Renders into the camera sensor")
+{
+    CameraBody camera;
+    camera.getSensor()->setPixelResolution (48, 32);
+    camera.lookAt (Eigen::Vector3f (0.0f, 3.0f, -3.0f), Eigen::Vector3f::Zero());
+
+    CpuPathTracer tracer;
+    tracer.setEnvironment (test::constantSky (Eigen::Vector3f (0.5f, 0.7f, 1.0f)));
+    tracer.addInstance (tracer.addMesh (test::quad (1.0f, Eigen::Vector3f (0.6f, 0.6f, 0.6f))), Pose::Identity());
+    tracer.render (camera);
+    CHECK (!camera.isDirty());
+
+    // the same launch through the view the camera hands over
+    CpuPathTracer reference;
+    reference.setEnvironment (test::constantSky (Eigen::Vector3f (0.5f, 0.7f, 1.0f)));
+    reference.addInstance (reference.addMesh (test::quad (1.0f, Eigen::Vector3f (0.6f, 0.6f, 0.6f))), Pose::Identity());
+    std::vector<float> rgba (48 * 32 * 4);
+    reference.render (PathTracerView::fromCamera (camera), rgba.data());
+
+    const float* pixels = static_cast<const float*> (camera.getSensorPixels().localpixels());
+    CHECK (std::equal (rgba.begin(), rgba.end(), pixels));
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
@@ -0,0 +1,242 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "DecodedImageCache";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using mace::DecodedImageCache;
+using mace::DecodedImageRef;
+using mace::ImageDecodeOptions;
+
+// The decoder is a stub that makes synthetic images so nothing
+// touches the disk, it counts how often each path gets decoded
+
+namespace test
+{
+    constexpr int SIZE = 16;
+    constexpr size_t IMAGE_BYTES = SIZE * SIZE * 4;
+
+    struct CountingDecoder
+    {
+        std::mutex mutex;
+        std::unordered_map<std::string, uint32_t> calls;
+        std::chrono::milliseconds delay{0};
+
+        uint32_t count (const std::string& path)
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            return calls[std::filesystem::path (path).filename().string()];
+        }
+
+        DecodedImageCache::Decoder make()
+        {
+            return [this] (const std::filesystem::path& path, const ImageDecodeOptions& options)
+            {
+                {
+                    std::lock_guard<std::mutex> lock (mutex);
+                    ++calls[path.filename().string()];
+                }
+                if (delay.count()) std::this_thread::sleep_for (delay);
+
+                if (path.filename() == "missing.png") return OIIO::ImageBuf();
+
+                return OIIO::ImageBuf (OIIO::ImageSpec (SIZE, SIZE, 4, OIIO::TypeDesc::UINT8));
+            };
+        }
+    };
+} // namespace test
+
+TEST_CASE ("The same file is decoded once and shared")
+{
+    test::CountingDecoder decoder;
+    DecodedImageCache cache (DecodedImageCache::DEFAULT_BYTE_BUDGET, decoder.make());
+
+    DecodedImageRef a = cache.acquire ("textures/wood.png");
+    DecodedImageRef b = cache.acquire ("textures/../textures/wood.png");
+
+    REQUIRE (a);
+    CHECK (a == b);
+    CHECK (decoder.count ("wood.png") == 1);
+    CHECK (cache.getEntryCount() == 1);
+    CHECK (cache.getHitCount() == 1);
+    CHECK (cache.getResidentBytes() == test::IMAGE_BYTES);
+}
+
+TEST_CASE ("Concurrent requests for one image wait for a single decode")
+{
+    test::CountingDecoder decoder;
+    decoder.delay = std::chrono::milliseconds (20);
+    DecodedImageCache cache (DecodedImageCache::DEFAULT_BYTE_BUDGET, decoder.make());
+
+    std::vector<DecodedImageRef> results (8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < results.size(); ++i)
+        threads.emplace_back ([&, i]()
+                              { results[i] = cache.acquire ("brick.png"); });
+    for (auto& t : threads)
+        t.join();
+
+    CHECK (decoder.count ("brick.png") == 1);
+    for (const auto& image : results)
+        CHECK (image == results[0]);
+}
+
+TEST_CASE ("A waiter whose image was evicted before it woke decodes it again")
+{
+    test::CountingDecoder decoder;
+    decoder.delay = std::chrono::milliseconds (2);
+    DecodedImageCache cache (DecodedImageCache::DEFAULT_BYTE_BUDGET, decoder.make());
+
+    // trim keeps dropping the image as soon as the first caller lets go of it, the
+    // waiters queued behind the decode often find it gone again when they wake
+    std::atomic<bool> running = true;
+    std::thread trimmer ([&]()
+                         {
+        while (running)
+            cache.trim(); });
+
+    std::atomic<uint32_t> missing = 0;
+    for (int round = 0; round < 300; ++round)
+    {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 32; ++i)
+            threads.emplace_back ([&]()
+                                  {
+                if (!cache.acquire ("gravel.png")) ++missing; });
+        for (auto& t : threads)
+            t.join();
+    }
+
+    running = false;
+    trimmer.join();
+
+    CHECK (missing == 0);
+}
+
+TEST_CASE ("Different decode options are different entries")
+{
+    test::CountingDecoder decoder;
+    DecodedImageCache cache (DecodedImageCache::DEFAULT_BYTE_BUDGET, decoder.make());
+
+    ImageDecodeOptions native;
+    native.forceRGBA8 = false;
+
+    DecodedImageRef a = cache.acquire ("stone.png");
+    DecodedImageRef b = cache.acquire ("stone.png", native);
+
+    CHECK (a != b);
+    CHECK (a->key != b->key);
+    CHECK (decoder.count ("stone.png") == 2);
+    CHECK (cache.getEntryCount() == 2);
+}
+
+TEST_CASE ("Unused images are evicted least recently used first")
+{
+    test::CountingDecoder decoder;
+    DecodedImageCache cache (test::IMAGE_BYTES * 2, decoder.make());
+
+    cache.acquire ("a.png");
+    cache.acquire ("b.png");
+    cache.acquire ("a.png"); // b is now the oldest
+    cache.acquire ("c.png");
+
+    CHECK (cache.getEntryCount() == 2);
+    CHECK (cache.getResidentBytes() <= cache.getByteBudget());
+
+    cache.acquire ("a.png");
+    CHECK (decoder.count ("a.png") == 1);
+
+    cache.acquire ("b.png");
+    CHECK (decoder.count ("b.png") == 2);
+}
+
+TEST_CASE ("Images a caller still holds are never evicted")
+{
+    test::CountingDecoder decoder;
+    DecodedImageCache cache (test::IMAGE_BYTES, decoder.make());
+
+    DecodedImageRef a = cache.acquire ("a.png");
+    DecodedImageRef b = cache.acquire ("b.png");
+
+    // both pinned, the cache goes over budget rather than drop them
+    CHECK (cache.getEntryCount() == 2);
+    CHECK (cache.getResidentBytes() == test::IMAGE_BYTES * 2);
+
+    a.reset();
+    cache.setByteBudget (test::IMAGE_BYTES);
+    CHECK (cache.getEntryCount() == 1);
+    CHECK (cache.acquire ("b.png") == b);
+}
+
+TEST_CASE ("Trim drops everything no caller holds")
+{
+    test::CountingDecoder decoder;
+    DecodedImageCache cache (DecodedImageCache::DEFAULT_BYTE_BUDGET, decoder.make());
+
+    DecodedImageRef kept = cache.acquire ("kept.png");
+    cache.acquire ("dropped.png");
+
+    cache.trim();
+    CHECK (cache.getEntryCount() == 1);
+    CHECK (cache.getResidentBytes() == kept->bytes);
+}
+
+TEST_CASE ("A failed decode returns nullptr and is not cached")
+{
+    test::CountingDecoder decoder;
+    DecodedImageCache cache (DecodedImageCache::DEFAULT_BYTE_BUDGET, decoder.make());
+
+    CHECK (cache.acquire ("missing.png") == nullptr);
+    CHECK (cache.getEntryCount() == 0);
+
+    // a later request tries again, the file may have shown up since
+    CHECK (cache.acquire ("missing.png") == nullptr);
+    CHECK (decoder.count ("missing.png") == 2);
+}
+
+TEST_CASE ("Float images are sRGB encoded on the way to 8 bit")
+{
+    // linear mid grey with half alpha
+    OIIO::ImageBuf linear (OIIO::ImageSpec (2, 1, 4, OIIO::TypeDesc::FLOAT));
+    float* pixels = static_cast<float*> (linear.localpixels());
+    for (int i = 0; i < 8; ++i)
+        pixels[i] = 0.5f;
+
+    OIIO::ImageBuf rgba8 = DecodedImageCache::toRGBA8 (linear);
+    REQUIRE (rgba8.initialized());
+    REQUIRE (rgba8.spec().format == OIIO::TypeDesc::UINT8);
+
+    const uint8_t* encoded = static_cast<const uint8_t*> (rgba8.localpixels());
+    for (int i = 0; i < 8; ++i)
+        CHECK (int (encoded[i]) == (i % 4 == 3 ? 128 : 188));
+
+    // out of range values are clamped
+    pixels[0] = 4.0f;
+    pixels[1] = -1.0f;
+    rgba8 = DecodedImageCache::toRGBA8 (linear);
+    encoded = static_cast<const uint8_t*> (rgba8.localpixels());
+    CHECK (encoded[0] == 255);
+    CHECK (encoded[1] == 0);
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
@@ -0,0 +1,181 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "DirectoryIndex";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using mace::DirectoryIndex;
+using mace::DirectoryIndexService;
+namespace fs = std::filesystem;
+
+// Each test builds a small folder tree under the temp folder and
+// removes it when it's done
+
+namespace test
+{
+    struct TempTree
+    {
+        fs::path root;
+
+        TempTree (const std::string& name)
+        {
+            root = fs::temp_directory_path() / ("DirectoryIndex_" + name);
+            fs::remove_all (root);
+            fs::create_directories (root);
+        }
+        ~TempTree() { fs::remove_all (root); }
+
+        fs::path touch (const fs::path& relative)
+        {
+            fs::path path = root / relative;
+            fs::create_directories (path.parent_path());
+            std::ofstream (path) << "x";
+            return path;
+        }
+    };
+} // namespace test
+
+TEST_CASE ("Files anywhere under the root are found by filename")
+{
+    test::TempTree tree ("nested");
+    fs::path wood = tree.touch ("a/b/c/wood.png");
+    tree.touch ("a/stone.jpg");
+    tree.touch ("readme.txt");
+
+    DirectoryIndex index (tree.root);
+
+    REQUIRE (index.find ("wood.png"));
+    CHECK (fs::equivalent (*index.find ("wood.png"), wood));
+
+    // only the filename part of a relative reference matters
+    CHECK (index.find ("textures/stone.jpg"));
+    CHECK (!index.find ("metal.png"));
+
+    CHECK (index.getFileCount() == 3);
+    CHECK (index.getFolderCount() == 4);
+}
+
+TEST_CASE ("Duplicate filenames come back in path order")
+{
+    test::TempTree tree ("duplicates");
+    tree.touch ("b/tile.png");
+    tree.touch ("a/tile.png");
+
+    DirectoryIndex index (tree.root);
+
+    std::vector<fs::path> all = index.findAll ("tile.png");
+    REQUIRE (all.size() == 2);
+    CHECK (all[0].parent_path().filename() == "a");
+    CHECK (fs::equivalent (*index.find ("tile.png"), all[0]));
+}
+
+TEST_CASE ("Case insensitive lookups are optional")
+{
+    test::TempTree tree ("case");
+    tree.touch ("Textures/Wood.PNG");
+
+    DirectoryIndex exact (tree.root);
+    DirectoryIndex relaxed (tree.root, true);
+
+    CHECK (!exact.find ("wood.png"));
+    CHECK (relaxed.find ("wood.png"));
+    CHECK (relaxed.find ("WOOD.png"));
+}
+
+TEST_CASE ("Refresh only picks up folders that changed")
+{
+    test::TempTree tree ("refresh");
+    tree.touch ("a/one.png");
+    tree.touch ("b/two.png");
+
+    DirectoryIndex index (tree.root);
+    index.setRefreshInterval (std::chrono::milliseconds (0));
+    CHECK (index.getFileCount() == 2);
+    CHECK (!index.refresh());
+
+    // new file in an existing folder, and a whole new folder tree
+    tree.touch ("a/three.png");
+    tree.touch ("c/d/four.png");
+    CHECK (index.refresh());
+    CHECK (index.find ("three.png"));
+    CHECK (index.find ("four.png"));
+    CHECK (index.getFolderCount() == 5);
+
+    // removing a folder forgets everything below it
+    fs::remove_all (tree.root / "c");
+    CHECK (index.refresh());
+    CHECK (!index.find ("four.png"));
+    CHECK (index.getFolderCount() == 3);
+}
+
+TEST_CASE ("A miss refreshes the index before giving up")
+{
+    test::TempTree tree ("miss");
+    tree.touch ("a/one.png");
+
+    DirectoryIndex index (tree.root);
+    index.setRefreshInterval (std::chrono::milliseconds (0));
+    CHECK (!index.find ("late.png"));
+
+    tree.touch ("a/late.png");
+    CHECK (index.find ("late.png"));
+
+    // a deleted file isn't handed out even before the index notices
+    fs::remove (tree.root / "a/one.png");
+    CHECK (!index.find ("one.png"));
+}
+
+TEST_CASE ("The service shares one index per root")
+{
+    test::TempTree tree ("service");
+    tree.touch ("x/shared.png");
+
+    DirectoryIndexService& service = DirectoryIndexService::get();
+    auto a = service.getIndex (tree.root);
+    auto b = service.getIndex (tree.root / "x" / "..");
+    CHECK (a == b);
+    CHECK (service.getIndex (tree.root, true) != a);
+    CHECK (service.find (tree.root, "shared.png"));
+
+    service.clear();
+    CHECK (service.getIndex (tree.root) != a);
+}
+
+TEST_CASE ("Lookups from inside scheduler tasks don't deadlock")
+{
+    test::TempTree tree ("nested_tasks");
+    for (int i = 0; i < 32; ++i)
+        tree.touch (fs::path ("folder" + std::to_string (i)) / ("file" + std::to_string (i) + ".png"));
+
+    mace::DirectoryIndexRef index = DirectoryIndex::create (tree.root);
+
+    std::atomic<uint32_t> found = 0;
+    mace::TaskScheduler::get().parallel_for (0, 32, 1, [&] (uint32_t start, uint32_t end)
+                                             {
+        for (uint32_t i = start; i < end; ++i)
+            if (index->find ("file" + std::to_string (i) + ".png")) ++found; });
+
+    CHECK (found == 32);
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
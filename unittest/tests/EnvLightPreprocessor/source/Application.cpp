@@ -0,0 +1,209 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "EnvLightPreprocessor";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using mace::EnvLightDistribution;
+using mace::EnvLightOptions;
+using mace::EnvLightPreprocessor;
+
+namespace test
+{
+    inline std::vector<float> makeRGBA (uint32_t width, uint32_t height, uint32_t seed)
+    {
+        std::vector<float> rgba (size_t (width) * height * 4);
+        std::mt19937 rng (seed);
+        std::uniform_real_distribution<float> dist (0.0f, 4.0f);
+        for (float& v : rgba)
+            v = dist (rng);
+        return rgba;
+    }
+
+    // what SkyDomeHandler used to compute one pixel at a time
+    inline float referenceImportance (const float* pixel, uint32_t y, uint32_t height)
+    {
+        float sinTheta = std::sin (std::numbers::pi_v<float> * (y + 0.5f) / height);
+        float r = std::max (pixel[0], 0.0f);
+        float g = std::max (pixel[1], 0.0f);
+        float b = std::max (pixel[2], 0.0f);
+        return (0.2126729f * r + 0.7151522f * g + 0.0721750f * b) * sinTheta;
+    }
+} // namespace test
+
+TEST_CASE ("Pixels are clamped to finite non negative values with alpha 1")
+{
+    std::vector<float> rgba = {
+        -1.0f, 2.0f, std::numeric_limits<float>::quiet_NaN(), 0.5f,
+        std::numeric_limits<float>::infinity(), 1.0f, 1.0f, 7.0f,
+        0.25f, 0.5f, 0.75f, 0.0f};
+
+    std::vector<float> importance;
+    uint32_t w = 0, h = 0;
+    EnvLightPreprocessor::computeImportance (rgba.data(), 3, 1, EnvLightOptions(), importance, w, h);
+
+    for (float v : rgba)
+    {
+        CHECK (std::isfinite (v));
+        CHECK (v >= 0.0f);
+    }
+    CHECK (rgba[0] == 0.0f);
+    CHECK (rgba[2] == 0.0f);
+    CHECK (rgba[3] == 1.0f);
+    CHECK (rgba[7] == 1.0f);
+    CHECK (rgba[8] == 0.25f);
+    CHECK (std::isfinite (importance[1]));
+}
+
+TEST_CASE ("Full resolution importance matches the per pixel reference")
+{
+    const uint32_t width = 67, height = 33;
+    std::vector<float> rgba = test::makeRGBA (width, height, 1);
+    std::vector<float> source = rgba;
+
+    std::vector<float> importance;
+    uint32_t w = 0, h = 0;
+    EnvLightPreprocessor::computeImportance (rgba.data(), width, height, EnvLightOptions(), importance, w, h);
+
+    REQUIRE (w == width);
+    REQUIRE (h == height);
+    for (uint32_t y = 0; y < height; ++y)
+        for (uint32_t x = 0; x < width; ++x)
+            REQUIRE (importance[y * width + x] ==
+                     doctest::Approx (test::referenceImportance (&source[(y * width + x) * 4], y, height)).epsilon (1e-5));
+}
+
+TEST_CASE ("The importance map is box filtered down by a whole factor")
+{
+    const uint32_t width = 10, height = 5;
+    std::vector<float> rgba = test::makeRGBA (width, height, 2);
+    std::vector<float> source = rgba;
+
+    EnvLightOptions options;
+    options.importanceWidth = 4;
+
+    std::vector<float> importance;
+    uint32_t w = 0, h = 0;
+    EnvLightPreprocessor::computeImportance (rgba.data(), width, height, options, importance, w, h);
+
+    // factor 3, the last column and row of cells cover what's left over
+    REQUIRE (w == 4);
+    REQUIRE (h == 2);
+
+    for (uint32_t my = 0; my < h; ++my)
+    {
+        for (uint32_t mx = 0; mx < w; ++mx)
+        {
+            double sum = 0.0;
+            uint32_t count = 0;
+            for (uint32_t y = my * 3; y < std::min (height, my * 3 + 3); ++y)
+                for (uint32_t x = mx * 3; x < std::min (width, mx * 3 + 3); ++x, ++count)
+                    sum += test::referenceImportance (&source[(y * width + x) * 4], y, height);
+
+            CHECK (importance[my * w + mx] == doctest::Approx (sum / count).epsilon (1e-5));
+        }
+    }
+}
+
+TEST_CASE ("Distributions are normalized and zero rows stay sampleable")
+{
+    const uint32_t width = 8, height = 4;
+    std::vector<float> importance (width * height);
+    for (uint32_t i = 0; i < importance.size(); ++i)
+        importance[i] = float (i % 5);
+    std::fill (importance.begin() + width, importance.begin() + 2 * width, 0.0f);
+
+    auto dist = EnvLightDistribution::build (importance.data(), width, height);
+    REQUIRE (dist);
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const float* pdf = dist->rowPDFs.data() + y * width;
+        const float* cdf = dist->rowCDFs.data() + y * (width + 1);
+
+        double integral = 0.0;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            integral += pdf[x] / width;
+            CHECK (cdf[x + 1] >= cdf[x]);
+        }
+        CHECK (integral == doctest::Approx (1.0));
+        CHECK (cdf[0] == 0.0f);
+        CHECK (cdf[width] == 1.0f);
+    }
+
+    // the empty row is uniform within itself but never picked by the marginal
+    CHECK (dist->rowIntegrals[1] == 0.0f);
+    CHECK (dist->rowPDFs[width] == 1.0f);
+    CHECK (dist->marginalPDF[1] == 0.0f);
+    CHECK (dist->marginalCDF[height] == 1.0f);
+
+    double total = 0.0;
+    for (float v : importance)
+        total += v;
+    CHECK (dist->integral == doctest::Approx (total / importance.size()));
+}
+
+TEST_CASE ("Distributions round trip through the cache file")
+{
+    std::vector<float> importance (16 * 8);
+    for (size_t i = 0; i < importance.size(); ++i)
+        importance[i] = float (i % 7) + 0.5f;
+
+    auto dist = EnvLightDistribution::build (importance.data(), 16, 8);
+    std::filesystem::path path = std::filesystem::temp_directory_path() / ("EnvLightTest" + std::string (EnvLightDistribution::EXTENSION));
+    REQUIRE (dist->save (path, 99));
+
+    auto loaded = EnvLightDistribution::load (path, 99);
+    REQUIRE (loaded);
+    CHECK (loaded->width == 16);
+    CHECK (loaded->height == 8);
+    CHECK (loaded->integral == dist->integral);
+    CHECK (loaded->rowCDFs == dist->rowCDFs);
+    CHECK (loaded->marginalCDF == dist->marginalCDF);
+
+    CHECK (EnvLightDistribution::load (path, 100) == nullptr);
+    std::filesystem::remove (path);
+}
+
+TEST_CASE ("RGB images come out as clamped RGBA")
+{
+    OIIO::ImageBuf image (OIIO::ImageSpec (4, 2, 3, OIIO::TypeDesc::FLOAT));
+    float* pixels = static_cast<float*> (image.localpixels());
+    for (int i = 0; i < 4 * 2 * 3; ++i)
+        pixels[i] = i % 2 ? 1.0f : -1.0f;
+
+    auto env = EnvLightPreprocessor::process (image);
+    REQUIRE (env);
+    CHECK (env->width == 4);
+    CHECK (env->height == 2);
+    REQUIRE (env->rgba.size() == 4 * 2 * 4);
+    CHECK (env->rgba[0] == 0.0f);
+    CHECK (env->rgba[1] == 1.0f);
+    CHECK (env->rgba[3] == 1.0f);
+    CHECK (!env->fromCache);
+    REQUIRE (env->distribution);
+    CHECK (env->distribution->width == 4);
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
@@ -0,0 +1,252 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "ImageRegions";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using mace::ImageRegions;
+using mace::ImageTile;
+using mace::ImageTileRange;
+
+namespace test
+{
+    const int WIDTH = 256;
+    const int HEIGHT = 128;
+    const int CHANNELS = 4;
+
+    // every value is exact in float and tells where it came from
+    inline float value (int x, int y, int c)
+    {
+        return float (x) + float (y) * 1000.0f + float (c) * 0.25f;
+    }
+
+    // a float texture tiled and MIP mapped like the ones baked for the renderer,
+    // 9 levels from 256 x 128 down to 1 x 1
+    inline std::string writeTexture()
+    {
+        std::filesystem::path folder = std::filesystem::temp_directory_path() / "ImageRegionsTest";
+        std::filesystem::create_directories (folder);
+        std::string path = (folder / "texture.exr").generic_string();
+
+        OIIO::ImageBuf image (OIIO::ImageSpec (WIDTH, HEIGHT, CHANNELS, OIIO::TypeDesc::FLOAT));
+        float* pixels = static_cast<float*> (image.localpixels());
+        for (int y = 0; y < HEIGHT; ++y)
+            for (int x = 0; x < WIDTH; ++x)
+                for (int c = 0; c < CHANNELS; ++c)
+                    pixels[(size_t (y) * WIDTH + x) * CHANNELS + c] = value (x, y, c);
+
+        OIIO::ImageSpec config;
+        config.tile_width = 16;
+        config.tile_height = 16;
+        config.attribute ("maketx:filtername", "box");
+        OIIO::ImageBufAlgo::make_texture (OIIO::ImageBufAlgo::MakeTxTexture, image, path, config);
+        return path;
+    }
+
+    inline OIIO::ImageCache* makeCache()
+    {
+        OIIO::ImageCache* cache = OIIO::ImageCache::create (false);
+        cache->attribute ("max_memory_MB", 64.0f);
+        cache->attribute ("autotile", 64);
+        return cache;
+    }
+
+    // the level read in one go straight from the file, bypassing the cache
+    inline std::vector<float> readLevel (const std::string& path, int miplevel, OIIO::ImageSpec& spec)
+    {
+        OIIO::ImageBuf level (path, 0, miplevel);
+        level.read (0, miplevel, true, OIIO::TypeDesc::FLOAT);
+        spec = level.spec();
+
+        std::vector<float> pixels (size_t (spec.width) * spec.height * spec.nchannels);
+        level.get_pixels (OIIO::get_roi (spec), OIIO::TypeDesc::FLOAT, pixels.data());
+        return pixels;
+    }
+} // namespace test
+
+TEST_CASE ("The chosen MIP level is the smallest still covering the scale")
+{
+    std::string path = test::writeTexture();
+    OIIO::ImageCache* cache = test::makeCache();
+
+    int levels = ImageRegions::getMipLevelCount (cache, path);
+    CHECK (levels == 9);
+
+    CHECK (ImageRegions::chooseMipLevel (cache, path, 1.0f) == 0);
+    CHECK (ImageRegions::chooseMipLevel (cache, path, 2.0f) == 0);
+    CHECK (ImageRegions::chooseMipLevel (cache, path, 0.5f) == 1);
+    CHECK (ImageRegions::chooseMipLevel (cache, path, 0.3f) == 1);
+    CHECK (ImageRegions::chooseMipLevel (cache, path, 0.25f) == 2);
+    CHECK (ImageRegions::chooseMipLevel (cache, path, 0.01f) == 6);
+
+    // the level covers the wanted size and the next one down doesn't
+    for (float scale = 0.005f; scale < 1.0f; scale *= 1.3f)
+    {
+        int level = ImageRegions::chooseMipLevel (cache, path, scale);
+
+        OIIO::ImageSpec spec;
+        REQUIRE (ImageRegions::getLevelSpec (cache, path, level, spec));
+        CHECK (spec.width >= test::WIDTH * scale);
+        CHECK (spec.height >= test::HEIGHT * scale);
+
+        if (level + 1 < levels)
+        {
+            OIIO::ImageSpec smaller;
+            REQUIRE (ImageRegions::getLevelSpec (cache, path, level + 1, smaller));
+            CHECK ((smaller.width < test::WIDTH * scale || smaller.height < test::HEIGHT * scale));
+        }
+    }
+
+    CHECK (ImageRegions::chooseMipLevel (cache, path + ".missing", 0.5f) == 0);
+
+    OIIO::ImageCache::destroy (cache);
+}
+
+TEST_CASE ("A clipped region read matches the full resolution image")
+{
+    std::string path = test::writeTexture();
+    OIIO::ImageCache* cache = test::makeCache();
+
+    OIIO::ImageSpec spec;
+    REQUIRE (ImageRegions::getLevelSpec (cache, path, 0, spec));
+    CHECK (spec.tile_width == 16);
+
+    // hangs off the right and top edges, with no channels given
+    OIIO::ROI roi = ImageRegions::clip (spec, OIIO::ROI (200, 300, -10, 50));
+    CHECK (roi.xbegin == 200);
+    CHECK (roi.xend == test::WIDTH);
+    CHECK (roi.ybegin == 0);
+    CHECK (roi.yend == 50);
+    CHECK (roi.chbegin == 0);
+    CHECK (roi.chend == test::CHANNELS);
+
+    std::vector<float> region (roi.npixels() * roi.nchannels());
+    REQUIRE (ImageRegions::read (cache, path, 0, roi, OIIO::TypeDesc::FLOAT, region.data()));
+    for (int y = roi.ybegin; y < roi.yend; ++y)
+        for (int x = roi.xbegin; x < roi.xend; ++x)
+            for (int c = 0; c < test::CHANNELS; ++c)
+                REQUIRE (region[(size_t (y - roi.ybegin) * roi.width() + (x - roi.xbegin)) * test::CHANNELS + c] == test::value (x, y, c));
+
+    // just the middle two channels, tightly packed
+    roi = ImageRegions::clip (spec, OIIO::ROI (10, 40, 20, 30, 0, 1, 1, 3));
+    CHECK (roi.nchannels() == 2);
+    region.assign (roi.npixels() * roi.nchannels(), 0.0f);
+    REQUIRE (ImageRegions::read (cache, path, 0, roi, OIIO::TypeDesc::FLOAT, region.data()));
+    for (int y = roi.ybegin; y < roi.yend; ++y)
+        for (int x = roi.xbegin; x < roi.xend; ++x)
+            for (int c = 0; c < 2; ++c)
+                REQUIRE (region[(size_t (y - roi.ybegin) * roi.width() + (x - roi.xbegin)) * 2 + c] == test::value (x, y, c + 1));
+
+    // nothing left once clipped
+    roi = ImageRegions::clip (spec, OIIO::ROI (300, 400, 0, 10));
+    CHECK ((roi.width() <= 0 || roi.height() <= 0));
+
+    OIIO::ImageCache::destroy (cache);
+}
+
+TEST_CASE ("A region of a lower MIP level matches that level read whole")
+{
+    std::string path = test::writeTexture();
+    OIIO::ImageCache* cache = test::makeCache();
+
+    const int miplevel = ImageRegions::chooseMipLevel (cache, path, 0.25f);
+    OIIO::ImageSpec levelSpec;
+    std::vector<float> level = test::readLevel (path, miplevel, levelSpec);
+    CHECK (levelSpec.width == test::WIDTH / 4);
+
+    OIIO::ImageSpec spec;
+    REQUIRE (ImageRegions::getLevelSpec (cache, path, miplevel, spec));
+    OIIO::ROI roi = ImageRegions::clip (spec, OIIO::ROI (5, 50, 3, 40));
+    CHECK (roi.yend == spec.height);
+
+    std::vector<float> region (roi.npixels() * roi.nchannels());
+    REQUIRE (ImageRegions::read (cache, path, miplevel, roi, OIIO::TypeDesc::FLOAT, region.data()));
+    for (int y = roi.ybegin; y < roi.yend; ++y)
+        for (int x = roi.xbegin; x < roi.xend; ++x)
+            for (int c = 0; c < test::CHANNELS; ++c)
+                REQUIRE (region[(size_t (y - roi.ybegin) * roi.width() + (x - roi.xbegin)) * test::CHANNELS + c] ==
+                         level[(size_t (y) * levelSpec.width + x) * test::CHANNELS + c]);
+
+    OIIO::ImageCache::destroy (cache);
+}
+
+TEST_CASE ("Streamed tiles cover the region once with the right pixels")
+{
+    std::string path = test::writeTexture();
+    OIIO::ImageCache* cache = test::makeCache();
+
+    // starts and ends part way into the 16 x 16 tiles
+    ImageTileRange tiles (cache, path, 0, OIIO::ROI (7, 61, 9, 40));
+    REQUIRE (tiles.isValid());
+    CHECK (tiles.getTileCount() == 4 * 3);
+
+    const OIIO::ROI& roi = tiles.getRegion();
+    std::vector<int> visits (roi.npixels(), 0);
+    for (const ImageTile& tile : tiles)
+    {
+        REQUIRE (tile.isValid());
+        REQUIRE (tile.format == OIIO::TypeDesc::FLOAT);
+        for (int y = tile.roi.ybegin; y < tile.roi.yend; ++y)
+        {
+            for (int x = tile.roi.xbegin; x < tile.roi.xend; ++x)
+            {
+                const float* p = reinterpret_cast<const float*> (tile.pixel (x, y));
+                for (int c = 0; c < test::CHANNELS; ++c)
+                    REQUIRE (p[c] == test::value (x, y, c));
+                ++visits[size_t (y - roi.ybegin) * roi.width() + (x - roi.xbegin)];
+            }
+        }
+    }
+    CHECK (std::all_of (visits.begin(), visits.end(), [] (int n)
+                        { return n == 1; }));
+
+    OIIO::ImageCache::destroy (cache);
+}
+
+TEST_CASE ("Tiles that can't be read come back invalid and the range carries on")
+{
+    std::string path = test::writeTexture();
+    OIIO::ImageCache* cache = test::makeCache();
+
+    ImageTileRange tiles (cache, path, 0, OIIO::ROI (7, 61, 9, 40));
+    REQUIRE (tiles.isValid());
+
+    // the spec is already read, the tiles are gone by the time they're asked for
+    cache->invalidate (OIIO::ustring (path));
+    std::filesystem::remove (path);
+
+    uint32_t count = 0;
+    size_t covered = 0;
+    for (const ImageTile& tile : tiles)
+    {
+        CHECK_FALSE (tile.isValid());
+        covered += size_t (tile.roi.width()) * tile.roi.height();
+        ++count;
+    }
+    CHECK (count == tiles.getTileCount());
+    CHECK (covered == tiles.getRegion().npixels());
+
+    OIIO::ImageCache::destroy (cache);
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
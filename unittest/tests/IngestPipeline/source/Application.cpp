@@ -0,0 +1,382 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "IngestPipeline";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using sabi::IngestJob;
+using sabi::IngestPipeline;
+using sabi::IngestProgress;
+using sabi::IngestStages;
+using sabi::MeshCache;
+
+// The first tests run the real parse, process and materials stages on small
+// files written to a temp folder, only the commit is a stub that records
+// what reached the main thread. The rest check the pipeline's scheduling.
+
+namespace test
+{
+    struct ProgressObserver : public Observer
+    {
+        uint32_t fired = 0;
+        IngestProgress last;
+        uint32_t dropped = 0;
+
+        void onProgress (const IngestProgress& progress)
+        {
+            ++fired;
+            last = progress;
+        }
+        void onCancel (uint32_t droppedJobs) { dropped += droppedJobs; }
+    };
+
+    // a fresh folder for the scene files and one for their mesh cache
+    struct SceneFolder
+    {
+        std::filesystem::path root = std::filesystem::temp_directory_path() / "IngestPipelineTest";
+        std::filesystem::path cache = root / "cache";
+
+        SceneFolder()
+        {
+            std::filesystem::remove_all (root);
+            std::filesystem::create_directories (cache);
+
+            // only looked up, the decoder below never reads it
+            std::ofstream (root / "albedo.png") << "png";
+        }
+        ~SceneFolder() { std::filesystem::remove_all (root); }
+
+        void write (const std::string& name, const std::string& text) const { std::ofstream (root / name) << text; }
+    };
+
+    // a unit quad, the uv seam down its diagonal keeps 5 of the 6 corners apart
+    // and there are no normals so process has to generate them
+    inline void writeQuadObj (const SceneFolder& folder, const std::string& name)
+    {
+        folder.write ("quad.mtl",
+                      "newmtl painted\n"
+                      "Kd 0.5 0.25 1\n"
+                      "map_Kd albedo.png\n");
+
+        folder.write (name,
+                      "mtllib quad.mtl\n"
+                      "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+                      "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvt 0.5 0.5\n"
+                      "usemtl painted\n"
+                      "f 1/1 2/2 3/3\n"
+                      "f 1/5 3/3 4/4\n");
+    }
+
+    // one triangle mesh placed by two nodes, the vertex data lives in a .bin next to it
+    inline void writeInstancedGltf (const SceneFolder& folder, const std::string& name)
+    {
+        const float positions[] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+        const uint16_t indices[] = {0, 1, 2, 0};
+
+        std::ofstream bin (folder.root / "triangle.bin", std::ios::binary);
+        bin.write (reinterpret_cast<const char*> (positions), sizeof (positions));
+        bin.write (reinterpret_cast<const char*> (indices), sizeof (indices));
+        bin.close();
+
+        folder.write (name, R"({
+            "asset": {"version": "2.0"},
+            "buffers": [{"byteLength": 44, "uri": "triangle.bin"}],
+            "bufferViews": [{"buffer": 0, "byteOffset": 0, "byteLength": 36}, {"buffer": 0, "byteOffset": 36, "byteLength": 6}],
+            "accessors": [
+                {"bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3", "min": [0, 0, 0], "max": [1, 1, 0]},
+                {"bufferView": 1, "componentType": 5123, "count": 3, "type": "SCALAR"}],
+            "images": [{"uri": "albedo.png"}],
+            "textures": [{"source": 0}],
+            "materials": [{"name": "tinted", "pbrMetallicRoughness": {"baseColorFactor": [0.5, 0.25, 1, 1], "baseColorTexture": {"index": 0}}}],
+            "meshes": [{"primitives": [{"attributes": {"POSITION": 0}, "indices": 1, "material": 0}]}],
+            "nodes": [{"mesh": 0, "translation": [1, 0, 0]}, {"mesh": 0, "translation": [2, 0, 0]}],
+            "scenes": [{"nodes": [0, 1]}],
+            "scene": 0
+        })");
+    }
+
+    // the textures are found on disk but not decoded, any image stands in for them
+    inline mace::DecodedImageCacheRef makeImageCache()
+    {
+        return mace::DecodedImageCache::create (mace::DecodedImageCache::DEFAULT_BYTE_BUDGET,
+                                                [] (const std::filesystem::path& path, const mace::ImageDecodeOptions& options)
+                                                { return OIIO::ImageBuf (OIIO::ImageSpec (2, 2, 4, OIIO::TypeDesc::UINT8)); });
+    }
+
+    // the stages the renderer uses, with the commit left to the test
+    inline IngestStages makeStages (const MeshCache& meshCache, mace::DecodedImageCacheRef images)
+    {
+        IngestStages stages;
+        stages.parse = [&meshCache] (IngestJob& job)
+        { sabi::ingestParse (job, meshCache); };
+        stages.process = [&meshCache] (IngestJob& job)
+        { sabi::ingestProcess (job, meshCache); };
+        stages.materials = [images] (IngestJob& job)
+        { sabi::ingestMaterials (job, *images); };
+        return stages;
+    }
+
+    // runs a single file through the pipeline and hands back what the commit saw
+    inline IngestJob ingest (const std::filesystem::path& path, const MeshCache& meshCache, mace::DecodedImageCacheRef images)
+    {
+        IngestJob committed;
+        IngestStages stages = makeStages (meshCache, images);
+        stages.commit = [&] (IngestJob& job)
+        { committed = job; };
+
+        IngestPipeline pipeline (std::move (stages));
+        pipeline.submit (path);
+        pipeline.flush();
+
+        return committed;
+    }
+} // namespace test
+
+TEST_CASE ("Every job goes through the CPU stages in order and commits on the calling thread")
+{
+    test::SceneFolder folder;
+    MeshCache meshCache (folder.cache);
+    mace::DecodedImageCacheRef images = test::makeImageCache();
+
+    std::thread::id mainThread = std::this_thread::get_id();
+
+    std::atomic<uint32_t> live = 0;
+    std::atomic<uint32_t> maxLive = 0;
+    std::vector<std::string> committed;
+    bool committedOffMainThread = false;
+
+    IngestStages stages = test::makeStages (meshCache, images);
+
+    // count the jobs between parse and commit around the real parse
+    stages.parse = [&, parse = std::move (stages.parse)] (IngestJob& job)
+    {
+        uint32_t now = ++live;
+        uint32_t seen = maxLive.load();
+        while (now > seen && !maxLive.compare_exchange_weak (seen, now)) {}
+
+        parse (job);
+    };
+    stages.commit = [&] (IngestJob& job)
+    {
+        if (std::this_thread::get_id() != mainThread) committedOffMainThread = true;
+
+        // the parsed source is released before the commit
+        CHECK (job.source == nullptr);
+        REQUIRE (job.meshes);
+        CHECK (job.images.size() == job.meshes->getMaterials().size());
+
+        committed.push_back (job.path.string());
+        --live;
+    };
+
+    const uint32_t maxInFlight = 3;
+    IngestPipeline pipeline (std::move (stages), maxInFlight, 2);
+
+    test::ProgressObserver observer;
+    pipeline.progressEmitter.connect<&test::ProgressObserver::onProgress> (observer);
+
+    for (int i = 0; i < 16; ++i)
+    {
+        std::string obj = "quad_" + std::to_string (i) + ".obj";
+        std::string gltf = "triangle_" + std::to_string (i) + ".gltf";
+        test::writeQuadObj (folder, obj);
+        test::writeInstancedGltf (folder, gltf);
+
+        pipeline.submit (folder.root / obj);
+        pipeline.submit (folder.root / gltf);
+    }
+    pipeline.submit (folder.root / "missing.obj");
+
+    pipeline.flush();
+
+    CHECK (pipeline.isIdle());
+    CHECK_FALSE (committedOffMainThread);
+    CHECK (committed.size() == 32);
+    CHECK (maxLive <= maxInFlight);
+
+    CHECK (observer.fired > 0);
+    CHECK (observer.last.submitted == 33);
+    CHECK (observer.last.committed == 32);
+    CHECK (observer.last.failed == 1);
+    CHECK (observer.last.cancelled == 0);
+}
+
+TEST_CASE ("An OBJ is welded, gets normals and finds its texture")
+{
+    test::SceneFolder folder;
+    test::writeQuadObj (folder, "quad.obj");
+    MeshCache meshCache (folder.cache);
+    mace::DecodedImageCacheRef images = test::makeImageCache();
+
+    // the second pass maps what the first one cached
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        CAPTURE (pass);
+        IngestJob job = test::ingest (folder.root / "quad.obj", meshCache, images);
+        REQUIRE (job.meshes);
+        CHECK (job.error.empty());
+
+        REQUIRE (job.meshes->getMeshes().size() == 1);
+        const sabi::CachedMesh& mesh = job.meshes->getMeshes()[0];
+        CHECK (mesh.V.cols() == 5);
+        REQUIRE (mesh.N.cols() == 5);
+        REQUIRE (mesh.surfaces.size() == 1);
+        CHECK (mesh.surfaces[0].F.cols() == 2);
+
+        // corners split by the seam still share the generated normal
+        for (int i = 0; i < mesh.N.cols(); ++i)
+            CHECK (Eigen::Vector3f (mesh.N.col (i)).isApprox (Eigen::Vector3f::UnitZ()));
+
+        CHECK (mesh.bounds.min().isApprox (Eigen::Vector3f::Zero()));
+        CHECK (mesh.bounds.max().isApprox (Eigen::Vector3f (1.0f, 1.0f, 0.0f)));
+
+        const std::vector<sabi::MaterialRef>& materials = job.meshes->getMaterials();
+        REQUIRE (materials.size() == 1);
+        CHECK (materials[0].name == "painted");
+        CHECK (materials[0].texture == "albedo.png");
+        CHECK (materials[0].diffuse.isApprox (Eigen::Vector3f (0.5f, 0.25f, 1.0f)));
+        CHECK_FALSE (materials[0].linearDiffuse);
+
+        REQUIRE (job.texturePaths.size() == 1);
+        CHECK (std::filesystem::equivalent (job.texturePaths[0], folder.root / "albedo.png"));
+        CHECK (job.images[0] != nullptr);
+    }
+
+    CHECK (meshCache.load (folder.root / "quad.obj") != nullptr);
+}
+
+TEST_CASE ("A glTF mesh placed by two nodes is decoded once")
+{
+    test::SceneFolder folder;
+    test::writeInstancedGltf (folder, "triangle.gltf");
+    MeshCache meshCache (folder.cache);
+    mace::DecodedImageCacheRef images = test::makeImageCache();
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        CAPTURE (pass);
+        IngestJob job = test::ingest (folder.root / "triangle.gltf", meshCache, images);
+        REQUIRE (job.meshes);
+
+        const std::vector<sabi::CachedMesh>& meshes = job.meshes->getMeshes();
+        REQUIRE (meshes.size() == 2);
+        CHECK (meshes[0].mesh == meshes[1].mesh);
+        CHECK (meshes[0].V.data() == meshes[1].V.data());
+        CHECK (meshes[0].V.cols() == 3);
+        CHECK (meshes[0].N.cols() == 3);
+        CHECK (meshes[0].transform.translation().isApprox (Eigen::Vector3f (1.0f, 0.0f, 0.0f)));
+        CHECK (meshes[1].transform.translation().isApprox (Eigen::Vector3f (2.0f, 0.0f, 0.0f)));
+
+        // base colour factors are linear and kept as they are
+        const std::vector<sabi::MaterialRef>& materials = job.meshes->getMaterials();
+        REQUIRE (materials.size() == 1);
+        CHECK (materials[0].name == "tinted");
+        CHECK (materials[0].linearDiffuse);
+        CHECK (materials[0].diffuse.isApprox (Eigen::Vector3f (0.5f, 0.25f, 1.0f)));
+
+        REQUIRE (job.images.size() == 1);
+        CHECK (job.images[0] != nullptr);
+    }
+}
+
+TEST_CASE ("Nothing is committed after a cancel and the pipeline keeps working")
+{
+    std::atomic<uint32_t> commits = 0;
+
+    IngestStages stages;
+    stages.parse = [] (IngestJob& job)
+    { std::this_thread::sleep_for (std::chrono::milliseconds (2)); };
+    stages.commit = [&] (IngestJob& job)
+    { ++commits; };
+
+    IngestPipeline pipeline (std::move (stages), 2);
+
+    test::ProgressObserver observer;
+    pipeline.cancelEmitter.connect<&test::ProgressObserver::onCancel> (observer);
+
+    for (int i = 0; i < 10; ++i)
+        pipeline.submit ("dropped.obj");
+
+    pipeline.cancel();
+    pipeline.flush();
+
+    CHECK (commits == 0);
+    CHECK (observer.dropped == 10);
+    CHECK (pipeline.getProgress().cancelled == 10);
+    CHECK (pipeline.isIdle());
+
+    for (int i = 0; i < 4; ++i)
+        pipeline.submit ("kept.obj");
+    pipeline.flush();
+
+    CHECK (commits == 4);
+    CHECK (pipeline.getProgress().committed == 4);
+}
+
+TEST_CASE ("update commits at most maxCommitsPerUpdate jobs")
+{
+    uint32_t commits = 0;
+
+    IngestStages stages;
+    stages.commit = [&] (IngestJob& job)
+    { ++commits; };
+
+    IngestPipeline pipeline (std::move (stages), 8, 1);
+    for (int i = 0; i < 4; ++i)
+        pipeline.submit ("budget.obj");
+
+    // wait for the workers without committing
+    while (true)
+    {
+        std::this_thread::sleep_for (std::chrono::milliseconds (5));
+        pipeline.update();
+        if (commits > 0) break;
+    }
+
+    CHECK (commits == 1);
+
+    pipeline.flush();
+    CHECK (commits == 4);
+}
+
+TEST_CASE ("Destroying a busy pipeline waits for its workers")
+{
+    std::atomic<uint32_t> parsed = 0;
+    {
+        IngestStages stages;
+        stages.parse = [&] (IngestJob& job)
+        {
+            std::this_thread::sleep_for (std::chrono::milliseconds (5));
+            ++parsed;
+        };
+
+        IngestPipeline pipeline (std::move (stages), 4);
+        for (int i = 0; i < 8; ++i)
+            pipeline.submit ("busy.obj");
+    }
+
+    // only the dispatched jobs ever started
+    CHECK (parsed <= 4);
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
@@ -0,0 +1,294 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "InstanceBVH";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using wabi::InstanceBVH;
+using wabi::Ray3f;
+using wabi::TriangleBVH;
+using wabi::TriangleBVHRef;
+
+namespace test
+{
+    struct Mesh
+    {
+        MatrixXf V;
+        MatrixXu F;
+    };
+
+    inline Mesh triangleSoup (uint32_t count, uint32_t seed)
+    {
+        std::mt19937 rng (seed);
+        std::uniform_real_distribution<float> position (-1.0f, 1.0f);
+        std::uniform_real_distribution<float> offset (-0.2f, 0.2f);
+
+        Mesh mesh;
+        mesh.V.resize (3, count * 3);
+        mesh.F.resize (3, count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            Eigen::Vector3f center (position (rng), position (rng), position (rng));
+            for (uint32_t corner = 0; corner < 3; ++corner)
+            {
+                mesh.V.col (i * 3 + corner) = center + Eigen::Vector3f (offset (rng), offset (rng), offset (rng));
+                mesh.F (corner, i) = i * 3 + corner;
+            }
+        }
+        return mesh;
+    }
+
+    inline Pose randomPose (std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> position (-8.0f, 8.0f);
+        std::uniform_real_distribution<float> angle (0.0f, 6.28f);
+        std::uniform_real_distribution<float> scale (0.5f, 2.0f);
+
+        Pose pose = Pose::Identity();
+        pose.translate (Eigen::Vector3f (position (rng), position (rng), position (rng)));
+        pose.rotate (Eigen::AngleAxisf (angle (rng), Eigen::Vector3f (position (rng), position (rng), position (rng)).normalized()));
+        pose.scale (Eigen::Vector3f (scale (rng), scale (rng), scale (rng)));
+        return pose;
+    }
+
+    inline std::vector<Ray3f> randomRays (uint32_t count, uint32_t seed)
+    {
+        std::mt19937 rng (seed);
+        std::uniform_real_distribution<float> position (-12.0f, 12.0f);
+
+        std::vector<Ray3f> rays;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            Eigen::Vector3f origin (position (rng), position (rng), position (rng));
+            Eigen::Vector3f target (position (rng) * 0.5f, position (rng) * 0.5f, position (rng) * 0.5f);
+            rays.emplace_back (origin, target - origin);
+        }
+        return rays;
+    }
+
+    // every instance's BLAS in turn, what the two levels have to agree with
+    inline bool bruteForce (const std::vector<Pose>& poses, const TriangleBVH& blas, const Ray3f& ray, float& tHit, int64_t& instance)
+    {
+        tHit = ray.tMax;
+        instance = INVALID_ID;
+        for (size_t i = 0; i < poses.size(); ++i)
+        {
+            Pose worldToObject = poses[i].inverse();
+            Eigen::Vector3f origin = worldToObject * ray.origin;
+            Eigen::Vector3f dir = worldToObject.linear() * ray.dir;
+
+            TriangleBVH::Hit hit;
+            if (blas.intersect (origin, dir, ray.tMin, tHit, hit))
+            {
+                tHit = hit.t;
+                instance = static_cast<int64_t> (i);
+            }
+        }
+        return instance != INVALID_ID;
+    }
+} // namespace test
+
+TEST_CASE ("Instances of one BLAS match brute force")
+{
+    test::Mesh mesh = test::triangleSoup (400, 1);
+    TriangleBVHRef blas = std::make_shared<TriangleBVH>();
+    blas->build (mesh.V, mesh.F);
+
+    std::mt19937 rng (2);
+    std::vector<Pose> poses;
+    InstanceBVH scene;
+    for (uint32_t i = 0; i < 60; ++i)
+    {
+        poses.push_back (test::randomPose (rng));
+        CHECK (scene.addInstance (blas, poses.back()) == i);
+    }
+    CHECK (scene.needsBuild());
+    scene.build();
+    CHECK (!scene.needsBuild());
+    CHECK (scene.getInstanceCount() == 60);
+
+    // one BLAS no matter how many instances
+    CHECK (blas.use_count() == 61);
+
+    uint32_t hits = 0;
+    for (Ray3f ray : test::randomRays (2000, 3))
+    {
+        float expectedT;
+        int64_t expectedInstance;
+        bool expected = test::bruteForce (poses, *blas, ray, expectedT, expectedInstance);
+
+        Ray3f any = ray;
+        REQUIRE (scene.intersect (ray) == expected);
+        CHECK (scene.intersectAny (any) == expected);
+        if (!expected) continue;
+
+        ++hits;
+        CHECK (ray.distToHit == doctest::Approx (expectedT));
+        if (ray.hitBodyID != expectedInstance)
+            CHECK (ray.distToHit == doctest::Approx (expectedT).epsilon (1e-6)); // a tie
+        CHECK (any.distToHit >= ray.distToHit);
+
+        // the world hit point really is on the instance's triangle
+        const Pose& pose = scene.getTransform (static_cast<uint32_t> (ray.hitBodyID));
+        Eigen::Vector3f v0 = pose * Eigen::Vector3f (mesh.V.col (mesh.F (0, ray.hitPolyID)));
+        Eigen::Vector3f v1 = pose * Eigen::Vector3f (mesh.V.col (mesh.F (1, ray.hitPolyID)));
+        Eigen::Vector3f v2 = pose * Eigen::Vector3f (mesh.V.col (mesh.F (2, ray.hitPolyID)));
+        Eigen::Vector3f fromBarys = ray.bary0 * v0 + ray.bary1 * v1 + ray.bary2 * v2;
+        CHECK ((fromBarys - ray.hitPoint).norm() < 1e-3f);
+        CHECK (std::abs (ray.surfaceNormal.dot (v1 - v0)) < 1e-3f * (v1 - v0).norm());
+    }
+    CHECK (hits > 200);
+}
+
+TEST_CASE ("Refit follows moving instances")
+{
+    test::Mesh mesh = test::triangleSoup (200, 4);
+    TriangleBVHRef blas = std::make_shared<TriangleBVH>();
+    blas->build (mesh.V, mesh.F);
+
+    std::mt19937 rng (5);
+    std::vector<Pose> poses;
+    InstanceBVH scene;
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        poses.push_back (test::randomPose (rng));
+        scene.addInstance (blas, poses.back());
+    }
+    scene.build();
+    size_t nodeCount = scene.getNodes().size();
+
+    // every instance moves, like a physics step
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        poses[i] = test::randomPose (rng);
+        scene.setTransform (i, poses[i]);
+    }
+    scene.refit();
+    CHECK (scene.getNodes().size() == nodeCount);
+
+    // every child is still inside its parent
+    const std::vector<InstanceBVH::Node>& nodes = scene.getNodes();
+    for (const InstanceBVH::Node& node : nodes)
+    {
+        if (node.isLeaf()) continue;
+        for (uint32_t child = node.leftOrFirst; child < node.leftOrFirst + 2; ++child)
+        {
+            CHECK ((nodes[child].boundsMin.array() >= node.boundsMin.array()).all());
+            CHECK ((nodes[child].boundsMax.array() <= node.boundsMax.array()).all());
+        }
+    }
+
+    for (Ray3f ray : test::randomRays (1000, 6))
+    {
+        float expectedT;
+        int64_t expectedInstance;
+        bool expected = test::bruteForce (poses, *blas, ray, expectedT, expectedInstance);
+
+        REQUIRE (scene.intersect (ray) == expected);
+        if (expected)
+            CHECK (ray.distToHit == doctest::Approx (expectedT));
+    }
+}
+
+TEST_CASE ("Removed slots are reused")
+{
+    test::Mesh mesh = test::triangleSoup (50, 7);
+    TriangleBVHRef blas = std::make_shared<TriangleBVH>();
+    blas->build (mesh.V, mesh.F);
+
+    InstanceBVH scene;
+    Pose pose = Pose::Identity();
+    uint32_t a = scene.addInstance (blas, pose);
+    pose.translate (Eigen::Vector3f (0.0f, 0.0f, 10.0f));
+    uint32_t b = scene.addInstance (blas, pose);
+    scene.build();
+
+    // straight down the z axis through both copies
+    Ray3f ray (Eigen::Vector3f (0.0f, 0.0f, -20.0f), Eigen::Vector3f (0.0f, 0.0f, 1.0f));
+    Ray3f first = ray;
+    if (scene.intersect (first))
+        CHECK (first.hitBodyID == a);
+
+    scene.removeInstance (a);
+    CHECK (scene.needsBuild());
+    CHECK (scene.getInstanceCount() == 1);
+
+    // a stale tree skips the removed instance
+    Ray3f stale = ray;
+    if (scene.intersect (stale))
+        CHECK (stale.hitBodyID == b);
+
+    // refit rebuilds when the instances changed
+    scene.refit();
+    CHECK (!scene.needsBuild());
+    CHECK (scene.getNodes().size() == 1);
+
+    CHECK (scene.addInstance (blas, Pose::Identity()) == a);
+    CHECK_THROWS (scene.addInstance (nullptr, Pose::Identity()));
+
+    scene.clear();
+    scene.build();
+    Ray3f empty = ray;
+    CHECK (!scene.intersect (empty));
+}
+
+TEST_CASE ("Hit fields are in world space")
+{
+    test::Mesh mesh;
+    mesh.V.resize (3, 3);
+    mesh.V.col (0) = Eigen::Vector3f (0.0f, 0.0f, 0.0f);
+    mesh.V.col (1) = Eigen::Vector3f (1.0f, 0.0f, 0.0f);
+    mesh.V.col (2) = Eigen::Vector3f (0.0f, 1.0f, 0.0f);
+    mesh.F.resize (3, 1);
+    mesh.F.col (0) = Vector3u (0, 1, 2);
+
+    TriangleBVHRef blas = std::make_shared<TriangleBVH>();
+    blas->build (mesh.V, mesh.F);
+
+    // stretched 4x in x and 2x in y, then tipped to face down the x axis
+    Pose pose = Pose::Identity();
+    pose.translate (Eigen::Vector3f (5.0f, 0.0f, 0.0f));
+    pose.rotate (Eigen::AngleAxisf (-0.5f * 3.14159265f, Eigen::Vector3f::UnitY()));
+    pose.scale (Eigen::Vector3f (4.0f, 2.0f, 1.0f));
+
+    InstanceBVH scene;
+    scene.addInstance (blas, pose);
+    scene.build();
+
+    Ray3f ray (Eigen::Vector3f (0.0f, 0.5f, 1.0f), Eigen::Vector3f (1.0f, 0.0f, 0.0f));
+    REQUIRE (scene.intersect (ray));
+    CHECK (ray.distToHit == doctest::Approx (5.0f));
+    CHECK (ray.hitPoint.isApprox (Eigen::Vector3f (5.0f, 0.5f, 1.0f), 1e-5f));
+    CHECK (ray.bary1 == doctest::Approx (0.25f));
+    CHECK (ray.bary2 == doctest::Approx (0.25f));
+    CHECK (std::abs (ray.surfaceNormal.x()) == doctest::Approx (1.0f));
+    CHECK (ray.hitPolyID == 0);
+    CHECK (ray.hitBodyID == 0);
+
+    // the box grows with the transform
+    Eigen::AlignedBox3f bounds = scene.getBounds();
+    CHECK (bounds.min().isApprox (Eigen::Vector3f (5.0f, 0.0f, 0.0f), 1e-5f));
+    CHECK (bounds.max().isApprox (Eigen::Vector3f (5.0f, 2.0f, 4.0f), 1e-5f));
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
@@ -0,0 +1,169 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "InstanceSources";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using mace::SlotHandle;
+using mace::SlotMap;
+using wabi::InstanceSources;
+
+namespace test
+{
+    // the SceneHandler's bookkeeping without OptiX: every node is an entry in the
+    // instance registry showing some geometry, only a source owns and releases it
+    struct MockScene
+    {
+        struct Entry
+        {
+            std::string name;
+            uint32_t geometry = 0;
+            bool ownsGeometry = false;
+        };
+
+        SlotMap<Entry> instances;
+        std::unordered_map<std::string, SlotHandle> nodes;
+        std::set<uint32_t> released;
+        InstanceSources sources;
+        uint32_t nextGeometry = 0;
+
+        uint32_t addSource (const std::string& name)
+        {
+            uint32_t geometry = nextGeometry++;
+            nodes[name] = instances.insert (Entry{name, geometry, true});
+            return geometry;
+        }
+
+        void addInstances (const std::string& source, uint32_t count)
+        {
+            uint32_t geometry = instances.at (instances.indexOf (nodes[source])).geometry;
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                std::string name = source + "_instance_" + std::to_string (i);
+                nodes[name] = instances.insert (Entry{name, geometry, false});
+                sources.addInstance (source, name);
+            }
+        }
+
+        // SceneHandler::removeNode
+        std::vector<std::string> remove (const std::string& name)
+        {
+            std::vector<std::string> removed = sources.remove (name);
+            for (const std::string& gone : removed)
+            {
+                auto it = nodes.find (gone);
+                REQUIRE (it != nodes.end());
+
+                Entry entry = instances.at (instances.indexOf (it->second));
+                instances.erase (it->second);
+                nodes.erase (it);
+
+                // what OptiXGeometry::release does
+                if (entry.ownsGeometry)
+                    released.insert (entry.geometry);
+            }
+            return removed;
+        }
+
+        // nothing left in the scene shows geometry that's been given back
+        bool allGeometryLive() const
+        {
+            for (uint32_t i = 0; i < instances.size(); ++i)
+            {
+                if (released.count (instances.at (i).geometry)) return false;
+            }
+            return true;
+        }
+    };
+} // namespace test
+
+TEST_CASE ("Removing a source takes its instances with it, the source last")
+{
+    InstanceSources sources;
+    for (int i = 0; i < 3; ++i)
+        sources.addInstance ("box", "box_" + std::to_string (i));
+    sources.addInstance ("ball", "ball_0");
+
+    CHECK (sources.getInstanceCount ("box") == 3);
+    CHECK (sources.isInstance ("box_1"));
+    CHECK (!sources.isInstance ("box"));
+
+    std::vector<std::string> removed = sources.remove ("box");
+    REQUIRE (removed.size() == 4);
+    CHECK (removed.back() == "box");
+    std::sort (removed.begin(), removed.end() - 1);
+    CHECK (removed[0] == "box_0");
+    CHECK (removed[1] == "box_1");
+    CHECK (removed[2] == "box_2");
+
+    CHECK (sources.getInstanceCount ("box") == 0);
+    CHECK (!sources.isInstance ("box_1"));
+    CHECK (sources.getInstanceCount ("ball") == 1);
+}
+
+TEST_CASE ("Removing an instance leaves its source and the other instances")
+{
+    InstanceSources sources;
+    sources.addInstance ("box", "a");
+    sources.addInstance ("box", "b");
+    sources.addInstance ("box", "c");
+
+    CHECK (sources.remove ("b") == std::vector<std::string>{"b"});
+    CHECK (sources.getInstanceCount ("box") == 2);
+    CHECK (!sources.isInstance ("b"));
+
+    // a node nobody instanced comes back on its own
+    CHECK (sources.remove ("ground") == std::vector<std::string>{"ground"});
+
+    std::vector<std::string> removed = sources.remove ("box");
+    CHECK (removed.size() == 3);
+    CHECK (removed.back() == "box");
+}
+
+TEST_CASE ("A source with instances can be removed without leaving them on its released geometry")
+{
+    test::MockScene scene;
+    scene.addSource ("ground");
+    scene.addSource ("box");
+    scene.addSource ("ball");
+    scene.addInstances ("box", 60);
+    scene.addInstances ("ball", 5);
+    REQUIRE (scene.instances.size() == 68);
+
+    std::vector<std::string> removed = scene.remove ("box");
+    CHECK (removed.size() == 61);
+    CHECK (scene.released.size() == 1);
+    CHECK (scene.instances.size() == 7);
+    CHECK (scene.allGeometryLive());
+
+    // one of the ball's instances on its own, then the ball and the rest
+    CHECK (scene.remove ("ball_instance_2").size() == 1);
+    CHECK (scene.released.size() == 1);
+    CHECK (scene.remove ("ball").size() == 5);
+    CHECK (scene.allGeometryLive());
+
+    REQUIRE (scene.instances.size() == 1);
+    CHECK (scene.instances.at (0).name == "ground");
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
@@ -0,0 +1,194 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "InstanceUpdateTracker";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using wabi::ASOperation;
+using wabi::InstanceUpdateSettings;
+using wabi::InstanceUpdateTracker;
+using wabi::TransformHandle;
+using wabi::TransformTable;
+
+namespace test
+{
+    // stands in for the IAS, keeps what it's given and counts the work
+    struct MockAS
+    {
+        std::vector<TransformTable::Transform> instances;
+        uint32_t batches = 0;
+        uint32_t transformsSet = 0;
+        uint32_t updates = 0;
+        uint32_t rebuilds = 0;
+
+        void setTransforms (const TransformHandle* handles, uint32_t count, const TransformTable& transforms)
+        {
+            ++batches;
+            transformsSet += count;
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                if (handles[i] >= instances.size())
+                    instances.resize (handles[i] + 1, TransformTable::Transform::Zero());
+                instances[handles[i]] = transforms.get (handles[i]);
+            }
+        }
+
+        void update() { ++updates; }
+        void rebuild() { ++rebuilds; }
+    };
+
+    inline Pose lifted (float y)
+    {
+        return Pose (Eigen::Translation3f (0.0f, y, 0.0f));
+    }
+} // namespace test
+
+TEST_CASE ("Adding instances rebuilds, moving them refits")
+{
+    TransformTable transforms;
+    InstanceUpdateTracker tracker;
+    test::MockAS as;
+
+    for (uint32_t i = 0; i < 60; ++i)
+        transforms.allocate (test::lifted (float (i)));
+    tracker.markTopologyChanged();
+    CHECK (tracker.needsRebuild());
+
+    CHECK (tracker.flush (transforms, as) == ASOperation::Rebuild);
+    CHECK (as.rebuilds == 1);
+    CHECK (as.transformsSet == 60);
+    CHECK (!tracker.needsRebuild());
+    CHECK (transforms.getDirtyCount() == 0);
+
+    // nothing moved, the backend isn't touched
+    CHECK (tracker.flush (transforms, as) == ASOperation::None);
+    CHECK (as.batches == 1);
+    CHECK (as.updates == 0);
+
+    transforms.set (5, test::lifted (-1.0f));
+    transforms.set (17, test::lifted (-1.0f));
+    CHECK (tracker.flush (transforms, as) == ASOperation::Update);
+    CHECK (tracker.getLastBatch() == std::vector<TransformHandle>{5, 17});
+    CHECK (as.updates == 1);
+    CHECK (as.rebuilds == 1);
+    CHECK (as.batches == 2);
+    CHECK (as.instances[17] == transforms.get (17));
+
+    // removing one rebuilds even when nothing moved
+    transforms.release (17);
+    tracker.markTopologyChanged();
+    CHECK (tracker.flush (transforms, as) == ASOperation::Rebuild);
+    CHECK (tracker.getLastBatch().empty());
+    CHECK (as.rebuilds == 2);
+    CHECK (as.batches == 2);
+}
+
+TEST_CASE ("Sleeping bodies cost nothing")
+{
+    TransformTable transforms;
+    InstanceUpdateTracker tracker;
+    test::MockAS as;
+
+    for (uint32_t i = 0; i < 60; ++i)
+        transforms.allocate (test::lifted (float (i)));
+    tracker.markTopologyChanged();
+    tracker.flush (transforms, as);
+    uint32_t afterBuild = as.transformsSet;
+
+    // 59 bodies asleep rewrite their pose, one falls
+    for (int frame = 1; frame <= 10; ++frame)
+    {
+        for (TransformHandle handle = 0; handle < 59; ++handle)
+            transforms.set (handle, test::lifted (float (handle)));
+        transforms.set (59, test::lifted (59.0f - frame));
+
+        CHECK (tracker.flush (transforms, as) == ASOperation::Update);
+        CHECK (tracker.getLastBatch() == std::vector<TransformHandle>{59});
+    }
+    CHECK (as.transformsSet - afterBuild == 10);
+    CHECK (as.updates == 10);
+    CHECK (as.rebuilds == 1);
+}
+
+TEST_CASE ("Moves under the epsilon add up")
+{
+    TransformTable transforms;
+    InstanceUpdateTracker tracker;
+    test::MockAS as;
+
+    TransformHandle handle = transforms.allocate (Pose::Identity());
+    tracker.markTopologyChanged();
+    tracker.flush (transforms, as);
+
+    // jitter of a settling body isn't worth a refit
+    const float epsilon = 1.0e-4f;
+    for (int i = 1; i <= 3; ++i)
+        CHECK (!transforms.set (handle, test::lifted (0.3e-4f * i), epsilon));
+    CHECK (tracker.flush (transforms, as) == ASOperation::None);
+    CHECK (transforms.get (handle) == TransformTable::Transform (Pose::Identity().matrix().block<3, 4> (0, 0)));
+
+    // compared against what was last written, so creeping away eventually counts
+    CHECK (transforms.set (handle, test::lifted (1.2e-4f), epsilon));
+    CHECK (tracker.flush (transforms, as) == ASOperation::Update);
+    CHECK (as.instances[handle] (1, 3) == doctest::Approx (1.2e-4f));
+}
+
+TEST_CASE ("Refits give way to a rebuild")
+{
+    InstanceUpdateSettings settings;
+    settings.updatesBeforeRebuild = 4;
+
+    TransformTable transforms;
+    InstanceUpdateTracker tracker (settings);
+    test::MockAS as;
+
+    TransformHandle handle = transforms.allocate (Pose::Identity());
+    tracker.markTopologyChanged();
+    tracker.flush (transforms, as);
+
+    std::vector<ASOperation> ops;
+    for (int frame = 1; frame <= 10; ++frame)
+    {
+        transforms.set (handle, test::lifted (float (frame)));
+        ops.push_back (tracker.flush (transforms, as));
+    }
+
+    const ASOperation U = ASOperation::Update;
+    const ASOperation R = ASOperation::Rebuild;
+    CHECK (ops == std::vector<ASOperation>{U, U, U, U, R, U, U, U, U, R});
+    CHECK (tracker.getUpdateCount() == 8);
+    CHECK (tracker.getRebuildCount() == 3);
+
+    // a loose tree still waits for something to move
+    CHECK (tracker.needsRebuild() == false);
+    for (int frame = 0; frame < 4; ++frame)
+    {
+        transforms.set (handle, test::lifted (float (-frame)));
+        tracker.flush (transforms, as);
+    }
+    CHECK (tracker.needsRebuild());
+    CHECK (tracker.flush (transforms, as) == ASOperation::None);
+    CHECK (tracker.getRebuildCount() == 3);
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
@@ -0,0 +1,244 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "MeshCache";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using sabi::CachedMesh;
+using sabi::MaterialRef;
+using sabi::MeshBuffers;
+using sabi::MeshCache;
+using sabi::MeshCacheViewRef;
+using sabi::MeshInstance;
+using sabi::Surface;
+
+namespace test
+{
+    // where the records start in a .nbmesh, see the layout in MeshCache.h
+    const uint64_t HEADER_BYTES = 64;
+    const uint64_t MESH_RECORD_BYTES = 136;
+    const uint64_t VERSION_OFFSET = 8;
+    const uint64_t UV_COUNT_OFFSET = 4; // in a SurfaceRecord
+
+    // a fresh folder with a stand in source file, the cache only looks at its
+    // path, size, time and bytes so it doesn't have to be a real model
+    inline std::filesystem::path makeSource (const std::string& folderName, const std::string& contents)
+    {
+        std::filesystem::path folder = std::filesystem::temp_directory_path() / folderName;
+        std::filesystem::remove_all (folder);
+        std::filesystem::create_directories (folder);
+
+        std::filesystem::path source = folder / "model.gltf";
+        std::ofstream (source, std::ios::binary) << contents;
+        return source;
+    }
+
+    // a quad with uvs and normals in two surfaces, and a single triangle without uvs
+    inline std::vector<MeshBuffers> makeMeshes()
+    {
+        std::vector<MeshBuffers> meshes (2);
+
+        MeshBuffers& quad = meshes[0];
+        quad.V.resize (3, 4);
+        quad.V << 0, 1, 1, 0,
+            0, 0, 1, 1,
+            0, 0, 0, 0;
+        quad.N = MatrixXf::Zero (3, 4);
+        quad.N.row (2).setOnes();
+        quad.FN = MatrixXf::Zero (3, 2);
+        quad.FN.row (2).setOnes();
+        quad.transform = Eigen::Affine3f::Identity();
+        quad.surfaces.resize (2);
+        quad.surfaces[0].F.resize (3, 1);
+        quad.surfaces[0].F << 0, 1, 2;
+        quad.surfaces[0].uvs = {{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}};
+        quad.surfaces[0].materialRef = 0;
+        quad.surfaces[1].F.resize (3, 1);
+        quad.surfaces[1].F << 0, 2, 3;
+        quad.surfaces[1].materialRef = 1;
+
+        MeshBuffers& triangle = meshes[1];
+        triangle.V.resize (3, 3);
+        triangle.V << 0, 2, 0,
+            0, 0, 3,
+            -1, -1, -1;
+        triangle.N = MatrixXf::Zero (3, 3);
+        triangle.FN = MatrixXf::Zero (3, 1);
+        triangle.transform = Eigen::Affine3f::Identity();
+        triangle.surfaces.resize (1);
+        triangle.surfaces[0].F.resize (3, 1);
+        triangle.surfaces[0].F << 2, 1, 0;
+        triangle.surfaces[0].materialIDs = {1};
+
+        return meshes;
+    }
+
+    inline std::vector<MaterialRef> makeMaterials()
+    {
+        std::vector<MaterialRef> materials (2);
+        materials[0].sourceIndex = 0;
+        materials[0].name = "painted";
+        materials[0].texture = "textures/paint.png";
+        materials[0].diffuse = Eigen::Vector3f (0.25f, 0.5f, 0.75f);
+        materials[0].linearDiffuse = true;
+        materials[1].sourceIndex = 3;
+        materials[1].name = "plain";
+        return materials;
+    }
+
+    inline std::vector<uint8_t> readFile (const std::filesystem::path& path)
+    {
+        std::ifstream in (path, std::ios::binary);
+        return std::vector<uint8_t> (std::istreambuf_iterator<char> (in), std::istreambuf_iterator<char>());
+    }
+
+    inline void patch (const std::filesystem::path& path, uint64_t offset, uint32_t value)
+    {
+        std::fstream file (path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp (offset);
+        file.write (reinterpret_cast<const char*> (&value), sizeof (value));
+    }
+} // namespace test
+
+TEST_CASE ("Stored meshes come back from the mapped file unchanged")
+{
+    std::filesystem::path source = test::makeSource ("MeshCacheRoundTrip", "stand in for a glTF file");
+    MeshCache cache;
+
+    std::vector<MeshBuffers> meshes = test::makeMeshes();
+    std::vector<MaterialRef> materials = test::makeMaterials();
+
+    // the quad placed twice, the triangle once
+    std::vector<MeshInstance> instances (3);
+    instances[0].mesh = 0;
+    instances[1].mesh = 0;
+    instances[1].transform.translate (Eigen::Vector3f (5.0f, 0.0f, 0.0f));
+    instances[2].mesh = 1;
+    instances[2].transform.rotate (Eigen::AngleAxisf (0.5f, Eigen::Vector3f::UnitY()));
+
+    REQUIRE (cache.store (source, meshes, materials, instances));
+    MeshCacheViewRef view = cache.load (source);
+    REQUIRE (view);
+
+    const std::vector<MaterialRef>& loadedMaterials = view->getMaterials();
+    REQUIRE (loadedMaterials.size() == 2);
+    for (size_t i = 0; i < materials.size(); ++i)
+    {
+        CHECK (loadedMaterials[i].sourceIndex == materials[i].sourceIndex);
+        CHECK (loadedMaterials[i].name == materials[i].name);
+        CHECK (loadedMaterials[i].texture == materials[i].texture);
+        CHECK (loadedMaterials[i].diffuse == materials[i].diffuse);
+        CHECK (loadedMaterials[i].linearDiffuse == materials[i].linearDiffuse);
+    }
+
+    const std::vector<CachedMesh>& loaded = view->getMeshes();
+    REQUIRE (loaded.size() == instances.size());
+    for (size_t i = 0; i < loaded.size(); ++i)
+    {
+        const CachedMesh& mesh = loaded[i];
+        const MeshBuffers& original = meshes[instances[i].mesh];
+
+        CHECK (mesh.mesh == instances[i].mesh);
+        CHECK (mesh.transform.matrix() == instances[i].transform.matrix());
+        CHECK (mesh.V == original.V);
+        CHECK (mesh.N == original.N);
+        CHECK (mesh.FN == original.FN);
+        CHECK (mesh.bounds.min() == Eigen::Vector3f (original.V.rowwise().minCoeff()));
+        CHECK (mesh.bounds.max() == Eigen::Vector3f (original.V.rowwise().maxCoeff()));
+
+        REQUIRE (mesh.surfaces.size() == original.surfaces.size());
+        for (size_t s = 0; s < mesh.surfaces.size(); ++s)
+        {
+            const Surface& surface = original.surfaces[s];
+            CHECK (mesh.surfaces[s].F == surface.F);
+            CHECK (mesh.surfaces[s].materialRef == surface.materialRef);
+            REQUIRE (mesh.surfaces[s].UV.cols() == surface.uvs.size());
+            for (size_t v = 0; v < surface.uvs.size(); ++v)
+                CHECK (Eigen::Vector2f (mesh.surfaces[s].UV.col (v)) == surface.uvs[v]);
+
+            if (surface.materialIDs.empty())
+                CHECK (mesh.surfaces[s].materialIDs == nullptr);
+            else
+                CHECK (std::equal (surface.materialIDs.begin(), surface.materialIDs.end(), mesh.surfaces[s].materialIDs));
+        }
+    }
+
+    // instances share the one copy of their mesh's data
+    CHECK (loaded[0].V.data() == loaded[1].V.data());
+
+    // nothing uninitialized reaches the file, the same meshes write the same bytes
+    std::vector<uint8_t> first = test::readFile (cache.getCachePath (source));
+    REQUIRE (cache.store (source, meshes, materials, instances));
+    CHECK (test::readFile (cache.getCachePath (source)) == first);
+}
+
+TEST_CASE ("A cache from another version or with broken uvs is rejected")
+{
+    std::filesystem::path source = test::makeSource ("MeshCacheRejects", "stand in for a glTF file");
+    MeshCache cache;
+    std::filesystem::path cachePath = cache.getCachePath (source);
+
+    // no instances, one record per mesh
+    REQUIRE (cache.store (source, test::makeMeshes(), test::makeMaterials()));
+    REQUIRE (cache.load (source));
+
+    test::patch (cachePath, test::VERSION_OFFSET, MeshCache::VERSION + 1);
+    CHECK_FALSE (cache.load (source));
+    test::patch (cachePath, test::VERSION_OFFSET, MeshCache::VERSION);
+    REQUIRE (cache.load (source));
+
+    // the quad's first surface claims one uv fewer than it has vertices
+    uint64_t surfaceRecords = mace::alignCacheOffset (test::HEADER_BYTES + 2 * test::MESH_RECORD_BYTES);
+    test::patch (cachePath, surfaceRecords + test::UV_COUNT_OFFSET, 3);
+    CHECK_FALSE (cache.load (source));
+
+    // a source that's gone has no cache
+    REQUIRE (cache.store (source, test::makeMeshes(), test::makeMaterials()));
+    std::filesystem::remove (source);
+    CHECK_FALSE (cache.load (source));
+}
+
+TEST_CASE ("Only content verification notices a source replaced with its old size and time")
+{
+    std::filesystem::path source = test::makeSource ("MeshCacheContent", "original contents");
+    MeshCache verifying (std::filesystem::path(), true);
+    MeshCache trusting;
+
+    REQUIRE (verifying.store (source, test::makeMeshes(), test::makeMaterials()));
+    CHECK (verifying.load (source));
+
+    // same size, and the time put back the way a restore from an archive would
+    auto time = std::filesystem::last_write_time (source);
+    std::ofstream (source, std::ios::binary | std::ios::trunc) << "replaced contents";
+    REQUIRE (std::filesystem::file_size (source) == std::string ("original contents").size());
+    std::filesystem::last_write_time (source, time);
+
+    CHECK_FALSE (verifying.load (source));
+    CHECK (trusting.load (source));
+
+    // a real edit moves the time and both notice
+    std::filesystem::last_write_time (source, time + std::chrono::seconds (5));
+    CHECK_FALSE (trusting.load (source));
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
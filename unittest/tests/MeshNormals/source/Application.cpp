@@ -0,0 +1,185 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "MeshNormals";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using Eigen::Vector3f;
+using sabi::NormalAccumulation;
+
+namespace test
+{
+    // fast_acos is an approximation, the corner angles it gives are good to about this
+    const float TOLERANCE = 1.0e-3f;
+
+    // unit cube, vertex v sits at (v & 1, (v >> 1) & 1, (v >> 2) & 1)
+    inline MatrixXf cubeVertices()
+    {
+        MatrixXf V (3, 8);
+        for (int v = 0; v < 8; ++v)
+            V.col (v) = Vector3f (float (v & 1), float ((v >> 1) & 1), float ((v >> 2) & 1));
+        return V;
+    }
+
+    // two triangles per side, counter clockwise seen from outside
+    inline MatrixXu cubeFaces()
+    {
+        const uint32_t quads[6][4] = {
+            {0, 4, 6, 2}, // -X
+            {1, 3, 7, 5}, // +X
+            {0, 1, 5, 4}, // -Y
+            {2, 6, 7, 3}, // +Y
+            {0, 2, 3, 1}, // -Z
+            {4, 5, 7, 6}, // +Z
+        };
+
+        MatrixXu F (3, 12);
+        for (int q = 0; q < 6; ++q)
+        {
+            F.col (q * 2) << quads[q][0], quads[q][1], quads[q][2];
+            F.col (q * 2 + 1) << quads[q][0], quads[q][2], quads[q][3];
+        }
+        return F;
+    }
+
+    inline Vector3f faceCenter (const MatrixXu& F, const MatrixXf& V, Eigen::Index f)
+    {
+        return (V.col (F (0, f)) + V.col (F (1, f)) + V.col (F (2, f))) / 3.0f;
+    }
+
+    // every corner of the cube gets a quarter turn from each of its 3 sides, however
+    // the sides are split, so its normal runs along the diagonal out of the cube
+    inline Vector3f cornerNormal (const MatrixXf& V, Eigen::Index v)
+    {
+        return (2.0f * Vector3f (V.col (v)) - Vector3f::Ones()).normalized();
+    }
+} // namespace test
+
+TEST_CASE ("Cube face normals point out and vertex normals along the corner diagonals")
+{
+    MatrixXf V = test::cubeVertices();
+    MatrixXu F = test::cubeFaces();
+    Vector3f center (0.5f, 0.5f, 0.5f);
+
+    for (NormalAccumulation mode : {NormalAccumulation::Gather, NormalAccumulation::Scatter})
+    {
+        MatrixXf N, FN;
+        CHECK (sabi::generate_normals (F, V, N, FN, mode) == 0);
+        REQUIRE (N.cols() == V.cols());
+        REQUIRE (FN.cols() == F.cols());
+
+        for (Eigen::Index f = 0; f < F.cols(); ++f)
+        {
+            // the axis from the middle of the cube through the face
+            Vector3f out = test::faceCenter (F, V, f) - center;
+            Vector3f axis = Vector3f::Zero();
+            Eigen::Index major;
+            out.cwiseAbs().maxCoeff (&major);
+            axis[major] = out[major] > 0.0f ? 1.0f : -1.0f;
+
+            CHECK ((Vector3f (FN.col (f)) - axis).norm() < test::TOLERANCE);
+        }
+
+        for (Eigen::Index v = 0; v < V.cols(); ++v)
+        {
+            CHECK (std::abs (N.col (v).norm() - 1.0f) < test::TOLERANCE);
+            CHECK ((Vector3f (N.col (v)) - test::cornerNormal (V, v)).norm() < test::TOLERANCE);
+        }
+    }
+
+    // turned inside out, every normal flips
+    MatrixXu flipped = F;
+    flipped.row (1).swap (flipped.row (2));
+
+    MatrixXf N, FN, flippedN, flippedFN;
+    sabi::generate_normals (F, V, N, FN);
+    sabi::generate_normals (flipped, V, flippedN, flippedFN);
+    CHECK ((flippedFN + FN).cwiseAbs().maxCoeff() < test::TOLERANCE);
+    CHECK ((flippedN + N).cwiseAbs().maxCoeff() < test::TOLERANCE);
+}
+
+TEST_CASE ("Gather and scatter agree on a mesh with shared and unshared vertices")
+{
+    // a bumpy grid, every vertex in up to 6 triangles of different shapes
+    const uint32_t size = 40;
+    MatrixXf V (3, size * size);
+    for (uint32_t y = 0; y < size; ++y)
+        for (uint32_t x = 0; x < size; ++x)
+            V.col (y * size + x) = Vector3f (float (x), float (y), std::sin (x * 0.3f) * std::cos (y * 0.2f) * 3.0f);
+
+    MatrixXu F (3, (size - 1) * (size - 1) * 2);
+    Eigen::Index f = 0;
+    for (uint32_t y = 0; y + 1 < size; ++y)
+    {
+        for (uint32_t x = 0; x + 1 < size; ++x)
+        {
+            uint32_t v = y * size + x;
+            F.col (f++) << v, v + 1, v + size + 1;
+            F.col (f++) << v, v + size + 1, v + size;
+        }
+    }
+
+    MatrixXf gatherN, gatherFN, scatterN, scatterFN;
+    CHECK (sabi::generate_normals (F, V, gatherN, gatherFN, NormalAccumulation::Gather) == 0);
+    CHECK (sabi::generate_normals (F, V, scatterN, scatterFN, NormalAccumulation::Scatter) == 0);
+
+    // the sums go in a different order, so only within rounding
+    CHECK ((gatherFN - scatterFN).cwiseAbs().maxCoeff() < 1.0e-5f);
+    CHECK ((gatherN - scatterN).cwiseAbs().maxCoeff() < 1.0e-5f);
+
+    // the grid faces up everywhere
+    CHECK (gatherN.row (2).minCoeff() > 0.0f);
+}
+
+TEST_CASE ("Degenerate faces are counted and add nothing")
+{
+    MatrixXf cube = test::cubeVertices();
+    MatrixXu cubeF = test::cubeFaces();
+
+    // the cube plus a vertex nothing uses, a triangle with a repeated corner
+    // and one whose corners are in a line
+    MatrixXf V (3, 9);
+    V << cube, Vector3f (5.0f, 5.0f, 5.0f);
+
+    MatrixXu F (3, 14);
+    F << cubeF, MatrixXu (3, 2);
+    F.col (12) << 0, 0, 7;
+    F.col (13) << 0, 1, 0;
+
+    for (NormalAccumulation mode : {NormalAccumulation::Gather, NormalAccumulation::Scatter})
+    {
+        MatrixXf N, FN;
+        CHECK (sabi::generate_normals (F, V, N, FN, mode) == 2);
+
+        CHECK (FN.col (12).isZero());
+        CHECK (FN.col (13).isZero());
+
+        // the cube's normals are just as they were without them
+        for (Eigen::Index v = 0; v < cube.cols(); ++v)
+            CHECK ((Vector3f (N.col (v)) - test::cornerNormal (V, v)).norm() < test::TOLERANCE);
+
+        CHECK (Vector3f (N.col (8)) == Vector3f::UnitX());
+    }
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
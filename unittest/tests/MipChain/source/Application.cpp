@@ -0,0 +1,196 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "MipChain";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using mace::MipChain;
+using mace::MipChainOptions;
+using mace::MipFilter;
+using mace::MipLevel;
+
+namespace test
+{
+    template <typename T>
+    OIIO::ImageBuf makeImage (int width, int height, int channels, const std::vector<T>& pixels)
+    {
+        OIIO::TypeDesc format = std::is_same_v<T, float> ? OIIO::TypeDesc::FLOAT : OIIO::TypeDesc::UINT8;
+        OIIO::ImageBuf image (OIIO::ImageSpec (width, height, channels, format));
+        std::memcpy (image.localpixels(), pixels.data(), pixels.size() * sizeof (T));
+        return image;
+    }
+
+    inline double mean (const float* pixels, size_t count)
+    {
+        double sum = 0.0;
+        for (size_t i = 0; i < count; ++i)
+            sum += pixels[i];
+        return sum / count;
+    }
+} // namespace test
+
+TEST_CASE ("Level sizes follow the CUDA convention")
+{
+    auto chain = MipChain::build (test::makeImage<uint8_t> (13, 5, 4, std::vector<uint8_t> (13 * 5 * 4, 0)));
+    REQUIRE (chain);
+
+    CHECK (chain->getLevelCount() == 4);
+    CHECK (chain->getLevel (1).width == 6);
+    CHECK (chain->getLevel (1).height == 2);
+    CHECK (chain->getLevel (2).width == 3);
+    CHECK (chain->getLevel (2).height == 1);
+    CHECK (chain->getLevel (3).width == 1);
+    CHECK (chain->getLevel (3).height == 1);
+
+    MipChainOptions options;
+    options.maxLevels = 2;
+    CHECK (MipChain::build (test::makeImage<uint8_t> (13, 5, 4, std::vector<uint8_t> (13 * 5 * 4, 0)), options)->getLevelCount() == 2);
+}
+
+TEST_CASE ("A constant image stays constant with either filter")
+{
+    for (MipFilter filter : {MipFilter::Box, MipFilter::Kaiser})
+    {
+        MipChainOptions options;
+        options.filter = filter;
+
+        auto bytes = MipChain::build (test::makeImage<uint8_t> (37, 19, 4, std::vector<uint8_t> (37 * 19 * 4, 77)), options);
+        REQUIRE (bytes);
+        CHECK (!bytes->isFloat());
+        for (uint32_t level = 0; level < bytes->getLevelCount(); ++level)
+        {
+            const uint8_t* pixels = bytes->getLevelData (level);
+            for (uint64_t i = 0; i < bytes->getLevel (level).bytes; ++i)
+                REQUIRE (pixels[i] == 77);
+        }
+
+        auto floats = MipChain::build (test::makeImage<float> (37, 19, 3, std::vector<float> (37 * 19 * 3, 2.5f)), options);
+        REQUIRE (floats);
+        CHECK (floats->isFloat());
+        const MipLevel& last = floats->getLevel (floats->getLevelCount() - 1);
+        CHECK (floats->getLevelPixels<float> (floats->getLevelCount() - 1)[0] == doctest::Approx (2.5f));
+        CHECK (last.width == 1);
+    }
+}
+
+TEST_CASE ("8 bit color is averaged in linear space, alpha is not")
+{
+    // one black and one white pixel, half transparent and opaque
+    std::vector<uint8_t> pixels = {0, 0, 0, 0, 255, 255, 255, 255};
+
+    auto srgb = MipChain::build (test::makeImage<uint8_t> (2, 1, 4, pixels));
+    const uint8_t* p = srgb->getLevelData (1);
+    CHECK (p[0] == 188);
+    CHECK (p[3] == 128);
+
+    MipChainOptions options;
+    options.srgb = false;
+    auto linear = MipChain::build (test::makeImage<uint8_t> (2, 1, 4, pixels), options);
+    p = linear->getLevelData (1);
+    CHECK (p[0] == 128);
+    CHECK (p[3] == 128);
+}
+
+TEST_CASE ("The box filter keeps the mean of odd sized float images")
+{
+    const int width = 45, height = 23;
+    std::vector<float> pixels (width * height);
+    std::mt19937 rng (7);
+    std::uniform_real_distribution<float> dist (0.0f, 10.0f);
+    for (float& v : pixels)
+        v = dist (rng);
+
+    auto chain = MipChain::build (test::makeImage<float> (width, height, 1, pixels));
+    REQUIRE (chain);
+
+    double mean = test::mean (pixels.data(), pixels.size());
+    for (uint32_t level = 1; level < chain->getLevelCount(); ++level)
+    {
+        const MipLevel& l = chain->getLevel (level);
+        CHECK (test::mean (chain->getLevelPixels<float> (level), size_t (l.width) * l.height) == doctest::Approx (mean).epsilon (1e-4));
+    }
+}
+
+TEST_CASE ("Chains round trip through the cache file")
+{
+    std::vector<uint8_t> pixels (64 * 32 * 4);
+    for (size_t i = 0; i < pixels.size(); ++i)
+        pixels[i] = static_cast<uint8_t> (i * 31);
+
+    auto chain = MipChain::build (test::makeImage<uint8_t> (64, 32, 4, pixels));
+    std::filesystem::path path = std::filesystem::temp_directory_path() / ("MipChainTest" + std::string (MipChain::EXTENSION));
+    REQUIRE (chain->save (path, 42));
+
+    auto loaded = MipChain::load (path, 42);
+    REQUIRE (loaded);
+    REQUIRE (loaded->getLevelCount() == chain->getLevelCount());
+    CHECK (loaded->getChannels() == 4);
+    for (uint32_t level = 0; level < chain->getLevelCount(); ++level)
+    {
+        REQUIRE (loaded->getLevel (level).bytes == chain->getLevel (level).bytes);
+        CHECK (std::memcmp (loaded->getLevelData (level), chain->getLevelData (level), chain->getLevel (level).bytes) == 0);
+    }
+
+    // written for a different source
+    CHECK (MipChain::load (path, 43) == nullptr);
+
+    loaded.reset();
+    std::filesystem::remove (path);
+}
+
+TEST_CASE ("Writers racing on one cache file leave it whole")
+{
+    std::vector<float> pixels (128 * 64 * 4);
+    for (size_t i = 0; i < pixels.size(); ++i)
+        pixels[i] = static_cast<float> (i % 97);
+
+    auto chain = MipChain::build (test::makeImage<float> (128, 64, 4, pixels));
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "MipChainRace";
+    std::filesystem::remove_all (dir);
+    std::filesystem::create_directories (dir);
+    std::filesystem::path path = dir / ("race" + std::string (MipChain::EXTENSION));
+
+    // the ingest workers do this when two materials share a texture
+    std::atomic<int> saved = 0;
+    std::vector<std::thread> writers;
+    for (int i = 0; i < 8; ++i)
+        writers.emplace_back ([&]()
+                              {
+            for (int j = 0; j < 20; ++j)
+                saved += chain->save (path, 7); });
+    for (auto& writer : writers)
+        writer.join();
+    CHECK (saved == 8 * 20);
+
+    auto loaded = MipChain::load (path, 7);
+    REQUIRE (loaded);
+    for (uint32_t level = 0; level < chain->getLevelCount(); ++level)
+        CHECK (std::memcmp (loaded->getLevelData (level), chain->getLevelData (level), chain->getLevel (level).bytes) == 0);
+    loaded.reset();
+
+    // nothing but the cache file is left behind
+    CHECK (std::distance (std::filesystem::directory_iterator (dir), std::filesystem::directory_iterator()) == 1);
+    std::filesystem::remove_all (dir);
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
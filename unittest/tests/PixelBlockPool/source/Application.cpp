@@ -0,0 +1,170 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "PixelBlockPool";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using mace::PixelBlockPool;
+using mace::PixelBlockRef;
+
+constexpr size_t MB = 1024 * 1024;
+
+TEST_CASE ("Released blocks are reused for images of about the same size")
+{
+    auto pool = PixelBlockPool::create (64 * MB);
+
+    void* first = nullptr;
+    {
+        PixelBlockRef block = pool->acquire (MB);
+        REQUIRE (block);
+        CHECK (block->size() >= MB);
+        CHECK (reinterpret_cast<uintptr_t> (block->data()) % mace::PixelBlock::ALIGNMENT == 0);
+        first = block->data();
+    }
+
+    PixelBlockPool::Stats stats = pool->getStats();
+    CHECK (stats.blocksInUse == 0);
+    CHECK (stats.blocksFree == 1);
+
+    // a little smaller still fits the free block
+    PixelBlockRef again = pool->acquire (MB - 10000);
+    CHECK (again->data() == first);
+    CHECK (pool->getStats().reuses == 1);
+
+    // too small to waste a megabyte on, gets its own
+    PixelBlockRef small = pool->acquire (4096);
+    CHECK (small->data() != first);
+    CHECK (pool->getStats().allocations == 2);
+}
+
+TEST_CASE ("Every holder gets its own block")
+{
+    auto pool = PixelBlockPool::create (64 * MB);
+
+    PixelBlockRef a = pool->acquire (MB);
+    PixelBlockRef b = pool->acquire (MB);
+    CHECK (a->data() != b->data());
+
+    std::memset (a->data(), 1, MB);
+    std::memset (b->data(), 2, MB);
+    CHECK (static_cast<uint8_t*> (a->data())[MB - 1] == 1);
+    CHECK (pool->getStats().bytesInUse == 2 * MB);
+}
+
+TEST_CASE ("Free blocks are evicted least recently used first")
+{
+    auto pool = PixelBlockPool::create (3 * MB);
+
+    PixelBlockRef a = pool->acquire (MB);
+    PixelBlockRef b = pool->acquire (MB);
+    PixelBlockRef c = pool->acquire (MB);
+    void* bData = b->data();
+    void* cData = c->data();
+
+    a.reset();
+    b.reset();
+    c.reset();
+    CHECK (pool->getStats().bytesFree == 3 * MB);
+
+    // needs room for a bigger block so the oldest free one (a) has to go
+    PixelBlockRef big = pool->acquire (2 * MB);
+    PixelBlockPool::Stats stats = pool->getStats();
+    CHECK (stats.evictions == 2);
+    CHECK (stats.blocksFree == 1);
+    CHECK (stats.bytesInUse + stats.bytesFree <= 3 * MB);
+
+    // c was released last so it's the one still cached
+    PixelBlockRef reused = pool->acquire (MB);
+    CHECK (reused->data() == cData);
+    CHECK (reused->data() != bData);
+}
+
+TEST_CASE ("Held blocks are never evicted and speculative acquires respect the budget")
+{
+    auto pool = PixelBlockPool::create (2 * MB);
+
+    PixelBlockRef a = pool->acquire (MB);
+    PixelBlockRef b = pool->acquire (MB);
+    std::memset (a->data(), 7, MB);
+
+    CHECK (pool->tryAcquire (MB) == nullptr);
+
+    // the foreground path still gets its block, over budget
+    PixelBlockRef c = pool->acquire (MB);
+    REQUIRE (c);
+    CHECK (pool->getStats().overBudget == 1);
+    CHECK (static_cast<uint8_t*> (a->data())[0] == 7);
+
+    // releasing brings it back under, the extra block isn't kept around
+    c.reset();
+    PixelBlockPool::Stats stats = pool->getStats();
+    CHECK (stats.bytesInUse + stats.bytesFree <= 2 * MB);
+
+    pool->setByteBudget (MB);
+    b.reset();
+    CHECK (pool->getStats().blocksFree == 0);
+}
+
+TEST_CASE ("Blocks keep the pool alive")
+{
+    PixelBlockRef block;
+    {
+        auto pool = PixelBlockPool::create (8 * MB);
+        block = pool->acquire (MB);
+    }
+    std::memset (block->data(), 3, MB);
+    block.reset();
+}
+
+TEST_CASE ("Concurrent callers")
+{
+    auto pool = PixelBlockPool::create (32 * MB);
+
+    std::vector<std::thread> threads;
+    std::atomic<int> failures = 0;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back ([&, t]()
+                              {
+                                  for (int i = 0; i < 200; ++i)
+                                  {
+                                      size_t bytes = (1 + (i + t) % 4) * 256 * 1024;
+                                      PixelBlockRef block = pool->acquire (bytes);
+                                      std::memset (block->data(), t, bytes);
+                                      std::this_thread::yield();
+                                      if (static_cast<uint8_t*> (block->data())[bytes - 1] != t) ++failures;
+                                  } });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    CHECK (failures == 0);
+    PixelBlockPool::Stats stats = pool->getStats();
+    CHECK (stats.blocksInUse == 0);
+    CHECK (stats.bytesFree <= 32 * MB);
+
+    pool->trim();
+    CHECK (pool->getStats().blocksFree == 0);
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
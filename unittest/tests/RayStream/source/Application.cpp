@@ -0,0 +1,177 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "RayStream";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using wabi::HitStreamf;
+using wabi::RayArena;
+using wabi::RayBundlef;
+using wabi::Ray3f;
+using wabi::RayStreamf;
+
+namespace test
+{
+    inline RayBundlef randomRays (size_t count, uint32_t seed)
+    {
+        std::mt19937 rng (seed);
+        std::uniform_real_distribution<float> dist (-10.0f, 10.0f);
+
+        RayBundlef rays;
+        for (size_t i = 0; i < count; ++i)
+        {
+            Ray3f& ray = rays.emplace_back (Eigen::Vector3f (dist (rng), dist (rng), dist (rng)),
+                                            Eigen::Vector3f (dist (rng), dist (rng), dist (rng)),
+                                            0.001f, 100.0f + i);
+            if (i % 3 == 0)
+            {
+                ray.wasHit = true;
+                ray.distToHit = 1.0f + i;
+                ray.hitBodyID = i / 3;
+                ray.hitPolyID = i * 7;
+                ray.bary1 = 0.25f;
+                ray.bary2 = 0.5f;
+            }
+        }
+        return rays;
+    }
+
+    inline bool isAligned (const void* p)
+    {
+        return reinterpret_cast<uintptr_t> (p) % RayArena::ALIGNMENT == 0;
+    }
+} // namespace test
+
+TEST_CASE ("The arena hands out aligned memory and reuses it after a reset")
+{
+    RayArena arena (4096);
+
+    void* a = arena.allocate (10);
+    void* b = arena.allocate (100);
+    CHECK (test::isAligned (a));
+    CHECK (test::isAligned (b));
+    CHECK (static_cast<std::byte*> (b) - static_cast<std::byte*> (a) == RayArena::ALIGNMENT);
+
+    // bigger than a chunk gets a chunk of its own
+    void* big = arena.allocate (10000);
+    CHECK (test::isAligned (big));
+    CHECK (arena.getCapacity() == 4096 + 10000 + 48);
+
+    arena.reset();
+    CHECK (arena.getBytesAllocated() == 0);
+    CHECK (arena.allocate (10) == a);
+    CHECK (arena.allocate (5000) == big);
+    CHECK (arena.getCapacity() == 4096 + 10000 + 48);
+
+    arena.release();
+    CHECK (arena.getCapacity() == 0);
+}
+
+TEST_CASE ("Stream arrays are aligned and don't overlap")
+{
+    RayArena arena;
+    RayStreamf rays (1001, arena);
+    HitStreamf hits (1001, arena);
+    CHECK (rays.getCapacity() == 1001);
+
+    const float* arrays[] = {rays.originX, rays.originY, rays.originZ, rays.dirX, rays.dirY, rays.dirZ, rays.tMin, rays.tMax, hits.t, hits.u, hits.v};
+    for (size_t i = 0; i < std::size (arrays); ++i)
+    {
+        CHECK (test::isAligned (arrays[i]));
+        if (i > 0 && i != 8) CHECK (arrays[i] - arrays[i - 1] >= 1001);
+    }
+    CHECK (test::isAligned (hits.bodyID));
+    CHECK (test::isAligned (hits.polyID));
+    CHECK (reinterpret_cast<const std::byte*> (hits.bodyID) >= reinterpret_cast<const std::byte*> (hits.v + 1001));
+    CHECK (hits.polyID - hits.bodyID >= 1001);
+
+    CHECK_THROWS (rays.resize (1002));
+    CHECK_THROWS (hits.resize (1002));
+}
+
+TEST_CASE ("RayBundle round trips through the streams")
+{
+    RayBundlef bundle = test::randomRays (257, 1);
+
+    RayStreamf rays (bundle.size());
+    HitStreamf hits (bundle.size());
+    wabi::toStreams (bundle, rays, &hits);
+    REQUIRE (rays.size() == bundle.size());
+    REQUIRE (hits.size() == bundle.size());
+
+    RayBundlef back;
+    wabi::toRayBundle (rays, &hits, back);
+    REQUIRE (back.size() == bundle.size());
+
+    for (size_t i = 0; i < bundle.size(); ++i)
+    {
+        const Ray3f& a = bundle[i];
+        const Ray3f& b = back[i];
+        CHECK (a.origin == b.origin);
+        CHECK (a.dir == b.dir);
+        CHECK (a.tMin == b.tMin);
+        CHECK (a.tMax == b.tMax);
+        CHECK (a.wasHit == b.wasHit);
+        CHECK (hits.wasHit (i) == a.wasHit);
+        if (a.wasHit)
+        {
+            CHECK (a.distToHit == b.distToHit);
+            CHECK (a.hitBodyID == b.hitBodyID);
+            CHECK (a.hitPolyID == b.hitPolyID);
+            CHECK (b.bary0 == 0.25f);
+            CHECK (b.hitPoint.isApprox (a.origin + a.dir * a.distToHit));
+        }
+        else
+        {
+            CHECK (b.hitBodyID == INVALID_ID);
+        }
+    }
+}
+
+TEST_CASE ("Columns work as Eigen arrays")
+{
+    RayBundlef bundle = test::randomRays (100, 2);
+
+    RayArena arena;
+    RayStreamf rays (bundle.size(), arena);
+    HitStreamf hits (bundle.size(), arena);
+    wabi::toStreams (bundle, rays, &hits);
+
+    // hit points for the whole stream a packet at a time
+    Eigen::ArrayXf t = hits.column (hits.t);
+    Eigen::ArrayXf hitX = rays.column (rays.originX) + rays.column (rays.dirX) * t;
+    for (size_t i = 0; i < bundle.size(); i += 3)
+        CHECK (hitX[i] == doctest::Approx (bundle[i] (bundle[i].distToHit).x()));
+
+    // clip every ray to half its length
+    rays.column (rays.tMax) *= 0.5f;
+    CHECK (rays.tMax[10] == 0.5f * bundle[10].tMax);
+
+    // the same arena serves the next batch from the same memory
+    const float* first = rays.originX;
+    arena.reset();
+    RayStreamf next (bundle.size(), arena);
+    CHECK (next.originX == first);
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
@@ -0,0 +1,134 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "SlotMap";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using mace::SlotHandle;
+using mace::SlotMap;
+
+TEST_CASE ("Handles stay valid while others are erased")
+{
+    SlotMap<int> map;
+    SlotHandle a = map.insert (10);
+    SlotHandle b = map.insert (20);
+    SlotHandle c = map.insert (30);
+    SlotHandle d = map.insert (40);
+    CHECK (map.size() == 4);
+    CHECK (map.indexOf (c) == 2);
+
+    // the last one fills the hole, nothing else moves
+    CHECK (map.erase (b) == 1);
+    CHECK (map.size() == 3);
+    CHECK (map.at (1) == 40);
+    CHECK (map.indexOf (d) == 1);
+    CHECK (map.handleAt (1) == d);
+    CHECK (map.indexOf (a) == 0);
+    CHECK (map.indexOf (c) == 2);
+    CHECK (map[c] == 30);
+
+    // erasing the last one moves nothing
+    CHECK (map.erase (c) == SlotMap<int>::npos);
+    CHECK (map.size() == 2);
+
+    // old handles go stale even when their slot is reused
+    CHECK (!map.contains (b));
+    CHECK_THROWS (map.erase (b));
+    CHECK_THROWS (map[c]);
+    SlotHandle e = map.insert (50);
+    CHECK (e.index == c.index);
+    CHECK (e != c);
+    CHECK (!map.contains (c));
+    CHECK (map[e] == 50);
+    CHECK (map.indexOf (e) == 2);
+
+    CHECK (!map.contains (SlotHandle()));
+
+    map.clear();
+    CHECK (map.empty());
+    CHECK (!map.contains (a));
+    CHECK (!map.contains (e));
+}
+
+TEST_CASE ("A mirrored array stays in step with single fix ups")
+{
+    // stands in for the IAS children, only ever erased at the end
+    const uint32_t count = 5000;
+    SlotMap<uint32_t> map;
+    std::vector<uint32_t> mirror;
+    std::vector<SlotHandle> handles;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        handles.push_back (map.insert (i));
+        mirror.push_back (i);
+    }
+
+    std::mt19937 rng (1);
+    std::shuffle (handles.begin(), handles.end(), rng);
+
+    // remove half, then put some back, then clear the rest
+    auto removeOne = [&] (SlotHandle handle)
+    {
+        uint32_t moved = map.erase (handle);
+        if (moved != SlotMap<uint32_t>::npos)
+            mirror[moved] = mirror.back();
+        mirror.pop_back();
+    };
+
+    for (uint32_t i = 0; i < count / 2; ++i)
+        removeOne (handles[i]);
+    handles.erase (handles.begin(), handles.begin() + count / 2);
+
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        handles.push_back (map.insert (count + i));
+        mirror.push_back (count + i);
+    }
+
+    REQUIRE (map.size() == mirror.size());
+    for (uint32_t i = 0; i < map.size(); ++i)
+        CHECK (map.at (i) == mirror[i]);
+    for (SlotHandle handle : handles)
+        CHECK (mirror[map.indexOf (handle)] == map[handle]);
+
+    for (SlotHandle handle : handles)
+        removeOne (handle);
+    CHECK (map.empty());
+    CHECK (mirror.empty());
+}
+
+TEST_CASE ("Values are moved not copied")
+{
+    SlotMap<std::unique_ptr<int>> map;
+    SlotHandle a = map.insert (std::make_unique<int> (1));
+    SlotHandle b = map.insert (std::make_unique<int> (2));
+    map.erase (a);
+    CHECK (*map[b] == 2);
+
+    int sum = 0;
+    for (const auto& value : map)
+        sum += *value;
+    CHECK (sum == 2);
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
@@ -0,0 +1,174 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "TaskScheduler";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using mace::TaskScheduler;
+using mace::TaskSchedulerSettings;
+
+namespace test
+{
+    inline TaskSchedulerSettings settings (uint32_t threadCount)
+    {
+        TaskSchedulerSettings s;
+        s.threadCount = threadCount;
+        return s;
+    }
+
+    // every index in [begin, end) seen exactly once and nothing outside it
+    inline bool coversOnce (TaskScheduler& scheduler, uint32_t begin, uint32_t end, uint32_t grainSize)
+    {
+        std::vector<std::atomic<uint32_t>> visits (end + 8);
+        scheduler.parallel_for (begin, end, grainSize, [&] (uint32_t start, uint32_t stop)
+                                {
+                                    for (uint32_t i = start; i < stop; ++i)
+                                        visits[i].fetch_add (1, std::memory_order_relaxed);
+                                });
+
+        for (uint32_t i = 0; i < visits.size(); ++i)
+        {
+            uint32_t expected = i >= begin && i < end ? 1 : 0;
+            if (visits[i].load() != expected) return false;
+        }
+        return true;
+    }
+} // namespace test
+
+TEST_CASE ("parallel_for covers every index once")
+{
+    TaskScheduler scheduler (test::settings (4));
+    CHECK (scheduler.getThreadCount() == 4);
+
+    CHECK (test::coversOnce (scheduler, 0, 1000, 0));
+    CHECK (test::coversOnce (scheduler, 0, 1000, 1));
+    CHECK (test::coversOnce (scheduler, 0, 1000, 7));   // last chunk is short
+    CHECK (test::coversOnce (scheduler, 13, 14, 0));    // one index, runs inline
+    CHECK (test::coversOnce (scheduler, 5, 5, 0));      // empty
+    CHECK (test::coversOnce (scheduler, 3, 100000, 0)); // many chunks per worker
+    CHECK (test::coversOnce (scheduler, 0, 64, 1000));  // grain bigger than the range
+
+    // nested from inside the tasks
+    std::vector<std::atomic<uint32_t>> visits (64 * 64);
+    scheduler.parallel_for (0, 64, 1, [&] (uint32_t start, uint32_t stop)
+                            {
+                                for (uint32_t row = start; row < stop; ++row)
+                                    scheduler.parallel_for (0, 64, 4, [&] (uint32_t s, uint32_t e)
+                                                            {
+                                                                for (uint32_t column = s; column < e; ++column)
+                                                                    visits[row * 64 + column].fetch_add (1);
+                                                            });
+                            });
+    CHECK (std::all_of (visits.begin(), visits.end(), [] (const std::atomic<uint32_t>& n)
+                        { return n.load() == 1; }));
+}
+
+TEST_CASE ("Idle workers steal what a busy one queued")
+{
+    TaskScheduler scheduler (test::settings (4));
+
+    const uint32_t taskCount = 8;
+    std::atomic<uint32_t> finished = 0;
+    std::mutex idMutex;
+    std::set<std::thread::id> runners;
+    std::thread::id owner;
+    bool allFinished = false;
+
+    std::future<void> busy = scheduler.async ([&]()
+                                              {
+        owner = std::this_thread::get_id();
+
+        // these go on this worker's own queue
+        for (uint32_t i = 0; i < taskCount; ++i)
+        {
+            scheduler.submit ([&]()
+                              {
+                {
+                    std::lock_guard<std::mutex> lock (idMutex);
+                    runners.insert (std::this_thread::get_id());
+                }
+                finished.fetch_add (1); });
+        }
+
+        // never helps, so they only get done if someone else takes them
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds (10);
+        while (finished.load() < taskCount && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for (std::chrono::milliseconds (1));
+        allFinished = finished.load() == taskCount; });
+
+    busy.get();
+    CHECK (allFinished);
+    CHECK (runners.size() >= 1);
+    CHECK (runners.count (owner) == 0);
+}
+
+TEST_CASE ("The first exception from a parallel_for body reaches the caller")
+{
+    TaskScheduler scheduler (test::settings (4));
+
+    std::atomic<uint32_t> chunksRun = 0;
+    CHECK_THROWS_AS (scheduler.parallel_for (0, 100, 1, [&] (uint32_t start, uint32_t)
+                                             {
+                                                 chunksRun.fetch_add (1);
+                                                 if (start == 37) throw std::runtime_error ("chunk 37");
+                                             }),
+                     std::runtime_error);
+
+    // the others still ran, the caller only returns once every chunk is done
+    CHECK (chunksRun.load() == 100);
+
+    // thrown from the chunk the caller runs itself
+    CHECK_THROWS_AS (scheduler.parallel_for (0, 10, 1, [] (uint32_t start, uint32_t)
+                                             {
+                                                 if (start == 0) throw std::out_of_range ("chunk 0");
+                                             }),
+                     std::out_of_range);
+
+    // still usable afterwards
+    CHECK (test::coversOnce (scheduler, 0, 500, 3));
+}
+
+TEST_CASE ("waitUntil returns from a thread the scheduler doesn't own")
+{
+    TaskScheduler scheduler (test::settings (2));
+
+    // long enough that the caller runs out of tasks to help with and has to sleep
+    std::atomic<uint32_t> finished = 0;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        scheduler.submit ([&]()
+                          {
+            std::this_thread::sleep_for (std::chrono::milliseconds (20));
+            finished.fetch_add (1); });
+    }
+
+    scheduler.waitUntil ([&]()
+                         { return finished.load() == 4; });
+    CHECK (finished.load() == 4);
+
+    std::future<int> answer = scheduler.async ([]()
+                                               { return 42; });
+    CHECK (answer.get() == 42);
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
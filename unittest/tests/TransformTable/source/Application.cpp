@@ -0,0 +1,179 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "TransformTable";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using wabi::INVALID_TRANSFORM;
+using wabi::TransformHandle;
+using wabi::TransformTable;
+
+namespace test
+{
+    inline Pose randomPose (std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> position (-8.0f, 8.0f);
+        std::uniform_real_distribution<float> angle (0.0f, 6.28f);
+
+        Pose pose = Pose::Identity();
+        pose.translate (Eigen::Vector3f (position (rng), position (rng), position (rng)));
+        pose.rotate (Eigen::AngleAxisf (angle (rng), Eigen::Vector3f (position (rng), position (rng), position (rng)).normalized()));
+        return pose;
+    }
+
+    inline std::vector<TransformHandle> dirtyHandles (const TransformTable& table)
+    {
+        std::vector<TransformHandle> handles;
+        table.forEachDirty ([&] (TransformHandle handle)
+                            { handles.push_back (handle); });
+        return handles;
+    }
+} // namespace test
+
+TEST_CASE ("Transforms are stored the way the IAS reads them")
+{
+    std::mt19937 rng (1);
+    Pose pose = test::randomPose (rng);
+
+    TransformTable table;
+    TransformHandle handle = table.allocate (pose);
+
+    // OptixInstance::transform, 3 rows of 4
+    const float* t = table.data (handle);
+    for (int row = 0; row < 3; ++row)
+        for (int col = 0; col < 4; ++col)
+            CHECK (t[row * 4 + col] == pose.matrix() (row, col));
+
+    CHECK (table.getPose (handle).matrix().isApprox (pose.matrix()));
+
+    // back to back, one upload for the whole table
+    TransformHandle next = table.allocate (Pose::Identity());
+    CHECK (table.data (next) == table.data() + next * 12);
+}
+
+TEST_CASE ("Released slots are reused")
+{
+    TransformTable table;
+    TransformHandle a = table.allocate (Pose::Identity());
+    TransformHandle b = table.allocate (Pose::Identity());
+    TransformHandle c = table.allocate (Pose::Identity());
+    CHECK (a == 0);
+    CHECK (b == 1);
+    CHECK (c == 2);
+    CHECK (table.getLiveCount() == 3);
+
+    table.release (b);
+    CHECK (!table.isLive (b));
+    CHECK (!table.isDirty (b));
+    CHECK (table.getLiveCount() == 2);
+    CHECK (table.size() == 3);
+    CHECK_THROWS (table.release (b));
+    CHECK_THROWS (table.release (INVALID_TRANSFORM));
+    CHECK (!table.isLive (INVALID_TRANSFORM));
+
+    CHECK (table.allocate (Pose::Identity()) == b);
+    CHECK (table.allocate (Pose::Identity()) == 3);
+    CHECK (table.getLiveCount() == 4);
+
+    table.clear();
+    CHECK (table.size() == 0);
+    CHECK (table.getLiveCount() == 0);
+    CHECK (table.getDirtyCount() == 0);
+}
+
+TEST_CASE ("Only transforms that changed are dirty")
+{
+    TransformTable table;
+    std::vector<TransformHandle> handles;
+    for (uint32_t i = 0; i < 200; ++i)
+        handles.push_back (table.allocate (Pose::Identity()));
+
+    // new slots are dirty until the first update
+    CHECK (table.getDirtyCount() == 200);
+    table.clearDirty();
+    CHECK (table.getDirtyCount() == 0);
+    CHECK (test::dirtyHandles (table).empty());
+
+    // writing the same pose is free, a sleeping body
+    for (TransformHandle handle : handles)
+        CHECK (!table.set (handle, Pose::Identity()));
+    CHECK (table.getDirtyCount() == 0);
+
+    // across word boundaries, visited in handle order
+    Pose moved (Eigen::Translation3f (0.0f, 1.0f, 0.0f));
+    for (TransformHandle handle : {130u, 3u, 64u, 63u, 199u})
+        CHECK (table.set (handle, moved));
+    CHECK (!table.set (64, moved));
+    CHECK (table.getDirtyCount() == 5);
+    CHECK (test::dirtyHandles (table) == std::vector<TransformHandle>{3, 63, 64, 130, 199});
+    CHECK (table.getPose (130).translation().y() == 1.0f);
+
+    table.clearDirty();
+    table.markDirty (7);
+    table.markDirty (7);
+    CHECK (table.getDirtyCount() == 1);
+
+    table.markAllDirty();
+    CHECK (table.getDirtyCount() == 200);
+
+    // released slots drop out of the dirty set
+    table.release (64);
+    CHECK (table.getDirtyCount() == 199);
+    table.markAllDirty();
+    CHECK (table.getDirtyCount() == 199);
+    CHECK (!table.isDirty (64));
+}
+
+TEST_CASE ("A physics step over ten thousand instances")
+{
+    const uint32_t count = 10000;
+
+    std::mt19937 rng (2);
+    std::vector<Pose> poses;
+    TransformTable table;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        poses.push_back (test::randomPose (rng));
+        CHECK (table.allocate (poses.back()) == i);
+    }
+    table.clearDirty();
+
+    // one in ten bodies awake
+    std::vector<TransformHandle> awake;
+    for (uint32_t i = 0; i < count; i += 10)
+    {
+        poses[i] = test::randomPose (rng);
+        table.set (i, poses[i]);
+        awake.push_back (i);
+    }
+    for (uint32_t i = 1; i < count; i += 10)
+        table.set (i, poses[i]);
+
+    CHECK (table.getDirtyCount() == awake.size());
+    CHECK (test::dirtyHandles (table) == awake);
+
+    for (uint32_t i = 0; i < count; ++i)
+        CHECK (table.getPose (i).matrix().isApprox (poses[i].matrix()));
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
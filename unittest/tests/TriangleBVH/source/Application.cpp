@@ -0,0 +1,299 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "TriangleBVH";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using wabi::HitStreamf;
+using wabi::Ray3f;
+using wabi::RayStreamf;
+using wabi::TriangleBVH;
+using wabi::TriangleBVHSettings;
+
+namespace test
+{
+    struct Mesh
+    {
+        MatrixXf V;
+        MatrixXu F;
+    };
+
+    // small random triangles scattered through a box, lots of overlap
+    inline Mesh triangleSoup (uint32_t count, uint32_t seed)
+    {
+        std::mt19937 rng (seed);
+        std::uniform_real_distribution<float> position (-10.0f, 10.0f);
+        std::uniform_real_distribution<float> offset (-1.0f, 1.0f);
+
+        Mesh mesh;
+        mesh.V.resize (3, count * 3);
+        mesh.F.resize (3, count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            Eigen::Vector3f center (position (rng), position (rng), position (rng));
+            for (uint32_t corner = 0; corner < 3; ++corner)
+            {
+                mesh.V.col (i * 3 + corner) = center + Eigen::Vector3f (offset (rng), offset (rng), offset (rng));
+                mesh.F (corner, i) = i * 3 + corner;
+            }
+        }
+        return mesh;
+    }
+
+    inline std::vector<Ray3f> randomRays (uint32_t count, uint32_t seed)
+    {
+        std::mt19937 rng (seed);
+        std::uniform_real_distribution<float> position (-15.0f, 15.0f);
+        std::uniform_real_distribution<float> direction (-1.0f, 1.0f);
+
+        std::vector<Ray3f> rays;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            Eigen::Vector3f origin (position (rng), position (rng), position (rng));
+            Eigen::Vector3f dir (direction (rng), direction (rng), direction (rng));
+            if (i % 10 == 0) dir = Eigen::Vector3f (0.0f, 0.0f, 1.0f); // axis aligned
+            rays.emplace_back (origin, dir, 0.0f, i % 4 == 0 ? 8.0f : std::numeric_limits<float>::max());
+        }
+        return rays;
+    }
+
+    // every triangle, no acceleration, same arithmetic as the BVH so edge cases agree
+    inline bool bruteForce (const Mesh& mesh, const Ray3f& ray, float& tHit, int64_t& polyID)
+    {
+        tHit = ray.tMax;
+        polyID = INVALID_ID;
+        for (int f = 0; f < mesh.F.cols(); ++f)
+        {
+            Eigen::Vector3f v0 = mesh.V.col (mesh.F (0, f));
+            Eigen::Vector3f e1 = mesh.V.col (mesh.F (1, f)) - v0;
+            Eigen::Vector3f e2 = mesh.V.col (mesh.F (2, f)) - v0;
+
+            Eigen::Vector3f p = ray.dir.cross (e2);
+            float det = e1.dot (p);
+            if (std::abs (det) < 1e-30f) continue;
+            float invDet = 1.0f / det;
+            Eigen::Vector3f s = ray.origin - v0;
+            float u = s.dot (p) * invDet;
+            Eigen::Vector3f q = s.cross (e1);
+            float v = ray.dir.dot (q) * invDet;
+            float t = e2.dot (q) * invDet;
+            if (u < 0.0f || v < 0.0f || u + v > 1.0f || t < ray.tMin || t >= tHit) continue;
+            tHit = t;
+            polyID = f;
+        }
+        return polyID != INVALID_ID;
+    }
+
+    // the hit fields describe a point that really is on the triangle
+    inline bool isConsistent (const Mesh& mesh, const Ray3f& ray)
+    {
+        Eigen::Vector3f v0 = mesh.V.col (mesh.F (0, ray.hitPolyID));
+        Eigen::Vector3f v1 = mesh.V.col (mesh.F (1, ray.hitPolyID));
+        Eigen::Vector3f v2 = mesh.V.col (mesh.F (2, ray.hitPolyID));
+        Eigen::Vector3f fromBarys = ray.bary0 * v0 + ray.bary1 * v1 + ray.bary2 * v2;
+
+        return ray.bary0 >= -1e-5f && ray.bary1 >= 0.0f && ray.bary2 >= 0.0f &&
+               ray.distToHit >= ray.tMin && ray.distToHit < ray.tMax &&
+               (fromBarys - ray.hitPoint).norm() < 1e-3f &&
+               (ray.origin + ray.dir * ray.distToHit - ray.hitPoint).norm() < 1e-4f;
+    }
+} // namespace test
+
+TEST_CASE ("Closest hits match brute force")
+{
+    test::Mesh mesh = test::triangleSoup (5000, 1);
+    std::vector<Ray3f> rays = test::randomRays (2000, 2);
+
+    for (bool parallel : {true, false})
+    {
+        TriangleBVHSettings settings;
+        settings.parallel = parallel;
+
+        TriangleBVH bvh;
+        bvh.setBodyID (42);
+        bvh.build (mesh.V, mesh.F, settings);
+        REQUIRE (bvh.getTriangleCount() == 5000);
+
+        uint32_t hits = 0;
+        for (Ray3f ray : rays)
+        {
+            float expectedT;
+            int64_t expectedPoly;
+            bool expected = test::bruteForce (mesh, ray, expectedT, expectedPoly);
+
+            bool hit = bvh.intersect (ray);
+            REQUIRE (hit == expected);
+            if (!hit)
+            {
+                CHECK (!ray.wasHit);
+                continue;
+            }
+
+            ++hits;
+            CHECK (ray.wasHit);
+            CHECK (ray.hitBodyID == 42);
+            CHECK (ray.distToHit == doctest::Approx (expectedT));
+            if (ray.hitPolyID != expectedPoly)
+                CHECK (ray.distToHit == doctest::Approx (expectedT).epsilon (1e-6)); // a tie
+            CHECK (test::isConsistent (mesh, ray));
+        }
+
+        // the soup is dense enough that most rays hit something
+        CHECK (hits > 500);
+    }
+}
+
+TEST_CASE ("Any hit finds a hit exactly when there is one")
+{
+    test::Mesh mesh = test::triangleSoup (3000, 3);
+    std::vector<Ray3f> rays = test::randomRays (1000, 4);
+
+    TriangleBVH bvh;
+    bvh.build (mesh.V, mesh.F);
+
+    for (Ray3f ray : rays)
+    {
+        float expectedT;
+        int64_t expectedPoly;
+        bool expected = test::bruteForce (mesh, ray, expectedT, expectedPoly);
+
+        REQUIRE (bvh.intersectAny (ray) == expected);
+        if (expected)
+        {
+            CHECK (ray.distToHit >= expectedT);
+            CHECK (test::isConsistent (mesh, ray));
+        }
+    }
+}
+
+TEST_CASE ("Streams give the same hits as single rays")
+{
+    test::Mesh mesh = test::triangleSoup (4000, 5);
+    std::vector<Ray3f> rays = test::randomRays (3000, 6);
+
+    TriangleBVH bvh;
+    bvh.setBodyID (7);
+    bvh.build (mesh.V, mesh.F);
+
+    RayStreamf stream (rays.size());
+    wabi::toStreams (rays, stream);
+
+    HitStreamf closest (rays.size());
+    HitStreamf any (rays.size());
+    bvh.intersect (stream, closest);
+    bvh.intersectAny (stream, any);
+    REQUIRE (closest.size() == rays.size());
+
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        Ray3f ray = rays[i];
+        bool hit = bvh.intersect (ray);
+        REQUIRE (closest.wasHit (i) == hit);
+        CHECK (any.wasHit (i) == hit);
+        if (!hit) continue;
+
+        CHECK (closest.t[i] == ray.distToHit);
+        CHECK (closest.polyID[i] == ray.hitPolyID);
+        CHECK (closest.bodyID[i] == 7);
+        CHECK (closest.u[i] == ray.bary1);
+        CHECK (closest.v[i] == ray.bary2);
+        CHECK (any.t[i] >= closest.t[i]);
+    }
+}
+
+TEST_CASE ("Hit fields for a known triangle")
+{
+    test::Mesh mesh;
+    mesh.V.resize (3, 3);
+    mesh.V.col (0) = Eigen::Vector3f (0.0f, 0.0f, 5.0f);
+    mesh.V.col (1) = Eigen::Vector3f (4.0f, 0.0f, 5.0f);
+    mesh.V.col (2) = Eigen::Vector3f (0.0f, 4.0f, 5.0f);
+    mesh.F.resize (3, 1);
+    mesh.F.col (0) = Vector3u (0, 1, 2);
+
+    TriangleBVH bvh;
+    bvh.setBodyID (3);
+    bvh.build (mesh.V, mesh.F);
+
+    Ray3f ray (Eigen::Vector3f (1.0f, 2.0f, 0.0f), Eigen::Vector3f (0.0f, 0.0f, 1.0f));
+    REQUIRE (bvh.intersect (ray));
+    CHECK (ray.distToHit == doctest::Approx (5.0f));
+    CHECK (ray.hitPolyID == 0);
+    CHECK (ray.hitBodyID == 3);
+    CHECK (ray.bary1 == doctest::Approx (0.25f));
+    CHECK (ray.bary2 == doctest::Approx (0.5f));
+    CHECK (ray.bary0 == doctest::Approx (0.25f));
+    CHECK (ray.hitPoint.isApprox (Eigen::Vector3f (1.0f, 2.0f, 5.0f)));
+    CHECK (ray.surfaceNormal.isApprox (Eigen::Vector3f (0.0f, 0.0f, 1.0f)));
+
+    // too short to reach it, or pointing away
+    Ray3f shortRay (Eigen::Vector3f (1.0f, 2.0f, 0.0f), Eigen::Vector3f (0.0f, 0.0f, 1.0f), 0.0f, 4.0f);
+    CHECK (!bvh.intersect (shortRay));
+    Ray3f away (Eigen::Vector3f (1.0f, 2.0f, 0.0f), Eigen::Vector3f (0.0f, 0.0f, -1.0f));
+    CHECK (!bvh.intersect (away));
+}
+
+TEST_CASE ("Tree structure")
+{
+    test::Mesh mesh = test::triangleSoup (20000, 7);
+
+    TriangleBVH bvh;
+    bvh.build (mesh.V, mesh.F);
+
+    const std::vector<TriangleBVH::Node>& nodes = bvh.getNodes();
+    const TriangleBVH::Stats& stats = bvh.getStats();
+    CHECK (stats.nodeCount == nodes.size());
+    CHECK (stats.leafCount * 2 - 1 == stats.nodeCount);
+    CHECK (stats.maxDepth < TriangleBVH::MAX_DEPTH);
+    CHECK (stats.sahCost > 0.0f);
+
+    // children sit inside their parent and every triangle is in exactly one leaf
+    std::vector<uint32_t> covered (bvh.getTriangleCount(), 0);
+    for (const TriangleBVH::Node& node : nodes)
+    {
+        if (node.isLeaf())
+        {
+            for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.triangleCount; ++i)
+                ++covered[i];
+            continue;
+        }
+        for (uint32_t child = node.leftOrFirst; child < node.leftOrFirst + 2; ++child)
+        {
+            CHECK ((nodes[child].boundsMin.array() >= node.boundsMin.array()).all());
+            CHECK ((nodes[child].boundsMax.array() <= node.boundsMax.array()).all());
+        }
+    }
+    CHECK (std::all_of (covered.begin(), covered.end(), [] (uint32_t c) { return c == 1; }));
+
+    // and nothing to hit in an empty mesh
+    TriangleBVH empty;
+    empty.build (MatrixXf (3, 0), MatrixXu (3, 0));
+    Ray3f ray (Eigen::Vector3f::Zero(), Eigen::Vector3f::UnitZ());
+    CHECK (empty.isEmpty());
+    CHECK (!empty.intersect (ray));
+
+    mesh.F (1, 10) = static_cast<uint32_t> (mesh.V.cols());
+    CHECK_THROWS (bvh.build (mesh.V, mesh.F));
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
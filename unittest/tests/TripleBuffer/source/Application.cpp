@@ -0,0 +1,115 @@
+#include "Jahley.h"
+
+const std::string APP_NAME = "TripleBuffer";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+using mace::TripleBuffer;
+
+// what a physics step publishes, every value is the step number
+struct Snapshot
+{
+    uint64_t step = 0;
+    std::vector<uint64_t> poses;
+};
+
+TEST_CASE ("The reader gets the latest published buffer")
+{
+    TripleBuffer<int> buffer;
+    CHECK (!buffer.hasUpdate());
+    CHECK (!buffer.acquire());
+
+    buffer.back() = 1;
+    buffer.publish();
+    CHECK (buffer.hasUpdate());
+    REQUIRE (buffer.acquire());
+    CHECK (buffer.front() == 1);
+
+    // nothing new, front stays put
+    CHECK (!buffer.acquire());
+    CHECK (buffer.front() == 1);
+
+    // the reader skips what it missed
+    buffer.back() = 2;
+    buffer.publish();
+    buffer.back() = 3;
+    buffer.publish();
+    REQUIRE (buffer.acquire());
+    CHECK (buffer.front() == 3);
+    CHECK (buffer.getPublishCount() == 3);
+
+    // the writer never gets the buffer the reader holds
+    for (int i = 4; i < 20; ++i)
+    {
+        CHECK (&buffer.back() != &buffer.front());
+        buffer.back() = i;
+        buffer.publish();
+        CHECK (buffer.front() == 3);
+    }
+    REQUIRE (buffer.acquire());
+    CHECK (buffer.front() == 19);
+}
+
+TEST_CASE ("A reader on another thread never sees a torn buffer")
+{
+    const uint64_t steps = 200000;
+    const size_t bodies = 64;
+
+    TripleBuffer<Snapshot> buffer;
+    for (uint32_t i = 0; i < 3; ++i)
+        buffer[i].poses.resize (bodies, 0);
+
+    std::thread writer ([&]()
+                        {
+        for (uint64_t step = 1; step <= steps; ++step)
+        {
+            Snapshot& snapshot = buffer.back();
+            snapshot.step = step;
+            std::fill (snapshot.poses.begin(), snapshot.poses.end(), step);
+            buffer.publish();
+        } });
+
+    uint64_t last = 0;
+    uint64_t acquired = 0;
+    uint64_t torn = 0;
+    uint64_t backwards = 0;
+    while (last < steps)
+    {
+        if (!buffer.acquire()) continue;
+
+        const Snapshot& snapshot = buffer.front();
+        ++acquired;
+        if (snapshot.step <= last) ++backwards;
+        for (uint64_t pose : snapshot.poses)
+            torn += pose != snapshot.step;
+        last = snapshot.step;
+    }
+    writer.join();
+
+    CHECK (torn == 0);
+    CHECK (backwards == 0);
+    CHECK (acquired > 0);
+    CHECK (last == steps);
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}